@@ -36,6 +36,15 @@ void timePrint (char * msg)
 	gettimeofday (&start, 0);
 }
 
+void memoryPrint (char * msg, KeySet * ks)
+{
+	ElektraMemoryUsage usage;
+	ksMemoryUsage (ks, &usage);
+
+	fprintf (stdout, "%20s: %20zu Bytes (keys %zu, names %zu, values %zu, meta %zu, index %zu, slack %zu)\n", msg, usage.total,
+		 usage.keys, usage.names, usage.values, usage.meta, usage.index, usage.slack);
+}
+
 void benchmarkCreate (void)
 {
 	large = ksNew (num_key * num_dir, KS_END);
@@ -34,6 +34,7 @@
 
 void timeInit (void);
 void timePrint (char * msg);
+void memoryPrint (char * msg, KeySet * ks);
 
 void benchmarkCreate (void);
 void benchmarkFillup (void);
@@ -51,6 +51,9 @@ int main (int argc, char ** argv)
 	benchmarkIterate ();
 	timePrint ("Iterated over keyset");
 
+	memoryPrint ("Memory of keyset", large);
+	timeInit ();
+
 	benchmarkDel ();
 	timePrint ("Del large keyset");
 }
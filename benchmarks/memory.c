@@ -0,0 +1,53 @@
+/**
+ * @file
+ *
+ * @brief Benchmark for the memory used by copies of a keyset with metadata.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <benchmarks.h>
+
+static void benchmarkSpec (void)
+{
+	Key * cur;
+	ksRewind (large);
+	while ((cur = ksNext (large)))
+	{
+		keySetMeta (cur, "type", "string");
+		keySetMeta (cur, "description", "a key of the benchmark");
+		keySetMeta (cur, "default", "data");
+	}
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc == 3)
+	{
+		num_dir = atoi (argv[1]);
+		num_key = atoi (argv[2]);
+	}
+	printf ("Using %d dirs %d keys\n", num_dir, num_key);
+
+	benchmarkCreate ();
+	benchmarkFillup ();
+	memoryPrint ("Keys", large);
+
+	benchmarkSpec ();
+	memoryPrint ("Keys with metadata", large);
+
+	KeySet * dup = ksDup (large);
+	memoryPrint ("ksDup", dup);
+	ksDel (dup);
+
+	KeySet * deepDup = ksDeepDup (large);
+	memoryPrint ("ksDeepDup", deepDup);
+
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	elektraInternPoolAdd (pool, deepDup);
+	elektraInternPoolDel (pool);
+	memoryPrint ("Interned ksDeepDup", deepDup);
+	ksDel (deepDup);
+
+	ksDel (large);
+}
@@ -1262,6 +1262,15 @@ static size_t benchmarkSearchTimeMeasure (KeySet * ks, size_t searches, int32_t
 			}
 		}
 	}
+	if (option & KDB_O_HASHINDEX)
+	{
+		// trigger hash index build if not build
+		(void) ksLookup (ks, ks->array[0], KDB_O_HASHINDEX | KDB_O_NOCASCADING);
+		if (!elektraHashIndexIsBuild (ks->hashIndex))
+		{
+			printExit ("trigger hash index build");
+		}
+	}
 	for (size_t repeatsI = 0; repeatsI < numberOfRepeats; ++repeatsI)
 	{
 		// sanity checks
@@ -1528,6 +1537,249 @@ static void benchmarkBinarySearchTime (char * name)
  * END =================================================== Binary search Time ========================================================== END
  */
 
+/**
+ * START ================================================= Hash index search Time ==================================================== START
+ *
+ * This benchmark measures the time of the lookups using the hash index of the KeySet.
+ * Same procedure and output format as the OPMPHM and binary search time benchmarks.
+ *
+ * The number of needed seeds for this benchmarks is: (numberOfShapes - 1) * nCount * ksPerN * (1  + searchesCount )
+ */
+
+static void benchmarkHashIndexSearchTime (char * name)
+{
+	benchmarkSearchTime (name, "benchmark_hashindex_search_time", KDB_O_HASHINDEX | KDB_O_NOCASCADING);
+}
+
+/**
+ * END =================================================== Hash index search Time ====================================================== END
+ */
+
+/**
+ * START ================================================ Interleaved Changes Time =================================================== START
+ *
+ * This benchmark measures lookups interleaved with changes of the KeySet, like plugins building a KeySet do.
+ * Every change pops a random Key and appends it again, followed by searchesPerChange lookups of random Keys.
+ * The OPMPHM is discarded with every change and rebuild by the next lookup, the hash index is updated.
+ * Uses all KeySet shapes except 6, for one n (KeySet size) ksPerN KeySets are used.
+ * Each measurement done with one KeySet is repeated numberOfRepeats time and summarized with the median.
+ * For one n (KeySet size) the ksPerN results are also summarized with the median.
+ * The results are written out in the following format:
+ *
+ * n;binary;opmphm;hashindex
+ *
+ * The number of needed seeds for this benchmarks is: (numberOfShapes - 1) * nCount * (ksPerN + 1)
+ */
+
+/**
+ * @brief Measures the interleaved changes and lookups numberOfRepeats time and returns median
+ *
+ * @param ks the KeySet
+ * @param changes the number of changes to make
+ * @param searchesPerChange the number of lookups after each change
+ * @param searchSeed the random seed used to determine the Keys to change and search
+ * @param option the options passed to the ksLookup (...)
+ * @param repeats array to store repeated measurements
+ * @param numberOfRepeats fields in repeats
+ *
+ * @retval median time
+ */
+static size_t benchmarkInterleavedTimeMeasure (KeySet * ks, size_t changes, size_t searchesPerChange, int32_t searchSeed,
+					       option_t option, size_t * repeats, size_t numberOfRepeats)
+{
+	for (size_t repeatsI = 0; repeatsI < numberOfRepeats; ++repeatsI)
+	{
+		// preparation for measurement
+		struct timeval start;
+		struct timeval end;
+		int32_t actualSearchSeed = searchSeed;
+		// set seed to return by elektraRandGetInitSeed () in the lookup
+		elektraRandBenchmarkInitSeed = searchSeed;
+
+		// START MEASUREMENT
+		__asm__("");
+		gettimeofday (&start, 0);
+		__asm__("");
+
+		for (size_t c = 0; c < changes; ++c)
+		{
+			Key * changed = ksLookup (ks, ks->array[actualSearchSeed % ks->size], option | KDB_O_POP);
+			if (!changed)
+			{
+				printExit ("Sanity Check Failed: could not pop Key");
+			}
+			ksAppendKey (ks, changed);
+			elektraRand (&actualSearchSeed);
+
+			for (size_t s = 0; s < searchesPerChange; ++s)
+			{
+				Key * keyFound = ksLookup (ks, ks->array[actualSearchSeed % ks->size], option);
+				if (!keyFound || keyFound != ks->array[actualSearchSeed % ks->size])
+				{
+					printExit ("Sanity Check Failed: found wrong Key");
+				}
+				elektraRand (&actualSearchSeed);
+			}
+		}
+
+		__asm__("");
+		gettimeofday (&end, 0);
+		__asm__("");
+		// END MEASUREMENT
+
+		// save result
+		repeats[repeatsI] = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+	}
+	// sort repeats
+	qsort (repeats, numberOfRepeats, sizeof (size_t), cmpInteger);
+	return repeats[numberOfRepeats / 2]; // take median
+}
+
+static void benchmarkInterleavedTime (char * name)
+{
+	const size_t startN = 50;
+	const size_t stepN = 500;
+	const size_t endN = 20000;
+	const size_t ksPerN = 3;
+	const size_t numberOfRepeats = 7;
+	const size_t changes = 100;
+	const size_t searchesPerChange = 10;
+	const size_t optionsCount = 3;
+	const option_t options[] = { KDB_O_NOCASCADING, KDB_O_OPMPHM | KDB_O_NOCASCADING, KDB_O_HASHINDEX | KDB_O_NOCASCADING };
+
+	// check config
+	if (startN >= endN || startN == 0)
+	{
+		printExit ("startN >= endN || startN == 0");
+	}
+	if (numberOfRepeats % 2 == 0)
+	{
+		printExit ("numberOfRepeats is even");
+	}
+	if (ksPerN % 2 == 0)
+	{
+		printExit ("ksPerN is even");
+	}
+
+	// calculate counts
+	size_t nCount = 0;
+	for (size_t nI = startN; nI <= endN; nI += stepN)
+	{
+		++nCount;
+	}
+
+	// memory allocation and initialization
+	// init results
+	size_t * results = elektraMalloc (nCount * optionsCount * sizeof (size_t));
+	if (!results)
+	{
+		printExit ("malloc");
+	}
+	// init repeats
+	size_t * repeats = elektraMalloc (numberOfRepeats * sizeof (size_t));
+	if (!repeats)
+	{
+		printExit ("malloc");
+	}
+	// init partialResult
+	size_t * partialResult = elektraMalloc (ksPerN * sizeof (size_t));
+	if (!partialResult)
+	{
+		printExit ("malloc");
+	}
+	// init KeySetStorage
+	KeySet ** keySetStorage = elektraMalloc (ksPerN * sizeof (KeySet *));
+	if (!keySetStorage)
+	{
+		printExit ("malloc");
+	}
+
+	// get KeySet shapes
+	KeySetShape * keySetShapes = getKeySetShapes ();
+
+	printf ("Run Benchmark %s:\n", name);
+
+	// for all KeySet shapes except 6
+	for (size_t shapeI = 0; shapeI < numberOfShapes; ++shapeI)
+	{
+		if (shapeI == 6)
+		{
+			continue;
+		}
+		KeySetShape * usedKeySetShape = &keySetShapes[shapeI];
+
+		// for all Ns
+		for (size_t nI = startN; nI <= endN; nI += stepN)
+		{
+			printf ("now at: shape = %zu/%zu n = %zu/%zu\r", shapeI + 1, numberOfShapes, nI, endN);
+			fflush (stdout);
+
+			// generate KeySets
+			int32_t genSeed;
+			for (size_t ksI = 0; ksI < ksPerN; ++ksI)
+			{
+				if (getRandomSeed (&genSeed) != &genSeed) printExit ("Seed Parsing Error or feed me more seeds");
+				keySetStorage[ksI] = generateKeySet (nI, &genSeed, usedKeySetShape);
+			}
+			int32_t searchSeed;
+			if (getRandomSeed (&searchSeed) != &searchSeed) printExit ("Seed Parsing Error or feed me more seeds");
+
+			// for all options, every option gets fresh copies of the KeySets
+			for (size_t optionI = 0; optionI < optionsCount; ++optionI)
+			{
+				for (size_t ksI = 0; ksI < ksPerN; ++ksI)
+				{
+					KeySet * ks = ksDup (keySetStorage[ksI]);
+					partialResult[ksI] = benchmarkInterleavedTimeMeasure (ks, changes, searchesPerChange, searchSeed,
+											      options[optionI], repeats, numberOfRepeats);
+					ksDel (ks);
+				}
+				// sort partialResult and take median as final result
+				qsort (partialResult, ksPerN, sizeof (size_t), cmpInteger);
+				results[((nI - startN) / stepN) * optionsCount + optionI] = partialResult[ksPerN / 2];
+			}
+
+			// free ks
+			for (size_t ksI = 0; ksI < ksPerN; ++ksI)
+			{
+				ksDel (keySetStorage[ksI]);
+			}
+		}
+
+		// write out
+		FILE * out = openOutFileWithRPartitePostfix ("benchmark_interleaved_time", shapeI);
+		if (!out)
+		{
+			printExit ("open out file");
+		}
+		// print header
+		fprintf (out, "n;binary;opmphm;hashindex\n");
+		// print data
+		for (size_t nI = startN; nI <= endN; nI += stepN)
+		{
+			fprintf (out, "%zu", nI);
+			for (size_t optionI = 0; optionI < optionsCount; ++optionI)
+			{
+				fprintf (out, ";%zu", results[((nI - startN) / stepN) * optionsCount + optionI]);
+			}
+			fprintf (out, "\n");
+		}
+
+		fclose (out);
+	}
+	printf ("\n");
+
+	elektraFree (repeats);
+	elektraFree (partialResult);
+	elektraFree (keySetStorage);
+	elektraFree (keySetShapes);
+	elektraFree (results);
+}
+
+/**
+ * END ================================================== Interleaved Changes Time ===================================================== END
+ */
+
 /**
  * START ================================================= hsearch Build Time ======================================================== START
  *
@@ -1830,7 +2082,7 @@ static void benchmarkPrintAllKeySetShapes (char * name)
 int main (int argc, char ** argv)
 {
 	// define all benchmarks
-	size_t benchmarksCount = 8;
+	size_t benchmarksCount = 10;
 #ifdef HAVE_HSEARCHR
 	// hsearchbuildtime
 	++benchmarksCount;
@@ -1881,6 +2133,16 @@ int main (int argc, char ** argv)
 	benchmarks[7].name = benchmarkNameBinarySearchTime;
 	benchmarks[7].benchmarkF = benchmarkBinarySearchTime;
 	benchmarks[7].numberOfSeedsNeeded = 54600;
+	// hashindexsearchtime
+	char * benchmarkNameHashIndexSearchTime = "hashindexsearchtime";
+	benchmarks[8].name = benchmarkNameHashIndexSearchTime;
+	benchmarks[8].benchmarkF = benchmarkHashIndexSearchTime;
+	benchmarks[8].numberOfSeedsNeeded = 54600;
+	// interleavedtime
+	char * benchmarkNameInterleavedTime = "interleavedtime";
+	benchmarks[9].name = benchmarkNameInterleavedTime;
+	benchmarks[9].benchmarkF = benchmarkInterleavedTime;
+	benchmarks[9].numberOfSeedsNeeded = 1120;
 #ifdef HAVE_HSEARCHR
 	// hsearchbuildtime
 	char * benchmarkNameHsearchBuildTime = "hsearchbuildtime";
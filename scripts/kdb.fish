@@ -360,7 +360,7 @@ end
 
 complete -c kdb -n 'not __fish_kdb_subcommand' -x -a '(__fish_kdb_print_subcommands -v)'
 
-set -l arguments complete editor export file fstab get getmeta import ls lsmeta rm rmmeta set setmeta sget smount spec-mount test umount
+set -l arguments complete editor export file fstab get getmeta import ls lsmeta memory rm rmmeta set setmeta sget smount spec-mount test trace umount
 set -l arguments $arguments vset 1
 set -l completion_function "__fish_kdb_needs_namespace $arguments"
 complete -c kdb -n "$completion_function" -x -a '(__fish_kdb_print_namespaces)'
@@ -31,6 +31,13 @@
 	it says how much can actually be stored.*/
 #define KEYSET_SIZE 16
 
+/** Default size of the blocks arena keys are allocated from. */
+#define ELEKTRA_ARENA_BLOCK_SIZE (64 * 1024)
+
+/** Size of the stack buffers lookup names are kept in.
+	Longer names are allocated. */
+#define ELEKTRA_KEYNAME_STACK_SIZE 512
+
 /** How many plugins can exist in an backend. */
 #define NR_OF_PLUGINS 10
 
@@ -56,6 +63,24 @@
  * to which mountpoint. */
 #define KDB_SYSTEM_ELEKTRA "system/elektra"
 
+/**Configuration of the persistent cache.
+ *
+ * Below this key the cache is enabled and configured,
+ * see elektraCacheInit(). */
+#define KDB_CACHE_CONFIG KDB_SYSTEM_ELEKTRA "/cache"
+
+/**Configuration of the parallel update of backends.
+ *
+ * Below this key the parallel kdbGet() is enabled and configured,
+ * see elektraParallelInit(). */
+#define KDB_PARALLEL_CONFIG KDB_SYSTEM_ELEKTRA "/parallel"
+
+/**Configuration of the interning of metadata.
+ *
+ * Below this key the intern pool of kdbGet() is enabled,
+ * see elektraInternPoolAdd(). */
+#define KDB_INTERN_CONFIG KDB_SYSTEM_ELEKTRA "/intern"
+
 
 #ifdef __cplusplus
 namespace ckdb
@@ -64,8 +89,15 @@ extern "C" {
 #endif
 
 typedef struct _Trie Trie;
+typedef struct _TrieRouter TrieRouter;
 typedef struct _Split Split;
 typedef struct _Backend Backend;
+typedef struct _ElektraArena ElektraArena;
+typedef struct _ElektraTrace ElektraTrace;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+typedef struct _ElektraHashIndex ElektraHashIndex;
+typedef struct _ElektraLookupCache ElektraLookupCache;
+#endif
 
 /* These define the type for pointers to all the kdb functions */
 typedef int (*kdbOpenPtr) (Plugin *, Key * errorKey);
@@ -115,12 +147,26 @@ typedef enum {
 			 to be changed. All attempts to change the value
 			 will lead to an error.
 			 Needed for metakeys*/
-	KEY_FLAG_RO_META = 1 << 3	/*!<
+	KEY_FLAG_RO_META = 1 << 3,	/*!<
 			 Read only flag for meta.
 			 Key meta is read only and not allowed
 			 to be changed. All attempts to change the value
 			 will lead to an error.
 			 Needed for metakeys.*/
+	KEY_FLAG_ARENA_STRUCT = 1 << 4, /*!<
+			 The Key struct itself lives in Key::arena.
+			 keyDel() releases the arena instead of
+			 freeing the key.*/
+	KEY_FLAG_ARENA_NAME = 1 << 5, /*!<
+			 The name lives in Key::arena (or other
+			 memory not owned by the key, like interned
+			 metadata names).
+			 It must be copied out before it gets
+			 reallocated and must never be freed.*/
+	KEY_FLAG_ARENA_VALUE = 1 << 6 /*!<
+			 The value lives in Key::arena.
+			 It must be copied out before it gets
+			 reallocated and must never be freed.*/
 } keyflag_t;
 
 
@@ -213,6 +259,12 @@ struct _Key
 	 * All the key's meta information.
 	 */
 	KeySet * meta;
+
+	/**
+	 * The block the key was allocated from, 0 for keys from keyNew().
+	 * @see elektraKsArenaKeyNew()
+	 */
+	ElektraArena * arena;
 };
 
 
@@ -248,10 +300,55 @@ struct _KeySet
 	 * The Order Preserving Minimal Perfect Hash Map.
 	 */
 	Opmphm * opmphm;
+	/**
+	 * The hash index of the key names, updated on insertion and removal.
+	 * @see KDB_O_HASHINDEX
+	 */
+	ElektraHashIndex * hashIndex;
+	/**
+	 * The results of cascading and spec lookups.
+	 * @see generation
+	 */
+	ElektraLookupCache * lookupCache;
 #endif
+
+	/**
+	 * Changed whenever keys are added, removed or replaced.
+	 * Unique within the process, so it also tells KeySets apart.
+	 * @see elektraKsNextGeneration()
+	 */
+	uint64_t generation;
+
+	/**
+	 * The block new arena keys are allocated from.
+	 * @see elektraKsArenaKeyNew()
+	 */
+	ElektraArena * arena;
+
+	/**
+	 * Number of further keys using this KeySet as their metadata.
+	 * Shared metadata is copied before it gets modified.
+	 * Only changed atomically with elektraKeyMetaRef() and elektraKeyMetaUnref().
+	 * @see elektraKeyMetaShare()
+	 */
+	size_t metaShares;
 };
 
 
+/**
+ * Everything needed to decide if a cache file still matches its
+ * configuration file, see elektraCacheGetStamp().
+ */
+typedef struct
+{
+	kdb_unsigned_long_long_t dev;
+	kdb_unsigned_long_long_t ino;
+	kdb_unsigned_long_long_t size;
+	kdb_long_long_t mtimeSec;
+	kdb_long_long_t mtimeNsec;
+	kdb_long_long_t ctime;
+} ElektraCacheStamp;
+
 /**
  * The access point to the key database.
  *
@@ -290,6 +387,19 @@ struct _KDB
 
 	Plugin * notificationPlugin; /*!< reference to global plugin for notifications.*/
 	ElektraNotificationCallbackContext * notificationCallbackContext; /*!< reference to context for notification callbacks.*/
+
+	char * cacheDirectory; /*!< Where cached KeySets of backends are stored, 0 if the cache is disabled.*/
+	kdb_unsigned_long_long_t cacheConfigHash; /*!< Hash of the mount configuration the cache files must match.*/
+	int cacheReadOnly;			  /*!< 1 if elektraCacheStore() must not write cache files, used while bootstrapping.*/
+	ElektraCacheStamp cacheBootstrapStamp; /*!< Stamp of the bootstrap configuration before it was read.*/
+
+	size_t parallelThreads; /*!< Maximum number of threads updating backends in kdbGet(), 0 if they are updated sequentially.*/
+
+	int lazyBackends; /*!< 1 if mountOpen() only opens the plugins of a backend when splitBuildup() first needs it.*/
+
+	ElektraInternPool * internPool; /*!< Interns the metadata of the keys returned by kdbGet(), 0 if disabled.*/
+
+	ElektraTrace * trace; /*!< Timing of kdbGet() and kdbSet(), 0 if they were never traced.*/
 };
 
 
@@ -341,6 +451,13 @@ struct _Backend
 	   More than three is not possible, because a backend
 	   can be only mounted in dir, system and user each once
 	   OR only in spec.*/
+
+	int threadSafe; /*!< 1 if all get plugins and set plugins before the commit
+	   plugin (except resolvers) declared the status threadsafe,
+	   -1 if not, 0 if not checked yet. */
+
+	KeySet * pluginConfig; /*!< The configuration of the plugins if they
+	   are not opened yet, see backendOpenPlugins(). */
 };
 
 /**
@@ -428,6 +545,7 @@ struct _Split
 				Is either the mountpoint of the backend
 				or "user", "system", "spec" for the split root/cascading backends */
 	splitflag_t * syncbits; /*!< Bits for various options, see #splitflag_t for documentation */
+	TrieRouter * router;    /*!< Routes the keys to the backends, created on first use */
 };
 
 // clang-format on
@@ -460,8 +578,33 @@ void splitPrepare (Split * split);
 int splitUpdateSize (Split * split);
 
 
+/*Cache handling*/
+void elektraCacheInit (KDB * handle, KeySet * config);
+void elektraCacheInitBootstrap (KDB * handle);
+void elektraCacheClose (KDB * handle);
+int elektraCacheGetStamp (const Key * parentKey, ElektraCacheStamp * stamp);
+int elektraCacheLoad (KDB * handle, const Key * parentKey, KeySet * returned, ElektraCacheStamp * stamp);
+int elektraCacheStore (KDB * handle, const Key * parentKey, KeySet * ks, const ElektraCacheStamp * stamp);
+int elektraCacheStoreBootstrap (KDB * handle, const Key * parentKey, KeySet * keys);
+
+/*Parallel update*/
+void elektraParallelInit (KDB * handle, KeySet * config);
+int elektraParallelGet (KDB * handle, Split * split, Key * parentKey, int (*getBackend) (KDB *, Split *, size_t, Key *));
+int elektraParallelSet (KDB * handle, Split * split, Key * parentKey, Key ** errorKey,
+			int (*setResolver) (KDB *, Split *, size_t, Key *, Key **),
+			int (*setBackend) (KDB *, Split *, size_t, Key *, Key **));
+
+/*Tracing*/
+void elektraTraceBegin (KDB * handle, Key * parentKey);
+uint64_t elektraTraceNow (KDB * handle);
+void elektraTraceRecord (KDB * handle, const char * phase, const Plugin * plugin, const Key * mountpoint, uint64_t start, ssize_t keys);
+void elektraTraceEnd (KDB * handle, Key * parentKey, const char * phase, ssize_t keys);
+void elektraTraceClose (KDB * handle);
+
 /*Backend handling*/
 Backend * backendOpen (KeySet * elektra_config, KeySet * modules, Key * errorKey);
+Backend * backendOpenLazy (KeySet * elektraConfig, Key * errorKey);
+int backendOpenPlugins (Backend * backend, KeySet * modules, Key * errorKey);
 Backend * backendOpenDefault (KeySet * modules, const char * file, Key * errorKey);
 Backend * backendOpenModules (KeySet * modules, Key * errorKey);
 Backend * backendOpenVersion (Key * errorKey);
@@ -484,6 +627,10 @@ Plugin * elektraPluginVersion (void);
 int trieClose (Trie * trie, Key * errorKey);
 Backend * trieLookup (Trie * trie, const Key * key);
 Trie * trieInsert (Trie * trie, const char * name, Backend * value);
+TrieRouter * trieRouterNew (Trie * trie);
+void trieRouterDel (TrieRouter * router);
+Trie * trieRouterGetTrie (const TrieRouter * router);
+Backend * trieRouterLookup (TrieRouter * router, const Key * key);
 
 /*Mounting handling */
 int mountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorKey);
@@ -497,6 +644,14 @@ Key * mountGetMountpoint (KDB * handle, const Key * where);
 Backend * mountGetBackend (KDB * handle, const Key * key);
 
 int keyInit (Key * key);
+
+/*Copy-on-write metadata*/
+void elektraKeyMetaRef (KeySet * meta);
+void elektraKeyMetaUnref (KeySet * meta);
+int elektraKeyMetaIsShared (const KeySet * meta);
+void elektraKeyMetaShare (Key * dest, const Key * source);
+int elektraKeyMetaDetach (Key * key);
+void elektraKeyMetaRelease (Key * key);
 void keyVInit (Key * key, const char * keyname, va_list ap);
 
 int keyClearSync (Key * key);
@@ -511,6 +666,7 @@ KeySet * ksDeepDup (const KeySet * source);
 
 Key * elektraKsPrev (KeySet * ks);
 Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos);
+int elektraKsMerge (KeySet * ks, Key * const * keys, size_t size);
 
 int elektraKeyLock (Key * key, enum elektraLockOptions what);
 
@@ -522,6 +678,8 @@ ssize_t elektraMemmove (Key ** array1, Key ** array2, size_t size);
 
 ssize_t elektraFinalizeName (Key * key);
 ssize_t elektraFinalizeEmptyName (Key * key);
+size_t elektraKeyNameBufferSize (const char * name);
+ssize_t elektraKeySetNameBuffer (Key * key, const char * newName, char * buffer);
 
 char * elektraEscapeKeyNamePart (const char * source, char * dest);
 
@@ -536,6 +694,40 @@ int elektraReadArrayNumber (const char * baseName, kdb_long_long_t * oldIndex);
 
 KeySet * elektraRenameKeys (KeySet * config, const char * name);
 
+/*Arena allocation of keys*/
+void elektraArenaRelease (ElektraArena * arena);
+Key * elektraArenaKeyDup (KeySet * ks, const Key * source);
+Key * elektraArenaKeyNewSingle (const Key * name, int referenceName, const void * value, size_t valueSize);
+int elektraArenaDetachName (Key * key);
+int elektraArenaContains (const ElektraArena * arena, const void * p);
+size_t elektraArenaUnused (const ElektraArena * arena);
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/*Hash index of key names*/
+ElektraHashIndex * elektraHashIndexNew (void);
+void elektraHashIndexDel (ElektraHashIndex * index);
+void elektraHashIndexClear (ElektraHashIndex * index);
+int elektraHashIndexIsBuild (const ElektraHashIndex * index);
+int elektraHashIndexBuild (ElektraHashIndex * index, const KeySet * ks);
+int elektraHashIndexCopy (ElektraHashIndex * dest, const KeySet * destKs, const ElektraHashIndex * source, const KeySet * sourceKs);
+ssize_t elektraHashIndexLookup (ElektraHashIndex * index, const KeySet * ks, const Key * key);
+void elektraHashIndexInsert (ElektraHashIndex * index, const KeySet * ks, size_t position);
+void elektraHashIndexReplace (ElektraHashIndex * index, const Key * old, Key * key);
+void elektraHashIndexRemove (ElektraHashIndex * index, const KeySet * ks, size_t position);
+size_t elektraHashIndexMemoryUsage (const ElektraHashIndex * index);
+
+/*Cache for cascading and spec lookups*/
+ElektraLookupCache * elektraLookupCacheNew (void);
+void elektraLookupCacheDel (ElektraLookupCache * cache);
+size_t elektraLookupCacheMemoryUsage (const ElektraLookupCache * cache);
+int elektraLookupCacheGet (KeySet * ks, const Key * key, option_t options, Key ** found);
+int elektraLookupCacheStart (KeySet * ks);
+void elektraLookupCacheDepend (KeySet * ks, const Key * specKey);
+void elektraLookupCacheStop (KeySet * ks, const Key * key, option_t options, Key * found);
+#endif
+
+void elektraKsNextGeneration (KeySet * ks);
+
 
 /* Conveniences Methods for Making Tests */
 
@@ -12,6 +12,7 @@
 #define KDBPROPOSAL_H
 
 #include <kdb.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 namespace ckdb
@@ -28,6 +29,77 @@ int elektraKsToMemArray (KeySet * ks, Key ** buffer);
 
 KeySet * ksRenameKeys (KeySet * config, const Key * name);
 
+Key * elektraKsArenaKeyNew (KeySet * ks, const char * name, const void * value, size_t valueSize);
+
+int kdbGetDelta (KDB * handle, KeySet * ks, Key * parentKey, KeySet * added, KeySet * removed, KeySet * modified);
+ssize_t ksLookupMany (KeySet * ks, const char * const * names, size_t count, Key ** found, option_t options);
+
+typedef struct _ElektraKsBuilder ElektraKsBuilder;
+
+ElektraKsBuilder * elektraKsBuilderNew (size_t alloc);
+ssize_t elektraKsBuilderAdd (ElektraKsBuilder * builder, Key * toAdd);
+ssize_t elektraKsBuilderBuild (ElektraKsBuilder * builder, KeySet * ks);
+void elektraKsBuilderDel (ElektraKsBuilder * builder);
+
+typedef struct _ElektraInternPool ElektraInternPool;
+
+/**
+ * @brief Statistics of an intern pool
+ *
+ * @ingroup proposal
+ */
+typedef struct
+{
+	size_t keys;	     ///< distinct metakeys in the pool
+	size_t sets;	     ///< distinct KeySets of metadata in the pool
+	size_t internedKeys; ///< metakeys replaced by a metakey of the pool
+	size_t sharedSets;   ///< KeySets of metadata replaced by a KeySet of the pool
+	size_t savedBytes;   ///< approximate memory freed by the replacements
+} ElektraInternStats;
+
+ElektraInternPool * elektraInternPoolNew (void);
+ssize_t elektraInternPoolAdd (ElektraInternPool * pool, KeySet * ks);
+int elektraInternPoolGetStats (const ElektraInternPool * pool, ElektraInternStats * stats);
+void elektraInternPoolDel (ElektraInternPool * pool);
+
+/**
+ * @brief Memory used by keys and KeySets in bytes
+ *
+ * @ingroup proposal
+ */
+typedef struct
+{
+	size_t keys;   ///< structs of the keys and KeySets and the used slots of the arrays of the KeySets
+	size_t names;  ///< escaped and unescaped names of the keys
+	size_t values; ///< values of the keys
+	size_t meta;   ///< metakeys and the KeySets holding them
+	size_t index;  ///< hash tables built for lookups (OPMPHM, hash index, lookup cache)
+	size_t slack;  ///< allocated but unused memory (free slots of arrays, arena blocks)
+	size_t total;  ///< sum of all categories
+} ElektraMemoryUsage;
+
+ssize_t keyMemoryUsage (const Key * key, ElektraMemoryUsage * usage);
+ssize_t ksMemoryUsage (const KeySet * ks, ElektraMemoryUsage * usage);
+
+/**
+ * @brief Timing of one phase of kdbGet() or kdbSet()
+ *
+ * @ingroup proposal
+ */
+typedef struct
+{
+	const char * phase;	 ///< e.g. `resolver`, `getstorage` or a global plugin position like `POSTGETSTORAGE`
+	const char * plugin;	 ///< name of the plugin, 0 if the phase does not belong to a plugin
+	const char * mountpoint; ///< mountpoint of the backend, 0 if the phase does not belong to a backend
+	uint64_t start;		 ///< nanoseconds since the start of kdbGet() or kdbSet()
+	uint64_t duration;	 ///< nanoseconds the phase took
+	ssize_t keys;		 ///< number of keys after the phase, -1 if unknown
+} ElektraTraceEvent;
+
+typedef void (*ElektraTraceCallback) (const ElektraTraceEvent * event, void * data);
+
+int elektraTraceSetCallback (KDB * handle, ElektraTraceCallback callback, void * data);
+
 /**
  * @brief Lock options
  *
@@ -51,7 +123,8 @@ enum elektraLookupOptions {
 	KDB_O_NOSPEC = 1 << 18,      ///< Do not use specification for cascading keys (internal)
 	KDB_O_NODEFAULT = 1 << 19,   ///< Do not honor the default spec (internal)
 	KDB_O_CALLBACK = 1 << 20,    ///< For spec/ lookups that traverse deeper into hierarchy (callback in ksLookup())
-	KDB_O_OPMPHM = 1 << 21       ///< Use OPMPHM for lookup, make sure to set ENABLE_OPTIMIZATIONS=ON at cmake
+	KDB_O_OPMPHM = 1 << 21,      ///< Use OPMPHM for lookup, make sure to set ENABLE_OPTIMIZATIONS=ON at cmake
+	KDB_O_HASHINDEX = 1 << 22    ///< Use (and from now on maintain) a hash index of the KeySet, needs ENABLE_OPTIMIZATIONS=ON
 };
 
 // locks a key, is this needed externally?
@@ -0,0 +1,346 @@
+/**
+ * @file
+ *
+ * @brief Arena allocation of keys.
+ *
+ * Storage plugins create lots of keys in one go. Allocating the struct,
+ * the name and the value of every key separately costs several malloc()
+ * calls per key and scatters the keys over the heap. Keys created with
+ * elektraKsArenaKeyNew() instead live in large blocks owned by the KeySet.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <string.h>
+
+#include "kdbinternal.h"
+
+/**
+ * @internal
+ *
+ * A block of memory holding the struct, name and value of several keys.
+ *
+ * Every key allocated from the block holds one reference, as does the
+ * KeySet which still allocates from it. The block is freed when the last
+ * reference is released, so keys stay valid when they are appended to
+ * other KeySets. Names and values are copied out of the block before they
+ * get reallocated.
+ */
+struct _ElektraArena
+{
+	size_t references; /**< Keys (and KeySets) using the block */
+	size_t size;       /**< Usable size of data */
+	size_t used;       /**< Bytes of data already handed out */
+	char data[];
+};
+
+/** Alignment of keys within a block */
+#define ELEKTRA_ARENA_ALIGN(size) (((size) + sizeof (void *) - 1) & ~(sizeof (void *) - 1))
+
+
+/**
+ * @internal
+ *
+ * @brief Releases one reference of an arena block.
+ *
+ * @param arena the block to release, may be NULL
+ */
+void elektraArenaRelease (ElektraArena * arena)
+{
+	if (!arena) return;
+	if (--arena->references == 0) elektraFree (arena);
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if memory was handed out by an arena block.
+ *
+ * @param arena the block, may be NULL
+ * @param p the memory to check
+ *
+ * @retval 1 if p is within the block
+ * @retval 0 otherwise
+ */
+int elektraArenaContains (const ElektraArena * arena, const void * p)
+{
+	return arena && (const char *) p >= arena->data && (const char *) p < arena->data + arena->used;
+}
+
+/**
+ * @internal
+ *
+ * @return the number of bytes of a block not handed out yet, 0 for NULL
+ */
+size_t elektraArenaUnused (const ElektraArena * arena)
+{
+	return arena ? arena->size - arena->used : 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Hands out size bytes of the current block of ks.
+ *
+ * A new block is started if the current one is too small.
+ * The returned memory holds one reference to ks->arena.
+ *
+ * @return the memory or 0 if a new block could not be allocated
+ */
+static char * elektraArenaAlloc (KeySet * ks, size_t size)
+{
+	size = ELEKTRA_ARENA_ALIGN (size);
+
+	ElektraArena * arena = ks->arena;
+	if (!arena || arena->size - arena->used < size)
+	{
+		size_t blockSize = size > ELEKTRA_ARENA_BLOCK_SIZE ? size : ELEKTRA_ARENA_BLOCK_SIZE;
+		arena = elektraMalloc (sizeof (ElektraArena) + blockSize);
+		if (!arena) return 0;
+
+		arena->references = 1;
+		arena->size = blockSize;
+		arena->used = 0;
+
+		// keys still hold references to the old block
+		elektraArenaRelease (ks->arena);
+		ks->arena = arena;
+	}
+
+	char * p = arena->data + arena->used;
+	arena->used += size;
+	++arena->references;
+	return p;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if keySetName() would store name unchanged.
+ *
+ * Such names can be copied into the arena directly, for all other names
+ * keySetName() does the canonicalization.
+ *
+ * @retval 1 if name is canonical
+ * @retval 0 otherwise
+ */
+static int elektraArenaIsCanonicalName (const char * name)
+{
+	if (name[0] != '/' && !keyNameIsSpec (name) && !keyNameIsProc (name) && !keyNameIsDir (name) && !keyNameIsUser (name) &&
+	    !keyNameIsSystem (name))
+	{
+		return 0;
+	}
+
+	// owners are handled by keySetName()
+	if (!strncmp (name, "user:", sizeof ("user:") - 1)) return 0;
+
+	const char * part = name[0] == '/' ? name + 1 : name;
+	for (;;)
+	{
+		const char * end = strchr (part, '/');
+		size_t length = end ? (size_t) (end - part) : strlen (part);
+
+		if (length == 0) return 0; // empty parts and trailing slashes
+		if (part[0] == '.' && (length == 1 || (length == 2 && part[1] == '.'))) return 0;
+		if (memchr (part, '\\', length)) return 0; // escapes
+
+		if (!end) return 1;
+		part = end + 1;
+	}
+}
+
+/**
+ * @brief Create a key within the arena of a KeySet and append it.
+ *
+ * The struct, the name and the value of the key are allocated from large
+ * blocks owned by @p ks instead of separate allocations. This is meant for
+ * storage plugins creating many keys at once.
+ *
+ * The key behaves like any other key: it can be modified, appended to
+ * other KeySets or popped. Its name and value are copied out of the arena
+ * when they are modified, the arena is freed when all its keys and
+ * @p ks are deleted.
+ *
+ * @param ks the KeySet to append the new key to
+ * @param name the name of the new key
+ * @param value the value of the new key or NULL for a null value
+ * @param valueSize the size of value (including the terminating null for strings)
+ *
+ * @return the new key, already appended to @p ks
+ * @retval 0 on NULL pointers, invalid names or memory errors
+ * @see ksAppendKey(), keyNew()
+ * @ingroup proposal
+ */
+Key * elektraKsArenaKeyNew (KeySet * ks, const char * name, const void * value, size_t valueSize)
+{
+	if (!ks || !name) return 0;
+	if (!value) valueSize = 0;
+
+	const int canonical = elektraArenaIsCanonicalName (name);
+	const size_t nameSize = canonical ? elektraStrLen (name) : 0;
+
+	char * p = elektraArenaAlloc (ks, sizeof (Key) + nameSize * 2 + valueSize);
+	if (!p) return 0;
+
+	Key * key = (Key *) p;
+	keyInit (key);
+	key->arena = ks->arena;
+	key->flags = KEY_FLAG_SYNC | KEY_FLAG_ARENA_STRUCT;
+	p += sizeof (Key);
+
+	if (canonical)
+	{
+		key->key = p;
+		memcpy (key->key, name, nameSize);
+		key->keySize = nameSize;
+		key->keyUSize = elektraUnescapeKeyName (key->key, key->key + nameSize);
+		set_bit (key->flags, KEY_FLAG_ARENA_NAME);
+		p += nameSize * 2;
+	}
+	else if (elektraKeySetName (key, name, 0) <= 0)
+	{
+		keyDel (key);
+		return 0;
+	}
+
+	if (valueSize > 0)
+	{
+		key->data.v = p;
+		memcpy (key->data.v, value, valueSize);
+		key->dataSize = valueSize;
+		set_bit (key->flags, KEY_FLAG_ARENA_VALUE);
+	}
+
+	if (ksAppendKey (ks, key) == -1) return 0;
+
+	return key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Duplicates a key into the arena of a KeySet.
+ *
+ * Like keyDup(), but struct, name and value of the duplicate are
+ * allocated from the arena of @p ks. The metadata is shared with
+ * @p source, metakeys are read-only anyway. The duplicate is not
+ * appended to @p ks.
+ *
+ * @return the duplicate or 0 on memory errors
+ * @see keyDup()
+ */
+Key * elektraArenaKeyDup (KeySet * ks, const Key * source)
+{
+	const size_t nameSize = source->key ? source->keySize + source->keyUSize : 0;
+	const size_t valueSize = source->data.v ? source->dataSize : 0;
+
+	char * p = elektraArenaAlloc (ks, sizeof (Key) + nameSize + valueSize);
+	if (!p) return 0;
+
+	Key * key = (Key *) p;
+	keyInit (key);
+	key->arena = ks->arena;
+	key->flags = KEY_FLAG_SYNC | KEY_FLAG_ARENA_STRUCT;
+	p += sizeof (Key);
+
+	if (nameSize > 0)
+	{
+		key->key = p;
+		memcpy (key->key, source->key, nameSize);
+		key->keySize = source->keySize;
+		key->keyUSize = source->keyUSize;
+		set_bit (key->flags, KEY_FLAG_ARENA_NAME);
+		p += nameSize;
+	}
+
+	if (valueSize > 0)
+	{
+		key->data.v = p;
+		memcpy (key->data.v, source->data.v, valueSize);
+		key->dataSize = valueSize;
+		set_bit (key->flags, KEY_FLAG_ARENA_VALUE);
+	}
+
+	elektraKeyMetaShare (key, source);
+
+	return key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Creates a key whose struct, name and value are a single allocation.
+ *
+ * The block only holds this key and is freed with it. Used for metakeys,
+ * which are created one at a time and never modified.
+ *
+ * @param name the key to take the name from
+ * @param referenceName if the name of @p name is in static memory and
+ *        can be used without copying it
+ * @param value the value or NULL for a null value
+ * @param valueSize the size of value (including the terminating null for strings)
+ *
+ * @return the new key or 0 on memory errors
+ */
+Key * elektraArenaKeyNewSingle (const Key * name, int referenceName, const void * value, size_t valueSize)
+{
+	const size_t nameSize = name->key && !referenceName ? name->keySize + name->keyUSize : 0;
+	if (!value) valueSize = 0;
+
+	ElektraArena * arena = elektraMalloc (sizeof (ElektraArena) + ELEKTRA_ARENA_ALIGN (sizeof (Key)) + nameSize + valueSize);
+	if (!arena) return 0;
+
+	arena->references = 1;
+	arena->size = arena->used = ELEKTRA_ARENA_ALIGN (sizeof (Key)) + nameSize + valueSize;
+
+	char * p = arena->data;
+	Key * key = (Key *) p;
+	keyInit (key);
+	key->arena = arena;
+	key->flags = KEY_FLAG_SYNC | KEY_FLAG_ARENA_STRUCT | KEY_FLAG_ARENA_NAME;
+	p += ELEKTRA_ARENA_ALIGN (sizeof (Key));
+
+	key->key = referenceName ? name->key : p;
+	if (nameSize > 0) memcpy (key->key, name->key, nameSize);
+	key->keySize = name->keySize;
+	key->keyUSize = name->keyUSize;
+	p += nameSize;
+
+	if (valueSize > 0)
+	{
+		key->data.v = p;
+		memcpy (key->data.v, value, valueSize);
+		key->dataSize = valueSize;
+		set_bit (key->flags, KEY_FLAG_ARENA_VALUE);
+	}
+
+	return key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Copies the name of an arena key out of the arena.
+ *
+ * Must be called before the name gets reallocated, does nothing for
+ * names which are not within an arena.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors (the name stays within the arena)
+ */
+int elektraArenaDetachName (Key * key)
+{
+	if (!test_bit (key->flags, KEY_FLAG_ARENA_NAME)) return 0;
+
+	char * name = elektraStrNDup (key->key, key->keySize + key->keyUSize);
+	if (!name) return -1;
+
+	key->key = name;
+	clear_bit (key->flags, KEY_FLAG_ARENA_NAME);
+	return 0;
+}
@@ -101,31 +101,61 @@ int elektraBackendSetMountpoint (Backend * backend, KeySet * elektraConfig, Key
 }
 
 /**
- * Opens the internal backend that indicates that a backend
- * is missing at that place.
+ * Turns a backend into the internal backend that indicates
+ * that a backend is missing at that place.
  *
- * @return the fresh allocated backend or 0 if no memory
+ * Plugins already opened are closed.
+ *
+ * @retval 0 on success
+ * @retval -1 if no memory
  */
-static Backend * backendOpenMissing (Key * mp)
+static int elektraBackendSetMissing (Backend * backend, Key * errorKey)
 {
-	Backend * backend = elektraBackendAllocate ();
+	for (int i = 0; i < NR_OF_PLUGINS; ++i)
+	{
+		elektraPluginClose (backend->setplugins[i], errorKey);
+		elektraPluginClose (backend->getplugins[i], errorKey);
+		elektraPluginClose (backend->errorplugins[i], errorKey);
+		backend->setplugins[i] = 0;
+		backend->getplugins[i] = 0;
+		backend->errorplugins[i] = 0;
+	}
 
 	Plugin * plugin = elektraPluginMissing ();
 	if (!plugin)
 	{
 		/* Could not allocate plugin */
-		elektraFree (backend);
-		return 0;
+		return -1;
 	}
 
 	backend->getplugins[0] = plugin;
 	backend->setplugins[0] = plugin;
 	plugin->refcounter = 2;
 
-	keySetString (mp, "missing");
+	keySetString (backend->mountpoint, "missing");
+	return 0;
+}
+
+/**
+ * Opens the internal backend that indicates that a backend
+ * is missing at that place.
+ *
+ * @return the fresh allocated backend or 0 if no memory
+ */
+static Backend * backendOpenMissing (Key * mp)
+{
+	Backend * backend = elektraBackendAllocate ();
+
 	backend->mountpoint = mp;
 	keyIncRef (backend->mountpoint);
 
+	if (elektraBackendSetMissing (backend, 0) == -1)
+	{
+		keyDecRef (backend->mountpoint);
+		elektraFree (backend);
+		return 0;
+	}
+
 	return backend;
 }
 
@@ -164,23 +194,81 @@ system/elektra/mountpoints/<name>
  * @ingroup backend
  */
 Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, Key * errorKey)
+{
+	Backend * backend = backendOpenLazy (elektraConfig, errorKey);
+	if (!backend) return 0;
+
+	backendOpenPlugins (backend, modules, errorKey);
+	return backend;
+}
+
+/**
+ * Builds a backend like backendOpen(), but without opening its plugins.
+ *
+ * Only the mountpoint is set up. The configuration of the plugins is
+ * kept within the backend until backendOpenPlugins() is called, which
+ * needs to be done before any plugin of the backend is used.
+ *
+ * @note The given KeySet will be deleted with the backend,
+ * don't use it afterwards.
+ *
+ * @param elektraConfig the configuration below system/elektra/mountpoints/<name>
+ * @param errorKey the key where warnings are added
+ *
+ * @return a pointer to a freshly allocated backend or
+ *         a "missing backend" if no mountpoint was found
+ * @retval 0 if out of memory
+ * @ingroup backend
+ */
+Backend * backendOpenLazy (KeySet * elektraConfig, Key * errorKey)
+{
+	ksRewind (elektraConfig);
+	ksNext (elektraConfig);
+
+	Backend * backend = elektraBackendAllocate ();
+	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
+	{ // warning already set
+		Backend * tmpBackend = backendOpenMissing (backend->mountpoint);
+		backendClose (backend, errorKey);
+		ksDel (elektraConfig);
+		return tmpBackend;
+	}
+
+	backend->pluginConfig = elektraConfig;
+	return backend;
+}
+
+/**
+ * Opens the plugins of a backend built by backendOpenLazy().
+ *
+ * If the plugins cannot be opened, the backend becomes a so called
+ * "missing backend". Does nothing if the plugins are already open.
+ *
+ * @param backend the backend to open the plugins for
+ * @param modules used to load new modules or get references
+ *        to existing one
+ * @param errorKey the key where warnings are added
+ *
+ * @retval 0 on success or if the plugins were opened before
+ * @retval -1 if the backend is missing now
+ * @ingroup backend
+ */
+int backendOpenPlugins (Backend * backend, KeySet * modules, Key * errorKey)
 {
 	Key * cur;
+	KeySet * elektraConfig = backend->pluginConfig;
 	KeySet * referencePlugins = 0;
 	KeySet * systemConfig = 0;
 	int failure = 0;
 
+	if (!elektraConfig) return 0;
+	backend->pluginConfig = 0;
+
 	referencePlugins = ksNew (0, KS_END);
 	ksRewind (elektraConfig);
 
 	Key * root = ksNext (elektraConfig);
 
-	Backend * backend = elektraBackendAllocate ();
-	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
-	{ // warning already set
-		failure = 1;
-	}
-
 	while ((cur = ksNext (elektraConfig)) != 0)
 	{
 		if (keyRel (root, cur) == 1)
@@ -233,18 +321,13 @@ Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, Key * errorKey)
 		}
 	}
 
-	if (failure)
-	{
-		Backend * tmpBackend = backendOpenMissing (backend->mountpoint);
-		backendClose (backend, errorKey);
-		backend = tmpBackend;
-	}
+	if (failure) elektraBackendSetMissing (backend, errorKey);
 
 	ksDel (systemConfig);
 	ksDel (elektraConfig);
 	ksDel (referencePlugins);
 
-	return backend;
+	return failure ? -1 : 0;
 }
 
 /**
@@ -446,6 +529,7 @@ int backendClose (Backend * backend, Key * errorKey)
 	keyDecRef (backend->mountpoint);
 	keySetName (errorKey, keyName (backend->mountpoint));
 	keyDel (backend->mountpoint);
+	ksDel (backend->pluginConfig);
 
 	for (int i = 0; i < NR_OF_PLUGINS; ++i)
 	{
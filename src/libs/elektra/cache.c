@@ -0,0 +1,851 @@
+/**
+ * @file
+ *
+ * @brief Persistent cache for the KeySets of backends.
+ *
+ * kdbGet() normally runs the whole plugin chain of every backend which
+ * needs an update, even if a configuration file did not change since
+ * another process parsed it. The cache stores the KeySet a backend
+ * produced in a relocatable binary file next to a stamp of the
+ * configuration file (device, inode, size, mtime and ctime) and a hash
+ * of the mount configuration. A freshly started process maps this file
+ * and reconstructs the KeySet without running the storage plugin.
+ *
+ * The cache is disabled unless `system/elektra/cache/enabled` is set to `1`.
+ * The directory can be changed with `system/elektra/cache/directory`,
+ * it defaults to `$XDG_CACHE_HOME/elektra` or `~/.cache/elektra`.
+ * The bootstrap configuration is only read from the cache if the
+ * environment variable `ELEKTRA_BOOTSTRAP_CACHE` is set to `1`.
+ * Cache files and directories not owned by the effective user or
+ * writable by others are never used.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <kdbassert.h>
+#include <kdbinternal.h>
+
+#define ELEKTRA_CACHE_MAGIC "ELEKTRAC"
+#define ELEKTRA_CACHE_VERSION 1
+#define ELEKTRA_CACHE_BYTE_ORDER 0x01020304
+#define ELEKTRA_CACHE_NO_VALUE UINT64_MAX
+#define ELEKTRA_CACHE_BOOTSTRAP "bootstrap"
+#define ELEKTRA_CACHE_BOOTSTRAP_ENV "ELEKTRA_BOOTSTRAP_CACHE"
+
+#define ELEKTRA_CACHE_FNV_OFFSET 14695981039346656037ULL
+#define ELEKTRA_CACHE_FNV_PRIME 1099511628211ULL
+
+/**
+ * @internal
+ *
+ * The header at the very beginning of every cache file.
+ *
+ * All offsets are relative to the start of the file, so the file can be
+ * mapped to any address.
+ */
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t fileSize;	 /*!< size of the whole cache file */
+	uint64_t configHash;	 /*!< hash of the mount configuration */
+	ElektraCacheStamp stamp; /*!< stamp of the cached configuration file */
+
+	uint64_t mountpointOffset; /*!< name of the parent key */
+	uint64_t mountpointSize;
+	uint64_t filenameOffset; /*!< resolved configuration file */
+	uint64_t filenameSize;
+
+	uint64_t keysOffset; /*!< array of CacheKey for the keys */
+	uint64_t numKeys;
+	uint64_t metaOffset; /*!< array of CacheKey for the (shared) metakeys */
+	uint64_t numMeta;
+	uint64_t metaRefsOffset; /*!< array of uint64_t indizes into the metakeys */
+	uint64_t numMetaRefs;
+} CacheHeader;
+
+/**
+ * @internal
+ *
+ * A serialized key, used both for keys and metakeys.
+ */
+typedef struct
+{
+	uint64_t nameOffset;	/*!< escaped name followed by unescaped name */
+	uint64_t nameSize;	  /*!< like Key::keySize */
+	uint64_t unescapedNameSize; /*!< like Key::keyUSize */
+	uint64_t valueOffset;       /*!< ELEKTRA_CACHE_NO_VALUE for null values */
+	uint64_t valueSize;
+	uint64_t metaStart; /*!< first index in the metaRefs array */
+	uint64_t metaCount;
+} CacheKey;
+
+
+static uint64_t elektraCacheHash (uint64_t hash, const void * data, size_t size)
+{
+	const unsigned char * p = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= p[i];
+		hash *= ELEKTRA_CACHE_FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * @retval 1 if the configuration enables the cache
+ * @retval 0 otherwise
+ */
+static int elektraCacheIsEnabled (KeySet * config)
+{
+	Key * enabled = ksLookupByName (config, KDB_CACHE_CONFIG "/enabled", 0);
+	return enabled && !strcmp (keyString (enabled), "1");
+}
+
+/**
+ * @internal
+ *
+ * @return the default cache directory to be freed with elektraFree(), 0 if there is none
+ */
+static char * elektraCacheDefaultDirectory (void)
+{
+	if (getenv ("XDG_CACHE_HOME") && strcmp (getenv ("XDG_CACHE_HOME"), ""))
+	{
+		return elektraFormat ("%s/elektra", getenv ("XDG_CACHE_HOME"));
+	}
+	if (getenv ("HOME") && strcmp (getenv ("HOME"), ""))
+	{
+		return elektraFormat ("%s/.cache/elektra", getenv ("HOME"));
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Initializes the cache of a KDB handle.
+ *
+ * Must be called with the bootstrap configuration (all keys below
+ * `system/elektra`) before it gets consumed by mountOpen().
+ *
+ * @param handle the handle to initialize the cache for
+ * @param config the bootstrap configuration
+ */
+void elektraCacheInit (KDB * handle, KeySet * config)
+{
+	handle->cacheDirectory = 0;
+	handle->cacheConfigHash = ELEKTRA_CACHE_FNV_OFFSET;
+	handle->cacheReadOnly = 0;
+
+	if (!elektraCacheIsEnabled (config)) return;
+
+	Key * directory = ksLookupByName (config, KDB_CACHE_CONFIG "/directory", 0);
+	if (directory && strcmp (keyString (directory), ""))
+	{
+		handle->cacheDirectory = elektraStrDup (keyString (directory));
+	}
+	else
+	{
+		handle->cacheDirectory = elektraCacheDefaultDirectory ();
+	}
+
+	if (!handle->cacheDirectory)
+	{
+		ELEKTRA_LOG_WARNING ("no cache directory found, cache disabled");
+		return;
+	}
+
+	// everything which changes how backends are assembled invalidates the cache
+	const char * mountpoints = KDB_SYSTEM_ELEKTRA "/mountpoints";
+	const char * globalplugins = KDB_SYSTEM_ELEKTRA "/globalplugins";
+	uint64_t hash = ELEKTRA_CACHE_FNV_OFFSET;
+	for (size_t i = 0; i < config->size; ++i)
+	{
+		Key * cur = config->array[i];
+		if (strncmp (keyName (cur), mountpoints, strlen (mountpoints)) &&
+		    strncmp (keyName (cur), globalplugins, strlen (globalplugins)))
+		{
+			continue;
+		}
+		hash = elektraCacheHash (hash, cur->key, cur->keySize);
+		hash = elektraCacheHash (hash, &cur->dataSize, sizeof (cur->dataSize));
+		if (cur->data.v) hash = elektraCacheHash (hash, cur->data.v, cur->dataSize);
+	}
+	handle->cacheConfigHash = hash;
+
+	ELEKTRA_LOG ("cache enabled in %s", handle->cacheDirectory);
+}
+
+/**
+ * @internal
+ *
+ * @brief Initializes the cache of a KDB handle for bootstrapping.
+ *
+ * Whether the cache is enabled is only known after the bootstrap
+ * configuration was read, so the cache files cannot enable themselves.
+ * The bootstrap cache is only used if the environment variable
+ * `ELEKTRA_BOOTSTRAP_CACHE` is `1`. Then the default cache directory is
+ * used to read the bootstrap configuration, but only
+ * elektraCacheStoreBootstrap() writes to it. As the cache files are
+ * validated with the stamp of the configuration file, a cache file
+ * written while the cache was enabled is outdated as soon as the cache
+ * gets disabled.
+ *
+ * Must be followed by elektraCacheClose().
+ *
+ * @param handle the handle to initialize the cache for
+ */
+void elektraCacheInitBootstrap (KDB * handle)
+{
+	const char * enabled = getenv (ELEKTRA_CACHE_BOOTSTRAP_ENV);
+	handle->cacheDirectory = enabled && !strcmp (enabled, "1") ? elektraCacheDefaultDirectory () : 0;
+	handle->cacheConfigHash = elektraCacheHash (ELEKTRA_CACHE_FNV_OFFSET, ELEKTRA_CACHE_BOOTSTRAP, sizeof (ELEKTRA_CACHE_BOOTSTRAP));
+	handle->cacheReadOnly = 1;
+	memset (&handle->cacheBootstrapStamp, 0, sizeof (ElektraCacheStamp));
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees all resources of the cache of a KDB handle.
+ */
+void elektraCacheClose (KDB * handle)
+{
+	elektraFree (handle->cacheDirectory);
+	handle->cacheDirectory = 0;
+	handle->cacheReadOnly = 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Fill the stamp of the configuration file resolved for parentKey.
+ *
+ * The stamp is zeroed if the file cannot be cached, so it never
+ * matches the stamp of an existing file.
+ *
+ * @retval 0 on success
+ * @retval -1 if the file cannot be cached (does not exist or is no regular file)
+ */
+int elektraCacheGetStamp (const Key * parentKey, ElektraCacheStamp * stamp)
+{
+	memset (stamp, 0, sizeof (ElektraCacheStamp));
+	const char * filename = keyString (parentKey);
+	if (!filename || filename[0] != '/') return -1;
+
+	struct stat buf;
+	if (stat (filename, &buf) == -1) return -1;
+	if (!S_ISREG (buf.st_mode)) return -1;
+
+	stamp->dev = buf.st_dev;
+	stamp->ino = buf.st_ino;
+	stamp->size = buf.st_size;
+	stamp->mtimeSec = ELEKTRA_STAT_SECONDS (buf);
+	stamp->mtimeNsec = ELEKTRA_STAT_NANO_SECONDS (buf);
+	stamp->ctime = buf.st_ctime;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @return the name of the cache file for the backend of parentKey, to be freed with elektraFree()
+ */
+static char * elektraCacheGetFilename (KDB * handle, const Key * parentKey)
+{
+	uint64_t hash = ELEKTRA_CACHE_FNV_OFFSET;
+	hash = elektraCacheHash (hash, keyName (parentKey), keyGetNameSize (parentKey));
+	hash = elektraCacheHash (hash, keyString (parentKey), keyGetValueSize (parentKey));
+	// handles with different mount configurations do not overwrite the files of each other
+	hash = elektraCacheHash (hash, &handle->cacheConfigHash, sizeof (handle->cacheConfigHash));
+	return elektraFormat ("%s/%016llx.cache", handle->cacheDirectory, (unsigned long long) hash);
+}
+
+static int elektraCacheMkdir (const char * directory)
+{
+	char * path = elektraStrDup (directory);
+	for (char * p = path + 1; *p; ++p)
+	{
+		if (*p != '/') continue;
+		*p = '\0';
+		if (mkdir (path, 0700) == -1 && errno != EEXIST)
+		{
+			elektraFree (path);
+			return -1;
+		}
+		*p = '/';
+	}
+	int ret = mkdir (path, 0700) == -1 && errno != EEXIST ? -1 : 0;
+	elektraFree (path);
+	return ret;
+}
+
+static int elektraCacheComparePointer (const void * p1, const void * p2)
+{
+	uintptr_t a = (uintptr_t) * (const Key * const *) p1;
+	uintptr_t b = (uintptr_t) * (const Key * const *) p2;
+	return (a > b) - (a < b);
+}
+
+static uint64_t elektraCacheKeyDataSize (const Key * key)
+{
+	return key->keySize + key->keyUSize + (key->data.v ? key->dataSize : 0);
+}
+
+/**
+ * @internal
+ *
+ * Serializes name and value of key into the blob at *dataOffset.
+ */
+static void elektraCacheWriteKey (char * buffer, CacheKey * record, const Key * key, uint64_t * dataOffset)
+{
+	record->nameOffset = *dataOffset;
+	record->nameSize = key->keySize;
+	record->unescapedNameSize = key->keyUSize;
+	memcpy (buffer + *dataOffset, key->key, key->keySize + key->keyUSize);
+	*dataOffset += key->keySize + key->keyUSize;
+
+	if (key->data.v)
+	{
+		record->valueOffset = *dataOffset;
+		record->valueSize = key->dataSize;
+		memcpy (buffer + *dataOffset, key->data.v, key->dataSize);
+		*dataOffset += key->dataSize;
+	}
+	else
+	{
+		record->valueOffset = ELEKTRA_CACHE_NO_VALUE;
+		record->valueSize = 0;
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Serializes ks into a newly allocated buffer.
+ *
+ * Metakeys shared between several keys are only written once.
+ *
+ * @param[out] bufferSize the size of the returned buffer
+ * @return the buffer to be freed with elektraFree() or 0 on memory errors
+ */
+static char * elektraCacheSerialize (KDB * handle, const Key * parentKey, const ElektraCacheStamp * stamp, KeySet * ks,
+				     size_t * bufferSize)
+{
+	uint64_t numMetaRefs = 0;
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		if (ks->array[i]->meta) numMetaRefs += ks->array[i]->meta->size;
+	}
+
+	Key ** meta = 0;
+	uint64_t numMeta = 0;
+	if (numMetaRefs > 0)
+	{
+		meta = elektraMalloc (numMetaRefs * sizeof (Key *));
+		if (!meta) return 0;
+		for (size_t i = 0; i < ks->size; ++i)
+		{
+			KeySet * m = ks->array[i]->meta;
+			if (!m) continue;
+			memcpy (meta + numMeta, m->array, m->size * sizeof (Key *));
+			numMeta += m->size;
+		}
+		qsort (meta, numMeta, sizeof (Key *), elektraCacheComparePointer);
+		uint64_t unique = 1;
+		for (uint64_t i = 1; i < numMeta; ++i)
+		{
+			if (meta[i] != meta[unique - 1]) meta[unique++] = meta[i];
+		}
+		numMeta = unique;
+	}
+
+	uint64_t dataSize = keyGetNameSize (parentKey) + keyGetValueSize (parentKey);
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		dataSize += elektraCacheKeyDataSize (ks->array[i]);
+	}
+	for (uint64_t i = 0; i < numMeta; ++i)
+	{
+		dataSize += elektraCacheKeyDataSize (meta[i]);
+	}
+
+	CacheHeader header;
+	memset (&header, 0, sizeof (CacheHeader));
+	memcpy (header.magic, ELEKTRA_CACHE_MAGIC, sizeof (header.magic));
+	header.version = ELEKTRA_CACHE_VERSION;
+	header.byteOrder = ELEKTRA_CACHE_BYTE_ORDER;
+	header.configHash = handle->cacheConfigHash;
+	header.stamp = *stamp;
+	header.keysOffset = sizeof (CacheHeader);
+	header.numKeys = ks->size;
+	header.metaOffset = header.keysOffset + header.numKeys * sizeof (CacheKey);
+	header.numMeta = numMeta;
+	header.metaRefsOffset = header.metaOffset + header.numMeta * sizeof (CacheKey);
+	header.numMetaRefs = numMetaRefs;
+	uint64_t dataOffset = header.metaRefsOffset + header.numMetaRefs * sizeof (uint64_t);
+	header.fileSize = dataOffset + dataSize;
+
+	char * buffer = elektraCalloc (header.fileSize);
+	if (!buffer)
+	{
+		elektraFree (meta);
+		return 0;
+	}
+
+	header.mountpointOffset = dataOffset;
+	header.mountpointSize = keyGetNameSize (parentKey);
+	memcpy (buffer + dataOffset, keyName (parentKey), header.mountpointSize);
+	dataOffset += header.mountpointSize;
+
+	header.filenameOffset = dataOffset;
+	header.filenameSize = keyGetValueSize (parentKey);
+	memcpy (buffer + dataOffset, keyString (parentKey), header.filenameSize);
+	dataOffset += header.filenameSize;
+
+	memcpy (buffer, &header, sizeof (CacheHeader));
+
+	CacheKey * metaRecords = (CacheKey *) (buffer + header.metaOffset);
+	for (uint64_t i = 0; i < numMeta; ++i)
+	{
+		elektraCacheWriteKey (buffer, &metaRecords[i], meta[i], &dataOffset);
+	}
+
+	CacheKey * keyRecords = (CacheKey *) (buffer + header.keysOffset);
+	uint64_t * metaRefs = (uint64_t *) (buffer + header.metaRefsOffset);
+	uint64_t metaRef = 0;
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		Key * cur = ks->array[i];
+		elektraCacheWriteKey (buffer, &keyRecords[i], cur, &dataOffset);
+		keyRecords[i].metaStart = metaRef;
+		keyRecords[i].metaCount = cur->meta ? cur->meta->size : 0;
+		for (uint64_t j = 0; j < keyRecords[i].metaCount; ++j)
+		{
+			Key ** found = bsearch (&cur->meta->array[j], meta, numMeta, sizeof (Key *), elektraCacheComparePointer);
+			metaRefs[metaRef++] = found - meta;
+		}
+	}
+
+	ELEKTRA_ASSERT (dataOffset == header.fileSize, "cache serialization wrote %llu instead of %llu bytes",
+			(unsigned long long) dataOffset, (unsigned long long) header.fileSize);
+
+	elektraFree (meta);
+	*bufferSize = header.fileSize;
+	return buffer;
+}
+
+/**
+ * @internal
+ *
+ * @brief Stores the KeySet produced by the backend of parentKey in the cache.
+ *
+ * The cache file is written to a temporary file first and renamed
+ * afterwards, so concurrent processes never see a partially written file.
+ *
+ * @param handle the handle with the cache configuration
+ * @param parentKey the parent of the backend, its value is the resolved filename
+ * @param ks the keys the backend returned
+ * @param stamp the stamp of the configuration file before the keys were read, see elektraCacheLoad()
+ *
+ * @retval 1 if the cache file was written
+ * @retval 0 if the cache is disabled, read-only, the configuration file cannot be cached or changed since @p stamp
+ * @retval -1 on errors
+ */
+int elektraCacheStore (KDB * handle, const Key * parentKey, KeySet * ks, const ElektraCacheStamp * stamp)
+{
+	if (!handle->cacheDirectory || handle->cacheReadOnly) return 0;
+
+	// a file replaced while the plugins parsed it would be cached with the old keys
+	ElektraCacheStamp current;
+	if (elektraCacheGetStamp (parentKey, &current) == -1) return 0;
+	if (memcmp (&current, stamp, sizeof (ElektraCacheStamp))) return 0;
+
+	size_t size = 0;
+	char * buffer = elektraCacheSerialize (handle, parentKey, stamp, ks, &size);
+	if (!buffer) return -1;
+
+	char * cacheFile = elektraCacheGetFilename (handle, parentKey);
+	char * tmpFile = elektraFormat ("%s.XXXXXX", cacheFile);
+	int fd = mkstemp (tmpFile);
+	if (fd == -1 && errno == ENOENT && elektraCacheMkdir (handle->cacheDirectory) == 0)
+	{
+		// mkstemp() leaves the template modified on errors
+		strcpy (tmpFile + strlen (tmpFile) - 6, "XXXXXX");
+		fd = mkstemp (tmpFile);
+	}
+
+	int ret = -1;
+	if (fd != -1)
+	{
+		size_t written = 0;
+		while (written < size)
+		{
+			ssize_t n = write (fd, buffer + written, size - written);
+			if (n == -1 && errno == EINTR) continue;
+			if (n <= 0) break;
+			written += n;
+		}
+		if (close (fd) == 0 && written == size && rename (tmpFile, cacheFile) == 0)
+		{
+			ret = 1;
+		}
+		else
+		{
+			unlink (tmpFile);
+		}
+	}
+
+	ELEKTRA_LOG_DEBUG ("storing cache %s for %s: %d", cacheFile, keyName (parentKey), ret);
+	elektraFree (tmpFile);
+	elektraFree (cacheFile);
+	elektraFree (buffer);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * Other users must not be able to plant keys in the cache.
+ *
+ * @retval 1 if the file is owned by the effective user and not writable by group or others
+ * @retval 0 otherwise
+ */
+static int elektraCacheIsPrivate (const struct stat * buf)
+{
+	return buf->st_uid == geteuid () && !(buf->st_mode & (S_IWGRP | S_IWOTH));
+}
+
+static int elektraCacheInBounds (uint64_t mapSize, uint64_t offset, uint64_t size)
+{
+	return offset <= mapSize && size <= mapSize - offset;
+}
+
+static int elektraCacheArrayInBounds (uint64_t mapSize, uint64_t offset, uint64_t count, uint64_t elementSize)
+{
+	return count <= mapSize / elementSize && elektraCacheInBounds (mapSize, offset, count * elementSize);
+}
+
+/**
+ * @internal
+ *
+ * Checks that name and value of a serialized key are within the mapped file
+ * and that the names, and the value of string keys, are null-terminated.
+ *
+ * @param isString whether the value is read as string, i.e. the key has no `binary` metakey
+ */
+static int elektraCacheIsValidKey (const char * map, uint64_t mapSize, const CacheKey * record, int isString)
+{
+	uint64_t nameBlockSize = record->nameSize + record->unescapedNameSize;
+	if (record->nameSize == 0 || record->unescapedNameSize == 0 || nameBlockSize < record->nameSize) return 0;
+	if (!elektraCacheInBounds (mapSize, record->nameOffset, nameBlockSize)) return 0;
+	if (map[record->nameOffset + record->nameSize - 1] != '\0') return 0;
+	if (map[record->nameOffset + nameBlockSize - 1] != '\0') return 0;
+	if (record->valueOffset == ELEKTRA_CACHE_NO_VALUE) return 1;
+	if (!elektraCacheInBounds (mapSize, record->valueOffset, record->valueSize)) return 0;
+	if (isString && (record->valueSize == 0 || map[record->valueOffset + record->valueSize - 1] != '\0')) return 0;
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * Creates a key out of a serialized metakey.
+ *
+ * @return the new key or 0 if the record is invalid
+ */
+static Key * elektraCacheReadKey (const char * map, uint64_t mapSize, const CacheKey * record)
+{
+	// metakeys never are binary
+	if (!elektraCacheIsValidKey (map, mapSize, record, 1)) return 0;
+
+	uint64_t nameBlockSize = record->nameSize + record->unescapedNameSize;
+	Key * key = keyNew (0);
+	if (!key) return 0;
+
+	key->key = elektraMalloc (nameBlockSize);
+	if (!key->key)
+	{
+		keyDel (key);
+		return 0;
+	}
+	memcpy (key->key, map + record->nameOffset, nameBlockSize);
+	key->keySize = record->nameSize;
+	key->keyUSize = record->unescapedNameSize;
+
+	if (record->valueOffset != ELEKTRA_CACHE_NO_VALUE)
+	{
+		key->data.v = elektraMalloc (record->valueSize);
+		if (!key->data.v)
+		{
+			keyDel (key);
+			return 0;
+		}
+		memcpy (key->data.v, map + record->valueOffset, record->valueSize);
+		key->dataSize = record->valueSize;
+	}
+
+	return key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks that the mapped cache file belongs to the configuration file of parentKey.
+ */
+static int elektraCacheIsValid (KDB * handle, const Key * parentKey, const ElektraCacheStamp * stamp, const char * map,
+				uint64_t mapSize)
+{
+	if (mapSize < sizeof (CacheHeader)) return 0;
+
+	CacheHeader header;
+	memcpy (&header, map, sizeof (CacheHeader));
+
+	if (memcmp (header.magic, ELEKTRA_CACHE_MAGIC, sizeof (header.magic))) return 0;
+	if (header.version != ELEKTRA_CACHE_VERSION) return 0;
+	if (header.byteOrder != ELEKTRA_CACHE_BYTE_ORDER) return 0;
+	if (header.fileSize != mapSize) return 0;
+	if (header.configHash != handle->cacheConfigHash) return 0;
+	if (memcmp (&header.stamp, stamp, sizeof (ElektraCacheStamp))) return 0;
+
+	if (header.mountpointSize != (uint64_t) keyGetNameSize (parentKey)) return 0;
+	if (!elektraCacheInBounds (mapSize, header.mountpointOffset, header.mountpointSize)) return 0;
+	if (memcmp (map + header.mountpointOffset, keyName (parentKey), header.mountpointSize)) return 0;
+
+	if (header.filenameSize != (uint64_t) keyGetValueSize (parentKey)) return 0;
+	if (!elektraCacheInBounds (mapSize, header.filenameOffset, header.filenameSize)) return 0;
+	if (memcmp (map + header.filenameOffset, keyString (parentKey), header.filenameSize)) return 0;
+
+	if (!elektraCacheArrayInBounds (mapSize, header.keysOffset, header.numKeys, sizeof (CacheKey))) return 0;
+	if (!elektraCacheArrayInBounds (mapSize, header.metaOffset, header.numMeta, sizeof (CacheKey))) return 0;
+	if (!elektraCacheArrayInBounds (mapSize, header.metaRefsOffset, header.numMetaRefs, sizeof (uint64_t))) return 0;
+	if (header.keysOffset % sizeof (uint64_t) || header.metaOffset % sizeof (uint64_t) ||
+	    header.metaRefsOffset % sizeof (uint64_t))
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Rebuilds the KeySet of a mapped and validated cache file.
+ *
+ * @retval 0 on success
+ * @retval -1 if the cache file is corrupt or memory is exhausted
+ */
+static int elektraCacheDeserialize (const char * map, uint64_t mapSize, KeySet * returned)
+{
+	const CacheHeader * header = (const CacheHeader *) map;
+	const CacheKey * keyRecords = (const CacheKey *) (map + header->keysOffset);
+	const CacheKey * metaRecords = (const CacheKey *) (map + header->metaOffset);
+	const uint64_t * metaRefs = (const uint64_t *) (map + header->metaRefsOffset);
+
+	int ret = -1;
+	Key ** meta = 0;
+	if (header->numMeta > 0)
+	{
+		meta = elektraCalloc (header->numMeta * sizeof (Key *));
+		if (!meta) return -1;
+	}
+
+	for (uint64_t i = 0; i < header->numMeta; ++i)
+	{
+		meta[i] = elektraCacheReadKey (map, mapSize, &metaRecords[i]);
+		if (!meta[i]) goto cleanup;
+		set_bit (meta[i]->flags, KEY_FLAG_RO_NAME);
+		set_bit (meta[i]->flags, KEY_FLAG_RO_VALUE);
+		set_bit (meta[i]->flags, KEY_FLAG_RO_META);
+	}
+
+	ksResize (returned, header->numKeys);
+	for (uint64_t i = 0; i < header->numKeys; ++i)
+	{
+		const CacheKey * record = &keyRecords[i];
+		if (record->metaStart > header->numMetaRefs || record->metaCount > header->numMetaRefs - record->metaStart)
+		{
+			goto cleanup;
+		}
+
+		int isString = 1;
+		for (uint64_t j = 0; j < record->metaCount; ++j)
+		{
+			uint64_t ref = metaRefs[record->metaStart + j];
+			if (ref >= header->numMeta) goto cleanup;
+			if (!strcmp (keyName (meta[ref]), "binary")) isString = 0;
+		}
+		if (!elektraCacheIsValidKey (map, mapSize, record, isString)) goto cleanup;
+
+		// keys of a backend live and die together, allocate them in one go
+		const char * value = record->valueOffset == ELEKTRA_CACHE_NO_VALUE ? 0 : map + record->valueOffset;
+		Key * key = elektraKsArenaKeyNew (returned, map + record->nameOffset, value, record->valueSize);
+		if (!key) goto cleanup;
+
+		if (record->metaCount > 0)
+		{
+			key->meta = ksNew (record->metaCount, KS_END);
+			for (uint64_t j = 0; j < record->metaCount; ++j)
+			{
+				ksAppendKey (key->meta, meta[metaRefs[record->metaStart + j]]);
+			}
+		}
+	}
+	ret = 0;
+
+cleanup:
+	// metakeys are owned by the metadata of the keys now
+	for (uint64_t i = 0; i < header->numMeta; ++i)
+	{
+		keyDel (meta[i]);
+	}
+	elektraFree (meta);
+	if (ret == -1) ksClear (returned);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Maps the cache file of parentKey if it is valid.
+ *
+ * @param stamp the stamp of the configuration file the cache file must match
+ * @param[out] map the mapped file, to be unmapped with munmap()
+ * @param[out] mapSize the size of the mapped file
+ *
+ * @retval 1 if the cache file is valid
+ * @retval 0 if the cache is disabled, missing, outdated or could have been modified by other users
+ */
+static int elektraCacheMap (KDB * handle, const Key * parentKey, const ElektraCacheStamp * stamp, char ** map, uint64_t * mapSize)
+{
+	if (!handle->cacheDirectory) return 0;
+
+	struct stat buf;
+	if (stat (handle->cacheDirectory, &buf) == -1 || !S_ISDIR (buf.st_mode) || !elektraCacheIsPrivate (&buf))
+	{
+		return 0;
+	}
+
+	char * cacheFile = elektraCacheGetFilename (handle, parentKey);
+	int fd = open (cacheFile, O_RDONLY);
+	elektraFree (cacheFile);
+	if (fd == -1) return 0;
+
+	if (fstat (fd, &buf) == -1 || !S_ISREG (buf.st_mode) || !elektraCacheIsPrivate (&buf) ||
+	    buf.st_size < (off_t) sizeof (CacheHeader))
+	{
+		close (fd);
+		return 0;
+	}
+
+	*mapSize = buf.st_size;
+	*map = mmap (0, *mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (*map == MAP_FAILED) return 0;
+
+	if (!elektraCacheIsValid (handle, parentKey, stamp, *map, *mapSize))
+	{
+		munmap (*map, *mapSize);
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Loads the KeySet of the backend of parentKey from the cache.
+ *
+ * Only used if nothing was appointed to the backend, i.e. @p returned is
+ * empty, because plugins may merge their keys with already present keys.
+ *
+ * If the keys are not loaded, @p stamp holds the stamp of the
+ * configuration file before the plugins parse it. It must be passed to
+ * elektraCacheStore(), which only stores the keys if the file was not
+ * replaced in the meantime. While bootstrapping the stamp is also kept
+ * for elektraCacheStoreBootstrap().
+ *
+ * @param handle the handle with the cache configuration
+ * @param parentKey the parent of the backend, its value is the resolved filename
+ * @param returned the (empty) KeySet where the cached keys will be appended
+ * @param[out] stamp the stamp of the configuration file
+ *
+ * @retval 1 if the keys were loaded from the cache
+ * @retval 0 if the cache is disabled, missing or outdated
+ */
+int elektraCacheLoad (KDB * handle, const Key * parentKey, KeySet * returned, ElektraCacheStamp * stamp)
+{
+	if (!handle->cacheDirectory)
+	{
+		memset (stamp, 0, sizeof (ElektraCacheStamp));
+		return 0;
+	}
+	if (elektraCacheGetStamp (parentKey, stamp) == -1) return 0;
+	if (handle->cacheReadOnly) handle->cacheBootstrapStamp = *stamp;
+	if (ksGetSize (returned) != 0) return 0;
+
+	char * map;
+	uint64_t mapSize;
+	if (!elektraCacheMap (handle, parentKey, stamp, &map, &mapSize)) return 0;
+
+	int ret = elektraCacheDeserialize (map, mapSize, returned) == 0;
+
+	munmap (map, mapSize);
+	ELEKTRA_LOG_DEBUG ("loading cache for %s: %d", keyName (parentKey), ret);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Stores the bootstrap configuration if it enables the cache.
+ *
+ * Nothing is written if the bootstrap configuration was just loaded
+ * from a valid cache file or if the configuration file changed since
+ * elektraCacheLoad() took its stamp.
+ *
+ * @pre elektraCacheInitBootstrap() was called
+ *
+ * @param handle the handle with the bootstrap cache
+ * @param parentKey the parent of the default backend, its value is the resolved filename
+ * @param keys the bootstrap configuration
+ *
+ * @retval 1 if the cache file was written
+ * @retval 0 if the cache is disabled or the cache file is still valid
+ * @retval -1 on errors
+ */
+int elektraCacheStoreBootstrap (KDB * handle, const Key * parentKey, KeySet * keys)
+{
+	if (!handle->cacheDirectory || !elektraCacheIsEnabled (keys)) return 0;
+
+	char * map;
+	uint64_t mapSize;
+	if (elektraCacheMap (handle, parentKey, &handle->cacheBootstrapStamp, &map, &mapSize))
+	{
+		munmap (map, mapSize);
+		return 0;
+	}
+
+	handle->cacheReadOnly = 0;
+	int ret = elektraCacheStore (handle, parentKey, keys, &handle->cacheBootstrapStamp);
+	handle->cacheReadOnly = 1;
+	return ret;
+}
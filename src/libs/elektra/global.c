@@ -19,7 +19,9 @@ void elektraGlobalGet (KDB * handle, KeySet * ks, Key * parentKey, int position,
 	Plugin * plugin;
 	if (handle && (plugin = handle->globalPlugins[position][subPosition]))
 	{
+		const uint64_t start = elektraTraceNow (handle);
 		plugin->kdbGet (plugin, ks, parentKey);
+		elektraTraceRecord (handle, GlobalpluginPositionsStr[position], plugin, 0, start, ksGetSize (ks));
 	}
 }
 
@@ -28,7 +30,9 @@ void elektraGlobalSet (KDB * handle, KeySet * ks, Key * parentKey, int position,
 	Plugin * plugin;
 	if (handle && (plugin = handle->globalPlugins[position][subPosition]))
 	{
+		const uint64_t start = elektraTraceNow (handle);
 		plugin->kdbSet (plugin, ks, parentKey);
+		elektraTraceRecord (handle, GlobalpluginPositionsStr[position], plugin, 0, start, ksGetSize (ks));
 	}
 }
 
@@ -37,6 +41,8 @@ void elektraGlobalError (KDB * handle, KeySet * ks, Key * parentKey, int positio
 	Plugin * plugin;
 	if (handle && (plugin = handle->globalPlugins[position][subPosition]))
 	{
+		const uint64_t start = elektraTraceNow (handle);
 		plugin->kdbError (plugin, ks, parentKey);
+		elektraTraceRecord (handle, GlobalpluginPositionsStr[position], plugin, 0, start, ksGetSize (ks));
 	}
 }
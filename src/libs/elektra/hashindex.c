@@ -0,0 +1,416 @@
+/**
+ * @file
+ *
+ * @brief Hash index of the key names of a KeySet.
+ *
+ * Unlike the OPMPHM the index is not rebuilt after every change of
+ * the KeySet. Insertions, removals and replacements of single keys
+ * update it in place, only operations moving many keys at once
+ * (ksCut(), ksCopy(), ksClear()) discard it until the next lookup.
+ *
+ * The index is an open addressing table with linear probing, it maps
+ * the unescaped name of every key to the key itself. Keys do not move
+ * when other keys are inserted or removed before them, so changes of
+ * the KeySet cost O(1). Every slot also remembers the position the key
+ * was last seen at. A lookup checks this position first and only
+ * searches the KeySet again if the key has been moved since.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kdbinternal.h"
+#include <kdbassert.h>
+
+/** Smallest number of slots */
+#define ELEKTRA_HASHINDEX_MIN_SIZE 16
+
+typedef struct
+{
+	Key * key;	   /**< The key in this slot, NULL for empty slots */
+	uint32_t hash;	   /**< Hash of the unescaped name of the key */
+	uint32_t position; /**< Position of the key in the KeySet when it was last seen, may be outdated */
+} ElektraHashIndexSlot;
+
+struct _ElektraHashIndex
+{
+	ElektraHashIndexSlot * slots; /**< The table, NULL if the index is not build */
+	size_t mask;		      /**< Number of slots - 1, the number of slots is a power of 2 */
+	size_t count;		      /**< Number of used slots */
+};
+
+
+/**
+ * @internal
+ *
+ * @brief FNV-1a hash of the unescaped name of a key.
+ */
+static uint32_t elektraHashIndexHash (const Key * key)
+{
+	const unsigned char * name = (const unsigned char *) key->key + key->keySize;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key->keyUSize; ++i)
+	{
+		hash ^= name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * @brief Compares the unescaped names of two keys like the binary search does.
+ */
+static int elektraHashIndexEqual (const Key * k1, const Key * k2)
+{
+	return k1->keyUSize == k2->keyUSize && !memcmp (k1->key + k1->keySize, k2->key + k2->keySize, k1->keyUSize);
+}
+
+/**
+ * @internal
+ *
+ * @brief Puts a key into the table without checking the load.
+ */
+static void elektraHashIndexPut (ElektraHashIndex * index, Key * key, uint32_t hash, size_t position)
+{
+	size_t i = hash & index->mask;
+	while (index->slots[i].key)
+	{
+		i = (i + 1) & index->mask;
+	}
+	index->slots[i].key = key;
+	index->slots[i].hash = hash;
+	index->slots[i].position = position;
+}
+
+/**
+ * @internal
+ *
+ * @brief Finds the slot of a key in the index.
+ *
+ * Only the pointers are compared, so @p key may already be freed.
+ *
+ * @param index a build index
+ * @param key the key to search
+ * @param hash the hash of the unescaped name of the key
+ *
+ * @return the slot of the key
+ */
+static size_t elektraHashIndexSlotOf (const ElektraHashIndex * index, const Key * key, uint32_t hash)
+{
+	size_t i = hash & index->mask;
+	while (index->slots[i].key != key)
+	{
+		ELEKTRA_ASSERT (index->slots[i].key, "key not in hash index");
+		i = (i + 1) & index->mask;
+	}
+	return i;
+}
+
+/**
+ * @internal
+ *
+ * @brief Finds the current position of the key in a slot.
+ *
+ * @return the position of the key within ks
+ */
+static size_t elektraHashIndexPosition (const KeySet * ks, const ElektraHashIndexSlot * slot)
+{
+	if (slot->position < ks->size && ks->array[slot->position] == slot->key) return slot->position;
+
+	// the key was moved by insertions or removals before it
+	const ssize_t position = ksSearchInternal (ks, slot->key);
+	ELEKTRA_ASSERT (position >= 0 && ks->array[position] == slot->key, "key %s of hash index not in keyset", keyName (slot->key));
+	return position;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates empty slots, at least twice as many as elements.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the index stays unchanged)
+ */
+static int elektraHashIndexAlloc (ElektraHashIndex * index, size_t elements)
+{
+	size_t size = ELEKTRA_HASHINDEX_MIN_SIZE;
+	while (size < elements * 2)
+	{
+		size *= 2;
+	}
+
+	ElektraHashIndexSlot * slots = elektraCalloc (size * sizeof (ElektraHashIndexSlot));
+	if (!slots) return -1;
+
+	elektraFree (index->slots);
+	index->slots = slots;
+	index->mask = size - 1;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Doubles the number of slots of a build index.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the index stays unchanged)
+ */
+static int elektraHashIndexGrow (ElektraHashIndex * index)
+{
+	ElektraHashIndex old = *index;
+	index->slots = NULL;
+	if (elektraHashIndexAlloc (index, old.mask + 1) == -1)
+	{
+		*index = old;
+		return -1;
+	}
+
+	// the hashes are stored, so the names do not need to be hashed again
+	for (size_t i = 0; i <= old.mask; ++i)
+	{
+		const ElektraHashIndexSlot * slot = &old.slots[i];
+		if (slot->key) elektraHashIndexPut (index, slot->key, slot->hash, slot->position);
+	}
+
+	elektraFree (old.slots);
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates an empty hash index.
+ *
+ * @retval ElektraHashIndex * on success
+ * @retval NULL on memory error
+ */
+ElektraHashIndex * elektraHashIndexNew (void)
+{
+	return elektraCalloc (sizeof (ElektraHashIndex));
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees a hash index.
+ */
+void elektraHashIndexDel (ElektraHashIndex * index)
+{
+	if (!index) return;
+	elektraHashIndexClear (index);
+	elektraFree (index);
+}
+
+/**
+ * @internal
+ *
+ * @brief Discards the table, it needs to be build again before the next lookup.
+ */
+void elektraHashIndexClear (ElektraHashIndex * index)
+{
+	elektraFree (index->slots);
+	index->slots = NULL;
+	index->mask = 0;
+	index->count = 0;
+}
+
+/**
+ * @internal
+ *
+ * @retval 1 if the index is build
+ * @retval 0 otherwise or on NULL
+ */
+int elektraHashIndexIsBuild (const ElektraHashIndex * index)
+{
+	return index && index->slots;
+}
+
+/**
+ * @internal
+ *
+ * @return the number of bytes allocated by the index, 0 for NULL
+ */
+size_t elektraHashIndexMemoryUsage (const ElektraHashIndex * index)
+{
+	if (!index) return 0;
+	return sizeof (ElektraHashIndex) + (index->slots ? (index->mask + 1) * sizeof (ElektraHashIndexSlot) : 0);
+}
+
+/**
+ * @internal
+ *
+ * @brief Builds the index for all keys of a KeySet.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error or if the KeySet is too large
+ */
+int elektraHashIndexBuild (ElektraHashIndex * index, const KeySet * ks)
+{
+	elektraHashIndexClear (index);
+
+	if (ks->size >= UINT32_MAX / 2) return -1;
+	if (elektraHashIndexAlloc (index, ks->size) == -1) return -1;
+
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		elektraHashIndexPut (index, ks->array[i], elektraHashIndexHash (ks->array[i]), i);
+	}
+	index->count = ks->size;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Copies a build index of a KeySet to the index of a copy of the KeySet.
+ *
+ * The keys of the copy may be duplicates (ksDeepDup()), they are taken
+ * from the same positions in @p destKs.
+ *
+ * @param dest the index of the copy
+ * @param destKs the copy, with the keys at the same positions as in @p sourceKs
+ * @param source the index to copy
+ * @param sourceKs the KeySet of @p source
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (dest is not build then)
+ */
+int elektraHashIndexCopy (ElektraHashIndex * dest, const KeySet * destKs, const ElektraHashIndex * source, const KeySet * sourceKs)
+{
+	elektraHashIndexClear (dest);
+	if (!elektraHashIndexIsBuild (source)) return 0;
+
+	if (elektraHashIndexAlloc (dest, (source->mask + 1) / 2) == -1) return -1;
+	ELEKTRA_ASSERT (dest->mask == source->mask, "hash index copy has a different size");
+
+	for (size_t i = 0; i <= source->mask; ++i)
+	{
+		const ElektraHashIndexSlot * slot = &source->slots[i];
+		if (!slot->key) continue;
+		const size_t position = elektraHashIndexPosition (sourceKs, slot);
+		dest->slots[i].key = destKs->array[position];
+		dest->slots[i].hash = slot->hash;
+		dest->slots[i].position = position;
+	}
+	dest->count = source->count;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Searches a key with the same unescaped name.
+ *
+ * @pre the index must be build
+ *
+ * @return the position of the key within ks
+ * @retval -1 if no such key is in ks
+ */
+ssize_t elektraHashIndexLookup (ElektraHashIndex * index, const KeySet * ks, const Key * key)
+{
+	ELEKTRA_ASSERT (elektraHashIndexIsBuild (index), "hash index not build");
+
+	const uint32_t hash = elektraHashIndexHash (key);
+	for (size_t i = hash & index->mask; index->slots[i].key; i = (i + 1) & index->mask)
+	{
+		ElektraHashIndexSlot * slot = &index->slots[i];
+		if (slot->hash == hash && elektraHashIndexEqual (slot->key, key))
+		{
+			slot->position = elektraHashIndexPosition (ks, slot);
+			return slot->position;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Adds a key inserted into a KeySet to the index.
+ *
+ * Must be called after the key was inserted at position and the
+ * size of the KeySet was incremented.
+ *
+ * If the table cannot grow, the index is discarded.
+ *
+ * @param index a build index
+ * @param ks the KeySet
+ * @param position the position of the new key
+ */
+void elektraHashIndexInsert (ElektraHashIndex * index, const KeySet * ks, size_t position)
+{
+	ELEKTRA_ASSERT (elektraHashIndexIsBuild (index), "hash index not build");
+
+	if (ks->size >= UINT32_MAX / 2 || ((index->count + 1) * 2 > index->mask + 1 && elektraHashIndexGrow (index) == -1))
+	{
+		elektraHashIndexClear (index);
+		return;
+	}
+
+	Key * key = ks->array[position];
+	elektraHashIndexPut (index, key, elektraHashIndexHash (key), position);
+	++index->count;
+}
+
+/**
+ * @internal
+ *
+ * @brief Replaces a key of the index with a key of the same name.
+ *
+ * Must be called after @p key replaced @p old in the KeySet,
+ * @p old may already be freed.
+ *
+ * @param index a build index
+ * @param old the replaced key
+ * @param key the key now in the KeySet
+ */
+void elektraHashIndexReplace (ElektraHashIndex * index, const Key * old, Key * key)
+{
+	ELEKTRA_ASSERT (elektraHashIndexIsBuild (index), "hash index not build");
+
+	// the names are the same, so the hash of the new key finds the old one
+	index->slots[elektraHashIndexSlotOf (index, old, elektraHashIndexHash (key))].key = key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes a key from the index.
+ *
+ * Must be called before the key is removed from the KeySet.
+ *
+ * @param index a build index
+ * @param ks the KeySet still containing the key
+ * @param position the position of the key to remove
+ */
+void elektraHashIndexRemove (ElektraHashIndex * index, const KeySet * ks, size_t position)
+{
+	ELEKTRA_ASSERT (elektraHashIndexIsBuild (index), "hash index not build");
+
+	ElektraHashIndexSlot * slots = index->slots;
+	const Key * key = ks->array[position];
+	size_t i = elektraHashIndexSlotOf (index, key, elektraHashIndexHash (key));
+
+	// backward shift deletion keeps the probe sequences intact without tombstones
+	for (size_t next = (i + 1) & index->mask; slots[next].key; next = (next + 1) & index->mask)
+	{
+		const size_t home = slots[next].hash & index->mask;
+		// move the entry if its home slot is not within (i, next]
+		if (((next - home) & index->mask) >= ((next - i) & index->mask))
+		{
+			slots[i] = slots[next];
+			i = next;
+		}
+	}
+	slots[i].key = NULL;
+	--index->count;
+}
@@ -0,0 +1,443 @@
+/**
+ * @file
+ *
+ * @brief Interning of metadata.
+ *
+ * Specifications repeat the same metadata (`type`, `check/range`,
+ * `default`, ...) for thousands of keys, every key having its own
+ * copies of the metakeys and of the KeySet holding them. An intern
+ * pool keeps one metakey for every distinct name and value and one
+ * KeySet for every distinct combination of metakeys. Keys added to
+ * the pool get the pooled metakeys and share the pooled KeySet of
+ * their metadata copy-on-write (see elektraKeyMetaShare()), so that
+ * the copies are freed.
+ *
+ * Metakeys are read-only, so replacing them by equal ones does not
+ * change what the keys look like to anybody.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kdbinternal.h"
+
+/** Smallest number of slots of a table */
+#define ELEKTRA_INTERN_MIN_SIZE 64
+
+/**
+ * Open addressing table with linear probing, items are
+ * metakeys or KeySets of metadata, NULL marks an empty slot.
+ */
+typedef struct
+{
+	uint32_t * hashes;
+	void ** items;
+	size_t mask;  /**< Number of slots - 1, the number of slots is a power of 2 */
+	size_t count; /**< Number of used slots */
+} ElektraInternTable;
+
+struct _ElektraInternPool
+{
+	ElektraInternTable keys; /**< Metakeys, the pool holds a reference to every one */
+	ElektraInternTable sets; /**< KeySets of metadata, the pool holds a share of every one */
+	ElektraInternStats stats;
+};
+
+
+/**
+ * @internal
+ *
+ * @brief FNV-1a hash continuing @p hash.
+ */
+static uint32_t elektraInternHash (uint32_t hash, const void * data, size_t size)
+{
+	const unsigned char * bytes = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * @brief Hash of the name and the value of a metakey.
+ */
+static uint32_t elektraInternKeyHash (const Key * key)
+{
+	uint32_t hash = elektraInternHash (2166136261u, key->key, key->keySize);
+	return elektraInternHash (hash, key->data.v, key->dataSize);
+}
+
+/**
+ * @internal
+ *
+ * @brief Hash of the metakeys of a KeySet, which are already interned.
+ */
+static uint32_t elektraInternSetHash (const KeySet * meta)
+{
+	return elektraInternHash (2166136261u, meta->array, meta->size * sizeof (Key *));
+}
+
+static int elektraInternKeyEqual (const void * item, const void * other)
+{
+	const Key * k1 = item;
+	const Key * k2 = other;
+	return k1->keySize == k2->keySize && k1->dataSize == k2->dataSize && !memcmp (k1->key, k2->key, k1->keySize) &&
+	       (!k1->dataSize || !memcmp (k1->data.v, k2->data.v, k1->dataSize));
+}
+
+static int elektraInternSetEqual (const void * item, const void * other)
+{
+	const KeySet * ks1 = item;
+	const KeySet * ks2 = other;
+	return ks1->size == ks2->size && !memcmp (ks1->array, ks2->array, ks1->size * sizeof (Key *));
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if only the pool uses a metakey.
+ */
+static int elektraInternKeyUnused (void * item)
+{
+	return keyGetRef (item) == 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if only the pool uses a KeySet of metadata.
+ */
+static int elektraInternSetUnused (void * item)
+{
+	return !elektraKeyMetaIsShared (item);
+}
+
+static void elektraInternKeyRelease (void * item)
+{
+	keyDecRef (item);
+	keyDel (item);
+}
+
+/**
+ * @internal
+ *
+ * @brief Gives up the share of the pool, like elektraKeyMetaRelease() does for keys.
+ */
+static void elektraInternSetRelease (void * item)
+{
+	elektraKeyMetaUnref (item);
+}
+
+/**
+ * @internal
+ *
+ * @brief Searches the slot of an item.
+ *
+ * @return the slot of an equal item or the empty slot where it belongs
+ */
+static size_t elektraInternTableSlot (const ElektraInternTable * table, uint32_t hash, const void * item,
+				      int (*equal) (const void *, const void *))
+{
+	size_t i = hash & table->mask;
+	while (table->items[i] && (table->hashes[i] != hash || !equal (table->items[i], item)))
+	{
+		i = (i + 1) & table->mask;
+	}
+	return i;
+}
+
+/**
+ * @internal
+ *
+ * @brief Makes room for one more item.
+ *
+ * Items nobody but the pool uses anymore are released first,
+ * the table only grows if that is not enough.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the table stays unchanged)
+ */
+static int elektraInternTableReserve (ElektraInternTable * table, int (*unused) (void *), void (*release) (void *))
+{
+	if (table->items && (table->count + 1) * 2 <= table->mask + 1) return 0;
+
+	size_t count = 0;
+	for (size_t i = 0; table->items && i <= table->mask; ++i)
+	{
+		if (table->items[i] && !unused (table->items[i])) ++count;
+	}
+
+	size_t size = ELEKTRA_INTERN_MIN_SIZE;
+	while (size < (count + 1) * 4)
+	{
+		size *= 2;
+	}
+
+	void ** items = elektraCalloc (size * sizeof (void *));
+	uint32_t * hashes = elektraMalloc (size * sizeof (uint32_t));
+	if (!items || !hashes)
+	{
+		elektraFree (items);
+		elektraFree (hashes);
+		return -1;
+	}
+
+	// the hashes are stored, so the items do not need to be hashed again
+	for (size_t i = 0; table->items && i <= table->mask; ++i)
+	{
+		void * item = table->items[i];
+		if (!item) continue;
+		if (unused (item))
+		{
+			release (item);
+			continue;
+		}
+
+		size_t j = table->hashes[i] & (size - 1);
+		while (items[j])
+		{
+			j = (j + 1) & (size - 1);
+		}
+		items[j] = item;
+		hashes[j] = table->hashes[i];
+	}
+
+	elektraFree (table->items);
+	elektraFree (table->hashes);
+	table->items = items;
+	table->hashes = hashes;
+	table->mask = size - 1;
+	table->count = count;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Releases all items of a table.
+ */
+static void elektraInternTableClear (ElektraInternTable * table, void (*release) (void *))
+{
+	for (size_t i = 0; table->items && i <= table->mask; ++i)
+	{
+		if (table->items[i]) release (table->items[i]);
+	}
+	elektraFree (table->items);
+	elektraFree (table->hashes);
+	memset (table, 0, sizeof (ElektraInternTable));
+}
+
+/**
+ * @internal
+ *
+ * @brief Approximate number of bytes a metakey occupies.
+ *
+ * Names within arenas are not counted, most of them are interned names
+ * of metadata, which are not allocated at all.
+ */
+static size_t elektraInternKeyBytes (const Key * key)
+{
+	size_t bytes = sizeof (Key) + key->dataSize;
+	if (!test_bit (key->flags, KEY_FLAG_ARENA_NAME)) bytes += key->keySize + key->keyUSize;
+	return bytes;
+}
+
+/**
+ * @internal
+ *
+ * @brief Replaces the metakeys of the metadata of a key by pooled ones.
+ *
+ * Equal metakeys have the same name, so they stay at their positions
+ * and the hash index of the KeySet stays valid. Only cached lookup
+ * results might point to the replaced metakeys.
+ *
+ * Metadata shared with other keys is copied before the first metakey
+ * is replaced, metadata which is interned already is not copied.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraInternKeys (ElektraInternPool * pool, Key * key)
+{
+	KeySet * meta = key->meta;
+	int replaced = 0;
+	for (size_t i = 0; i < meta->size; ++i)
+	{
+		Key * metaKey = meta->array[i];
+		if (metaKey->meta) continue;
+
+		if (elektraInternTableReserve (&pool->keys, elektraInternKeyUnused, elektraInternKeyRelease) == -1) return -1;
+
+		const uint32_t hash = elektraInternKeyHash (metaKey);
+		const size_t slot = elektraInternTableSlot (&pool->keys, hash, metaKey, elektraInternKeyEqual);
+		Key * pooled = pool->keys.items[slot];
+		if (pooled == metaKey) continue;
+
+		if (!pooled)
+		{
+			keyIncRef (metaKey);
+			pool->keys.items[slot] = metaKey;
+			pool->keys.hashes[slot] = hash;
+			++pool->keys.count;
+			continue;
+		}
+
+		// the copy references the same metakeys
+		if (elektraKeyMetaDetach (key) == -1) return -1;
+		meta = key->meta;
+
+		if (keyGetRef (metaKey) == 1) pool->stats.savedBytes += elektraInternKeyBytes (metaKey);
+		keyIncRef (pooled);
+		keyDecRef (metaKey);
+		keyDel (metaKey);
+		meta->array[i] = pooled;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		if (elektraHashIndexIsBuild (meta->hashIndex)) elektraHashIndexReplace (meta->hashIndex, metaKey, pooled);
+#endif
+		if (meta->cursor == metaKey) meta->cursor = pooled;
+		++pool->stats.internedKeys;
+		replaced = 1;
+	}
+
+	if (replaced) elektraKsNextGeneration (meta);
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Lets a key share the pooled KeySet with the same metakeys.
+ *
+ * @pre the metakeys are interned
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraInternSet (ElektraInternPool * pool, Key * key)
+{
+	if (elektraInternTableReserve (&pool->sets, elektraInternSetUnused, elektraInternSetRelease) == -1) return -1;
+
+	KeySet * meta = key->meta;
+	const uint32_t hash = elektraInternSetHash (meta);
+	const size_t slot = elektraInternTableSlot (&pool->sets, hash, meta, elektraInternSetEqual);
+	KeySet * pooled = pool->sets.items[slot];
+	if (pooled == meta) return 0;
+
+	if (!pooled)
+	{
+		elektraKeyMetaRef (meta);
+		pool->sets.items[slot] = meta;
+		pool->sets.hashes[slot] = hash;
+		++pool->sets.count;
+		return 0;
+	}
+
+	if (!elektraKeyMetaIsShared (meta)) pool->stats.savedBytes += sizeof (KeySet) + meta->alloc * sizeof (Key *);
+	elektraKeyMetaRef (pooled);
+	elektraKeyMetaRelease (key);
+	key->meta = pooled;
+	++pool->stats.sharedSets;
+	return 0;
+}
+
+/**
+ * @brief Create a new intern pool.
+ *
+ * Metadata of keys is interned with elektraInternPoolAdd().
+ * A pool is not thread-safe, like KeySets it must be used by
+ * one thread at a time.
+ *
+ * @return a new pool, free it with elektraInternPoolDel()
+ * @retval 0 on memory error
+ * @ingroup proposal
+ */
+ElektraInternPool * elektraInternPoolNew (void)
+{
+	return elektraCalloc (sizeof (ElektraInternPool));
+}
+
+/**
+ * @brief Delete an intern pool.
+ *
+ * Keys keep the interned metadata, it is freed with the last key
+ * using it.
+ *
+ * @param pool the pool to delete
+ * @ingroup proposal
+ */
+void elektraInternPoolDel (ElektraInternPool * pool)
+{
+	if (!pool) return;
+
+	elektraInternTableClear (&pool->keys, elektraInternKeyRelease);
+	elektraInternTableClear (&pool->sets, elektraInternSetRelease);
+	elektraFree (pool);
+}
+
+/**
+ * @brief Intern the metadata of all keys of a KeySet.
+ *
+ * Equal metakeys of the keys are replaced by one metakey of the
+ * pool, keys with equal metadata afterwards share one KeySet of
+ * metadata. Modifying the metadata of a key copies its metadata
+ * first, so the other keys are not affected.
+ *
+ * Metadata stays in the pool until the pool is deleted or no key
+ * uses it anymore and the pool needs room for other metadata.
+ * Adding the same keys repeatedly (e.g. after every kdbGet())
+ * therefore does not let the pool grow.
+ *
+ * @param pool the pool to intern the metadata with
+ * @param ks the KeySet whose keys should share their metadata
+ *
+ * @return the number of keys processed
+ * @retval -1 on NULL pointers or memory errors, the metadata of some keys might be interned then
+ * @ingroup proposal
+ */
+ssize_t elektraInternPoolAdd (ElektraInternPool * pool, KeySet * ks)
+{
+	if (!pool || !ks) return -1;
+
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		Key * key = ks->array[i];
+		if (!key->meta || key->meta->size == 0) continue;
+
+		if (elektraInternKeys (pool, key) == -1) return -1;
+		if (elektraInternSet (pool, key) == -1) return -1;
+	}
+	return ks->size;
+}
+
+/**
+ * @brief Get statistics about an intern pool.
+ *
+ * The number of metakeys and KeySets in the pool include metadata
+ * not used anymore but not released yet.
+ *
+ * @param pool the pool to get the statistics of
+ * @param [out] stats receives the statistics
+ *
+ * @retval 0 on success
+ * @retval -1 on NULL pointers
+ * @ingroup proposal
+ */
+int elektraInternPoolGetStats (const ElektraInternPool * pool, ElektraInternStats * stats)
+{
+	if (!pool || !stats) return -1;
+
+	*stats = pool->stats;
+	stats->keys = pool->keys.count;
+	stats->sets = pool->sets.count;
+	return 0;
+}
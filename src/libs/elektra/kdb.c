@@ -168,9 +168,19 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 	keySetName (errorKey, KDB_SYSTEM_ELEKTRA);
 	keySetString (errorKey, "kdbOpen(): get");
 
+	// the bootstrap configuration is read from the cache, if it enabled the cache before
+	elektraCacheInitBootstrap (handle);
+
 	int funret = 1;
 	int ret = kdbGet (handle, keys, errorKey);
 	int fallbackret = 0;
+	if (ret == 1)
+	{
+		// the value of errorKey is the resolved filename now
+		elektraCacheStoreBootstrap (handle, errorKey, keys);
+	}
+	elektraCacheClose (handle);
+
 	if (ret == 0 || ret == -1)
 	{
 		// could not get KDB_DB_INIT, try KDB_DB_FILE
@@ -213,6 +223,27 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 }
 
 
+/**
+ * @brief Enables the interning of metadata
+ * @internal
+ *
+ * If `system/elektra/intern/enabled` is `1`, the metadata of all keys
+ * returned by kdbGet() is interned, see elektraInternPoolAdd().
+ *
+ * @param handle the handle to initialize
+ * @param config the bootstrap configuration
+ */
+static void elektraInternInit (KDB * handle, KeySet * config)
+{
+	handle->internPool = 0;
+
+	Key * enabled = ksLookupByName (config, KDB_INTERN_CONFIG "/enabled", 0);
+	if (!enabled || strcmp (keyString (enabled), "1")) return;
+
+	handle->internPool = elektraInternPoolNew ();
+	ELEKTRA_LOG ("interning of metadata enabled");
+}
+
 /**
  * @brief Opens the session with the Key database.
  *
@@ -301,6 +332,10 @@ KDB * kdbOpen (Key * errorKey)
 		break;
 	}
 
+	elektraCacheInit (handle, keys);
+	elektraParallelInit (handle, keys);
+	elektraInternInit (handle, keys);
+
 	keySetString (errorKey, "kdbOpen(): mountGlobals");
 
 	if (mountGlobals (handle, ksDup (keys), handle->modules, errorKey) == -1)
@@ -333,6 +368,8 @@ KDB * kdbOpen (Key * errorKey)
 
 	keySetString (errorKey, "kdbOpen(): mountOpen");
 	// Open the trie, keys will be deleted within mountOpen
+	// plugins of backends are only opened when a backend is used the first time
+	handle->lazyBackends = 1;
 	if (mountOpen (handle, keys, handle->modules, errorKey) == -1)
 	{
 		ELEKTRA_ADD_WARNING (93, errorKey, "Initial loading of trie did not work");
@@ -433,6 +470,9 @@ int kdbClose (KDB * handle, Key * errorKey)
 		ELEKTRA_ADD_WARNING (47, errorKey, "modules were not open");
 	}
 
+	elektraCacheClose (handle);
+	elektraInternPoolDel (handle->internPool);
+	elektraTraceClose (handle);
 	elektraFree (handle);
 
 	keySetName (errorKey, keyName (initialParent));
@@ -451,7 +491,7 @@ int kdbClose (KDB * handle, Key * errorKey)
  * @retval 0 no update needed
  * @retval number of plugins which need update
  */
-static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
+static int elektraGetCheckUpdateNeeded (KDB * handle, Split * split, Key * parentKey)
 {
 	int updateNeededOccurred = 0;
 	for (size_t i = 0; i < split->size; i++)
@@ -465,8 +505,10 @@ static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
 			ksRewind (split->keysets[i]);
 			keySetName (parentKey, keyName (split->parents[i]));
 			keySetString (parentKey, "");
+			const uint64_t start = elektraTraceNow (handle);
 			ret = backend->getplugins[RESOLVER_PLUGIN]->kdbGet (backend->getplugins[RESOLVER_PLUGIN], split->keysets[i],
 									    parentKey);
+			elektraTraceRecord (handle, "resolver", backend->getplugins[RESOLVER_PLUGIN], backend->mountpoint, start, -1);
 			// store resolved filename
 			keySetString (split->parents[i], keyString (parentKey));
 			// no keys in that backend
@@ -495,15 +537,75 @@ static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
 	return updateNeededOccurred;
 }
 
+/**
+ * @internal
+ * @brief Runs the get-chain (without resolver) of one backend of the split.
+ *
+ * Must only touch the KeySet of this backend and @p parentKey,
+ * it might run in parallel to other backends (see elektraParallelGet()).
+ *
+ * @retval 0 on success
+ * @retval -1 on error
+ */
+static int elektraGetDoUpdateBackend (KDB * handle, Split * split, size_t i, Key * parentKey)
+{
+	Backend * backend = split->handles[i];
+	ksRewind (split->keysets[i]);
+	keySetName (parentKey, keyName (split->parents[i]));
+	keySetString (parentKey, keyString (split->parents[i]));
+
+	const uint64_t cacheStart = elektraTraceNow (handle);
+	ElektraCacheStamp stamp;
+	if (elektraCacheLoad (handle, split->parents[i], split->keysets[i], &stamp) == 1)
+	{
+		// configuration file unchanged, no need to parse it
+		elektraTraceRecord (handle, "cache", 0, backend->mountpoint, cacheStart, ksGetSize (split->keysets[i]));
+		return 0;
+	}
+	// plugins might merge with appointed keys, only cache what they produced alone
+	int cacheable = ksGetSize (split->keysets[i]) == 0;
+
+	for (size_t p = 1; p < NR_OF_PLUGINS; ++p)
+	{
+		int ret = 0;
+		if (backend->getplugins[p] && backend->getplugins[p]->kdbGet)
+		{
+			const uint64_t start = elektraTraceNow (handle);
+			ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], parentKey);
+			elektraTraceRecord (handle, "getstorage", backend->getplugins[p], backend->mountpoint, start,
+					    ksGetSize (split->keysets[i]));
+		}
+
+		if (ret == -1)
+		{
+			// Ohh, an error occurred,
+			// lets stop the process.
+			return -1;
+		}
+	}
+
+	// only stored if the file was not replaced while the plugins parsed it
+	if (cacheable) elektraCacheStore (handle, split->parents[i], split->keysets[i], &stamp);
+	return 0;
+}
+
 /**
  * @internal
  * @brief Do the real update.
  *
+ * Backends whose configuration file is unchanged since it was
+ * cached are restored from the cache instead (see elektraCacheLoad()).
+ *
  * @retval -1 on error
  * @retval 0 on success
  */
-static int elektraGetDoUpdate (Split * split, Key * parentKey)
+static int elektraGetDoUpdate (KDB * handle, Split * split, Key * parentKey)
 {
+	if (handle->parallelThreads > 0)
+	{
+		return elektraParallelGet (handle, split, parentKey, elektraGetDoUpdateBackend);
+	}
+
 	const int bypassedSplits = 1;
 	for (size_t i = 0; i < split->size - bypassedSplits; i++)
 	{
@@ -512,25 +614,10 @@ static int elektraGetDoUpdate (Split * split, Key * parentKey)
 			// skip it, update is not needed
 			continue;
 		}
-		Backend * backend = split->handles[i];
-		ksRewind (split->keysets[i]);
-		keySetName (parentKey, keyName (split->parents[i]));
-		keySetString (parentKey, keyString (split->parents[i]));
 
-		for (size_t p = 1; p < NR_OF_PLUGINS; ++p)
+		if (elektraGetDoUpdateBackend (handle, split, i, parentKey) == -1)
 		{
-			int ret = 0;
-			if (backend->getplugins[p] && backend->getplugins[p]->kdbGet)
-			{
-				ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], parentKey);
-			}
-
-			if (ret == -1)
-			{
-				// Ohh, an error occurred,
-				// lets stop the process.
-				return -1;
-			}
+			return -1;
 		}
 	}
 	return 0;
@@ -570,9 +657,11 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 	const int bypassedSplits = 1;
 	int pgs_done = 0;
 	int pgc_done = 0;
+	// the global plugins only run in the last pass, the handle is needed for tracing
+	KDB * globals = run == LAST ? handle : 0;
 
-	elektraGlobalGet (handle, ks, parentKey, GETSTORAGE, INIT);
-	elektraGlobalGet (handle, ks, parentKey, GETSTORAGE, MAXONCE);
+	elektraGlobalGet (globals, ks, parentKey, GETSTORAGE, INIT);
+	elektraGlobalGet (globals, ks, parentKey, GETSTORAGE, MAXONCE);
 
 	// elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, INIT);
 
@@ -607,8 +696,11 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 				pgs_done = 1;
 				keySetName (parentKey, keyName (initialParent));
 				ksRewind (ks);
+				const uint64_t traceStart = elektraTraceNow (handle);
 				handle->globalPlugins[POSTGETSTORAGE][FOREACH]->kdbGet (handle->globalPlugins[POSTGETSTORAGE][FOREACH], ks,
 											parentKey);
+				elektraTraceRecord (handle, GlobalpluginPositionsStr[POSTGETSTORAGE],
+						    handle->globalPlugins[POSTGETSTORAGE][FOREACH], 0, traceStart, ksGetSize (ks));
 				keySetName (parentKey, keyName (split->parents[i]));
 			}
 			else if (!pgc_done && (p == (NR_OF_PLUGINS - 1)) && handle->globalPlugins[POSTGETCLEANUP][FOREACH])
@@ -616,21 +708,29 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 				pgc_done = 1;
 				keySetName (parentKey, keyName (initialParent));
 				ksRewind (ks);
+				const uint64_t traceStart = elektraTraceNow (handle);
 				handle->globalPlugins[POSTGETCLEANUP][FOREACH]->kdbGet (handle->globalPlugins[POSTGETCLEANUP][FOREACH], ks,
 											parentKey);
+				elektraTraceRecord (handle, GlobalpluginPositionsStr[POSTGETCLEANUP],
+						    handle->globalPlugins[POSTGETCLEANUP][FOREACH], 0, traceStart, ksGetSize (ks));
 				keySetName (parentKey, keyName (split->parents[i]));
 			}
 
 			if (backend->getplugins[p] && backend->getplugins[p]->kdbGet)
 			{
+				const uint64_t traceStart = elektraTraceNow (handle);
 				if (p <= STORAGE_PLUGIN)
 				{
 					ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], parentKey);
+					elektraTraceRecord (handle, "getstorage", backend->getplugins[p], backend->mountpoint, traceStart,
+							    ksGetSize (split->keysets[i]));
 				}
 				else
 				{
 					KeySet * cutKS = prepareGlobalKS (ks, parentKey);
 					ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], cutKS, parentKey);
+					elektraTraceRecord (handle, "getstorage", backend->getplugins[p], backend->mountpoint, traceStart,
+							    ksGetSize (cutKS));
 					ksAppend (ks, cutKS);
 					ksDel (cutKS);
 				}
@@ -640,13 +740,13 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 			{
 				// Ohh, an error occurred,
 				// lets stop the process.
-				elektraGlobalError (handle, ks, parentKey, GETSTORAGE, DEINIT);
+				elektraGlobalError (globals, ks, parentKey, GETSTORAGE, DEINIT);
 				// elektraGlobalError (handle, ks, parentKey, POSTGETSTORAGE, DEINIT);
 				return -1;
 			}
 		}
 	}
-	elektraGlobalGet (handle, ks, parentKey, GETSTORAGE, DEINIT);
+	elektraGlobalGet (globals, ks, parentKey, GETSTORAGE, DEINIT);
 	// elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, DEINIT);
 	return 0;
 }
@@ -781,6 +881,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	ELEKTRA_LOG ("now in new kdbGet (%s)", keyName (parentKey));
 
 	Split * split = splitNew ();
+	elektraTraceBegin (handle, parentKey);
 
 	if (!handle || !ks)
 	{
@@ -793,15 +894,17 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	elektraGlobalGet (handle, ks, parentKey, PREGETSTORAGE, MAXONCE);
 	elektraGlobalGet (handle, ks, parentKey, PREGETSTORAGE, DEINIT);
 
+	uint64_t start = elektraTraceNow (handle);
 	if (splitBuildup (split, handle, parentKey) == -1)
 	{
 		clearError (parentKey);
 		ELEKTRA_SET_ERROR (38, parentKey, "error in splitBuildup");
 		goto error;
 	}
+	elektraTraceRecord (handle, "splitBuildup", 0, 0, start, -1);
 
 	// Check if a update is needed at all
-	switch (elektraGetCheckUpdateNeeded (split, parentKey))
+	switch (elektraGetCheckUpdateNeeded (handle, split, parentKey))
 	{
 	case 0: // We don't need an update so let's do nothing
 		keySetName (parentKey, keyName (initialParent));
@@ -811,6 +914,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		splitUpdateFileName (split, handle, parentKey);
 		keyDel (initialParent);
 		splitDel (split);
+		elektraTraceEnd (handle, parentKey, "get", ksGetSize (ks));
 		errno = errnosave;
 		keyDel (oldError);
 		return 0;
@@ -830,7 +934,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	if (handle->globalPlugins[POSTGETSTORAGE][FOREACH] || handle->globalPlugins[POSTGETCLEANUP][FOREACH])
 	{
 		clearError (parentKey);
-		if (elektraGetDoUpdateWithGlobalHooks (NULL, split, NULL, parentKey, initialParent, FIRST) == -1)
+		if (elektraGetDoUpdateWithGlobalHooks (handle, split, NULL, parentKey, initialParent, FIRST) == -1)
 		{
 			goto error;
 		}
@@ -841,6 +945,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 
 		keySetName (parentKey, keyName (initialParent));
 
+		start = elektraTraceNow (handle);
 		if (splitGet (split, parentKey, handle) == -1)
 		{
 			ELEKTRA_ADD_WARNING (108, parentKey, keyName (ksCurrent (ks)));
@@ -848,6 +953,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		}
 		ksClear (ks);
 		splitMerge (split, ks);
+		elektraTraceRecord (handle, "merge", 0, 0, start, ksGetSize (ks));
 
 		clearError (parentKey);
 		if (elektraGetDoUpdateWithGlobalHooks (handle, split, ks, parentKey, initialParent, LAST) == -1)
@@ -865,7 +971,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		/* Now do the real updating,
 		   but not for bypassed keys in split->size-1 */
 		clearError (parentKey);
-		if (elektraGetDoUpdate (split, parentKey) == -1)
+		if (elektraGetDoUpdate (handle, split, parentKey) == -1)
 		{
 			goto error;
 		}
@@ -874,6 +980,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 			copyError (parentKey, oldError);
 		}
 		/* Now post-process the updated keysets */
+		start = elektraTraceNow (handle);
 		if (splitGet (split, parentKey, handle) == -1)
 		{
 			ELEKTRA_ADD_WARNING (108, parentKey, keyName (ksCurrent (ks)));
@@ -883,12 +990,23 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		ksClear (ks);
 
 		splitMerge (split, ks);
+		elektraTraceRecord (handle, "merge", 0, 0, start, ksGetSize (ks));
 	}
 
 	elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, INIT);
 	elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, MAXONCE);
 	elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, DEINIT);
 
+	if (handle->internPool)
+	{
+		start = elektraTraceNow (handle);
+		if (elektraInternPoolAdd (handle->internPool, ks) == -1)
+		{
+			ELEKTRA_LOG_WARNING ("could not intern the metadata of all keys");
+		}
+		elektraTraceRecord (handle, "intern", 0, 0, start, ksGetSize (ks));
+	}
+
 	ksRewind (ks);
 
 	keySetName (parentKey, keyName (initialParent));
@@ -897,6 +1015,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	keyDel (initialParent);
 	keyDel (oldError);
 	splitDel (split);
+	elektraTraceEnd (handle, parentKey, "get", ksGetSize (ks));
 	errno = errnosave;
 	return 1;
 
@@ -911,96 +1030,302 @@ error:
 	keyDel (initialParent);
 	keyDel (oldError);
 	splitDel (split);
+	elektraTraceEnd (handle, parentKey, "get", ksGetSize (ks));
 	errno = errnosave;
 	return -1;
 }
 
 /**
  * @internal
- * @brief Does all set steps but not commit
+ * @brief Checks if value or metadata of two keys with the same name differ
+ *
+ * @retval 1 if the keys differ
+ * @retval 0 if the keys are equal
+ */
+static int elektraGetDeltaKeyChanged (const Key * oldKey, const Key * newKey)
+{
+	if (oldKey->dataSize != newKey->dataSize) return 1;
+	if (oldKey->dataSize > 0 && memcmp (oldKey->data.v, newKey->data.v, oldKey->dataSize)) return 1;
+
+	// keys duplicated from each other share their metadata
+	if (oldKey->meta == newKey->meta) return 0;
+
+	const size_t oldMetaSize = oldKey->meta ? oldKey->meta->size : 0;
+	const size_t newMetaSize = newKey->meta ? newKey->meta->size : 0;
+	if (oldMetaSize != newMetaSize) return 1;
+
+	// metakeys are sorted, so they can be compared pairwise
+	for (size_t i = 0; i < oldMetaSize; ++i)
+	{
+		const Key * oldMeta = oldKey->meta->array[i];
+		const Key * newMeta = newKey->meta->array[i];
+		if (oldMeta == newMeta) continue;
+		if (keyCmp (oldMeta, newMeta)) return 1;
+		if (elektraGetDeltaKeyChanged (oldMeta, newMeta)) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ * @brief Compares the keys before and after kdbGet()
+ *
+ * Both keysets are sorted, so one pass over them is enough.
+ * Keys which are equal to the key with the same name in @p previous
+ * are replaced by the key of @p previous within @p ks, so that
+ * unchanged keys keep their identity.
+ *
+ * @param previous the keys passed to kdbGet()
+ * @param ks the keys returned by kdbGet(), will be modified
+ * @param added, removed, modified receive the changed keys, may be 0
+ */
+static void elektraGetDelta (KeySet * previous, KeySet * ks, KeySet * added, KeySet * removed, KeySet * modified)
+{
+	size_t i = 0;
+	size_t j = 0;
+	while (i < previous->size || j < ks->size)
+	{
+		int cmp;
+		if (i == previous->size)
+			cmp = 1;
+		else if (j == ks->size)
+			cmp = -1;
+		else if (previous->array[i] == ks->array[j])
+			cmp = 0;
+		else
+			cmp = keyCmp (previous->array[i], ks->array[j]);
+
+		if (cmp < 0)
+		{
+			if (removed) ksAppendKey (removed, previous->array[i]);
+			++i;
+			continue;
+		}
+
+		if (cmp > 0)
+		{
+			if (added) ksAppendKey (added, ks->array[j]);
+			++j;
+			continue;
+		}
+
+		Key * oldKey = previous->array[i];
+		Key * newKey = ks->array[j];
+		if (oldKey != newKey)
+		{
+			if (elektraGetDeltaKeyChanged (oldKey, newKey))
+			{
+				if (modified) ksAppendKey (modified, newKey);
+			}
+			else
+			{
+				// same name, so the key stays at its position
+				keyIncRef (oldKey);
+				keyDecRef (newKey);
+				keyDel (newKey);
+				ks->array[j] = oldKey;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+				if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexReplace (ks->hashIndex, newKey, oldKey);
+#endif
+				elektraKsNextGeneration (ks);
+			}
+		}
+		++i;
+		++j;
+	}
+}
+
+/**
+ * @brief Retrieve keys like kdbGet() and report what changed.
+ *
+ * Works exactly like kdbGet(), but additionally compares the keys
+ * returned with the keys passed in @p ks. Applications polling the
+ * key database do not need to compare the keysets themselves.
+ *
+ * Keys whose value and metadata did not change are kept in @p ks
+ * as they were passed, so pointers to them stay valid. Keys of
+ * backends which were not updated are recognized by their identity,
+ * only their names are compared.
+ *
+ * The keysets receiving the changes are not cleared, the changes are
+ * appended.
+ *
+ * @param handle contains internal information of @link kdbOpen() opened @endlink key database
+ * @param ks the keyset to update, see kdbGet()
+ * @param parentKey see kdbGet()
+ * @param added receives keys which are not in @p ks before, may be NULL
+ * @param removed receives keys which are not in @p ks anymore, may be NULL
+ * @param modified receives the new version of keys whose value or metadata changed, may be NULL
+ *
+ * @retval 1 if the keys were retrieved successfully
+ * @retval 0 if there was no update - no changes are reported then
+ * @retval -1 on failure - no changes are reported then
+ * @see kdbGet()
+ * @ingroup proposal
+ */
+int kdbGetDelta (KDB * handle, KeySet * ks, Key * parentKey, KeySet * added, KeySet * removed, KeySet * modified)
+{
+	if (!ks) return kdbGet (handle, ks, parentKey);
+
+	KeySet * previous = ksDup (ks);
+	if (!previous)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "could not duplicate keyset passed to kdbGetDelta");
+		return -1;
+	}
+
+	int ret = kdbGet (handle, ks, parentKey);
+	if (ret == 1)
+	{
+		elektraGetDelta (previous, ks, added, removed, modified);
+	}
+
+	ksDel (previous);
+	return ret;
+}
+
+/**
+ * @internal
+ * @brief Runs the set plugins first to last-1 of one backend of the split
  *
+ * @param handle holds the global plugins
  * @param split all information for iteration
+ * @param i the index of the backend within the split
  * @param parentKey to add warnings (also passed to plugins for the same reason)
  * @param [out] errorKey may point to which key caused the error or 0 otherwise
+ * @param first the first plugin to run
+ * @param last the plugin to stop before
  *
+ * @retval 1 on success
+ * @retval 0 if the resolver says that sync is not needed
  * @retval -1 on error
- * @retval 0 on success
  */
-static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, Plugin * hooks[][NR_GLOBAL_SUBPOSITIONS])
+static int elektraSetPrepareBackend (KDB * handle, Split * split, size_t i, Key * parentKey, Key ** errorKey, size_t first,
+				     size_t last)
 {
-	int any_error = 0;
-	for (size_t i = 0; i < split->size; i++)
+	Plugin * (*hooks)[NR_GLOBAL_SUBPOSITIONS] = handle->globalPlugins;
+	int any_error = 1;
+	for (size_t p = first; p < last; ++p)
 	{
-		for (size_t p = 0; p < COMMIT_PLUGIN; ++p)
-		{
-			int ret = 0; // last return value
+		int ret = 0; // last return value
 
-			Backend * backend = split->handles[i];
-			ksRewind (split->keysets[i]);
-			if (backend->setplugins[p] && backend->setplugins[p]->kdbSet)
+		Backend * backend = split->handles[i];
+		ksRewind (split->keysets[i]);
+		if (backend->setplugins[p] && backend->setplugins[p]->kdbSet)
+		{
+			if (p != 0)
 			{
-				if (p != 0)
-				{
-					keySetString (parentKey, keyString (split->parents[i]));
-				}
-				else
-				{
-					keySetString (parentKey, "");
-				}
-				keySetName (parentKey, keyName (split->parents[i]));
-				ret = backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], parentKey);
+				keySetString (parentKey, keyString (split->parents[i]));
+			}
+			else
+			{
+				keySetString (parentKey, "");
+			}
+			keySetName (parentKey, keyName (split->parents[i]));
+			const uint64_t start = elektraTraceNow (handle);
+			ret = backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], parentKey);
+			elektraTraceRecord (handle, p == 0 ? "setresolver" : "setstorage", backend->setplugins[p], backend->mountpoint,
+					    start, ksGetSize (split->keysets[i]));
 
 #if VERBOSE && DEBUG
-				printf ("Prepare %s with keys %zd in plugin: %zu, split: %zu, ret: %d\n", keyName (parentKey),
-					ksGetSize (split->keysets[i]), p, i, ret);
+			printf ("Prepare %s with keys %zd in plugin: %zu, split: %zu, ret: %d\n", keyName (parentKey),
+				ksGetSize (split->keysets[i]), p, i, ret);
 #endif
 
-				if (p == 0)
-				{
-					if (ret == 0)
-					{
-						// resolver says that sync is
-						// not needed, so we
-						// skip other pre-commit
-						// plugins
-						break;
-					}
-					keySetString (split->parents[i], keyString (parentKey));
-				}
-			}
-
 			if (p == 0)
 			{
-				if (hooks[PRESETSTORAGE][FOREACH])
+				if (ret == 0)
 				{
-					ksRewind (split->keysets[i]);
-					hooks[PRESETSTORAGE][FOREACH]->kdbSet (hooks[PRESETSTORAGE][FOREACH], split->keysets[i], parentKey);
+					// resolver says that sync is
+					// not needed, so we
+					// skip other pre-commit
+					// plugins
+					return 0;
 				}
+				keySetString (split->parents[i], keyString (parentKey));
 			}
-			else if (p == (STORAGE_PLUGIN - 1))
+		}
+
+		if (p == 0)
+		{
+			if (hooks[PRESETSTORAGE][FOREACH])
 			{
-				if (hooks[PRESETCLEANUP][FOREACH])
-				{
-					ksRewind (split->keysets[i]);
-					hooks[PRESETCLEANUP][FOREACH]->kdbSet (hooks[PRESETCLEANUP][FOREACH], split->keysets[i], parentKey);
-				}
+				ksRewind (split->keysets[i]);
+				const uint64_t start = elektraTraceNow (handle);
+				hooks[PRESETSTORAGE][FOREACH]->kdbSet (hooks[PRESETSTORAGE][FOREACH], split->keysets[i], parentKey);
+				elektraTraceRecord (handle, GlobalpluginPositionsStr[PRESETSTORAGE], hooks[PRESETSTORAGE][FOREACH],
+						    split->handles[i]->mountpoint, start, ksGetSize (split->keysets[i]));
 			}
-
-			if (ret == -1)
+		}
+		else if (p == (STORAGE_PLUGIN - 1))
+		{
+			if (hooks[PRESETCLEANUP][FOREACH])
 			{
-				// do not
-				// abort because it might
-				// corrupt the KeySet
-				// and leads to warnings
-				// because of .tmp files not
-				// found
-				*errorKey = ksCurrent (split->keysets[i]);
-
-				// so better keep going, but of
-				// course we will not commit
-				any_error = -1;
+				ksRewind (split->keysets[i]);
+				const uint64_t start = elektraTraceNow (handle);
+				hooks[PRESETCLEANUP][FOREACH]->kdbSet (hooks[PRESETCLEANUP][FOREACH], split->keysets[i], parentKey);
+				elektraTraceRecord (handle, GlobalpluginPositionsStr[PRESETCLEANUP], hooks[PRESETCLEANUP][FOREACH],
+						    split->handles[i]->mountpoint, start, ksGetSize (split->keysets[i]));
 			}
 		}
+
+		if (ret == -1)
+		{
+			// do not
+			// abort because it might
+			// corrupt the KeySet
+			// and leads to warnings
+			// because of .tmp files not
+			// found
+			*errorKey = ksCurrent (split->keysets[i]);
+
+			// so better keep going, but of
+			// course we will not commit
+			any_error = -1;
+		}
+	}
+	return any_error;
+}
+
+/** Runs the resolver of a backend, see elektraSetPrepareBackend() */
+static int elektraSetPrepareResolver (KDB * handle, Split * split, size_t i, Key * parentKey, Key ** errorKey)
+{
+	return elektraSetPrepareBackend (handle, split, i, parentKey, errorKey, RESOLVER_PLUGIN, RESOLVER_PLUGIN + 1);
+}
+
+/** Runs the plugins after the resolver up to the commit plugin, see elektraSetPrepareBackend() */
+static int elektraSetPrepareStorage (KDB * handle, Split * split, size_t i, Key * parentKey, Key ** errorKey)
+{
+	return elektraSetPrepareBackend (handle, split, i, parentKey, errorKey, RESOLVER_PLUGIN + 1, COMMIT_PLUGIN);
+}
+
+/**
+ * @internal
+ * @brief Does all set steps but not commit
+ *
+ * @param handle holds the global plugins and the parallel configuration
+ * @param split all information for iteration
+ * @param parentKey to add warnings (also passed to plugins for the same reason)
+ * @param [out] errorKey may point to which key caused the error or 0 otherwise
+ *
+ * @retval -1 on error
+ * @retval 0 on success
+ */
+static int elektraSetPrepare (KDB * handle, Split * split, Key * parentKey, Key ** errorKey)
+{
+	// the global cleanup plugin is shared by all backends, so it cannot run in parallel
+	if (handle->parallelThreads > 0 && !handle->globalPlugins[PRESETCLEANUP][FOREACH])
+	{
+		return elektraParallelSet (handle, split, parentKey, errorKey, elektraSetPrepareResolver, elektraSetPrepareStorage);
+	}
+
+	int any_error = 0;
+	for (size_t i = 0; i < split->size; i++)
+	{
+		if (elektraSetPrepareBackend (handle, split, i, parentKey, errorKey, RESOLVER_PLUGIN, COMMIT_PLUGIN) == -1)
+		{
+			any_error = -1;
+		}
 	}
 	return any_error;
 }
@@ -1009,10 +1334,11 @@ static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, P
  * @internal
  * @brief Does the commit
  *
+ * @param handle for tracing
  * @param split all information for iteration
  * @param parentKey to add warnings (also passed to plugins for the same reason)
  */
-static void elektraSetCommit (Split * split, Key * parentKey)
+static void elektraSetCommit (KDB * handle, Split * split, Key * parentKey)
 {
 	for (size_t p = COMMIT_PLUGIN; p < NR_OF_PLUGINS; ++p)
 	{
@@ -1033,7 +1359,10 @@ static void elektraSetCommit (Split * split, Key * parentKey)
 					keyString (parentKey));
 #endif
 				ksRewind (split->keysets[i]);
+				const uint64_t start = elektraTraceNow (handle);
 				ret = backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], parentKey);
+				elektraTraceRecord (handle, "commit", backend->setplugins[p], backend->mountpoint, start,
+						    ksGetSize (split->keysets[i]));
 				if (p == COMMIT_PLUGIN)
 				{
 					// name of non-temp file
@@ -1053,10 +1382,11 @@ static void elektraSetCommit (Split * split, Key * parentKey)
  * @internal
  * @brief Does the rollback
  *
+ * @param handle for tracing
  * @param split all information for iteration
  * @param parentKey to add warnings (also passed to plugins for the same reason)
  */
-static void elektraSetRollback (Split * split, Key * parentKey)
+static void elektraSetRollback (KDB * handle, Split * split, Key * parentKey)
 {
 	for (size_t p = 0; p < NR_OF_PLUGINS; ++p)
 	{
@@ -1069,7 +1399,10 @@ static void elektraSetRollback (Split * split, Key * parentKey)
 			if (backend->errorplugins[p])
 			{
 				keySetName (parentKey, keyName (split->parents[i]));
+				const uint64_t start = elektraTraceNow (handle);
 				ret = backend->errorplugins[p]->kdbError (backend->errorplugins[p], split->keysets[i], parentKey);
+				elektraTraceRecord (handle, "rollback", backend->errorplugins[p], backend->mountpoint, start,
+						    ksGetSize (split->keysets[i]));
 			}
 
 			if (ret == -1)
@@ -1187,6 +1520,8 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 
 	ELEKTRA_LOG ("now in new kdbSet (%s) %p %zd", keyName (parentKey), (void *) handle, ksGetSize (ks));
 
+	elektraTraceBegin (handle, parentKey);
+
 	elektraGlobalSet (handle, ks, parentKey, PRESETSTORAGE, INIT);
 	elektraGlobalSet (handle, ks, parentKey, PRESETSTORAGE, MAXONCE);
 	elektraGlobalSet (handle, ks, parentKey, PRESETSTORAGE, DEINIT);
@@ -1196,14 +1531,17 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	Split * split = splitNew ();
 	Key * errorKey = 0;
 
+	uint64_t start = elektraTraceNow (handle);
 	if (splitBuildup (split, handle, parentKey) == -1)
 	{
 		clearError (parentKey); // clear previous error to set new one
 		ELEKTRA_SET_ERROR (38, parentKey, "error in splitBuildup");
 		goto error;
 	}
+	elektraTraceRecord (handle, "splitBuildup", 0, 0, start, -1);
 
 	// 1.) Search for syncbits
+	start = elektraTraceNow (handle);
 	int syncstate = splitDivide (split, handle, ks);
 	if (syncstate == -1)
 	{
@@ -1216,6 +1554,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	// 2.) Search for changed sizes
 	syncstate |= splitSync (split);
 	ELEKTRA_ASSERT (syncstate <= 1, "syncstate not equal or below 1, but %d", syncstate);
+	elektraTraceRecord (handle, "splitDivide", 0, 0, start, -1);
 	if (syncstate != 1)
 	{
 		/* No update is needed */
@@ -1231,6 +1570,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 		}
 		keyDel (initialParent);
 		splitDel (split);
+		elektraTraceEnd (handle, parentKey, "set", ksGetSize (ks));
 		errno = errnosave;
 		keyDel (oldError);
 		return syncstate == 0 ? 0 : -1;
@@ -1240,7 +1580,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	splitPrepare (split);
 
 	clearError (parentKey); // clear previous error to set new one
-	if (elektraSetPrepare (split, parentKey, &errorKey, handle->globalPlugins) == -1)
+	if (elektraSetPrepare (handle, split, parentKey, &errorKey) == -1)
 	{
 		goto error;
 	}
@@ -1255,7 +1595,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	elektraGlobalSet (handle, ks, parentKey, PRECOMMIT, MAXONCE);
 	elektraGlobalSet (handle, ks, parentKey, PRECOMMIT, DEINIT);
 
-	elektraSetCommit (split, parentKey);
+	elektraSetCommit (handle, split, parentKey);
 
 	elektraGlobalSet (handle, ks, parentKey, COMMIT, INIT);
 	elektraGlobalSet (handle, ks, parentKey, COMMIT, MAXONCE);
@@ -1280,6 +1620,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	splitDel (split);
 
 	keyDel (oldError);
+	elektraTraceEnd (handle, parentKey, "set", ksGetSize (ks));
 	errno = errnosave;
 	return 1;
 
@@ -1290,7 +1631,7 @@ error:
 	elektraGlobalError (handle, ks, parentKey, PREROLLBACK, MAXONCE);
 	elektraGlobalError (handle, ks, parentKey, PREROLLBACK, DEINIT);
 
-	elektraSetRollback (split, parentKey);
+	elektraSetRollback (handle, split, parentKey);
 
 	if (errorKey)
 	{
@@ -1310,6 +1651,7 @@ error:
 	keySetName (parentKey, keyName (initialParent));
 	keyDel (initialParent);
 	splitDel (split);
+	elektraTraceEnd (handle, parentKey, "set", ksGetSize (ks));
 	errno = errnosave;
 	keyDel (oldError);
 	return -1;
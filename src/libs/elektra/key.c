@@ -282,6 +282,7 @@ Key * keyDup (const Key * source)
 
 	/* prepare to set dynamic properties */
 	dest->key = dest->data.v = dest->meta = 0;
+	dest->arena = 0;
 
 	/* copy dynamic properties */
 	if (keyCopy (dest, source) == -1)
@@ -310,9 +311,9 @@ Key * keyDup (const Key * source)
  * both keys. Affiliation to keysets
  * are also not affected.
  *
- * The metadata will be duplicated for the destination
- * key. So it will not take much additional space, even
- * with lots of metadata.
+ * The metadata will be shared with the destination
+ * key until one of them modifies it. So it will not take
+ * much additional space, even with lots of metadata.
  *
  * When you pass a NULL-pointer as source the
  * data of dest will be cleaned completely
@@ -362,7 +363,6 @@ int keyCopy (Key * dest, const Key * source)
 	// remember dynamic memory to be removed
 	char * destKey = dest->key;
 	void * destData = dest->data.c;
-	KeySet * destMeta = dest->meta;
 
 	// duplicate dynamic properties
 	if (source->key)
@@ -385,39 +385,28 @@ int keyCopy (Key * dest, const Key * source)
 		dest->data.v = 0;
 	}
 
-	if (source->meta)
-	{
-		dest->meta = ksDup (source->meta);
-		if (!dest->meta) goto memerror;
-	}
-	else
-	{
-		dest->meta = 0;
-	}
-
 	// successful, now do the irreversible stuff: we obviously modified dest
 	set_bit (dest->flags, KEY_FLAG_SYNC);
+	elektraKeyMetaShare (dest, source);
 
 	// copy sizes accordingly
 	dest->keySize = source->keySize;
 	dest->keyUSize = source->keyUSize;
 	dest->dataSize = source->dataSize;
 
-	// free old resources of destination
-	elektraFree (destKey);
-	elektraFree (destData);
-	ksDel (destMeta);
+	// free old resources of destination (arena memory is released with the key)
+	if (!test_bit (dest->flags, KEY_FLAG_ARENA_NAME)) elektraFree (destKey);
+	if (!test_bit (dest->flags, KEY_FLAG_ARENA_VALUE)) elektraFree (destData);
+	clear_bit (dest->flags, KEY_FLAG_ARENA_NAME | KEY_FLAG_ARENA_VALUE);
 
 	return 1;
 
 memerror:
 	elektraFree (dest->key);
 	elektraFree (dest->data.v);
-	ksDel (dest->meta);
 
 	dest->key = destKey;
 	dest->data.v = destData;
-	dest->meta = destMeta;
 	return -1;
 }
 
@@ -461,7 +450,14 @@ int keyDel (Key * key)
 	}
 
 	rc = keyClear (key);
-	elektraFree (key);
+	if (test_bit (key->flags, KEY_FLAG_ARENA_STRUCT))
+	{
+		elektraArenaRelease (key->arena);
+	}
+	else
+	{
+		elektraFree (key);
+	}
 
 	return rc;
 }
@@ -503,11 +499,13 @@ int keyClear (Key * key)
 	}
 
 	size_t ref = 0;
+	ElektraArena * arena = key->arena;
+	keyflag_t arenaStruct = key->flags & KEY_FLAG_ARENA_STRUCT;
 
 	ref = key->ksReference;
-	if (key->key) elektraFree (key->key);
-	if (key->data.v) elektraFree (key->data.v);
-	if (key->meta) ksDel (key->meta);
+	if (key->key && !test_bit (key->flags, KEY_FLAG_ARENA_NAME)) elektraFree (key->key);
+	if (key->data.v && !test_bit (key->flags, KEY_FLAG_ARENA_VALUE)) elektraFree (key->data.v);
+	elektraKeyMetaRelease (key);
 
 	keyInit (key);
 
@@ -515,6 +513,10 @@ int keyClear (Key * key)
 	/* Set reference properties */
 	key->ksReference = ref;
 
+	/* The struct itself still lives in the arena */
+	key->arena = arena;
+	key->flags |= arenaStruct;
+
 	return 0;
 }
 
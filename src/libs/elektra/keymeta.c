@@ -123,6 +123,250 @@
 #include <errno.h>
 #endif
 
+/**
+ * Names of metadata used by many keys, stored as escaped and
+ * unescaped name like Key::key, sorted by the escaped name.
+ * Metakeys with these names reference them instead of a copy.
+ */
+#define ELEKTRA_META_NAME(name, unescaped)                                                                                                 \
+	{                                                                                                                                  \
+		name "\0" unescaped, sizeof (name), sizeof (unescaped)                                                                     \
+	}
+
+static const struct
+{
+	const char * name;
+	size_t keySize;
+	size_t keyUSize;
+} elektraMetaNames[] = {
+	ELEKTRA_META_NAME ("array", "array"),
+	ELEKTRA_META_NAME ("binary", "binary"),
+	ELEKTRA_META_NAME ("check/enum", "check\0enum"),
+	ELEKTRA_META_NAME ("check/path", "check\0path"),
+	ELEKTRA_META_NAME ("check/range", "check\0range"),
+	ELEKTRA_META_NAME ("check/type", "check\0type"),
+	ELEKTRA_META_NAME ("check/validation", "check\0validation"),
+	ELEKTRA_META_NAME ("check/validation/message", "check\0validation\0message"),
+	ELEKTRA_META_NAME ("comment/#0", "comment\0#0"),
+	ELEKTRA_META_NAME ("comment/#0/space", "comment\0#0\0space"),
+	ELEKTRA_META_NAME ("comment/#0/start", "comment\0#0\0start"),
+	ELEKTRA_META_NAME ("default", "default"),
+	ELEKTRA_META_NAME ("description", "description"),
+	ELEKTRA_META_NAME ("env", "env"),
+	ELEKTRA_META_NAME ("internal/ini/key/number", "internal\0ini\0key\0number"),
+	ELEKTRA_META_NAME ("internal/ini/order", "internal\0ini\0order"),
+	ELEKTRA_META_NAME ("internal/ini/parent", "internal\0ini\0parent"),
+	ELEKTRA_META_NAME ("internal/ini/section", "internal\0ini\0section"),
+	ELEKTRA_META_NAME ("opt", "opt"),
+	ELEKTRA_META_NAME ("opt/long", "opt\0long"),
+	ELEKTRA_META_NAME ("order", "order"),
+	ELEKTRA_META_NAME ("origvalue", "origvalue"),
+	ELEKTRA_META_NAME ("override/#0", "override\0#0"),
+	ELEKTRA_META_NAME ("type", "type"),
+};
+
+
+/**
+ * @internal
+ *
+ * @brief Adds a further key to the users of the KeySet of metadata.
+ *
+ * The number of shares is changed atomically, but this does not make
+ * keys sharing metadata safe to use from different threads: like
+ * keyDup() always did, they share metakeys whose reference counts are
+ * not atomic. Such keys must be modified and deleted by one thread at a time.
+ */
+void elektraKeyMetaRef (KeySet * meta)
+{
+	__atomic_add_fetch (&meta->metaShares, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes a user of the KeySet of metadata, the last one deletes it.
+ */
+void elektraKeyMetaUnref (KeySet * meta)
+{
+	size_t shares = __atomic_load_n (&meta->metaShares, __ATOMIC_ACQUIRE);
+	// only the last user sees no further shares
+	while (shares && !__atomic_compare_exchange_n (&meta->metaShares, &shares, shares - 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+	}
+	if (!shares) ksDel (meta);
+}
+
+/**
+ * @internal
+ *
+ * @retval 1 if further keys use the KeySet of metadata
+ * @retval 0 otherwise
+ */
+int elektraKeyMetaIsShared (const KeySet * meta)
+{
+	return __atomic_load_n (&meta->metaShares, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Replaces the metadata of dest with the metadata of source.
+ *
+ * The KeySet of the metadata is shared until one of the keys modifies
+ * its metadata, see elektraKeyMetaDetach().
+ *
+ * @param dest the key to set the metadata of
+ * @param source the key to share the metadata with, may be dest
+ */
+void elektraKeyMetaShare (Key * dest, const Key * source)
+{
+	KeySet * meta = source->meta;
+	if (meta) elektraKeyMetaRef (meta);
+	elektraKeyMetaRelease (dest);
+	dest->meta = meta;
+}
+
+/**
+ * @internal
+ *
+ * @brief Gives a key its own copy of shared metadata.
+ *
+ * Must be called before the KeySet of the metadata is modified.
+ * The copy references the same metakeys, which are read-only anyway,
+ * and keeps the cursor, so iterations over the metadata continue.
+ *
+ * @param key the key which will modify its metadata
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors (the metadata is still shared then)
+ */
+int elektraKeyMetaDetach (Key * key)
+{
+	if (!key->meta || !elektraKeyMetaIsShared (key->meta)) return 0;
+
+	KeySet * meta = ksDup (key->meta);
+	if (!meta) return -1;
+	// the copy holds the same metakeys
+	meta->cursor = key->meta->cursor;
+	meta->current = key->meta->current;
+
+	elektraKeyMetaUnref (key->meta);
+	key->meta = meta;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes the metadata of a key, it is deleted with its last key.
+ *
+ * @param key the key to remove the metadata from
+ */
+void elektraKeyMetaRelease (Key * key)
+{
+	if (!key->meta) return;
+
+	elektraKeyMetaUnref (key->meta);
+	key->meta = 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Sets the name of a key used to look up metadata.
+ *
+ * Most names are stored in @p buffer, only long names and names that
+ * need to be canonicalized differently are allocated.
+ *
+ * @param search a key initialized with keyInit()
+ * @param metaName the name of the metadata
+ * @param buffer ELEKTRA_KEYNAME_STACK_SIZE bytes
+ *
+ * @retval 0 on success, clean up with elektraKeyMetaNameClear()
+ * @retval -1 on invalid names
+ */
+static int elektraKeyMetaNameSet (Key * search, const char * metaName, char * buffer)
+{
+	if (elektraKeyNameBufferSize (metaName) <= ELEKTRA_KEYNAME_STACK_SIZE && elektraKeySetNameBuffer (search, metaName, buffer) != -1)
+	{
+		return 0;
+	}
+
+	// long names and names with owner
+	keyInit (search);
+	return elektraKeySetName (search, metaName, KEY_META_NAME | KEY_EMPTY_NAME) == -1 ? -1 : 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees what elektraKeyMetaNameSet() allocated.
+ */
+static void elektraKeyMetaNameClear (Key * search)
+{
+	if (!test_bit (search->flags, KEY_FLAG_ARENA_NAME)) elektraFree (search->key);
+	ksDel (search->meta);
+}
+
+/**
+ * @internal
+ *
+ * @return the interned copy of the name of search or 0 if there is none
+ */
+static const char * elektraKeyMetaInternedName (const Key * search)
+{
+	size_t left = 0;
+	size_t right = sizeof (elektraMetaNames) / sizeof (elektraMetaNames[0]);
+	while (left < right)
+	{
+		const size_t middle = left + (right - left) / 2;
+		const int cmp = strcmp (search->key, elektraMetaNames[middle].name);
+		if (cmp == 0)
+		{
+			// escaped names with the same characters have the same unescaped name
+			return elektraMetaNames[middle].keyUSize == search->keyUSize ? elektraMetaNames[middle].name : 0;
+		}
+		if (cmp < 0)
+			right = middle;
+		else
+			left = middle + 1;
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Creates a read-only metakey in a single allocation.
+ *
+ * @param search a key with the name of the metakey
+ * @param value the value of the metakey
+ * @param valueSize the size of value including the terminating null
+ *
+ * @return the new metakey or 0 on memory errors
+ */
+static Key * elektraKeyMetaNew (const Key * search, const char * value, size_t valueSize)
+{
+	const char * interned = elektraKeyMetaInternedName (search);
+	Key * metaKey;
+	if (interned)
+	{
+		Key internedKey = *search;
+		internedKey.key = (char *) interned;
+		metaKey = elektraArenaKeyNewSingle (&internedKey, 1, value, valueSize);
+	}
+	else
+	{
+		metaKey = elektraArenaKeyNewSingle (search, 0, value, valueSize);
+	}
+	if (!metaKey) return 0;
+
+	set_bit (metaKey->flags, KEY_FLAG_RO_NAME);
+	set_bit (metaKey->flags, KEY_FLAG_RO_VALUE);
+	set_bit (metaKey->flags, KEY_FLAG_RO_META);
+	return metaKey;
+}
+
 
 /**Rewind the internal iterator to first metadata.
  *
@@ -154,6 +398,8 @@ int keyRewindMeta (Key * key)
 {
 	if (!key) return -1;
 	if (!key->meta) return 0;
+	// the cursor must not be shared with other keys
+	if (elektraKeyMetaDetach (key) == -1) return -1;
 
 	return ksRewind (key->meta);
 }
@@ -188,6 +434,7 @@ const Key * keyNextMeta (Key * key)
 	Key * ret;
 	if (!key) return 0;
 	if (!key->meta) return 0;
+	if (elektraKeyMetaDetach (key) == -1) return 0;
 
 	ret = ksNext (key->meta);
 
@@ -305,6 +552,7 @@ int keyCopyMeta (Key * dest, const Key * source, const char * metaName)
 	if (dest->meta)
 	{
 		Key * r;
+		if (elektraKeyMetaDetach (dest) == -1) return -1;
 		r = ksLookup (dest->meta, ret, KDB_O_POP);
 		if (r)
 		{
@@ -374,11 +622,13 @@ int keyCopyAllMeta (Key * dest, const Key * source)
 		/*Make sure that dest also does not have metaName*/
 		if (dest->meta)
 		{
+			if (elektraKeyMetaDetach (dest) == -1) return -1;
 			ksAppend (dest->meta, source->meta);
 		}
 		else
 		{
-			dest->meta = ksDup (source->meta);
+			// shared until one of the keys modifies its metadata
+			elektraKeyMetaShare (dest, source);
 		}
 		return 1;
 	}
@@ -403,6 +653,9 @@ int f(Key *k)
  * @note You must not delete or change the returned key,
  *    use keySetMeta() if you want to delete or change it.
  *
+ * The metadata is not modified, so keys sharing their metadata
+ * can be read concurrently.
+ *
  * @param key the key object to work with
  * @param metaName the name of the meta information you want the value from
  * @retval 0 if the key or metaName is 0
@@ -413,19 +666,24 @@ int f(Key *k)
  **/
 const Key * keyGetMeta (const Key * key, const char * metaName)
 {
-	Key * ret;
-	Key * search;
+	Key * ret = 0;
 
 	if (!key) return 0;
 	if (!metaName) return 0;
 	if (!key->meta) return 0;
 
-	search = keyNew (0);
-	elektraKeySetName (search, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+	struct _Key search;
+	// short names are kept on the stack, so most lookups do not need the heap
+	char buffer[ELEKTRA_KEYNAME_STACK_SIZE];
 
-	ret = ksLookup (key->meta, search, 0);
-
-	keyDel (search);
+	keyInit (&search);
+	if (elektraKeyMetaNameSet (&search, metaName, buffer) == 0)
+	{
+		// unlike ksLookup() this leaves cursor and lookup caches alone
+		const ssize_t position = ksSearchInternal (key->meta, &search);
+		if (position >= 0) ret = key->meta->array[position];
+	}
+	elektraKeyMetaNameClear (&search);
 
 	return ret;
 }
@@ -458,8 +716,7 @@ const Key * keyGetMeta (const Key * key, const char * metaName)
  **/
 ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString)
 {
-	Key * toSet;
-	char * metaStringDup;
+	Key * toSet = 0;
 	ssize_t metaNameSize;
 	ssize_t metaStringSize = 0;
 
@@ -473,62 +730,57 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 	// optimization: we have nothing and want to remove something:
 	if (!key->meta && !newMetaString) return 0;
 
-	toSet = keyNew (0);
-	if (!toSet) return -1;
+	struct _Key search;
+	char buffer[ELEKTRA_KEYNAME_STACK_SIZE];
 
-	elektraKeySetName (toSet, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+	keyInit (&search);
+	if (elektraKeyMetaNameSet (&search, metaName, buffer) == -1)
+	{
+		elektraKeyMetaNameClear (&search);
+		return -1;
+	}
 
-	/*Lets have a look if the key is already inserted.*/
-	if (key->meta)
+	// ksLookup() would move the cursor of metadata shared with other keys
+	const ssize_t oldPosition = key->meta ? ksSearchInternal (key->meta, &search) : -1;
+	Key * old = oldPosition >= 0 ? key->meta->array[oldPosition] : 0;
+	if (!old && !newMetaString)
 	{
-		Key * ret;
-		ret = ksLookup (key->meta, toSet, KDB_O_POP);
-		if (ret)
-		{
-			/*It was already there, so lets drop that one*/
-			keyDel (ret);
-			key->flags |= KEY_FLAG_SYNC;
-		}
+		elektraKeyMetaNameClear (&search);
+		return 0;
 	}
 
 	if (newMetaString)
 	{
-		/*Add the meta information to the key*/
-		metaStringDup = elektraStrNDup (newMetaString, metaStringSize);
-		if (!metaStringDup)
+		/*Create the new meta information first, so that the key stays unchanged on errors*/
+		toSet = elektraKeyMetaNew (&search, newMetaString, metaStringSize);
+		if (!toSet)
 		{
-			// TODO: actually we might already have changed
-			// the key
-			keyDel (toSet);
+			elektraKeyMetaNameClear (&search);
 			return -1;
 		}
-
-		if (toSet->data.v) elektraFree (toSet->data.v);
-		toSet->data.c = metaStringDup;
-		toSet->dataSize = metaStringSize;
 	}
-	else
+
+	/*Other keys sharing the meta information keep the old one*/
+	if (elektraKeyMetaDetach (key) == -1 || (!key->meta && !(key->meta = ksNew (0, KS_END))))
 	{
-		/*The request is to remove the meta string.
-		  So simply drop it.*/
 		keyDel (toSet);
-		return 0;
+		elektraKeyMetaNameClear (&search);
+		return -1;
 	}
 
-	if (!key->meta)
+	if (old)
 	{
-		/*Create a new place for meta information.*/
-		key->meta = ksNew (0, KS_END);
-		if (!key->meta)
-		{
-			keyDel (toSet);
-			return -1;
-		}
+		/*It was already there, so lets drop that one*/
+		keyDel (ksLookup (key->meta, &search, KDB_O_POP));
+		key->flags |= KEY_FLAG_SYNC;
 	}
+	elektraKeyMetaNameClear (&search);
 
-	set_bit (toSet->flags, KEY_FLAG_RO_NAME);
-	set_bit (toSet->flags, KEY_FLAG_RO_VALUE);
-	set_bit (toSet->flags, KEY_FLAG_RO_META);
+	if (!toSet)
+	{
+		/*The request is to remove the meta string.*/
+		return 0;
+	}
 
 	ksAppendKey (key->meta, toSet);
 	key->flags |= KEY_FLAG_SYNC;
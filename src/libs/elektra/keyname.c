@@ -420,7 +420,8 @@ static void elektraHandleUserName (Key * key, const char * newName)
 
 static void elektraRemoveKeyName (Key * key)
 {
-	if (key->key) elektraFree (key->key);
+	if (key->key && !test_bit (key->flags, KEY_FLAG_ARENA_NAME)) elektraFree (key->key);
+	clear_bit (key->flags, KEY_FLAG_ARENA_NAME);
 	key->key = 0;
 	key->keySize = 0;
 	key->keyUSize = 0;
@@ -468,6 +469,106 @@ static int keyGetNameNamespace (const char * name)
 }
 
 
+static void elektraKeyNameAddLevels (Key * key, const char * newName);
+
+/**
+ * @internal
+ *
+ * @brief Sets keySize and keyUSize to the size of the root of newName.
+ *
+ * Note that keyUSize is abused for cascading and user:owner names.
+ *
+ * @retval 1 on success
+ * @retval 0 if newName is empty
+ * @retval -1 if newName has an invalid namespace
+ */
+static int elektraKeyNameSetRoot (Key * key, const char * newName, option_t options)
+{
+	switch (keyGetNameNamespace (newName))
+	{
+	case KEY_NS_NONE:
+		ELEKTRA_ASSERT (0, "non empty key has no namespace?");
+	case KEY_NS_EMPTY:
+		return 0;
+	case KEY_NS_CASCADING:
+		key->keyUSize = 1;
+		key->keySize = sizeof ("/");
+		break;
+	case KEY_NS_SPEC:
+		key->keyUSize = key->keySize = sizeof ("spec");
+		break;
+	case KEY_NS_PROC:
+		key->keyUSize = key->keySize = sizeof ("proc");
+		break;
+	case KEY_NS_DIR:
+		key->keyUSize = key->keySize = sizeof ("dir");
+		break;
+	case KEY_NS_USER:
+		elektraHandleUserName (key, newName);
+		break;
+	case KEY_NS_SYSTEM:
+		key->keyUSize = key->keySize = sizeof ("system");
+		break;
+	case KEY_NS_META:
+		if (!(options & KEY_META_NAME)) return -1;
+		keyNameGetOneLevel (newName, &key->keySize);
+		key->keyUSize = ++key->keySize; // for null
+		break;
+	}
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Copies the root of newName to key->key and adds the remaining levels.
+ *
+ * @pre key->key has space for twice the root set by elektraKeyNameSetRoot()
+ *
+ * @param inBuffer if key->key is large enough for the whole name already
+ */
+static ssize_t elektraKeyNameSetLevels (Key * key, const char * newName, int inBuffer)
+{
+	const size_t length = elektraStrLen (newName);
+	memcpy (key->key, newName, key->keySize);
+	if (length == key->keyUSize || length == key->keySize)
+	{ // use || because full length is keyUSize in user, but keySize for /
+		// newName consisted of root only
+		elektraFinalizeName (key);
+		return key->keyUSize;
+	}
+
+	if (elektraOnlySlashes (newName + key->keyUSize - 1))
+	{
+		elektraFinalizeName (key);
+		return key->keySize;
+	}
+
+	key->key[key->keySize - 1] = '\0';
+	const char * levels = newName + key->keyUSize;
+	ssize_t ret;
+	if (inBuffer)
+	{
+		ret = -1;
+		if (elektraValidateKeyName (levels, elektraStrLen (levels)))
+		{
+			elektraKeyNameAddLevels (key, levels);
+			ret = key->keySize;
+		}
+	}
+	else
+	{
+		ret = keyAddName (key, levels);
+	}
+
+	if (ret == -1)
+		elektraRemoveKeyName (key);
+	else
+		return key->keySize;
+	return ret;
+}
+
+
 /**
  * Set a new name to a key.
  *
@@ -518,62 +619,144 @@ ssize_t elektraKeySetName (Key * key, const char * newName, option_t options)
 	elektraRemoveKeyName (key);
 	if (!(options & KEY_META_NAME)) keySetOwner (key, NULL);
 
-	switch (keyGetNameNamespace (newName))
+	const int root = elektraKeyNameSetRoot (key, newName, options);
+	if (root == -1) return -1;
+	if (root == 0)
 	{
-	case KEY_NS_NONE:
-		ELEKTRA_ASSERT (0, "non empty key has no namespace?");
-	case KEY_NS_EMPTY:
 		elektraFinalizeEmptyName (key);
 		return 0; // as documented
-	case KEY_NS_CASCADING:
-		key->keyUSize = 1;
-		key->keySize = sizeof ("/");
-		break;
-	case KEY_NS_SPEC:
-		key->keyUSize = key->keySize = sizeof ("spec");
-		break;
-	case KEY_NS_PROC:
-		key->keyUSize = key->keySize = sizeof ("proc");
-		break;
-	case KEY_NS_DIR:
-		key->keyUSize = key->keySize = sizeof ("dir");
-		break;
-	case KEY_NS_USER:
-		elektraHandleUserName (key, newName);
-		break;
-	case KEY_NS_SYSTEM:
-		key->keyUSize = key->keySize = sizeof ("system");
-		break;
-	case KEY_NS_META:
-		if (!(options & KEY_META_NAME)) return -1;
-		keyNameGetOneLevel (newName, &key->keySize);
-		key->keyUSize = ++key->keySize; // for null
-		break;
-	} // Note that we abused keyUSize for cascading and user:owner
+	}
 
-	const size_t length = elektraStrLen (newName);
 	key->key = elektraMalloc (key->keySize * 2);
-	memcpy (key->key, newName, key->keySize);
-	if (length == key->keyUSize || length == key->keySize)
-	{ // use || because full length is keyUSize in user, but keySize for /
-		// newName consisted of root only
-		elektraFinalizeName (key);
-		return key->keyUSize;
+	return elektraKeyNameSetLevels (key, newName, 0);
+}
+
+/**
+ * @internal
+ *
+ * @brief Bytes needed by elektraKeySetNameBuffer() to store a name.
+ *
+ * @param name the name which will be set
+ *
+ * @return size of the buffer for both the escaped and the unescaped name
+ */
+size_t elektraKeyNameBufferSize (const char * name)
+{
+	if (!name) return 2;
+	return (strlen (name) + 2) * 2;
+}
+
+/**
+ * @internal
+ *
+ * @brief Sets an already canonical name in a single pass.
+ *
+ * Canonical names have a namespace (or are cascading), no escapes
+ * and no empty, `.`, `..` or `%` levels. Their unescaped name is the
+ * name with every `/` replaced by a null character.
+ *
+ * @retval 1 if the name was canonical and is set now
+ * @retval 0 if the name needs to be canonicalized (key is unchanged)
+ */
+static int elektraKeyNameSetCanonical (Key * key, const char * newName, char * buffer)
+{
+	const char * level = newName;
+	if (*newName != '/')
+	{
+		switch (keyGetNameNamespace (newName))
+		{
+		case KEY_NS_SPEC:
+		case KEY_NS_PROC:
+		case KEY_NS_DIR:
+		case KEY_NS_SYSTEM:
+			break;
+		case KEY_NS_USER:
+			if (newName[sizeof ("user") - 1] == ':') return 0;
+			break;
+		default:
+			return 0;
+		}
+		level = strchr (newName, '/');
+		if (!level) return 0;
 	}
 
-	if (elektraOnlySlashes (newName + key->keyUSize - 1))
+	const char * p = ++level;
+	for (;; ++p)
 	{
-		elektraFinalizeName (key);
-		return key->keySize;
+		if (*p == '\\') return 0;
+		if (*p != '/' && *p) continue;
+
+		const size_t size = p - level;
+		if (size == 0 || (size == 1 && (*level == '.' || *level == '%')) || (size == 2 && !strncmp (level, "..", 2)))
+		{
+			return 0;
+		}
+		if (!*p) break;
+		level = p + 1;
 	}
 
-	key->key[key->keySize - 1] = '\0';
-	const ssize_t ret = keyAddName (key, newName + key->keyUSize);
-	if (ret == -1)
-		elektraRemoveKeyName (key);
-	else
+	const size_t size = p - newName + 1;
+	memcpy (buffer, newName, size);
+	char * unescaped = buffer + size;
+	for (size_t i = 0; i < size; ++i)
+	{
+		unescaped[i] = newName[i] == '/' ? '\0' : newName[i];
+	}
+
+	key->key = buffer;
+	key->keySize = key->keyUSize = size;
+	key->flags |= KEY_FLAG_SYNC;
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Sets the name of a key without allocating memory for it.
+ *
+ * The name (and the unescaped name) is written to @p buffer which is
+ * owned by the caller and must stay valid as long as the key uses the
+ * name. It is meant for keys only used for lookups, e.g. keys
+ * initialized with keyInit() on the stack.
+ *
+ * Like elektraKeySetName() with KEY_META_NAME and KEY_CASCADING_NAME.
+ * Names with an owner (user:owner) are not supported.
+ *
+ * @param key the key to set the name of
+ * @param newName the new name
+ * @param buffer at least elektraKeyNameBufferSize() bytes
+ *
+ * @return size of the new name as elektraKeySetName()
+ * @retval -1 if the name is invalid or has an owner
+ */
+ssize_t elektraKeySetNameBuffer (Key * key, const char * newName, char * buffer)
+{
+	if (!key || !buffer) return -1;
+	if (test_bit (key->flags, KEY_FLAG_RO_NAME)) return -1;
+
+	elektraRemoveKeyName (key);
+	if (newName && keyNameIsUser (newName) && newName[sizeof ("user") - 1] == ':') return -1;
+
+	if (newName && elektraKeyNameSetCanonical (key, newName, buffer))
+	{
+		set_bit (key->flags, KEY_FLAG_ARENA_NAME);
 		return key->keySize;
-	return ret;
+	}
+
+	const int root = elektraKeyNameSetRoot (key, newName, KEY_META_NAME | KEY_CASCADING_NAME);
+	if (root == -1) return -1;
+
+	key->key = buffer;
+	set_bit (key->flags, KEY_FLAG_ARENA_NAME);
+	if (root == 0)
+	{
+		buffer[0] = buffer[1] = '\0';
+		key->keySize = key->keyUSize = 1;
+		key->flags |= KEY_FLAG_SYNC;
+		return 0;
+	}
+
+	return elektraKeyNameSetLevels (key, newName, 1);
 }
 
 
@@ -841,6 +1024,7 @@ ssize_t keyAddBaseName (Key * key, const char * baseName)
 	if (!baseName) return key->keySize;
 	if (test_bit (key->flags, KEY_FLAG_RO_NAME)) return -1;
 	if (!key->key) return -1;
+	if (elektraArenaDetachName (key) == -1) return -1;
 
 	char * escaped = elektraMalloc (strlen (baseName) * 2 + 2);
 	elektraEscapeKeyNamePart (baseName, escaped);
@@ -962,9 +1146,25 @@ ssize_t keyAddName (Key * key, const char * newName)
 
 	const size_t origSize = key->keySize;
 	const size_t newSize = origSize + nameSize;
+	if (elektraArenaDetachName (key) == -1) return -1;
 	elektraRealloc ((void **) &key->key, newSize * 2);
 	if (!key->key) return -1;
 
+	elektraKeyNameAddLevels (key, newName);
+
+	return origSize == key->keySize ? 0 : key->keySize;
+}
+
+
+/**
+ * @internal
+ *
+ * @brief Appends the levels of newName to the name of key and finalizes it.
+ *
+ * @pre key->key has space for twice its size plus the size of newName
+ */
+static void elektraKeyNameAddLevels (Key * key, const char * newName)
+{
 	size_t size = 0;
 	const char * p = newName;
 	int avoidSlash = 0;
@@ -1006,8 +1206,6 @@ ssize_t keyAddName (Key * key, const char * newName)
 	++key->keySize; /*for \\0 ending*/
 
 	elektraFinalizeName (key);
-
-	return origSize == key->keySize ? 0 : key->keySize;
 }
 
 
@@ -1098,6 +1296,11 @@ ssize_t keySetBaseName (Key * key, const char * baseName)
 	elektraEscapeKeyNamePart (baseName, escaped);
 	size_t sizeEscaped = elektraStrLen (escaped);
 
+	if (elektraArenaDetachName (key) == -1)
+	{
+		elektraFree (escaped);
+		return -1;
+	}
 	elektraRealloc ((void **) &key->key, (key->keySize + sizeEscaped) * 2);
 	if (!key->key)
 	{
@@ -36,6 +36,42 @@
 #define ELEKTRA_MAX_PREFIX_SIZE sizeof ("namespace/")
 #define ELEKTRA_MAX_NAMESPACE_SIZE sizeof ("system")
 
+/** Lower bits of a generation counting the changes of one KeySet, see elektraKsNextGeneration() */
+#define ELEKTRA_KS_GENERATION_BITS 24
+
+/** Source of the upper bits of generations */
+static uint64_t elektraKsGenerations = 0;
+
+/**
+ * @internal
+ *
+ * @brief Returns a generation no KeySet had before.
+ */
+static uint64_t elektraKsNewGeneration (void)
+{
+	return __atomic_add_fetch (&elektraKsGenerations, 1, __ATOMIC_RELAXED) << ELEKTRA_KS_GENERATION_BITS;
+}
+
+/**
+ * @internal
+ *
+ * @brief Marks that keys were added to, removed from or replaced within a KeySet.
+ *
+ * Must be invoked by every function doing so. Results stored in the
+ * lookup cache are only valid for one generation.
+ *
+ * The lower bits count the changes, the upper bits are unique for
+ * every KeySet: a KeySet allocated where another one was freed does
+ * not continue its generations.
+ *
+ * @param ks the KeySet
+ */
+void elektraKsNextGeneration (KeySet * ks)
+{
+	++ks->generation;
+	if (!(ks->generation & ((UINT64_C (1) << ELEKTRA_KS_GENERATION_BITS) - 1))) ks->generation = elektraKsNewGeneration ();
+}
+
 /**
  * @internal
  *
@@ -58,7 +94,24 @@ static void elektraOpmphmInvalidate (KeySet * ks ELEKTRA_UNUSED)
 /**
  * @internal
  *
- * @brief KeySets OPMPHM copy.
+ * @brief Discards the hash index of a KeySet.
+ *
+ * Must be invoked by every function that moves many Keys within a KeySet at once.
+ * The index is build again with the next lookup.
+ *
+ * @param ks the KeySet
+ */
+static void elektraHashIndexInvalidate (KeySet * ks ELEKTRA_UNUSED)
+{
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	if (ks->hashIndex) elektraHashIndexClear (ks->hashIndex);
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief KeySets OPMPHM and hash index copy.
  *
  * Should be invoked by every function making a copy of a KeySet.
  *
@@ -72,6 +125,17 @@ static void elektraOpmphmCopy (KeySet * dest ELEKTRA_UNUSED, const KeySet * sour
 	{
 		return;
 	}
+	if (elektraHashIndexIsBuild (source->hashIndex))
+	{
+		if (!dest->hashIndex)
+		{
+			dest->hashIndex = elektraHashIndexNew ();
+		}
+		if (dest->hashIndex)
+		{
+			elektraHashIndexCopy (dest->hashIndex, dest, source->hashIndex, source);
+		}
+	}
 	// nothing to copy
 	if (!opmphmIsBuild (source->opmphm))
 	{
@@ -259,6 +323,46 @@ KeySet * ksVNew (size_t alloc, va_list va)
 	return keyset;
 }
 
+/**
+ * @internal
+ *
+ * @brief Fills the empty KeySet ks with all keys of source.
+ *
+ * The keys of source are already sorted and unique, so they can be
+ * copied in one go instead of searching the position of every single
+ * key like ksAppend() does.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors
+ */
+static int elektraKsAppendSorted (KeySet * ks, const KeySet * source)
+{
+	ELEKTRA_ASSERT (ks->size == 0, "keyset must be empty, but has %zu keys", ks->size);
+
+	if (source->size == 0) return 0;
+
+	// grow like ksAppend()
+	size_t toAlloc;
+	for (toAlloc = ks->alloc > 0 ? ks->alloc : KEYSET_SIZE; source->size >= toAlloc; toAlloc *= 2)
+		;
+	if (toAlloc != ks->alloc && ksResize (ks, toAlloc - 1) == -1) return -1;
+
+	elektraMemcpy (ks->array, source->array, source->size);
+	for (size_t i = 0; i < source->size; ++i)
+	{
+		keyIncRef (ks->array[i]);
+	}
+	ks->size = source->size;
+	ks->array[ks->size] = 0;
+
+	// like ksAppendKey(), leave the cursor at the last key
+	ksSetCursor (ks, ks->size - 1);
+	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
+	elektraHashIndexInvalidate (ks);
+	return 0;
+}
+
 /**
  * Return a duplicate of a keyset.
  *
@@ -273,7 +377,7 @@ KeySet * ksVNew (size_t alloc, va_list va)
  *
  * @param source has to be an initialized source KeySet
  * @return a flat copy of source on success
- * @retval 0 on NULL pointer
+ * @retval 0 on NULL pointer or a memory error happened
  * @see ksNew(), ksDel()
  * @see keyDup() for key duplication
  */
@@ -288,7 +392,13 @@ KeySet * ksDup (const KeySet * source)
 	}
 
 	KeySet * keyset = ksNew (size, KS_END);
-	ksAppend (keyset, source);
+	if (!keyset) return 0;
+
+	if (elektraKsAppendSorted (keyset, source) == -1)
+	{
+		ksDel (keyset);
+		return 0;
+	}
 	elektraOpmphmCopy (keyset, source);
 	return keyset;
 }
@@ -303,6 +413,11 @@ KeySet * ksDup (const KeySet * source)
  *
  * the sync status will be as in the original KeySet
  *
+ * The duplicated keys are allocated within the arena of the new
+ * keyset (see elektraKsArenaKeyNew()) and share the metadata with
+ * the original keys. Names and values are copied out of the arena
+ * on the first modification.
+ *
  * @param source has to be an initialized source KeySet
  * @return a deep copy of source on success
  * @retval 0 on NULL pointer or a memory error happened
@@ -322,7 +437,12 @@ KeySet * ksDeepDup (const KeySet * source)
 	for (i = 0; i < s; ++i)
 	{
 		Key * k = source->array[i];
-		Key * d = keyDup (k);
+		Key * d = elektraArenaKeyDup (keyset, k);
+		if (!d)
+		{
+			ksDel (keyset);
+			return 0;
+		}
 		if (!test_bit (k->flags, KEY_FLAG_SYNC))
 		{
 			keyClearSync (d);
@@ -377,7 +497,7 @@ int f (KeySet *ks)
  * @param dest has to be an initialized KeySet where to write the keys
  * @retval 1 on success
  * @retval 0 if dest was cleared successfully (source is NULL)
- * @retval -1 on NULL pointer
+ * @retval -1 on NULL pointer or a memory error happened
  * @see ksNew(), ksDel(), ksDup()
  * @see keyCopy() for copying keys
  */
@@ -387,7 +507,7 @@ int ksCopy (KeySet * dest, const KeySet * source)
 	ksClear (dest);
 	if (!source) return 0;
 
-	ksAppend (dest, source);
+	if (elektraKsAppendSorted (dest, source) == -1) return -1;
 	ksSetCursor (dest, ksGetCursor (source));
 
 	elektraOpmphmCopy (dest, source);
@@ -421,8 +541,13 @@ int ksDel (KeySet * ks)
 	{
 		opmphmDel (ks->opmphm);
 	}
+	elektraHashIndexDel (ks->hashIndex);
+	elektraLookupCacheDel (ks->lookupCache);
 #endif
 
+	// keys which escaped to other keysets keep the arena alive
+	elektraArenaRelease (ks->arena);
+
 	elektraFree (ks);
 
 	return rc;
@@ -456,6 +581,8 @@ int ksClear (KeySet * ks)
 	ks->alloc = KEYSET_SIZE;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
+	elektraHashIndexInvalidate (ks);
 	return 0;
 }
 
@@ -766,6 +893,8 @@ ssize_t ksSearchInternal (const KeySet * ks, const Key * toAppend)
 	ssize_t middle = -1;
 	ssize_t insertpos = 0;
 
+	// keys are often appended in order (e.g. when splitting a keyset)
+	if (right >= 0 && keyCompareByNameOwner (&toAppend, &ks->array[right]) > 0) return -ks->size - 1;
 
 	while (1)
 	{
@@ -872,13 +1001,18 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 		}
 
 		/* Pop the key in the result */
-		keyDecRef (ks->array[result]);
-		keyDel (ks->array[result]);
+		Key * old = ks->array[result];
+		keyDecRef (old);
+		keyDel (old);
 
 		/* And use the other one instead */
 		keyIncRef (toAppend);
 		ks->array[result] = toAppend;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexReplace (ks->hashIndex, old, toAppend);
+#endif
 		ksSetCursor (ks, result);
+		elektraKsNextGeneration (ks);
 	}
 	else
 	{
@@ -916,6 +1050,10 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 			ksSetCursor (ks, insertpos);
 		}
 		elektraOpmphmInvalidate (ks);
+		elektraKsNextGeneration (ks);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexInsert (ks->hashIndex, ks, insertpos);
+#endif
 	}
 
 	return ks->size;
@@ -943,26 +1081,147 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
  */
 ssize_t ksAppend (KeySet * ks, const KeySet * toAppend)
 {
-	size_t toAlloc = 0;
-
 	if (!ks) return -1;
 	if (!toAppend) return -1;
 
 	if (toAppend->size == 0) return ks->size;
+	if (toAppend->size == 1) return ksAppendKey (ks, toAppend->array[0]);
 
-	/* Do only one resize in advance */
-	for (toAlloc = ks->alloc; ks->size + toAppend->size >= toAlloc; toAlloc *= 2)
+	if (elektraKsMerge (ks, toAppend->array, toAppend->size) == -1) return -1;
+	return ks->size;
+}
+
+
+/**
+ * @internal
+ *
+ * @brief Appends keys after the last key of ks.
+ *
+ * @pre all keys must be greater than the last key of ks
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors
+ */
+static int elektraKsAppendAfter (KeySet * ks, Key * const * keys, size_t size)
+{
+	size_t toAlloc;
+	for (toAlloc = ks->alloc > 0 ? ks->alloc : KEYSET_SIZE; ks->size + size >= toAlloc; toAlloc *= 2)
 		;
-	ksResize (ks, toAlloc - 1);
+	if (toAlloc != ks->alloc && ksResize (ks, toAlloc - 1) == -1) return -1;
 
-	/* TODO: here is lots of room for optimizations */
-	for (size_t i = 0; i < toAppend->size; ++i)
+	for (size_t i = 0; i < size; ++i)
 	{
-		ksAppendKey (ks, toAppend->array[i]);
+		elektraKeyLock (keys[i], KEY_LOCK_NAME);
+		keyIncRef (keys[i]);
+		ks->array[ks->size++] = keys[i];
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexInsert (ks->hashIndex, ks, ks->size - 1);
+#endif
 	}
-	return ks->size;
+	ks->array[ks->size] = 0;
+
+	ksSetCursor (ks, ks->size - 1);
+	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
+	return 0;
 }
 
+/**
+ * @internal
+ *
+ * @brief Merges sorted keys into a KeySet.
+ *
+ * Works like calling ksAppendKey() for every key, but both arrays are
+ * merged in place in a single pass from the back instead of moving the
+ * keys of ks for every key inserted. Keys of ks are replaced by keys with the same name.
+ * Like ksAppendKey(), the cursor is set to the last key merged.
+ *
+ * @pre keys must be sorted like a KeySet and must not contain the same name twice
+ *
+ * @param ks the KeySet to merge into
+ * @param keys the keys to merge, they are referenced by ks afterwards
+ * @param size the number of keys
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors, ks is unchanged then
+ */
+int elektraKsMerge (KeySet * ks, Key * const * keys, size_t size)
+{
+	if (size == 0) return 0;
+	if (ks->size == 0 || keyCmp (ks->array[ks->size - 1], keys[0]) < 0) return elektraKsAppendAfter (ks, keys, size);
+	if (keys == ks->array)
+	{
+		// ksAppend (ks, ks) does not change anything
+		ksSetCursor (ks, ks->size - 1);
+		return 0;
+	}
+
+	size_t toAlloc;
+	for (toAlloc = ks->alloc; ks->size + size >= toAlloc; toAlloc *= 2)
+		;
+	if (toAlloc != ks->alloc)
+	{
+		// ksResize() would free the array on errors
+		if (elektraRealloc ((void **) &ks->array, toAlloc * sizeof (Key *)) == -1) return -1;
+		ks->alloc = toAlloc;
+	}
+
+	// merge from the back, so that the keys of ks are moved at most once
+	Key ** array = ks->array;
+	size_t i = ks->size;
+	size_t j = size;
+	size_t merged = ks->size + size;
+	size_t cursor = 0;
+	while (j > 0)
+	{
+		const int cmp = i > 0 ? keyCmp (array[i - 1], keys[j - 1]) : -1;
+		if (cmp > 0)
+		{
+			array[--merged] = array[--i];
+			continue;
+		}
+
+		--j;
+		if (cmp == 0)
+		{
+			Key * replaced = array[--i];
+			if (replaced != keys[j])
+			{
+				keyDecRef (replaced);
+				keyDel (replaced);
+				elektraKeyLock (keys[j], KEY_LOCK_NAME);
+				keyIncRef (keys[j]);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+				if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexReplace (ks->hashIndex, replaced, keys[j]);
+#endif
+			}
+		}
+		else
+		{
+			elektraKeyLock (keys[j], KEY_LOCK_NAME);
+			keyIncRef (keys[j]);
+		}
+		if (j == size - 1) cursor = merged - 1;
+		array[--merged] = keys[j];
+	}
+
+	// keys replacing keys of ks left a gap between the untouched and the merged keys
+	const size_t gap = merged - i;
+	if (gap > 0) elektraMemmove (array + i, array + merged, ks->size + size - merged);
+	ks->size += size - gap;
+	array[ks->size] = 0;
+
+	// if all keys replaced keys, the names and their positions stay the same
+	if (gap != size)
+	{
+		elektraOpmphmInvalidate (ks);
+		elektraHashIndexInvalidate (ks);
+	}
+
+	ksSetCursor (ks, cursor - gap);
+	elektraKsNextGeneration (ks);
+	return 0;
+}
 
 /**
  * @internal
@@ -997,7 +1256,12 @@ ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from)
 
 	ks->array[ks->size] = 0;
 
-	if (ret) elektraOpmphmInvalidate (ks);
+	if (ret)
+	{
+		elektraOpmphmInvalidate (ks);
+		elektraKsNextGeneration (ks);
+		elektraHashIndexInvalidate (ks);
+	}
 
 	return ret;
 }
@@ -1075,6 +1339,8 @@ KeySet * ksCut (KeySet * ks, const Key * cutpoint)
 	// if (strcmp(name, "")) return 0;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
+	elektraHashIndexInvalidate (ks);
 
 	if (name[0] == '/')
 	{
@@ -1262,6 +1528,10 @@ Key * ksPop (KeySet * ks)
 	if (ks->size == 0) return 0;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	if (elektraHashIndexIsBuild (ks->hashIndex)) elektraHashIndexRemove (ks->hashIndex, ks, ks->size - 1);
+#endif
 
 	--ks->size;
 	if (ks->size + 1 < ks->alloc / 2) ksResize (ks, ks->alloc / 2 - 1);
@@ -1788,6 +2058,35 @@ finished:
 	return ret;
 }
 
+/**
+ * @internal
+ * @brief Puts a namespace in front of a cascading name
+ *
+ * The unescaped cascading name starts with an empty part, so the
+ * unescaped name in the namespace is the namespace followed by the
+ * unescaped cascading name. So there is no need to unescape again.
+ *
+ * @param key the key to set the name of, will point into newname
+ * @param ns the namespace to prepend (without /)
+ * @param name the cascading name (name and unescaped name)
+ * @param size the size of the cascading name
+ * @param usize the size of the unescaped cascading name
+ * @param newname the buffer to write to (ELEKTRA_MAX_NAMESPACE_SIZE * 2 + size + usize)
+ */
+static void elektraLookupSetNamespace (Key * key, const char * ns, const char * name, size_t size, size_t usize, char * newname)
+{
+	const size_t namespaceSize = strlen (ns);
+	memcpy (newname, ns, namespaceSize);
+	memcpy (newname + namespaceSize, name, size);
+	key->key = newname;
+	key->keySize = namespaceSize + size;
+
+	char * unescaped = newname + key->keySize;
+	memcpy (unescaped, ns, namespaceSize);
+	memcpy (unescaped + namespaceSize, name + size, usize);
+	key->keyUSize = namespaceSize + usize;
+}
+
 /**
  * @internal
  * @brief Helper for ksLookup
@@ -1797,18 +2096,17 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 	char * name = key->key;
 	size_t size = key->keySize;
 	size_t usize = key->keyUSize;
-	size_t length = strlen (name) + ELEKTRA_MAX_NAMESPACE_SIZE;
-	char newname[length * 2];
+	char stackBuffer[ELEKTRA_KEYNAME_STACK_SIZE];
+	const size_t newnameSize = ELEKTRA_MAX_NAMESPACE_SIZE * 2 + size + usize;
+	char * newname = newnameSize <= sizeof (stackBuffer) ? stackBuffer : elektraMalloc (newnameSize);
 	Key * found = 0;
 	Key * specKey = 0;
 
+	if (!newname) return 0;
+
 	if (!(options & KDB_O_NOSPEC))
 	{
-		strncpy (newname + 2, "spec", 4);
-		strcpy (newname + 6, name);
-		key->key = newname + 2;
-		key->keySize = length - 2;
-		elektraFinalizeName (key);
+		elektraLookupSetNamespace (key, "spec", name, size, usize, newname);
 		specKey = ksLookup (ks, key, (options & ~KDB_O_DEL) | KDB_O_CALLBACK);
 	}
 
@@ -1818,6 +2116,7 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 		key->key = name;
 		key->keySize = size;
 		key->keyUSize = usize;
+		if (newname != stackBuffer) elektraFree (newname);
 
 		if (strncmp (keyName (specKey), "spec/", 5))
 		{ // the search was modified in a way that not a spec Key was returned
@@ -1825,6 +2124,9 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 		}
 
 		// we found a spec key, so we know what to do
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		elektraLookupCacheDepend (ks, specKey);
+#endif
 		specKey = keyDup (specKey);
 		keySetBinary (specKey, keyValue (key), keyGetValueSize (key));
 		elektraCopyCallbackMeta (specKey, key);
@@ -1835,40 +2137,10 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 	}
 
 	// default cascading:
-	strncpy (newname + 2, "proc", 4);
-	strcpy (newname + 6, name);
-	key->key = newname + 2;
-	key->keySize = length - 2;
-	elektraFinalizeName (key);
-	found = ksLookup (ks, key, options & ~KDB_O_DEL);
-
-	if (!found)
-	{
-		strncpy (newname + 3, "dir", 3);
-		strcpy (newname + 6, name);
-		key->key = newname + 3;
-		key->keySize = length - 3;
-		elektraFinalizeName (key);
-		found = ksLookup (ks, key, options & ~KDB_O_DEL);
-	}
-
-	if (!found)
+	const char * namespaces[] = { "proc", "dir", "user", "system" };
+	for (size_t i = 0; !found && i < sizeof (namespaces) / sizeof (namespaces[0]); ++i)
 	{
-		strncpy (newname + 2, "user", 4);
-		strcpy (newname + 6, name);
-		key->key = newname + 2;
-		key->keySize = length - 2;
-		elektraFinalizeName (key);
-		found = ksLookup (ks, key, options & ~KDB_O_DEL);
-	}
-
-	if (!found)
-	{
-		strncpy (newname, "system", 6);
-		strcpy (newname + 6, name);
-		key->key = newname;
-		key->keySize = length;
-		elektraFinalizeName (key);
+		elektraLookupSetNamespace (key, namespaces[i], name, size, usize, newname);
 		found = ksLookup (ks, key, options & ~KDB_O_DEL);
 	}
 
@@ -1876,6 +2148,7 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 	key->key = name;
 	key->keySize = size;
 	key->keyUSize = usize;
+	if (newname != stackBuffer) elektraFree (newname);
 
 	if (!found && !(options & KDB_O_NODEFAULT))
 	{
@@ -2084,6 +2357,51 @@ static Key * elektraLookupOpmphmSearch (KeySet * ks, Key const * key, option_t o
 	}
 }
 
+/**
+ * @internal
+ *
+ * @brief Searches for a Key using the hash index.
+ *
+ * Creates and builds the hash index when not here, from then on
+ * it is maintained by every insertion and removal.
+ *
+ * @param ks the KeySet
+ * @param key the Key to search for
+ * @param options lookup options
+ *
+ * @return Key * when key found
+ * @return NULL when key not found
+ */
+static Key * elektraLookupHashIndexSearch (KeySet * ks, Key const * key, option_t options)
+{
+	if (!ks->hashIndex)
+	{
+		ks->hashIndex = elektraHashIndexNew ();
+		if (!ks->hashIndex)
+		{
+			return elektraLookupBinarySearch (ks, key, options);
+		}
+	}
+	if (!elektraHashIndexIsBuild (ks->hashIndex) && elektraHashIndexBuild (ks->hashIndex, ks))
+	{
+		// when the build fails use binary search as backup
+		return elektraLookupBinarySearch (ks, key, options);
+	}
+
+	ssize_t index = elektraHashIndexLookup (ks->hashIndex, ks, key);
+	if (index < 0)
+	{
+		return 0;
+	}
+
+	if (options & KDB_O_POP)
+	{
+		return elektraKsPopAtCursor (ks, index);
+	}
+	ksSetCursor (ks, index);
+	return ks->array[index];
+}
+
 #endif
 
 /**
@@ -2104,12 +2422,16 @@ static Key * elektraLookupSearch (KeySet * ks, Key * key, option_t options)
 	Key * found = 0;
 
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
-	// KDB_O_WITHOWNER and KDB_O_NOCASE flags are not compatible with OPMPHM
-	if (((options & KDB_O_WITHOWNER) || (options & KDB_O_NOCASE)) && (options & KDB_O_OPMPHM))
+	// KDB_O_WITHOWNER and KDB_O_NOCASE flags are not compatible with OPMPHM and the hash index
+	const int exact = !(options & KDB_O_WITHOWNER) && !(options & KDB_O_NOCASE);
+	if (!exact && (options & KDB_O_OPMPHM))
 	{
 		// remove OPMPHM
 		options ^= KDB_O_OPMPHM;
 	}
+	// a KeySet with a hash index always uses it
+	const int hashIndex = exact && (ks->hashIndex || (options & KDB_O_HASHINDEX));
+	options &= ~KDB_O_HASHINDEX;
 
 	if (options & KDB_O_OPMPHM)
 	{
@@ -2132,6 +2454,10 @@ static Key * elektraLookupSearch (KeySet * ks, Key * key, option_t options)
 			found = elektraLookupOpmphmSearch (ks, key, options);
 		}
 	}
+	else if (hashIndex)
+	{
+		found = elektraLookupHashIndexSearch (ks, key, options);
+	}
 	else
 	{
 		found = elektraLookupBinarySearch (ks, key, options);
@@ -2191,6 +2517,11 @@ static Key * elektraLookupCreateKey (KeySet * ks, Key * key, ELEKTRA_UNUSED opti
  * Furthermore, using the kdb-tool, it is possible to introspect which values
  * an application will get (by doing the same cascading lookup).
  *
+ * The same @p key can be used for many lookups: no memory is allocated
+ * for it, also not for cascading lookups (unless the specification
+ * needs to be followed). So for names looked up repeatedly, keep the
+ * key instead of using ksLookupByName() every time.
+ *
  * If found, @p ks internal cursor will be positioned in the matched key
  * (also accessible by ksCurrent()), and a pointer to the Key is returned.
  * If not found, @p ks internal cursor will not move, and a NULL pointer is
@@ -2271,8 +2602,22 @@ Key * ksLookup (KeySet * ks, Key * key, option_t options)
 
 	Key * ret = 0;
 	const int mask = ~KDB_O_DEL & ~KDB_O_CREATE;
+	const int cascading = !(options & KDB_O_NOCASCADING) && name[0] == '/';
+	int cached = 0;
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	// results of lookups which do more than one search are cached, unless the result depends on a cursor or callback
+	if (((options & KDB_O_SPEC) || cascading) && !(options & (KDB_O_NOALL | KDB_O_POP)) && !keyGetMeta (key, "callback"))
+	{
+		cached = elektraLookupCacheGet (ks, key, options & mask, &ret) ? -1 : elektraLookupCacheStart (ks);
+	}
+#endif
 
-	if (options & KDB_O_SPEC)
+	if (cached == -1)
+	{
+		// found in the cache
+	}
+	else if (options & KDB_O_SPEC)
 	{
 		Key * lookupKey = key;
 		if (test_bit (key->flags, KEY_FLAG_RO_NAME)) lookupKey = keyDup (key);
@@ -2283,7 +2628,7 @@ Key * ksLookup (KeySet * ks, Key * key, option_t options)
 			keyDel (lookupKey);
 		}
 	}
-	else if (!(options & KDB_O_NOCASCADING) && strcmp (name, "") && name[0] == '/')
+	else if (cascading)
 	{
 		Key * lookupKey = key;
 		if (test_bit (key->flags, KEY_FLAG_RO_NAME)) lookupKey = keyDup (key);
@@ -2306,6 +2651,10 @@ Key * ksLookup (KeySet * ks, Key * key, option_t options)
 		ret = elektraLookupSearch (ks, key, options & mask);
 	}
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	if (cached == 1) elektraLookupCacheStop (ks, key, options & mask, ret);
+#endif
+
 	if (!ret && options & KDB_O_CREATE) ret = elektraLookupCreateKey (ks, key, options & mask);
 
 	if (options & KDB_O_DEL) keyDel (key);
@@ -2340,17 +2689,141 @@ Key * ksLookupByName (KeySet * ks, const char * name, option_t options)
 	if (!ks->size) return 0;
 
 	struct _Key key;
+	// short names are kept on the stack, so most lookups do not need the heap
+	char stackBuffer[ELEKTRA_KEYNAME_STACK_SIZE];
+	char * buffer = elektraKeyNameBufferSize (name) <= sizeof (stackBuffer) ? stackBuffer : 0;
 
 	keyInit (&key);
-	elektraKeySetName (&key, name, KEY_META_NAME | KEY_CASCADING_NAME);
-
-	found = ksLookup (ks, &key, options);
-	elektraFree (key.key);
+	if (buffer && elektraKeySetNameBuffer (&key, name, buffer) != -1)
+	{
+		found = ksLookup (ks, &key, options);
+	}
+	else
+	{
+		// long names, names with owner (or invalid names)
+		elektraKeySetName (&key, name, KEY_META_NAME | KEY_CASCADING_NAME);
+		found = ksLookup (ks, &key, options);
+		elektraFree (key.key);
+	}
 	ksDel (key.meta); // sometimes owner is set
 	return found;
 }
 
 
+/**
+ * @brief Lookup many keys by their names at once.
+ *
+ * Does the same as calling ksLookupByName() for every name, but the
+ * names are sorted once and then searched with a single pass over the
+ * sorted keys of @p ks, every search starting where the last one ended.
+ * Except of one block of memory for all names, nothing is allocated.
+ *
+ * Cascading names and options not compatible with the sorted order
+ * (e.g. @p KDB_O_NOCASE) are looked up one by one using ksLookup().
+ *
+ * The cursor of @p ks is not changed.
+ *
+ * @param ks where to look for
+ * @param names the names of the keys to look up, in any order
+ * @param count the number of names
+ * @param found will be set to the key found (or 0) for every name in the order of @p names
+ * @param options some @p KDB_O_* option bits as for ksLookupByName(),
+ *        @p KDB_O_POP, @p KDB_O_DEL and @p KDB_O_CREATE are not supported
+ *
+ * @return the number of keys found
+ * @retval -1 on NULL pointers, unsupported options or memory errors
+ * @see ksLookupByName()
+ * @ingroup proposal
+ */
+ssize_t ksLookupMany (KeySet * ks, const char * const * names, size_t count, Key ** found, option_t options)
+{
+	if (!ks || !found) return -1;
+	if (count && !names) return -1;
+	if (options & (KDB_O_POP | KDB_O_DEL | KDB_O_CREATE)) return -1;
+
+	size_t bufferSize = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		found[i] = 0;
+		bufferSize += elektraKeyNameBufferSize (names[i]);
+	}
+	if (!count || !ks->size) return 0;
+
+	// one block for the lookup keys, the sorted lookup keys and all names
+	char * block = elektraMalloc (count * (sizeof (struct _Key) + sizeof (Key *)) + bufferSize);
+	if (!block) return -1;
+	struct _Key * keys = (struct _Key *) block;
+	Key ** sorted = (Key **) (keys + count);
+	char * buffer = (char *) (sorted + count);
+
+	const int merge = !(options & (KDB_O_SPEC | KDB_O_NOALL | KDB_O_NOCASE | KDB_O_WITHOWNER));
+	const cursor_t cursor = ksGetCursor (ks);
+	size_t sortedSize = 0;
+	ssize_t foundCount = 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Key * key = &keys[i];
+		keyInit (key);
+		if (elektraKeySetNameBuffer (key, names[i], buffer) == -1)
+		{
+			// e.g. user:owner names
+			found[i] = ksLookupByName (ks, names[i], options);
+		}
+		else if (merge && key->key[0] != '\0' && (key->key[0] != '/' || (options & KDB_O_NOCASCADING)))
+		{
+			sorted[sortedSize++] = key;
+		}
+		else
+		{
+			found[i] = ksLookup (ks, key, options);
+		}
+		buffer += elektraKeyNameBufferSize (names[i]);
+	}
+
+	qsort (sorted, sortedSize, sizeof (Key *), keyCompareByName);
+
+	size_t left = 0;
+	for (size_t i = 0; i < sortedSize && left < ks->size; ++i)
+	{
+		// gallop from the position of the previous name to find a range containing the name
+		size_t right = left;
+		size_t step = 1;
+		while (right < ks->size && keyCompareByName (&ks->array[right], &sorted[i]) < 0)
+		{
+			left = right + 1;
+			right += step;
+			step *= 2;
+		}
+		if (right > ks->size) right = ks->size;
+
+		// binary search for the first key not less than the name within [left, right)
+		while (left < right)
+		{
+			const size_t middle = left + (right - left) / 2;
+			if (keyCompareByName (&ks->array[middle], &sorted[i]) < 0)
+				left = middle + 1;
+			else
+				right = middle;
+		}
+
+		if (left < ks->size && !keyCompareByName (&ks->array[left], &sorted[i]))
+		{
+			found[sorted[i] - keys] = ks->array[left];
+		}
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (found[i]) ++foundCount;
+		ksDel (keys[i].meta); // sometimes owner is set
+	}
+	elektraFree (block);
+	ksSetCursor (ks, cursor);
+	return foundCount;
+}
+
+
 /*
  * Lookup for a Key contained in @p ks KeySet that matches @p value,
  * starting from ks' ksNext() position.
@@ -2591,11 +3064,16 @@ int ksInit (KeySet * ks)
 	ks->size = 0;
 	ks->alloc = 0;
 	ks->flags = 0;
+	ks->arena = 0;
+	ks->metaShares = 0;
+	ks->generation = elektraKsNewGeneration ();
 
 	ksRewind (ks);
 
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	ks->opmphm = NULL;
+	ks->hashIndex = NULL;
+	ks->lookupCache = NULL;
 	// first lookup should predict so invalidate it
 	elektraOpmphmInvalidate (ks);
 #endif
@@ -2630,6 +3108,7 @@ int ksClose (KeySet * ks)
 	ks->size = 0;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsNextGeneration (ks);
 
 	return 0;
 }
@@ -509,6 +509,14 @@ ssize_t keySetRaw (Key * key, const void * newBinary, size_t dataSize)
 	if (!key) return -1;
 	if (key->flags & KEY_FLAG_RO_VALUE) return -1;
 
+	if (test_bit (key->flags, KEY_FLAG_ARENA_VALUE))
+	{
+		// never free or reallocate arena memory, it stays valid
+		// until the key is deleted, so newBinary may still point into it
+		key->data.v = NULL;
+		clear_bit (key->flags, KEY_FLAG_ARENA_VALUE);
+	}
+
 	if (!dataSize || !newBinary)
 	{
 		if (key->data.v)
@@ -0,0 +1,198 @@
+/**
+ * @file
+ *
+ * @brief Building KeySets from keys in arbitrary order.
+ *
+ * ksAppendKey() keeps the KeySet sorted after every key, so appending
+ * keys which are not in name order moves the keys behind them every
+ * time. A builder only collects the keys and sorts them once when the
+ * KeySet is built.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdlib.h>
+
+#include "kdbinternal.h"
+
+typedef struct
+{
+	Key * key;
+	size_t order; /**< Position in which the key was added */
+} ElektraKsBuilderEntry;
+
+struct _ElektraKsBuilder
+{
+	ElektraKsBuilderEntry * entries;
+	size_t size;
+	size_t alloc;
+};
+
+
+/**
+ * @internal
+ *
+ * @brief Sorts by name, keys with the same name in the order they were added.
+ */
+static int elektraKsBuilderCompare (const void * p1, const void * p2)
+{
+	const ElektraKsBuilderEntry * e1 = p1;
+	const ElektraKsBuilderEntry * e2 = p2;
+
+	int ret = keyCmp (e1->key, e2->key);
+	if (ret != 0) return ret;
+	return e1->order < e2->order ? -1 : e1->order > e2->order;
+}
+
+/**
+ * @brief Create a new builder.
+ *
+ * Keys are added with elektraKsBuilderAdd() in any order and
+ * appended to a KeySet with elektraKsBuilderBuild().
+ *
+ * @param alloc the number of keys expected, the builder grows as needed
+ *
+ * @return a new builder, free it with elektraKsBuilderDel()
+ * @retval 0 on memory error
+ * @ingroup proposal
+ */
+ElektraKsBuilder * elektraKsBuilderNew (size_t alloc)
+{
+	ElektraKsBuilder * builder = elektraCalloc (sizeof (ElektraKsBuilder));
+	if (!builder) return 0;
+
+	if (alloc > 0)
+	{
+		builder->entries = elektraMalloc (alloc * sizeof (ElektraKsBuilderEntry));
+		if (!builder->entries)
+		{
+			elektraFree (builder);
+			return 0;
+		}
+		builder->alloc = alloc;
+	}
+	return builder;
+}
+
+/**
+ * @brief Delete a builder together with all keys not built yet.
+ *
+ * @param builder the builder to delete
+ * @ingroup proposal
+ */
+void elektraKsBuilderDel (ElektraKsBuilder * builder)
+{
+	if (!builder) return;
+
+	for (size_t i = 0; i < builder->size; ++i)
+	{
+		keyDecRef (builder->entries[i].key);
+		keyDel (builder->entries[i].key);
+	}
+	elektraFree (builder->entries);
+	elektraFree (builder);
+}
+
+/**
+ * @brief Add a key to a builder.
+ *
+ * Like with ksAppendKey() the builder takes ownership of the key and
+ * locks its name. If several keys with the same name are added, the
+ * last one wins.
+ *
+ * @param builder the builder to add the key to
+ * @param toAdd the key to add, it will be deleted on errors
+ *
+ * @return the number of keys in the builder
+ * @retval -1 on NULL pointers, keys without name or memory errors
+ * @ingroup proposal
+ */
+ssize_t elektraKsBuilderAdd (ElektraKsBuilder * builder, Key * toAdd)
+{
+	if (!toAdd) return -1;
+	if (!builder || !toAdd->key)
+	{
+		keyDel (toAdd);
+		return -1;
+	}
+
+	if (builder->size == builder->alloc)
+	{
+		size_t alloc = builder->alloc > 0 ? builder->alloc * 2 : KEYSET_SIZE;
+		if (elektraRealloc ((void **) &builder->entries, alloc * sizeof (ElektraKsBuilderEntry)) == -1)
+		{
+			keyDel (toAdd);
+			return -1;
+		}
+		builder->alloc = alloc;
+	}
+
+	elektraKeyLock (toAdd, KEY_LOCK_NAME);
+	keyIncRef (toAdd);
+	builder->entries[builder->size].key = toAdd;
+	builder->entries[builder->size].order = builder->size;
+	return ++builder->size;
+}
+
+/**
+ * @brief Append all keys of a builder to a KeySet.
+ *
+ * The keys are sorted once and merged into ks, which takes
+ * O(n log n) for n keys instead of moving the keys of the KeySet for
+ * every single key. Keys already in ks are replaced by keys with the
+ * same name, like ksAppend() does.
+ *
+ * Afterwards the builder is empty and can be reused.
+ *
+ * @param builder the builder containing the keys
+ * @param ks the KeySet to append the keys to
+ *
+ * @return the size of ks after appending
+ * @retval -1 on NULL pointers or memory errors, the keys stay in the builder then
+ * @ingroup proposal
+ */
+ssize_t elektraKsBuilderBuild (ElektraKsBuilder * builder, KeySet * ks)
+{
+	if (!builder || !ks) return -1;
+	if (builder->size == 0) return ks->size;
+
+	qsort (builder->entries, builder->size, sizeof (ElektraKsBuilderEntry), elektraKsBuilderCompare);
+
+	// keep the last key of every name, the keys are collected at the beginning of the entries
+	Key ** keys = (Key **) builder->entries;
+	size_t size = 0;
+	for (size_t i = 0; i < builder->size; ++i)
+	{
+		Key * key = builder->entries[i].key;
+		if (i + 1 < builder->size && keyCmp (key, builder->entries[i + 1].key) == 0)
+		{
+			keyDecRef (key);
+			keyDel (key);
+			continue;
+		}
+		keys[size++] = key;
+	}
+
+	if (elektraKsMerge (ks, keys, size) == -1)
+	{
+		// the remaining keys are sorted and unique, keep them in their order
+		for (size_t i = size; i-- > 0;)
+		{
+			builder->entries[i].key = keys[i];
+			builder->entries[i].order = i;
+		}
+		builder->size = size;
+		return -1;
+	}
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		keyDecRef (keys[i]);
+	}
+	builder->size = 0;
+	return ks->size;
+}
@@ -0,0 +1,359 @@
+/**
+ * @file
+ *
+ * @brief Cache for the results of cascading and specification lookups.
+ *
+ * A cascading lookup tries the specification and up to four namespaces,
+ * each with its own binary search. The cache maps the name of the
+ * lookup key to the key found, as long as the KeySet did not change.
+ *
+ * Every KeySet has a generation which is changed by all operations
+ * adding, removing or replacing keys (see elektraKsNextGeneration()).
+ * Results depending on specification keys additionally store the
+ * generation of their metadata, which is a KeySet, too.
+ *
+ * Lookups done while a lookup is recorded (e.g. the links of a
+ * specification) neither use nor fill the cache.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kdbinternal.h"
+#include <kdbassert.h>
+
+/** Smallest number of slots */
+#define ELEKTRA_LOOKUPCACHE_MIN_SIZE 16
+
+/** Maximum number of specification keys a cached result may depend on */
+#define ELEKTRA_LOOKUPCACHE_MAX_DEPENDENCIES 4
+
+/** Number of entries allowed additionally to the size of the KeySet */
+#define ELEKTRA_LOOKUPCACHE_EXTRA_ENTRIES 1024
+
+typedef struct
+{
+	const Key * key;	 /**< Specification key within the KeySet */
+	const KeySet * meta;     /**< Its metadata when the result was stored */
+	uint64_t metaGeneration; /**< Generation of the metadata */
+} ElektraLookupCacheDependency;
+
+typedef struct
+{
+	char * name;		 /**< Unescaped name of the lookup key, NULL for empty slots */
+	size_t nameSize;	 /**< Size of the unescaped name */
+	uint32_t hash;		 /**< Hash of the unescaped name */
+	option_t options;	/**< Options of the lookup */
+	const KeySet * meta;     /**< Metadata of the lookup key for KDB_O_SPEC lookups */
+	uint64_t metaGeneration; /**< Generation of the metadata */
+	Key * found;		 /**< Key found, 0 if nothing was found */
+	size_t position;	 /**< Position of the key found within the KeySet */
+	size_t dependencyCount;
+	ElektraLookupCacheDependency dependencies[ELEKTRA_LOOKUPCACHE_MAX_DEPENDENCIES];
+} ElektraLookupCacheEntry;
+
+struct _ElektraLookupCache
+{
+	ElektraLookupCacheEntry * entries; /**< Open addressing table, NULL if empty */
+	size_t mask;			   /**< Number of slots - 1, the number of slots is a power of 2 */
+	size_t count;			   /**< Number of used slots */
+	uint64_t generation;		   /**< Generation of the KeySet the entries are valid for */
+
+	int recording;	/**< A lookup which will be stored is running */
+	int uncacheable; /**< The running lookup cannot be stored */
+	size_t dependencyCount;
+	ElektraLookupCacheDependency dependencies[ELEKTRA_LOOKUPCACHE_MAX_DEPENDENCIES];
+};
+
+
+/**
+ * @internal
+ *
+ * @brief FNV-1a hash of the unescaped name of a key.
+ */
+static uint32_t elektraLookupCacheHash (const Key * key)
+{
+	const unsigned char * name = (const unsigned char *) key->key + key->keySize;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key->keyUSize; ++i)
+	{
+		hash ^= name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees all entries.
+ */
+static void elektraLookupCacheClear (ElektraLookupCache * cache)
+{
+	if (cache->entries)
+	{
+		for (size_t i = 0; i <= cache->mask; ++i)
+		{
+			elektraFree (cache->entries[i].name);
+		}
+		elektraFree (cache->entries);
+	}
+	cache->entries = NULL;
+	cache->mask = 0;
+	cache->count = 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Discards the entries if they belong to another generation of the KeySet.
+ */
+static void elektraLookupCacheSync (ElektraLookupCache * cache, const KeySet * ks)
+{
+	if (cache->generation == ks->generation) return;
+	elektraLookupCacheClear (cache);
+	cache->generation = ks->generation;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if metadata did not change since it was stored.
+ */
+static int elektraLookupCacheMetaValid (const KeySet * meta, uint64_t metaGeneration, const Key * key)
+{
+	return key->meta == meta && (!meta || meta->generation == metaGeneration);
+}
+
+/**
+ * @internal
+ *
+ * @retval 1 if the entry is the result for this lookup
+ * @retval 0 otherwise
+ */
+static int elektraLookupCacheEntryMatches (const ElektraLookupCacheEntry * entry, uint32_t hash, const Key * key, option_t options)
+{
+	return entry->hash == hash && entry->options == options && entry->nameSize == key->keyUSize &&
+	       !memcmp (entry->name, key->key + key->keySize, key->keyUSize);
+}
+
+/**
+ * @internal
+ *
+ * @brief Searches the slot of a lookup.
+ *
+ * @return the slot with the entry for the lookup or the empty slot where it belongs
+ */
+static ElektraLookupCacheEntry * elektraLookupCacheSlot (ElektraLookupCache * cache, uint32_t hash, const Key * key, option_t options)
+{
+	size_t i = hash & cache->mask;
+	while (cache->entries[i].name && !elektraLookupCacheEntryMatches (&cache->entries[i], hash, key, options))
+	{
+		i = (i + 1) & cache->mask;
+	}
+	return &cache->entries[i];
+}
+
+/**
+ * @internal
+ *
+ * @brief Doubles the number of slots.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the cache stays unchanged)
+ */
+static int elektraLookupCacheGrow (ElektraLookupCache * cache)
+{
+	const size_t size = cache->entries ? (cache->mask + 1) * 2 : ELEKTRA_LOOKUPCACHE_MIN_SIZE;
+	ElektraLookupCacheEntry * entries = elektraCalloc (size * sizeof (ElektraLookupCacheEntry));
+	if (!entries) return -1;
+
+	for (size_t i = 0; cache->entries && i <= cache->mask; ++i)
+	{
+		if (!cache->entries[i].name) continue;
+		size_t j = cache->entries[i].hash & (size - 1);
+		while (entries[j].name)
+		{
+			j = (j + 1) & (size - 1);
+		}
+		entries[j] = cache->entries[i];
+	}
+
+	elektraFree (cache->entries);
+	cache->entries = entries;
+	cache->mask = size - 1;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates an empty lookup cache.
+ *
+ * @retval ElektraLookupCache * on success
+ * @retval NULL on memory error
+ */
+ElektraLookupCache * elektraLookupCacheNew (void)
+{
+	return elektraCalloc (sizeof (ElektraLookupCache));
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees a lookup cache.
+ */
+void elektraLookupCacheDel (ElektraLookupCache * cache)
+{
+	if (!cache) return;
+	elektraLookupCacheClear (cache);
+	elektraFree (cache);
+}
+
+/**
+ * @internal
+ *
+ * @return the number of bytes allocated by the cache, 0 for NULL
+ */
+size_t elektraLookupCacheMemoryUsage (const ElektraLookupCache * cache)
+{
+	if (!cache) return 0;
+
+	size_t bytes = sizeof (ElektraLookupCache);
+	for (size_t i = 0; cache->entries && i <= cache->mask; ++i)
+	{
+		bytes += sizeof (ElektraLookupCacheEntry) + cache->entries[i].nameSize;
+	}
+	return bytes;
+}
+
+/**
+ * @internal
+ *
+ * @brief Looks up the stored result of a lookup.
+ *
+ * On a hit the cursor of ks is set to the key found, like ksLookup() does.
+ *
+ * @param ks the KeySet to look in
+ * @param key the lookup key
+ * @param options the options of the lookup
+ * @param [out] found the stored result
+ *
+ * @retval 1 if the result was stored and is still valid
+ * @retval 0 otherwise
+ */
+int elektraLookupCacheGet (KeySet * ks, const Key * key, option_t options, Key ** found)
+{
+	ElektraLookupCache * cache = ks->lookupCache;
+	if (!cache || cache->recording) return 0;
+
+	elektraLookupCacheSync (cache, ks);
+	if (!cache->entries) return 0;
+
+	const ElektraLookupCacheEntry * entry = elektraLookupCacheSlot (cache, elektraLookupCacheHash (key), key, options);
+	if (!entry->name) return 0;
+
+	if ((options & KDB_O_SPEC) && !elektraLookupCacheMetaValid (entry->meta, entry->metaGeneration, key)) return 0;
+	for (size_t i = 0; i < entry->dependencyCount; ++i)
+	{
+		const ElektraLookupCacheDependency * dependency = &entry->dependencies[i];
+		if (!elektraLookupCacheMetaValid (dependency->meta, dependency->metaGeneration, dependency->key)) return 0;
+	}
+
+	*found = entry->found;
+	if (entry->found) ksSetCursor (ks, entry->position);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Starts recording a lookup, whose result will be stored by elektraLookupCacheStop().
+ *
+ * @retval 1 if the lookup is recorded
+ * @retval 0 if it is nested in another recorded lookup or on memory errors
+ */
+int elektraLookupCacheStart (KeySet * ks)
+{
+	if (!ks->lookupCache) ks->lookupCache = elektraLookupCacheNew ();
+	ElektraLookupCache * cache = ks->lookupCache;
+	if (!cache || cache->recording) return 0;
+
+	cache->recording = 1;
+	cache->uncacheable = 0;
+	cache->dependencyCount = 0;
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Notes that the recorded lookup used the metadata of a specification key of ks.
+ */
+void elektraLookupCacheDepend (KeySet * ks, const Key * specKey)
+{
+	ElektraLookupCache * cache = ks->lookupCache;
+	if (!cache || !cache->recording) return;
+
+	if (cache->dependencyCount == ELEKTRA_LOOKUPCACHE_MAX_DEPENDENCIES || keyGetMeta (specKey, "callback"))
+	{
+		cache->uncacheable = 1;
+		return;
+	}
+
+	ElektraLookupCacheDependency * dependency = &cache->dependencies[cache->dependencyCount++];
+	dependency->key = specKey;
+	dependency->meta = specKey->meta;
+	dependency->metaGeneration = specKey->meta ? specKey->meta->generation : 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Stops recording a lookup and stores its result.
+ *
+ * @param ks the KeySet looked in
+ * @param key the lookup key
+ * @param options the options of the lookup
+ * @param found the result of the lookup
+ */
+void elektraLookupCacheStop (KeySet * ks, const Key * key, option_t options, Key * found)
+{
+	ElektraLookupCache * cache = ks->lookupCache;
+	ELEKTRA_ASSERT (cache && cache->recording, "lookup was not recorded");
+	cache->recording = 0;
+
+	// the position of the key found is needed to set the cursor
+	if (cache->uncacheable || (found && ks->cursor != found)) return;
+
+	// the lookup might have added a default key
+	elektraLookupCacheSync (cache, ks);
+	if (cache->count >= ks->size + ELEKTRA_LOOKUPCACHE_EXTRA_ENTRIES) elektraLookupCacheClear (cache);
+	if ((cache->count + 1) * 2 > (cache->entries ? cache->mask + 1 : 0) && elektraLookupCacheGrow (cache) == -1) return;
+
+	const uint32_t hash = elektraLookupCacheHash (key);
+	ElektraLookupCacheEntry * entry = elektraLookupCacheSlot (cache, hash, key, options);
+	if (!entry->name)
+	{
+		entry->name = elektraMalloc (key->keyUSize);
+		if (!entry->name) return;
+		memcpy (entry->name, key->key + key->keySize, key->keyUSize);
+		entry->nameSize = key->keyUSize;
+		entry->hash = hash;
+		entry->options = options;
+		++cache->count;
+	}
+
+	entry->meta = key->meta;
+	entry->metaGeneration = key->meta ? key->meta->generation : 0;
+	entry->found = found;
+	entry->position = found ? ks->current : 0;
+	entry->dependencyCount = cache->dependencyCount;
+	memcpy (entry->dependencies, cache->dependencies, cache->dependencyCount * sizeof (ElektraLookupCacheDependency));
+}
@@ -0,0 +1,252 @@
+/**
+ * @file
+ *
+ * @brief Introspection of the memory used by keys and KeySets.
+ *
+ * ksGetAlloc() only tells the number of slots of the array of a
+ * KeySet. The functions here add up everything a KeySet owns: the
+ * keys with their names and values, their metadata and the tables
+ * built for lookups.
+ *
+ * Metadata is shared between keys (see elektraKeyMetaShare() and
+ * elektraInternPoolAdd()), so it is counted only once per call.
+ * Keys and metadata shared with other KeySets are counted for every
+ * KeySet, so the sum over several KeySets is an upper bound.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "kdbinternal.h"
+
+/** Smallest number of slots of the set of visited metadata */
+#define ELEKTRA_MEMORYUSAGE_MIN_SIZE 64
+
+/**
+ * Open addressing set of the metakeys and KeySets of metadata
+ * already counted. If it cannot grow, shared metadata is counted
+ * several times.
+ */
+typedef struct
+{
+	const void ** items;
+	size_t mask;
+	size_t count;
+} ElektraMemoryUsageVisited;
+
+
+/**
+ * @internal
+ *
+ * @brief Hash of a pointer (Fibonacci hashing of the address).
+ */
+static size_t elektraMemoryUsageHash (const void * p)
+{
+	return (size_t) (((uint64_t) (uintptr_t) p * UINT64_C (11400714819323198485)) >> 32);
+}
+
+/**
+ * @internal
+ *
+ * @brief Doubles the number of slots.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the set stays unchanged)
+ */
+static int elektraMemoryUsageGrow (ElektraMemoryUsageVisited * visited)
+{
+	const size_t size = visited->items ? (visited->mask + 1) * 2 : ELEKTRA_MEMORYUSAGE_MIN_SIZE;
+	const void ** items = elektraCalloc (size * sizeof (void *));
+	if (!items) return -1;
+
+	for (size_t i = 0; visited->items && i <= visited->mask; ++i)
+	{
+		if (!visited->items[i]) continue;
+		size_t j = elektraMemoryUsageHash (visited->items[i]) & (size - 1);
+		while (items[j])
+		{
+			j = (j + 1) & (size - 1);
+		}
+		items[j] = visited->items[i];
+	}
+
+	elektraFree (visited->items);
+	visited->items = items;
+	visited->mask = size - 1;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Marks p as counted.
+ *
+ * @retval 1 if p was not counted before
+ * @retval 0 if it was
+ */
+static int elektraMemoryUsageVisit (ElektraMemoryUsageVisited * visited, const void * p)
+{
+	if ((visited->count + 1) * 2 > (visited->items ? visited->mask + 1 : 0) && elektraMemoryUsageGrow (visited) == -1) return 1;
+
+	size_t i = elektraMemoryUsageHash (p) & visited->mask;
+	while (visited->items[i])
+	{
+		if (visited->items[i] == p) return 0;
+		i = (i + 1) & visited->mask;
+	}
+	visited->items[i] = p;
+	++visited->count;
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Size of the name of a key.
+ *
+ * Names within arena blocks, but not within the block of the key,
+ * are interned names of metadata, which are not allocated at all.
+ */
+static size_t elektraMemoryUsageName (const Key * key)
+{
+	if (!key->key) return 0;
+	if (test_bit (key->flags, KEY_FLAG_ARENA_NAME) && !elektraArenaContains (key->arena, key->key)) return 0;
+	return key->keySize + key->keyUSize;
+}
+
+/**
+ * @internal
+ *
+ * @brief Memory of the tables built for lookups in a KeySet.
+ */
+static size_t elektraMemoryUsageIndex (const KeySet * ks)
+{
+	size_t bytes = 0;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	if (ks->opmphm)
+	{
+		bytes += sizeof (Opmphm) + ks->opmphm->size;
+		if (ks->opmphm->hashFunctionSeeds) bytes += ks->opmphm->rUniPar * sizeof (int32_t);
+	}
+	bytes += elektraHashIndexMemoryUsage (ks->hashIndex);
+	bytes += elektraLookupCacheMemoryUsage (ks->lookupCache);
+#else
+	(void) ks;
+#endif
+	return bytes;
+}
+
+static void elektraMemoryUsageKey (const Key * key, ElektraMemoryUsage * usage, ElektraMemoryUsageVisited * visited);
+
+/**
+ * @internal
+ *
+ * @brief Adds the metadata of a key to the meta category, unless it was counted before.
+ */
+static void elektraMemoryUsageMeta (const KeySet * meta, ElektraMemoryUsage * usage, ElektraMemoryUsageVisited * visited)
+{
+	if (!meta || !elektraMemoryUsageVisit (visited, meta)) return;
+
+	ElektraMemoryUsage metaUsage = { 0 };
+	metaUsage.keys = sizeof (KeySet) + meta->size * sizeof (Key *);
+	metaUsage.slack = (meta->alloc - meta->size) * sizeof (Key *) + elektraArenaUnused (meta->arena);
+	metaUsage.index = elektraMemoryUsageIndex (meta);
+	for (size_t i = 0; i < meta->size; ++i)
+	{
+		if (elektraMemoryUsageVisit (visited, meta->array[i])) elektraMemoryUsageKey (meta->array[i], &metaUsage, visited);
+	}
+
+	usage->meta += metaUsage.keys + metaUsage.names + metaUsage.values + metaUsage.meta + metaUsage.index + metaUsage.slack;
+}
+
+/**
+ * @internal
+ *
+ * @brief Adds the memory of a key and its metadata.
+ */
+static void elektraMemoryUsageKey (const Key * key, ElektraMemoryUsage * usage, ElektraMemoryUsageVisited * visited)
+{
+	usage->keys += sizeof (Key);
+	usage->names += elektraMemoryUsageName (key);
+	usage->values += key->dataSize;
+	elektraMemoryUsageMeta (key->meta, usage, visited);
+}
+
+/**
+ * @internal
+ *
+ * @brief Sums up the categories and frees the visited set.
+ */
+static ssize_t elektraMemoryUsageFinish (ElektraMemoryUsage * usage, ElektraMemoryUsageVisited * visited)
+{
+	elektraFree (visited->items);
+	usage->total = usage->keys + usage->names + usage->values + usage->meta + usage->index + usage->slack;
+	return usage->total;
+}
+
+/**
+ * @brief Get the memory used by a key.
+ *
+ * Counts the struct of the key, its name, its value and its
+ * metadata. Metadata shared with other keys is counted fully.
+ *
+ * @param key the key to inspect
+ * @param [out] usage receives the bytes used per category
+ *
+ * @return the total number of bytes used by the key
+ * @retval -1 on NULL pointers
+ * @see ksMemoryUsage()
+ * @ingroup proposal
+ */
+ssize_t keyMemoryUsage (const Key * key, ElektraMemoryUsage * usage)
+{
+	if (!key || !usage) return -1;
+
+	ElektraMemoryUsageVisited visited = { 0 };
+	memset (usage, 0, sizeof (ElektraMemoryUsage));
+	elektraMemoryUsageKey (key, usage, &visited);
+	return elektraMemoryUsageFinish (usage, &visited);
+}
+
+/**
+ * @brief Get the memory used by a KeySet.
+ *
+ * Unlike ksGetAlloc(), which only reports the slots of the array,
+ * everything the KeySet holds is counted: the keys with their names,
+ * values and metadata, the tables built for lookups and memory
+ * allocated but not used yet.
+ *
+ * Metadata shared between keys of the KeySet is counted once. Keys
+ * and metadata also used by other KeySets (e.g. after ksDup()) are
+ * counted for every KeySet, so the sum over several KeySets is an
+ * upper bound of the memory they use together.
+ *
+ * @param ks the KeySet to inspect
+ * @param [out] usage receives the bytes used per category
+ *
+ * @return the total number of bytes used by the KeySet
+ * @retval -1 on NULL pointers
+ * @see keyMemoryUsage()
+ * @ingroup proposal
+ */
+ssize_t ksMemoryUsage (const KeySet * ks, ElektraMemoryUsage * usage)
+{
+	if (!ks || !usage) return -1;
+
+	ElektraMemoryUsageVisited visited = { 0 };
+	memset (usage, 0, sizeof (ElektraMemoryUsage));
+	usage->keys = sizeof (KeySet) + ks->size * sizeof (Key *);
+	usage->slack = (ks->alloc - ks->size) * sizeof (Key *) + elektraArenaUnused (ks->arena);
+	usage->index = elektraMemoryUsageIndex (ks);
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		elektraMemoryUsageKey (ks->array[i], usage, &visited);
+	}
+	return elektraMemoryUsageFinish (usage, &visited);
+}
@@ -40,6 +40,10 @@
  *
  * The config will be deleted within this function.
  *
+ * If kdb->lazyBackends is set, the plugins of the backends are not
+ * opened here, but when splitBuildup() needs them for the first time.
+ * The modules must then be the modules of the handle.
+ *
  * @note mountDefault is not allowed to be executed before
  *
  * @param kdb the handle to work with
@@ -64,7 +68,7 @@ int mountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorKey)
 		if (keyRel (root, cur) == 1)
 		{
 			KeySet * cut = ksCut (config, cur);
-			Backend * backend = backendOpen (cut, modules, errorKey);
+			Backend * backend = kdb->lazyBackends ? backendOpenLazy (cut, errorKey) : backendOpen (cut, modules, errorKey);
 
 			if (!backend)
 			{
@@ -0,0 +1,528 @@
+/**
+ * @file
+ *
+ * @brief Parallel execution of the plugin chains of backends.
+ *
+ * Mountpoints are independent files, so kdbGet() and kdbSet() do not need
+ * to run the storage plugins of one backend after the other. If enabled with
+ * `system/elektra/parallel/enabled` set to `1`, the get-chains and the
+ * prepare phase of kdbSet() (serializing and syncing the temporary files)
+ * run on several threads (at most `system/elektra/parallel/threads`,
+ * by default the number of online processors).
+ *
+ * Only backends whose plugins all have the status `threadsafe` run in
+ * parallel. kdbGet() additionally requires the KeySet of the backend to
+ * be empty (no keys were appointed to it, so no keys or metakeys are
+ * shared with other backends). Resolvers and commit plugins always run in
+ * the calling thread. Every backend gets its own parentKey, warnings and
+ * errors are merged into the real parentKey in the order of the split
+ * afterwards.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <kdbinternal.h>
+
+/**
+ * @internal
+ *
+ * State shared by all threads of one parallel run.
+ */
+typedef struct
+{
+	KDB * handle;
+	Split * split;
+	size_t size; /*!< number of split indices to consider */
+	int (*getBackend) (KDB *, Split *, size_t, Key *);
+	int (*setBackend) (KDB *, Split *, size_t, Key *, Key **);
+
+	Key ** parentKeys; /*!< private parentKey per split index, 0 if not run in parallel */
+	Key ** errorKeys;  /*!< errorKey reported by setBackend per split index */
+	int * results;     /*!< result of getBackend or setBackend per split index */
+	size_t * jobs;     /*!< first split index of every backend to run */
+	size_t nrJobs;
+
+	size_t next; /*!< next job to take, protected by mutex */
+	pthread_mutex_t mutex;
+} ParallelRun;
+
+
+/**
+ * @internal
+ *
+ * @brief Initializes the parallel update of a KDB handle.
+ *
+ * Must be called with the bootstrap configuration (all keys below
+ * `system/elektra`) before it gets consumed by mountOpen().
+ *
+ * @param handle the handle to initialize
+ * @param config the bootstrap configuration
+ */
+void elektraParallelInit (KDB * handle, KeySet * config)
+{
+	handle->parallelThreads = 0;
+
+	Key * enabled = ksLookupByName (config, KDB_PARALLEL_CONFIG "/enabled", 0);
+	if (!enabled || strcmp (keyString (enabled), "1")) return;
+
+	long threads = 0;
+	Key * configured = ksLookupByName (config, KDB_PARALLEL_CONFIG "/threads", 0);
+	if (configured && strcmp (keyString (configured), ""))
+	{
+		char * end;
+		threads = strtol (keyString (configured), &end, 10);
+		if (*end != '\0') threads = 0;
+	}
+	if (threads <= 0) threads = sysconf (_SC_NPROCESSORS_ONLN);
+
+	// a single thread would only add overhead
+	if (threads < 2) return;
+
+	handle->parallelThreads = threads;
+	ELEKTRA_LOG ("parallel kdbGet enabled with %ld threads", threads);
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if the space separated list @p tags contains @p tag.
+ */
+static int elektraParallelHasTag (const char * tags, const char * tag)
+{
+	const size_t length = strlen (tag);
+	for (const char * cur = strstr (tags, tag); cur; cur = strstr (cur + 1, tag))
+	{
+		if ((cur == tags || cur[-1] == ' ') && (cur[length] == ' ' || cur[length] == '\0')) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if the contract of a plugin contains the status `threadsafe`.
+ */
+static int elektraParallelPluginIsThreadSafe (Plugin * plugin)
+{
+	if (!plugin->name) return 0;
+
+	KeySet * contract = ksNew (0, KS_END);
+	Key * pk = keyNew ("system/elektra/modules", KEY_END);
+	keyAddBaseName (pk, plugin->name);
+	plugin->kdbGet (plugin, contract, pk);
+	keyAddName (pk, "infos/status");
+
+	Key * status = ksLookup (contract, pk, 0);
+	int threadSafe = status && elektraParallelHasTag (keyString (status), "threadsafe");
+
+	ksDel (contract);
+	keyDel (pk);
+	return threadSafe;
+}
+
+/**
+ * @internal
+ *
+ * @brief Checks if the plugin chains of a backend may run in parallel.
+ *
+ * The result is remembered in the backend, so the contracts are only
+ * queried on the first update.
+ *
+ * @retval 1 if all get plugins and all set plugins before the commit
+ *           plugin (except the resolvers) are thread-safe
+ * @retval 0 otherwise
+ */
+static int elektraParallelIsThreadSafe (Backend * backend)
+{
+	if (backend->threadSafe) return backend->threadSafe == 1;
+
+	backend->threadSafe = 1;
+	for (size_t p = RESOLVER_PLUGIN + 1; p < NR_OF_PLUGINS && backend->threadSafe == 1; ++p)
+	{
+		Plugin * plugins[] = { backend->getplugins[p], p < COMMIT_PLUGIN ? backend->setplugins[p] : 0 };
+		for (size_t i = 0; i < 2; ++i)
+		{
+			if (!plugins[i] || (i == 1 && plugins[i] == plugins[0])) continue;
+			if (!elektraParallelPluginIsThreadSafe (plugins[i]))
+			{
+				ELEKTRA_LOG_DEBUG ("backend %s is not thread-safe because of plugin %s", keyName (backend->mountpoint),
+						   plugins[i]->name);
+				backend->threadSafe = -1;
+				break;
+			}
+		}
+	}
+	return backend->threadSafe == 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Takes jobs until none are left.
+ *
+ * All split indices of a backend (e.g. the user and system part of a
+ * cascading mountpoint) run in the same thread, one plugin instance
+ * never runs concurrently.
+ */
+static void * elektraParallelWorker (void * data)
+{
+	ParallelRun * pr = data;
+
+	for (;;)
+	{
+		pthread_mutex_lock (&pr->mutex);
+		const size_t job = pr->next < pr->nrJobs ? pr->next++ : pr->nrJobs;
+		pthread_mutex_unlock (&pr->mutex);
+		if (job == pr->nrJobs) return 0;
+
+		const size_t first = pr->jobs[job];
+		Backend * backend = pr->split->handles[first];
+		for (size_t i = first; i < pr->size; ++i)
+		{
+			if (pr->split->handles[i] != backend || !pr->parentKeys[i]) continue;
+			if (pr->getBackend)
+			{
+				pr->results[i] = pr->getBackend (pr->handle, pr->split, i, pr->parentKeys[i]);
+				if (pr->results[i] == -1) break;
+			}
+			else
+			{
+				// like the sequential kdbSet(), keep going after errors
+				pr->results[i] = pr->setBackend (pr->handle, pr->split, i, pr->parentKeys[i], &pr->errorKeys[i]);
+			}
+		}
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Reserves the next warning of @p dest.
+ *
+ * The warnings get numbered the same way ELEKTRA_ADD_WARNING does.
+ *
+ * @param dest the key to add a warning to
+ * @param name is set to the name of the new warning, e.g. `warnings/#03`
+ */
+static void elektraParallelNextWarning (Key * dest, char name[13])
+{
+	strcpy (name, "warnings/#00");
+
+	const Key * counter = keyGetMeta (dest, "warnings");
+	if (counter)
+	{
+		name[10] = keyString (counter)[0];
+		name[11] = keyString (counter)[1];
+		if (++name[11] > '9')
+		{
+			name[11] = '0';
+			if (++name[10] > '9') name[10] = '0';
+		}
+	}
+	keySetMeta (dest, "warnings", &name[10]);
+}
+
+/**
+ * @internal
+ *
+ * @brief Copies the metakeys @p from and below of @p source to @p to and below of @p dest.
+ */
+static void elektraParallelCopyMeta (Key * dest, const char * to, Key * source, const char * from)
+{
+	const size_t fromSize = strlen (from);
+	const Key * meta;
+
+	keyRewindMeta (source);
+	while ((meta = keyNextMeta (source)) != 0)
+	{
+		const char * metaName = keyName (meta);
+		if (strncmp (metaName, from, fromSize) || (metaName[fromSize] != '\0' && metaName[fromSize] != '/')) continue;
+
+		char * target = elektraFormat ("%s%s", to, metaName + fromSize);
+		keySetMeta (dest, target, keyString (meta));
+		elektraFree (target);
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Appends the warnings of @p source to the warnings of @p dest.
+ */
+static void elektraParallelCopyWarnings (Key * dest, Key * source)
+{
+	char from[13];
+	char to[13];
+	const Key * meta;
+
+	keyRewindMeta (source);
+	while ((meta = keyNextMeta (source)) != 0)
+	{
+		const char * metaName = keyName (meta);
+		if (strncmp (metaName, "warnings/#", 10) || strlen (metaName) != 12) continue;
+
+		strcpy (from, metaName);
+		elektraParallelNextWarning (dest, to);
+		elektraParallelCopyMeta (dest, to, source, from);
+
+		// the iteration was reset by copying
+		keyRewindMeta (source);
+		while ((meta = keyNextMeta (source)) != 0 && strcmp (keyName (meta), from))
+			;
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Merges the warnings and errors of the private parentKeys into @p parentKey.
+ *
+ * The first error (in the order of the split) becomes the error of
+ * @p parentKey, the others are added as warnings like
+ * ELEKTRA_SET_ERROR does if there is an error already.
+ *
+ * @retval 0 if no backend failed
+ * @retval -1 otherwise
+ */
+static int elektraParallelMerge (ParallelRun * pr, Key * parentKey)
+{
+	int ret = 0;
+	for (size_t i = 0; i < pr->size; ++i)
+	{
+		if (!pr->parentKeys[i]) continue;
+
+		elektraParallelCopyWarnings (parentKey, pr->parentKeys[i]);
+		if (keyGetMeta (pr->parentKeys[i], "error"))
+		{
+			if (keyGetMeta (parentKey, "error"))
+			{
+				char name[13];
+				elektraParallelNextWarning (parentKey, name);
+				elektraParallelCopyMeta (parentKey, name, pr->parentKeys[i], "error");
+			}
+			else
+			{
+				keySetName (parentKey, keyName (pr->split->parents[i]));
+				keySetString (parentKey, keyString (pr->split->parents[i]));
+				elektraParallelCopyMeta (parentKey, "error", pr->parentKeys[i], "error");
+			}
+		}
+		if (pr->results[i] == -1) ret = -1;
+	}
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates the per index arrays of @p pr.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors (nothing can run in parallel then)
+ */
+static int elektraParallelInitRun (ParallelRun * pr, KDB * handle, Split * split, size_t size)
+{
+	memset (pr, 0, sizeof (ParallelRun));
+	pr->handle = handle;
+	pr->split = split;
+	pr->size = size;
+	pr->parentKeys = elektraCalloc (size * sizeof (Key *) + 1);
+	pr->errorKeys = elektraCalloc (size * sizeof (Key *) + 1);
+	pr->results = elektraCalloc (size * sizeof (int) + 1);
+	pr->jobs = elektraMalloc (size * sizeof (size_t) + 1);
+
+	if (!pr->parentKeys || !pr->errorKeys || !pr->results || !pr->jobs) return -1;
+	return 0;
+}
+
+static void elektraParallelCloseRun (ParallelRun * pr)
+{
+	for (size_t i = 0; pr->parentKeys && i < pr->size; ++i)
+	{
+		keyDel (pr->parentKeys[i]);
+	}
+	elektraFree (pr->parentKeys);
+	elektraFree (pr->errorKeys);
+	elektraFree (pr->results);
+	elektraFree (pr->jobs);
+}
+
+/**
+ * @internal
+ *
+ * @brief Marks split index @p i to run in parallel.
+ */
+static void elektraParallelAddJob (ParallelRun * pr, size_t i)
+{
+	Split * split = pr->split;
+	pr->parentKeys[i] = keyNew (keyName (split->parents[i]), KEY_VALUE, keyString (split->parents[i]), KEY_END);
+
+	for (size_t j = 0; j < i; ++j)
+	{
+		// already part of the job of an earlier index
+		if (pr->parentKeys[j] && split->handles[j] == split->handles[i]) return;
+	}
+	pr->jobs[pr->nrJobs++] = i;
+}
+
+/**
+ * @internal
+ *
+ * @brief Runs all jobs of @p pr on up to handle->parallelThreads threads.
+ *
+ * The calling thread takes jobs, too.
+ */
+static void elektraParallelExecute (ParallelRun * pr)
+{
+	if (pr->nrJobs == 0) return;
+
+	size_t nrThreads = (pr->nrJobs < pr->handle->parallelThreads ? pr->nrJobs : pr->handle->parallelThreads) - 1;
+	pthread_t * threads = nrThreads > 0 ? elektraMalloc (nrThreads * sizeof (pthread_t)) : 0;
+	size_t started = 0;
+
+	pthread_mutex_init (&pr->mutex, 0);
+	while (threads && started < nrThreads && !pthread_create (&threads[started], 0, elektraParallelWorker, pr))
+	{
+		++started;
+	}
+	elektraParallelWorker (pr);
+	for (size_t t = 0; t < started; ++t)
+	{
+		pthread_join (threads[t], 0);
+	}
+	pthread_mutex_destroy (&pr->mutex);
+	elektraFree (threads);
+}
+
+/**
+ * @internal
+ *
+ * @brief Updates all backends of a split which need an update.
+ *
+ * Like calling @p getBackend for every split index with SPLIT_FLAG_SYNC
+ * set (except the bypass), but thread-safe backends with empty KeySets
+ * are updated on up to handle->parallelThreads threads. The other
+ * backends are updated afterwards in the calling thread.
+ *
+ * In contrast to the sequential update, all thread-safe backends
+ * are updated even if one of them fails.
+ *
+ * @param handle the handle with parallelThreads set
+ * @param split the split to update
+ * @param parentKey to add warnings and set an error
+ * @param getBackend runs the get-chain of one split index
+ *
+ * @retval 0 on success
+ * @retval -1 if getBackend failed for any backend, parentKey contains
+ *            the error of the first failed backend of the split
+ */
+int elektraParallelGet (KDB * handle, Split * split, Key * parentKey, int (*getBackend) (KDB *, Split *, size_t, Key *))
+{
+	const size_t size = split->size - 1; // without bypass
+	int ret = 0;
+
+	ParallelRun pr;
+	if (elektraParallelInitRun (&pr, handle, split, size) == 0)
+	{
+		pr.getBackend = getBackend;
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+			if (ksGetSize (split->keysets[i]) > 0 || !elektraParallelIsThreadSafe (split->handles[i])) continue;
+			elektraParallelAddJob (&pr, i);
+		}
+
+		elektraParallelExecute (&pr);
+
+		// merge in the order of the split, as the sequential update would have reported it
+		ret = elektraParallelMerge (&pr, parentKey);
+	}
+
+	for (size_t i = 0; ret == 0 && i < size; ++i)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+		if (pr.parentKeys && pr.parentKeys[i]) continue;
+		if (getBackend (handle, split, i, parentKey) == -1) ret = -1;
+	}
+
+	elektraParallelCloseRun (&pr);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Prepares all backends of a split for the commit.
+ *
+ * Like calling @p setResolver and then @p setBackend for every split
+ * index, but @p setBackend of thread-safe backends runs on up to
+ * handle->parallelThreads threads. The resolvers (which lock the
+ * configuration files) always run in the calling thread, one after
+ * the other, before any other plugin.
+ *
+ * @param handle the handle with parallelThreads set
+ * @param split the split to prepare
+ * @param parentKey to add warnings and set an error
+ * @param [out] errorKey may point to which key caused the error
+ * @param setResolver runs the resolver of one split index,
+ *        returns 0 if the backend does not need to be written
+ * @param setBackend runs the other plugins before the commit plugin
+ *
+ * @retval 0 on success
+ * @retval -1 if any backend failed
+ */
+int elektraParallelSet (KDB * handle, Split * split, Key * parentKey, Key ** errorKey,
+			int (*setResolver) (KDB *, Split *, size_t, Key *, Key **),
+			int (*setBackend) (KDB *, Split *, size_t, Key *, Key **))
+{
+	const size_t size = split->size;
+	int ret = 0;
+
+	ParallelRun pr;
+	if (elektraParallelInitRun (&pr, handle, split, size) == -1)
+	{
+		elektraParallelCloseRun (&pr);
+		for (size_t i = 0; i < size; ++i)
+		{
+			const int resolved = setResolver (handle, split, i, parentKey, errorKey);
+			if (resolved == -1) ret = -1;
+			if (resolved != 0 && setBackend (handle, split, i, parentKey, errorKey) == -1) ret = -1;
+		}
+		return ret;
+	}
+	pr.setBackend = setBackend;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		// remembered for the backends which are not thread-safe, overwritten by the workers otherwise
+		pr.results[i] = setResolver (handle, split, i, parentKey, errorKey);
+		if (pr.results[i] == -1) ret = -1;
+		if (pr.results[i] != 0 && elektraParallelIsThreadSafe (split->handles[i])) elektraParallelAddJob (&pr, i);
+	}
+
+	elektraParallelExecute (&pr);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (pr.parentKeys[i] && pr.results[i] == -1 && pr.errorKeys[i]) *errorKey = pr.errorKeys[i];
+	}
+	if (elektraParallelMerge (&pr, parentKey) == -1) ret = -1;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (pr.parentKeys[i] || pr.results[i] == 0) continue;
+		if (setBackend (handle, split, i, parentKey, errorKey) == -1) ret = -1;
+	}
+
+	elektraParallelCloseRun (&pr);
+	return ret;
+}
@@ -116,6 +116,17 @@ Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos)
 	size_t c = pos;
 	if (c >= ks->size) return 0;
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	// the index is updated for the position c,
+	// ksPop() must not update it for the last position again
+	ElektraHashIndex * hashIndex = ks->hashIndex;
+	if (c != ks->size - 1 && elektraHashIndexIsBuild (hashIndex))
+	{
+		elektraHashIndexRemove (hashIndex, ks, c);
+		ks->hashIndex = 0;
+	}
+#endif
+
 	if (c != ks->size - 1)
 	{
 		Key ** found = ks->array + c;
@@ -142,5 +153,9 @@ Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos)
 
 	ksRewind (ks);
 
-	return ksPop (ks);
+	Key * popped = ksPop (ks);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	ks->hashIndex = hashIndex;
+#endif
+	return popped;
 }
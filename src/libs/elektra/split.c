@@ -87,6 +87,7 @@ void splitDel (Split * keysets)
 	elektraFree (keysets->handles);
 	elektraFree (keysets->parents);
 	elektraFree (keysets->syncbits);
+	trieRouterDel (keysets->router);
 	elektraFree (keysets);
 }
 
@@ -265,26 +266,24 @@ static int elektraKeySetNameByNamespace (Key * parentKey, elektraNamespace ns)
 
 
 /**
- * Walks through kdb->split and adds all backends below parentKey to split.
- *
- * Sets syncbits to 2 if it is a default or root backend (which needs splitting).
- * The information is copied from kdb->split.
- *
- * @pre split needs to be empty, directly after creation with splitNew().
- *
- * @pre there needs to be a valid defaultBackend
- *      but its ok not to have a trie inside KDB.
+ * @brief Append a mounted backend to the split.
  *
- * @pre parentKey must be a valid key! (could be implemented more generally,
- *      but that would require splitting up of keysets of the same backend)
+ * Opens the plugins of the backend if this was not done yet (see
+ * KDB::lazyBackends).
  *
- * @param split will get all backends appended
- * @param kdb the handle to get information about backends
- * @param parentKey the information below which key the backends are from interest
- * @ingroup split
- * @retval 1 always
+ * @param split the split object to work with
+ * @param kdb the handle the backend is mounted in
+ * @param i the position of the backend within kdb->split
+ * @param errorKey warnings about plugins that could not be opened are added here
  */
-int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
+static void splitAppendMounted (Split * split, KDB * kdb, size_t i, Key * errorKey)
+{
+	Backend * backend = kdb->split->handles[i];
+	if (backend && backend->pluginConfig) backendOpenPlugins (backend, kdb->modules, errorKey);
+	splitAppend (split, backend, keyDup (kdb->split->parents[i]), kdb->split->syncbits[i]);
+}
+
+static int elektraSplitBuildup (Split * split, KDB * kdb, Key * parentKey, Key * errorKey)
 {
 	/* For compatibility reasons invalid names are accepted, too.
 	 * This solution is faster than checking the name of parentKey
@@ -303,7 +302,7 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 		{
 			if (!elektraKeySetNameByNamespace (key, ins)) continue;
 			keyAddName (key, keyName (parentKey));
-			splitBuildup (split, kdb, key);
+			elektraSplitBuildup (split, kdb, key, errorKey);
 		}
 		keyDel (key);
 		return 1;
@@ -327,7 +326,7 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 			printf ("   def add %s\n", keyName (kdb->split->parents[i]));
 #endif
 			/* Catch all: add all mountpoints */
-			splitAppend (split, kdb->split->handles[i], keyDup (kdb->split->parents[i]), kdb->split->syncbits[i]);
+			splitAppendMounted (split, kdb, i, errorKey);
 		}
 		else if (backend == kdb->split->handles[i] && keyRel (kdb->split->parents[i], parentKey) >= 0)
 		{
@@ -335,7 +334,7 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 			printf ("   exa add %s\n", keyName (kdb->split->parents[i]));
 #endif
 			/* parentKey is exactly in this backend, so add it! */
-			splitAppend (split, kdb->split->handles[i], keyDup (kdb->split->parents[i]), kdb->split->syncbits[i]);
+			splitAppendMounted (split, kdb, i, errorKey);
 		}
 		else if (keyRel (parentKey, kdb->split->parents[i]) >= 0)
 		{
@@ -343,13 +342,66 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 			printf ("   rel add %s\n", keyName (kdb->split->parents[i]));
 #endif
 			/* this backend is completely below the parentKey, so lets add it. */
-			splitAppend (split, kdb->split->handles[i], keyDup (kdb->split->parents[i]), kdb->split->syncbits[i]);
+			splitAppendMounted (split, kdb, i, errorKey);
 		}
 	}
 
 	return 1;
 }
 
+/**
+ * Walks through kdb->split and adds all backends below parentKey to split.
+ *
+ * Sets syncbits to 2 if it is a default or root backend (which needs splitting).
+ * The information is copied from kdb->split.
+ *
+ * @pre split needs to be empty, directly after creation with splitNew().
+ *
+ * @pre there needs to be a valid defaultBackend
+ *      but its ok not to have a trie inside KDB.
+ *
+ * @pre parentKey must be a valid key! (could be implemented more generally,
+ *      but that would require splitting up of keysets of the same backend)
+ *
+ * @param split will get all backends appended
+ * @param kdb the handle to get information about backends
+ * @param parentKey the information below which key the backends are from interest,
+ *        warnings about plugins which could not be opened are added to it
+ * @ingroup split
+ * @retval 1 always
+ */
+int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
+{
+	return elektraSplitBuildup (split, kdb, parentKey, parentKey);
+}
+
+
+/**
+ * @brief Lookup the backend of a key like mountGetBackend().
+ *
+ * Uses the router of the split, so keys should be looked up in the
+ * order of their KeySet.
+ *
+ * @param split the split object to work with
+ * @param handle the handle with the mounted backends
+ * @param key the key to look up
+ *
+ * @return the backend handle associated with the key
+ * @ingroup split
+ */
+static Backend * splitGetBackend (Split * split, KDB * handle, const Key * key)
+{
+	if (!split->router || trieRouterGetTrie (split->router) != handle->trie)
+	{
+		trieRouterDel (split->router);
+		split->router = trieRouterNew (handle->trie);
+	}
+	if (!split->router || !strcmp (keyName (key), "")) return mountGetBackend (handle, key);
+
+	Backend * ret = trieRouterLookup (split->router, key);
+	if (!ret) return handle->defaultBackend;
+	return ret;
+}
 
 /**
  * Splits up the keysets and search for a sync bit in every key.
@@ -375,16 +427,26 @@ int splitDivide (Split * split, KDB * handle, KeySet * ks)
 {
 	int needsSync = 0;
 	Key * curKey = 0;
+	Backend * lastHandle = 0;
+	elektraNamespace lastNamespace = KEY_NS_NONE;
+	ssize_t curFound = -1;
 
 	ksRewind (ks);
 	while ((curKey = ksNext (ks)) != 0)
 	{
 		// TODO: handle keys in wrong namespaces
-		Backend * curHandle = mountGetBackend (handle, curKey);
+		Backend * curHandle = splitGetBackend (split, handle, curKey);
 		if (!curHandle) return -1;
 
 		/* If key could be appended to any of the existing split keysets */
-		ssize_t curFound = splitSearchBackend (split, curHandle, curKey);
+		elektraNamespace curNamespace = keyGetNamespace (curKey);
+		if (curHandle != lastHandle || curNamespace != lastNamespace)
+		{
+			// consecutive keys mostly belong to the same backend
+			curFound = splitSearchBackend (split, curHandle, curKey);
+			lastHandle = curHandle;
+			lastNamespace = curNamespace;
+		}
 
 		if (curFound == -1) continue; // key not relevant in this kdbSet
 
@@ -438,17 +500,25 @@ int splitAppoint (Split * split, KDB * handle, KeySet * ks)
 {
 	Key * curKey = 0;
 	ssize_t defFound = splitAppend (split, 0, 0, 0);
+	Backend * lastHandle = 0;
+	elektraNamespace lastNamespace = KEY_NS_NONE;
+	ssize_t curFound = -1;
 
 	ksRewind (ks);
 	while ((curKey = ksNext (ks)) != 0)
 	{
-		Backend * curHandle = mountGetBackend (handle, curKey);
+		Backend * curHandle = splitGetBackend (split, handle, curKey);
 		if (!curHandle) return -1;
 
 		/* If key could be appended to any of the existing split keysets */
-		ssize_t curFound = splitSearchBackend (split, curHandle, curKey);
-
-		if (curFound == -1) curFound = defFound;
+		elektraNamespace curNamespace = keyGetNamespace (curKey);
+		if (curHandle != lastHandle || curNamespace != lastNamespace)
+		{
+			curFound = splitSearchBackend (split, curHandle, curKey);
+			if (curFound == -1) curFound = defFound;
+			lastHandle = curHandle;
+			lastNamespace = curNamespace;
+		}
 
 		if (split->syncbits[curFound] & SPLIT_FLAG_SYNC)
 		{
@@ -522,7 +592,7 @@ static int elektraSplitPostprocess (Split * split, int i, Key * warningKey, KDB
 	ksRewind (split->keysets[i]);
 	while ((cur = ksNext (split->keysets[i])) != 0)
 	{
-		Backend * curHandle = mountGetBackend (handle, cur);
+		Backend * curHandle = splitGetBackend (split, handle, cur);
 		if (!curHandle) return -1;
 
 		keyClearSync (cur);
@@ -0,0 +1,319 @@
+/**
+ * @file
+ *
+ * @brief Timing of the phases of kdbGet() and kdbSet().
+ *
+ * Tracing is active during a kdbGet() or kdbSet() if the parentKey
+ * has the metakey `trace` or a callback was registered with
+ * elektraTraceSetCallback(). kdb.c then measures the global plugins,
+ * splitBuildup(), every plugin of every backend and the merging of the
+ * KeySets. At the end of the call the events are passed to the
+ * callback and, if requested, written to the metadata of the
+ * parentKey:
+ *
+ * - `trace/#<n>/phase` the phase, e.g. `resolver` or `POSTGETSTORAGE`
+ * - `trace/#<n>/plugin` the plugin, if the event belongs to one
+ * - `trace/#<n>/mountpoint` the mountpoint, if the event belongs to one
+ * - `trace/#<n>/start` nanoseconds since the start of the call
+ * - `trace/#<n>/duration` nanoseconds the phase took
+ * - `trace/#<n>/keys` number of keys afterwards, if known
+ *
+ * The last event is the whole kdbGet() (phase `get`) or kdbSet()
+ * (phase `set`). Without tracing only a pointer is checked per phase.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <kdbinternal.h>
+
+/** Smallest number of events allocated */
+#define ELEKTRA_TRACE_MIN_EVENTS 32
+
+struct _ElektraTrace
+{
+	ElektraTraceCallback callback;
+	void * data;
+
+	int depth;	   /*!< nesting of kdbGet()/kdbSet() calls, only the outermost one is traced */
+	int active;	   /*!< 1 if the current call is traced */
+	int toMeta;	   /*!< 1 if the events are written to the metadata of the parentKey */
+	uint64_t origin;   /*!< time the current call started */
+	ElektraTraceEvent * events;
+	size_t size;
+	size_t alloc;
+	pthread_mutex_t mutex; /*!< protects the events, backends might be updated in parallel */
+};
+
+
+/**
+ * @internal
+ *
+ * @brief Monotonic time in nanoseconds.
+ */
+static uint64_t elektraTraceClock (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday (&tv, 0);
+	return (uint64_t) tv.tv_sec * 1000000000 + (uint64_t) tv.tv_usec * 1000;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates the trace of a handle if not done before.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraTraceInit (KDB * handle)
+{
+	if (handle->trace) return 0;
+
+	handle->trace = elektraCalloc (sizeof (ElektraTrace));
+	if (!handle->trace) return -1;
+	pthread_mutex_init (&handle->trace->mutex, 0);
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes the metadata of a previous trace.
+ *
+ * Metakeys are sorted, so after a removal the iteration restarts.
+ */
+static void elektraTraceRemoveMeta (Key * parentKey)
+{
+	const Key * meta;
+	keyRewindMeta (parentKey);
+	while ((meta = keyNextMeta (parentKey)) != 0)
+	{
+		if (strncmp (keyName (meta), "trace/", sizeof ("trace/") - 1)) continue;
+		keySetMeta (parentKey, keyName (meta), 0);
+		keyRewindMeta (parentKey);
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Writes one event to the metadata of the parentKey.
+ */
+static void elektraTraceWriteMeta (Key * parentKey, size_t index, const ElektraTraceEvent * event)
+{
+	char name[ELEKTRA_MAX_ARRAY_SIZE + sizeof ("trace/") + sizeof ("/mountpoint")];
+	char value[32];
+	strcpy (name, "trace/");
+	elektraWriteArrayNumber (name + sizeof ("trace/") - 1, index);
+	char * field = name + strlen (name);
+
+	strcpy (field, "/phase");
+	keySetMeta (parentKey, name, event->phase);
+	if (event->plugin)
+	{
+		strcpy (field, "/plugin");
+		keySetMeta (parentKey, name, event->plugin);
+	}
+	if (event->mountpoint)
+	{
+		strcpy (field, "/mountpoint");
+		keySetMeta (parentKey, name, event->mountpoint);
+	}
+	strcpy (field, "/start");
+	snprintf (value, sizeof (value), "%llu", (unsigned long long) event->start);
+	keySetMeta (parentKey, name, value);
+	strcpy (field, "/duration");
+	snprintf (value, sizeof (value), "%llu", (unsigned long long) event->duration);
+	keySetMeta (parentKey, name, value);
+	if (event->keys >= 0)
+	{
+		strcpy (field, "/keys");
+		snprintf (value, sizeof (value), "%zd", event->keys);
+		keySetMeta (parentKey, name, value);
+	}
+}
+
+/**
+ * @brief Register a callback receiving the timing of kdbGet() and kdbSet().
+ *
+ * While a callback is registered every kdbGet() and kdbSet() on the
+ * handle is traced, see trace.c. At the end of each call the callback
+ * is called once per event in the order they ended. The strings of an
+ * event are only valid during the callback.
+ *
+ * Independent of the callback, a single call can be traced by adding
+ * the metakey `trace` to its parentKey, the events are then written
+ * to the metadata `trace/#<n>` of the parentKey.
+ *
+ * @param handle the handle to trace
+ * @param callback the function to call, 0 to stop tracing
+ * @param data passed to the callback
+ *
+ * @retval 0 on success
+ * @retval -1 on NULL handle or memory error
+ * @ingroup proposal
+ */
+int elektraTraceSetCallback (KDB * handle, ElektraTraceCallback callback, void * data)
+{
+	if (!handle) return -1;
+	if (!callback && !handle->trace) return 0;
+	if (elektraTraceInit (handle) == -1) return -1;
+
+	handle->trace->callback = callback;
+	handle->trace->data = data;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Starts tracing a kdbGet() or kdbSet().
+ *
+ * Must be paired with elektraTraceEnd(). A call made while a trace
+ * is already running only increments a depth counter, so only the
+ * outermost begin/end pair starts and finishes the trace.
+ *
+ * @param handle the handle of the call
+ * @param parentKey the parentKey of the call, traced if it has the metakey `trace`
+ */
+void elektraTraceBegin (KDB * handle, Key * parentKey)
+{
+	if (!handle) return;
+	if (handle->trace && handle->trace->depth++ > 0) return;
+
+	const int toMeta = keyGetMeta (parentKey, "trace") != 0;
+	if (!toMeta && !(handle->trace && handle->trace->callback)) return;
+
+	if (elektraTraceInit (handle) == -1)
+	{
+		ELEKTRA_LOG_WARNING ("could not allocate trace");
+		return;
+	}
+
+	ElektraTrace * trace = handle->trace;
+	if (trace->depth == 0) trace->depth = 1;
+	if (toMeta) elektraTraceRemoveMeta (parentKey);
+	trace->toMeta = toMeta;
+	trace->size = 0;
+	trace->origin = elektraTraceClock ();
+	trace->active = 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Get the time of the start of a phase.
+ *
+ * @return nanoseconds since the start of the traced call, 0 if tracing is inactive
+ */
+uint64_t elektraTraceNow (KDB * handle)
+{
+	if (!handle || !handle->trace || !handle->trace->active) return 0;
+	return elektraTraceClock () - handle->trace->origin;
+}
+
+/**
+ * @internal
+ *
+ * @brief Records a phase which started at @p start and ends now.
+ *
+ * Does nothing if tracing is inactive. Might be called from several
+ * threads at once.
+ *
+ * @param handle the handle of the call
+ * @param phase the name of the phase, must be valid until the handle is closed
+ * @param plugin the plugin the phase belongs to or 0
+ * @param mountpoint the mountpoint of the backend the phase belongs to or 0
+ * @param start the result of elektraTraceNow() at the start of the phase
+ * @param keys number of keys after the phase or -1 if unknown
+ */
+void elektraTraceRecord (KDB * handle, const char * phase, const Plugin * plugin, const Key * mountpoint, uint64_t start, ssize_t keys)
+{
+	if (!handle || !handle->trace || !handle->trace->active) return;
+
+	ElektraTrace * trace = handle->trace;
+	const uint64_t end = elektraTraceClock () - trace->origin;
+
+	pthread_mutex_lock (&trace->mutex);
+	if (trace->size == trace->alloc)
+	{
+		const size_t alloc = trace->alloc ? trace->alloc * 2 : ELEKTRA_TRACE_MIN_EVENTS;
+		if (elektraRealloc ((void **) &trace->events, alloc * sizeof (ElektraTraceEvent)) == -1)
+		{
+			pthread_mutex_unlock (&trace->mutex);
+			return;
+		}
+		trace->alloc = alloc;
+	}
+
+	ElektraTraceEvent * event = &trace->events[trace->size++];
+	event->phase = phase;
+	event->plugin = plugin ? plugin->name : 0;
+	event->mountpoint = mountpoint ? keyName (mountpoint) : 0;
+	if (event->mountpoint && !*event->mountpoint) event->mountpoint = "/";
+	event->start = start;
+	event->duration = end - start;
+	event->keys = keys;
+	pthread_mutex_unlock (&trace->mutex);
+}
+
+/**
+ * @internal
+ *
+ * @brief Finishes the trace of a kdbGet() or kdbSet().
+ *
+ * Records the whole call as @p phase and delivers all events.
+ *
+ * @param handle the handle of the call
+ * @param parentKey the parentKey of the call, receives the events if it had the metakey `trace`
+ * @param phase `get` or `set`
+ * @param keys number of keys of the KeySet passed to the call
+ */
+void elektraTraceEnd (KDB * handle, Key * parentKey, const char * phase, ssize_t keys)
+{
+	if (!handle || !handle->trace || --handle->trace->depth > 0) return;
+
+	ElektraTrace * trace = handle->trace;
+	trace->depth = 0;
+	if (!trace->active) return;
+
+	elektraTraceRecord (handle, phase, 0, 0, 0, keys);
+	trace->active = 0;
+
+	for (size_t i = 0; i < trace->size; ++i)
+	{
+		if (trace->callback) trace->callback (&trace->events[i], trace->data);
+		if (trace->toMeta) elektraTraceWriteMeta (parentKey, i, &trace->events[i]);
+	}
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees the trace of a handle.
+ */
+void elektraTraceClose (KDB * handle)
+{
+	if (!handle->trace) return;
+
+	pthread_mutex_destroy (&handle->trace->mutex);
+	elektraFree (handle->trace->events);
+	elektraFree (handle->trace);
+	handle->trace = 0;
+}
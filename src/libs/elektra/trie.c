@@ -33,7 +33,7 @@
 #include "kdbinternal.h"
 
 static char * elektraTrieStartsWith (const char * str, const char * substr);
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
+static Backend * elektraTriePrefixLookup (Trie * trie, const char * name, size_t size, size_t offset);
 
 /**
  * @brief The Trie structure
@@ -50,23 +50,14 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
  */
 Backend * trieLookup (Trie * trie, const Key * key)
 {
-	char * where = 0;
-	Backend * ret = 0;
-	size_t len = 0;
-
 	if (!key) return 0;
 	if (!trie) return 0;
 
-	len = keyGetNameSize (key) + 1;
-	if (len <= 1) return 0; // would crash otherwise
-	where = elektraMalloc (len);
-	strncpy (where, keyName (key), len);
-	where[len - 2] = '/';
-
-	ret = elektraTriePrefixLookup (trie, where);
-	elektraFree (where);
+	ssize_t nameSize = keyGetNameSize (key);
+	if (nameSize <= 0) return 0; // would crash otherwise
 
-	return ret;
+	// the name is looked up with a '/' appended, without copying it
+	return elektraTriePrefixLookup (trie, keyName (key), nameSize - 1, 0);
 }
 
 /**
@@ -245,11 +236,43 @@ static char * elektraTrieStartsWith (const char * str, const char * substr)
 	return 0;
 }
 
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name)
+/**
+ * @return the character at position i of name with a '/' appended
+ */
+static inline unsigned char elektraTrieNameAt (const char * name, size_t size, size_t i)
+{
+	if (i < size) return (unsigned char) name[i];
+	return i == size ? '/' : '\0';
+}
+
+/**
+ * @retval 1 if name with a '/' appended continues with text at offset
+ * @retval 0 otherwise
+ */
+static int elektraTrieNameContinuesWith (const char * name, size_t size, size_t offset, const char * text, size_t textlen)
+{
+	if (offset + textlen <= size) return !memcmp (name + offset, text, textlen);
+
+	for (size_t i = 0; i < textlen; ++i)
+	{
+		if ((unsigned char) text[i] != elektraTrieNameAt (name, size, offset + i)) return 0;
+	}
+	return 1;
+}
+
+/**
+ * Lookups name with a '/' appended, starting at offset.
+ *
+ * @param trie the trie to look in
+ * @param name the name of the key
+ * @param size the length of the name
+ * @param offset the number of characters already matched by the parents of trie
+ */
+static Backend * elektraTriePrefixLookup (Trie * trie, const char * name, size_t size, size_t offset)
 {
 	if (trie == NULL) return NULL;
 
-	unsigned char idx = (unsigned char) name[0];
+	unsigned char idx = elektraTrieNameAt (name, size, offset);
 	const char * trieText = trie->text[idx];
 
 	if (trieText == NULL)
@@ -258,9 +281,9 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name)
 	}
 
 	void * ret = NULL;
-	if (elektraTrieStartsWith (name, trieText) == 0)
+	if (elektraTrieNameContinuesWith (name, size, offset, trieText, trie->textlen[idx]))
 	{
-		ret = elektraTriePrefixLookup (trie->children[idx], name + trie->textlen[idx]);
+		ret = elektraTriePrefixLookup (trie->children[idx], name, size, offset + trie->textlen[idx]);
 	}
 	else
 	{
@@ -275,3 +298,328 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name)
 
 	return ret;
 }
+
+
+/**
+ * @brief An entry of a router: a name inserted into the trie.
+ */
+typedef struct
+{
+	Key * mountpoint; /*!< Key with the name, for the order of KeySets */
+	char * name;      /*!< The name as inserted into the trie, ends with '/' */
+	size_t size;      /*!< Length of the name without the '/' */
+	Backend * value;  /*!< The backend of the name */
+	ssize_t parent;   /*!< The nearest entry before whose name is a prefix of this name, -1 if none */
+	size_t order;     /*!< Depth-first position within the trie, the last of equal names wins */
+} TrieRouterEntry;
+
+/**
+ * @brief The private router structure.
+ *
+ * The names of the trie sorted like keys within a KeySet, so that all
+ * keys below a name directly follow it. The name a key is routed to
+ * is the greatest name not greater than the key or one of its parents.
+ */
+struct _TrieRouter
+{
+	Trie * trie;		 /*!< The trie the router was built from */
+	TrieRouterEntry * entries; /*!< The sorted names */
+	size_t size;		 /*!< Number of entries */
+	size_t alloc;		 /*!< Allocated entries */
+	Backend * fallback;	/*!< The backend of the empty name, matching every key */
+	ssize_t position;	  /*!< Greatest entry not greater than the previous key, -1 if none */
+	int useTrie;		   /*!< Names could not be ordered, lookups use the trie */
+};
+
+/**
+ * Adds a name of the trie to the router, which takes ownership of name.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (name is freed)
+ */
+static int elektraTrieRouterAdd (TrieRouter * router, char * name, Backend * value)
+{
+	if (router->size == router->alloc)
+	{
+		size_t alloc = router->alloc > 0 ? router->alloc * 2 : APPROXIMATE_NR_OF_BACKENDS;
+		if (elektraRealloc ((void **) &router->entries, alloc * sizeof (TrieRouterEntry)) == -1)
+		{
+			elektraFree (name);
+			return -1;
+		}
+		router->alloc = alloc;
+	}
+
+	TrieRouterEntry * entry = &router->entries[router->size];
+	entry->mountpoint = 0;
+	entry->name = name;
+	entry->size = strlen (name) - 1;
+	entry->value = value;
+	entry->parent = -1;
+	entry->order = router->size;
+	++router->size;
+	return 0;
+}
+
+/**
+ * Adds all names of trie below prefix to the router, depth-first.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraTrieRouterCollect (TrieRouter * router, Trie * trie, const char * prefix, size_t prefixlen)
+{
+	if (trie == NULL) return 0;
+
+	for (size_t i = 0; i < KDB_MAX_UCHAR; ++i)
+	{
+		if (trie->text[i] == NULL) continue;
+
+		char * name = elektraMalloc (prefixlen + trie->textlen[i] + 1);
+		if (!name) return -1;
+		memcpy (name, prefix, prefixlen);
+		memcpy (name + prefixlen, trie->text[i], trie->textlen[i] + 1);
+
+		// a name inserted again is stored in the empty_value of the child, so it is added afterwards
+		if (trie->value[i])
+		{
+			if (elektraTrieRouterAdd (router, name, trie->value[i]) == -1) return -1;
+			if (elektraTrieRouterCollect (router, trie->children[i], name, prefixlen + trie->textlen[i]) == -1) return -1;
+		}
+		else
+		{
+			int ret = elektraTrieRouterCollect (router, trie->children[i], name, prefixlen + trie->textlen[i]);
+			elektraFree (name);
+			if (ret == -1) return -1;
+		}
+	}
+
+	if (prefixlen > 0 && trie->empty_value)
+	{
+		char * name = elektraStrDup (prefix);
+		if (!name) return -1;
+		return elektraTrieRouterAdd (router, name, trie->empty_value);
+	}
+	return 0;
+}
+
+/**
+ * Sorts by the name of the mountpoints, equal names in the order they were inserted.
+ */
+static int elektraTrieRouterCompare (const void * p1, const void * p2)
+{
+	const TrieRouterEntry * e1 = p1;
+	const TrieRouterEntry * e2 = p2;
+
+	int ret = keyCmp (e1->mountpoint, e2->mountpoint);
+	if (ret != 0) return ret;
+	return e1->order < e2->order ? -1 : e1->order > e2->order;
+}
+
+/**
+ * @retval 1 if the entry is a prefix of the name with a '/' appended
+ * @retval 0 otherwise
+ */
+static int elektraTrieRouterMatches (const TrieRouterEntry * entry, const char * name, size_t size)
+{
+	if (entry->size > size) return 0;
+	if (memcmp (entry->name, name, entry->size)) return 0;
+	return entry->size == size || name[entry->size] == '/';
+}
+
+/**
+ * Sorts the entries and links them to their parents.
+ *
+ * @retval 0 on success
+ * @retval -1 if the names cannot be ordered like keys
+ */
+static int elektraTrieRouterSort (TrieRouter * router)
+{
+	for (size_t i = 0; i < router->size; ++i)
+	{
+		TrieRouterEntry * entry = &router->entries[i];
+		// only names of whole keys (ending with '/') are prefixes of exactly the keys below
+		if (entry->name[entry->size] != '/') return -1;
+		entry->mountpoint = keyNew (entry->name, KEY_END);
+		// the name must already be canonical, otherwise the order of keys does not fit to the prefixes
+		if (!entry->mountpoint || strlen (keyName (entry->mountpoint)) != entry->size ||
+		    strncmp (keyName (entry->mountpoint), entry->name, entry->size))
+		{
+			return -1;
+		}
+	}
+
+	qsort (router->entries, router->size, sizeof (TrieRouterEntry), elektraTrieRouterCompare);
+
+	// keep the name inserted last
+	size_t size = 0;
+	for (size_t i = 0; i < router->size; ++i)
+	{
+		TrieRouterEntry * entry = &router->entries[i];
+		if (i + 1 < router->size && keyCmp (entry->mountpoint, router->entries[i + 1].mountpoint) == 0)
+		{
+			keyDel (entry->mountpoint);
+			elektraFree (entry->name);
+			continue;
+		}
+		router->entries[size++] = *entry;
+	}
+	router->size = size;
+
+	for (size_t i = 0; i < router->size; ++i)
+	{
+		TrieRouterEntry * entry = &router->entries[i];
+		// all names between a prefix and the entry are below the prefix, so the parents of the previous entry are candidates
+		ssize_t parent = (ssize_t) i - 1;
+		while (parent >= 0 && !elektraTrieRouterMatches (&router->entries[parent], entry->name, entry->size))
+		{
+			parent = router->entries[parent].parent;
+		}
+		entry->parent = parent;
+	}
+	return 0;
+}
+
+/**
+ * Frees all entries.
+ */
+static void elektraTrieRouterClear (TrieRouter * router)
+{
+	for (size_t i = 0; i < router->size; ++i)
+	{
+		keyDel (router->entries[i].mountpoint);
+		elektraFree (router->entries[i].name);
+	}
+	elektraFree (router->entries);
+	router->entries = 0;
+	router->size = 0;
+	router->alloc = 0;
+}
+
+/**
+ * @brief Create a router for the names of a trie.
+ *
+ * trieLookup() needs to descend the trie for every key. A router
+ * stores the names of the trie in the order of keys within a KeySet.
+ * Routing the keys of a KeySet in their order only needs to check if
+ * the next mountpoint was reached and if the key is still below the
+ * current one, which needs no allocation and touches only few entries.
+ *
+ * The router must not be used after the trie changed.
+ *
+ * @param trie the trie to route to
+ *
+ * @return the router, free it with trieRouterDel()
+ * @retval 0 on memory error
+ * @ingroup trie
+ */
+TrieRouter * trieRouterNew (Trie * trie)
+{
+	TrieRouter * router = elektraCalloc (sizeof (TrieRouter));
+	if (!router) return 0;
+
+	router->trie = trie;
+	router->fallback = trie ? trie->empty_value : 0;
+	router->position = -1;
+
+	if (elektraTrieRouterCollect (router, trie, "", 0) == -1)
+	{
+		trieRouterDel (router);
+		return 0;
+	}
+
+	if (elektraTrieRouterSort (router) == -1)
+	{
+		elektraTrieRouterClear (router);
+		router->useTrie = 1;
+	}
+	return router;
+}
+
+/**
+ * @brief Frees a router.
+ *
+ * @param router the router to free
+ * @ingroup trie
+ */
+void trieRouterDel (TrieRouter * router)
+{
+	if (!router) return;
+	elektraTrieRouterClear (router);
+	elektraFree (router);
+}
+
+/**
+ * @return the trie the router was created for
+ * @ingroup trie
+ */
+Trie * trieRouterGetTrie (const TrieRouter * router)
+{
+	return router->trie;
+}
+
+/**
+ * @return the greatest entry from first on not greater than key, first - 1 if there is none
+ */
+static ssize_t elektraTrieRouterSearch (const TrieRouter * router, size_t first, const Key * key)
+{
+	size_t lo = first;
+	size_t hi = router->size;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (keyCmp (router->entries[mid].mountpoint, key) <= 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return (ssize_t) lo - 1;
+}
+
+/**
+ * @brief Lookup a backend like trieLookup().
+ *
+ * Keys can be looked up in any order, but looking them up in the
+ * order of a KeySet is fastest: mostly one comparison with the next
+ * mountpoint and one with the current one.
+ *
+ * @param router the router to work with
+ * @param key the name of this key will be looked up
+ *
+ * @return the backend if found
+ * @return 0 otherwise
+ * @ingroup trie
+ */
+Backend * trieRouterLookup (TrieRouter * router, const Key * key)
+{
+	if (!router || !key) return 0;
+	if (router->useTrie) return trieLookup (router->trie, key);
+
+	ssize_t nameSize = keyGetNameSize (key);
+	if (nameSize <= 0) return 0;
+
+	const TrieRouterEntry * entries = router->entries;
+	ssize_t position = router->position;
+	if (position >= 0 && keyCmp (entries[position].mountpoint, key) > 0)
+	{
+		// the keys are not looked up in order
+		position = elektraTrieRouterSearch (router, 0, key);
+	}
+	else if ((size_t) (position + 1) < router->size && keyCmp (entries[position + 1].mountpoint, key) <= 0)
+	{
+		position = elektraTrieRouterSearch (router, position + 1, key);
+	}
+	router->position = position;
+
+	const char * name = keyName (key);
+	const size_t size = nameSize - 1;
+	for (ssize_t i = position; i >= 0; i = entries[i].parent)
+	{
+		if (elektraTrieRouterMatches (&entries[i], name, size)) return entries[i].value;
+	}
+	return router->fallback;
+}
@@ -60,10 +60,11 @@ ssize_t keySetStringF (Key * key, const char * format, ...)
 		return -1;
 	}
 
-	if (key->data.c)
+	if (key->data.c && !test_bit (key->flags, KEY_FLAG_ARENA_VALUE))
 	{
 		elektraFree (key->data.c);
 	}
+	clear_bit (key->flags, KEY_FLAG_ARENA_VALUE);
 
 	key->data.c = p;
 	key->dataSize = elektraStrLen (key->data.c);
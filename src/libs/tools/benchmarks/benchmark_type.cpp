@@ -0,0 +1,137 @@
+/**
+ * @file
+ *
+ * @brief benchmark for checking many typed keys with the type plugin
+ *
+ * The benchmark creates keys for all numeric types supported by the type plugin and measures how long the plugin takes to check
+ * them. To compare the plugin with another implementation, run the benchmark at both commits.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#include <kdbconfig.h>
+#include <kdbtimer.hpp>
+#include <modules.hpp>
+
+#include <unistd.h>
+
+#include <iostream>
+
+long long nr_keys = 100000LL;
+
+const int benchmarkIterations = 11; // is a good number to not need mean values for median
+
+std::string const root = "user/benchmark/type";
+
+struct TypedValue
+{
+	char const * type;
+	char const * value;
+};
+
+TypedValue const testData[] = { { "short", "-12345" },
+				{ "unsigned_short", "65535" },
+				{ "long", "2147483647" },
+				{ "unsigned_long", "4000000000" },
+				{ "long_long", "-9223372036854775808" },
+				{ "unsigned_long_long", "18446744073709551615" },
+				{ "float", "3.14159" },
+				{ "double", "-2.5e-300" },
+				{ "long_double", "1e4000" },
+				{ "boolean", "1" },
+				{ "empty long", "" },
+				{ "FSType", "ext4,nfs" } };
+
+
+kdb::KeySet createKeySet ()
+{
+	using namespace kdb;
+
+	size_t const nr_types = sizeof (testData) / sizeof (testData[0]);
+	KeySet data;
+	for (long long i = 0; i < nr_keys; ++i)
+	{
+		TypedValue const & typed = testData[i % nr_types];
+		Key k (root + "/key" + std::to_string (i), KEY_VALUE, typed.value, KEY_META, "check/type", typed.type, KEY_END);
+		if (i % (2 * nr_types) == 0)
+		{
+			// every other short gets a range
+			k.setMeta<std::string> ("check/type/min", "-20000");
+			k.setMeta<std::string> ("check/type/max", "20000");
+		}
+		data.append (k);
+	}
+	return data;
+}
+
+__attribute__ ((noinline)) void benchmark_check (kdb::tools::PluginPtr & plugin, kdb::KeySet & data)
+{
+	using namespace kdb;
+	static Timer t ("check");
+
+	Key parent (root, KEY_END);
+	data.rewind (); // like kdbSet, the plugin checks the keys starting at the cursor
+
+	t.start ();
+	int ret = plugin->set (data, parent);
+	t.stop ();
+
+	if (ret != 1)
+	{
+		std::cerr << "type check failed: " << parent.getMeta<std::string> ("error/reason") << std::endl;
+		exit (1);
+	}
+
+	std::cout << t;
+}
+
+
+void computer_info ()
+{
+	std::cout << std::endl;
+	std::cout << std::endl;
+#ifndef _WIN32
+	char hostname[1024];
+	gethostname (hostname, 1023);
+	std::cout << "hostname " << hostname << std::endl;
+#endif
+#ifdef __GNUC__
+	std::cout << "gcc: " << __GNUC__ << std::endl;
+#endif
+#ifdef __INTEL_COMPILER
+	std::cout << "icc: " << __INTEL_COMPILER << std::endl;
+#endif
+#ifdef __clang__
+	std::cout << "clang: " << __clang__ << std::endl;
+#endif
+	std::cout << "sizeof(int) " << sizeof (int) << std::endl;
+	std::cout << "sizeof(long) " << sizeof (long) << std::endl;
+	std::cout << "sizeof(long long) " << sizeof (long long) << std::endl;
+	std::cout << "number of keys " << nr_keys << std::endl;
+	std::cout << std::endl;
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc > 1)
+	{
+		nr_keys = atoll (argv[1]);
+	}
+
+	computer_info ();
+
+	kdb::tools::Modules modules;
+	// without a module config, so that the plugin builds up its type checker
+	kdb::tools::PluginPtr plugin = modules.load ("type", kdb::KeySet ());
+	kdb::KeySet data = createKeySet ();
+
+	for (int i = 0; i < benchmarkIterations; ++i)
+	{
+		std::cout << i << std::endl;
+
+		benchmark_check (plugin, data);
+	}
+
+	std::cerr << "value,benchmark" << std::endl;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file
+ *
+ * @brief benchmark for reading and writing large YAML files with the yamlcpp plugin
+ *
+ * The benchmark reads the test data of the yamlcpp plugin, stores many copies of it in a single file and then measures how long the
+ * plugin takes to write and read this file. To compare the plugin with another implementation, run the benchmark at both commits.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#include <kdbconfig.h>
+#include <kdbtimer.hpp>
+#include <modules.hpp>
+
+#include <unistd.h>
+
+#include <iostream>
+
+long long nr_copies = 1000LL;
+
+const int benchmarkIterations = 11; // is a good number to not need mean values for median
+
+std::string dataDirectory = BUILTIN_DATA_FOLDER "/yamlcpp/";
+
+std::string const testData[] = { "flat_block_mapping",	 "flat_flow_mapping", "nested_block_mapping",
+				 "nested_mixed_mapping", "simple_sequence",   "nested_sequences" };
+
+std::string const root = "user/benchmark/yamlcpp";
+std::string const file = "/tmp/benchmark_yamlcpp.yaml";
+
+
+kdb::KeySet createKeySet (kdb::tools::PluginPtr & plugin)
+{
+	using namespace kdb;
+
+	KeySet data;
+	for (auto const & name : testData)
+	{
+		KeySet ks;
+		Key parent (root, KEY_VALUE, (dataDirectory + name + ".yaml").c_str (), KEY_END);
+		if (plugin->get (ks, parent) != 1)
+		{
+			std::cerr << "could not read test data from " << parent.getString () << std::endl;
+			exit (1);
+		}
+
+		for (long long copy = 0; copy < nr_copies; ++copy)
+		{
+			std::string const prefix = root + "/" + name + "/copy" + std::to_string (copy);
+			for (auto key : ks)
+			{
+				Key dup = key.dup ();
+				dup.setName (prefix + key.getName ().substr (root.size ()));
+				data.append (dup);
+			}
+		}
+	}
+	return data;
+}
+
+__attribute__ ((noinline)) void benchmark_write (kdb::tools::PluginPtr & plugin, kdb::KeySet & data)
+{
+	using namespace kdb;
+	static Timer t ("write");
+
+	KeySet ks = data.dup ();
+	Key parent (root, KEY_VALUE, file.c_str (), KEY_END);
+
+	t.start ();
+	plugin->set (ks, parent);
+	t.stop ();
+
+	std::cout << t;
+}
+
+__attribute__ ((noinline)) void benchmark_read (kdb::tools::PluginPtr & plugin)
+{
+	using namespace kdb;
+	static Timer t ("read");
+
+	KeySet ks;
+	Key parent (root, KEY_VALUE, file.c_str (), KEY_END);
+
+	t.start ();
+	plugin->get (ks, parent);
+	t.stop ();
+
+	std::cout << t;
+}
+
+
+void computer_info ()
+{
+	std::cout << std::endl;
+	std::cout << std::endl;
+#ifndef _WIN32
+	char hostname[1024];
+	gethostname (hostname, 1023);
+	std::cout << "hostname " << hostname << std::endl;
+#endif
+#ifdef __GNUC__
+	std::cout << "gcc: " << __GNUC__ << std::endl;
+#endif
+#ifdef __INTEL_COMPILER
+	std::cout << "icc: " << __INTEL_COMPILER << std::endl;
+#endif
+#ifdef __clang__
+	std::cout << "clang: " << __clang__ << std::endl;
+#endif
+	std::cout << "sizeof(int) " << sizeof (int) << std::endl;
+	std::cout << "sizeof(long) " << sizeof (long) << std::endl;
+	std::cout << "sizeof(long long) " << sizeof (long long) << std::endl;
+	std::cout << "copies of test data " << nr_copies << std::endl;
+	std::cout << std::endl;
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc > 1)
+	{
+		nr_copies = atoll (argv[1]);
+	}
+	if (argc > 2)
+	{
+		dataDirectory = std::string (argv[2]) + "/";
+	}
+
+	computer_info ();
+
+	kdb::tools::Modules modules;
+	kdb::tools::PluginPtr plugin = modules.load ("yamlcpp");
+	kdb::KeySet data = createKeySet (plugin);
+	std::cout << "number of keys " << data.size () << std::endl;
+
+	for (int i = 0; i < benchmarkIterations; ++i)
+	{
+		std::cout << i << std::endl;
+
+		benchmark_write (plugin, data);
+		benchmark_read (plugin);
+	}
+
+	unlink (file.c_str ());
+	std::cerr << "value,benchmark" << std::endl;
+}
@@ -22,6 +22,7 @@
 #endif
 #include "gpg.h"
 #include "helper.h"
+#include "keycache.h"
 #include <kdb.h>
 #include <kdberrors.h>
 #include <kdbtypes.h>
@@ -32,6 +33,12 @@
 static pthread_mutex_t mutex_ref_cnt = PTHREAD_MUTEX_INITIALIZER;
 static unsigned int ref_cnt = 0;
 
+#if defined(ELEKTRA_CRYPTO_API_GCRYPT)
+#define CRYPTO_BACKEND_FUNCTION(name) elektraCryptoGcry##name
+#elif defined(ELEKTRA_CRYPTO_API_OPENSSL)
+#define CRYPTO_BACKEND_FUNCTION(name) elektraCryptoOpenSSL##name
+#endif
+
 // gurads against compiler warnings because the functions are only used within the specified compile variants
 #if defined(ELEKTRA_CRYPTO_API_GCRYPT) || defined(ELEKTRA_CRYPTO_API_OPENSSL) || defined(ELEKTRA_CRYPTO_API_BOTAN)
 
@@ -179,28 +186,54 @@ static int elektraCryptoCreateRandomString (Key * errorKey ELEKTRA_UNUSED, char
 	return -1;
 }
 
+#ifdef CRYPTO_BACKEND_FUNCTION
+
 /**
- * @brief overwrites the value of the key with zeroes and then releases the Key.
- * @param key to be overwritten and released
+ * @brief set the cryptographic key and IV derived from the given salt on the crypto handle.
+ *
+ * The key material is taken from the cache of the plugin instance, if the salt has been seen before.
+ * Otherwise it is derived from the master password and added to the cache.
+ *
+ * @param cache the cache of the plugin instance
+ * @param cryptoHandle the handle to be keyed
+ * @param errorKey holds an error description in case of failure
+ * @param masterKey holds the decrypted master password
+ * @param salt the salt of the (Elektra) Key to be encrypted or decrypted
+ * @param saltLen the length of the salt
+ * @param iterations the iteration count of the key derivation function
+ * @param op tells if the handle is used for encryption or decryption
+ * @retval 1 on success
+ * @retval -1 on failure. errorKey holds an error description.
  */
-static void elektraCryptoSafelyReleaseKey (Key * key)
+static int elektraCryptoSetKey (ElektraCryptoKeyCache * cache, elektraCryptoHandle * cryptoHandle, Key * errorKey, Key * masterKey,
+				const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen, const kdb_unsigned_long_t iterations,
+				const enum ElektraCryptoOperation op)
 {
-	if (key)
+	kdb_octet_t keyMaterial[ELEKTRA_CRYPTO_KEY_MATERIAL_LEN];
+	const kdb_octet_t * cached = CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, salt, saltLen);
+	if (!cached)
 	{
-		// overwrite key content with zeroes
-		ssize_t length = keyGetValueSize (key);
-		if (length > 0)
+		if (CRYPTO_BACKEND_FUNCTION (DeriveKey) (errorKey, masterKey, salt, saltLen, iterations, keyMaterial, op) != 1)
 		{
-			memset ((void *) keyValue (key), 0, length);
+			memset (keyMaterial, 0, sizeof (keyMaterial));
+			return -1;
 		}
-
-		// release the key
-		keyDel (key);
+		CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (cache, salt, saltLen, keyMaterial);
+		cached = keyMaterial;
 	}
+
+	const int result = CRYPTO_BACKEND_FUNCTION (SetKey) (cryptoHandle, errorKey, cached);
+	memset (keyMaterial, 0, sizeof (keyMaterial));
+	return result;
 }
 
+#endif
+
 /**
  * @brief encrypt the (Elektra) Keys contained in data.
+ *
+ * All Keys are encrypted with the same crypto handle, which is keyed anew for every Key.
+ *
  * @param handle for the current plugin instance
  * @param data the KeySet holding the data
  * @param errorKey holds an error description in case of failure
@@ -210,19 +243,22 @@ static void elektraCryptoSafelyReleaseKey (Key * key)
 static int elektraCryptoEncrypt (Plugin * handle ELEKTRA_UNUSED, KeySet * data ELEKTRA_UNUSED, Key * errorKey ELEKTRA_UNUSED)
 {
 	Key * k;
-	Key * masterKey = NULL;
+	int result = 1;
 
 #if defined(ELEKTRA_CRYPTO_API_GCRYPT) || defined(ELEKTRA_CRYPTO_API_OPENSSL) || defined(ELEKTRA_CRYPTO_API_BOTAN)
 	KeySet * pluginConfig = elektraPluginGetConfig (handle);
-	masterKey = CRYPTO_PLUGIN_FUNCTION (getMasterPassword) (errorKey, pluginConfig);
+	ElektraCryptoKeyCache * cache = elektraPluginGetData (handle);
+	Key * masterKey = CRYPTO_PLUGIN_FUNCTION (keyCacheGetMasterPassword) (cache, errorKey, pluginConfig);
 	if (!masterKey)
 	{
-		goto error; // error has been set by getMasterPassword
+		return -1; // error has been set by getMasterPassword
 	}
 #endif
 
-#if defined(ELEKTRA_CRYPTO_API_GCRYPT) || defined(ELEKTRA_CRYPTO_API_OPENSSL)
+#ifdef CRYPTO_BACKEND_FUNCTION
 	elektraCryptoHandle * cryptoHandle = NULL;
+	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, pluginConfig);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, iterations);
 #endif
 
 	ksRewind (data);
@@ -233,58 +269,49 @@ static int elektraCryptoEncrypt (Plugin * handle ELEKTRA_UNUSED, KeySet * data E
 			continue;
 		}
 
-#if defined(ELEKTRA_CRYPTO_API_GCRYPT)
-
-		if (elektraCryptoGcryHandleCreate (&cryptoHandle, pluginConfig, errorKey, masterKey, k, ELEKTRA_CRYPTO_ENCRYPT) != 1)
-		{
-			goto error;
-		}
-
-		if (elektraCryptoGcryEncrypt (cryptoHandle, k, errorKey) != 1)
-		{
-			elektraCryptoGcryHandleDestroy (cryptoHandle);
-			goto error;
-		}
-
-		elektraCryptoGcryHandleDestroy (cryptoHandle);
-		cryptoHandle = NULL;
-
-#elif defined(ELEKTRA_CRYPTO_API_OPENSSL)
+#ifdef CRYPTO_BACKEND_FUNCTION
 
-		if (elektraCryptoOpenSSLHandleCreate (&cryptoHandle, pluginConfig, errorKey, masterKey, k, ELEKTRA_CRYPTO_ENCRYPT) != 1)
+		if (!cryptoHandle && CRYPTO_BACKEND_FUNCTION (HandleCreate) (&cryptoHandle, errorKey) != 1)
 		{
-			elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-			goto error;
+			result = -1;
+			break;
 		}
 
-		if (elektraCryptoOpenSSLEncrypt (cryptoHandle, k, errorKey) != 1)
+		// every Key gets a fresh salt, so the key material for encryption is never reused
+		kdb_octet_t salt[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN];
+		if (CRYPTO_BACKEND_FUNCTION (CreateSalt) (errorKey, salt) != 1 ||
+		    CRYPTO_PLUGIN_FUNCTION (setSaltAsMetakey) (errorKey, k, salt, sizeof (salt)) != 1 ||
+		    elektraCryptoSetKey (cache, cryptoHandle, errorKey, masterKey, salt, sizeof (salt), iterations,
+					 ELEKTRA_CRYPTO_ENCRYPT) != 1 ||
+		    CRYPTO_BACKEND_FUNCTION (Encrypt) (cryptoHandle, k, errorKey) != 1)
 		{
-			elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-			goto error;
+			result = -1;
+			break;
 		}
 
-		elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-		cryptoHandle = NULL;
-
 #elif defined(ELEKTRA_CRYPTO_API_BOTAN)
 
 		if (elektraCryptoBotanEncrypt (pluginConfig, k, errorKey, masterKey) != 1)
 		{
-			goto error; // failure, error has been set by elektraCryptoBotanEncrypt
+			result = -1; // failure, error has been set by elektraCryptoBotanEncrypt
+			break;
 		}
 
 #endif
 	}
-	elektraCryptoSafelyReleaseKey (masterKey);
-	return 1;
 
-error:
-	elektraCryptoSafelyReleaseKey (masterKey);
-	return -1;
+#ifdef CRYPTO_BACKEND_FUNCTION
+	CRYPTO_BACKEND_FUNCTION (HandleDestroy) (cryptoHandle);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+#endif
+	return result;
 }
 
 /**
  * @brief decrypt the (Elektra) Keys contained in data.
+ *
+ * All Keys are decrypted with the same crypto handle, which is keyed anew for every Key.
+ *
  * @param handle for the current plugin instance
  * @param data the KeySet holding the data
  * @param errorKey holds an error description in case of failure
@@ -294,19 +321,22 @@ error:
 static int elektraCryptoDecrypt (Plugin * handle ELEKTRA_UNUSED, KeySet * data, Key * errorKey)
 {
 	Key * k;
-	Key * masterKey = NULL;
+	int result = 1;
 
 #if defined(ELEKTRA_CRYPTO_API_GCRYPT) || defined(ELEKTRA_CRYPTO_API_OPENSSL) || defined(ELEKTRA_CRYPTO_API_BOTAN)
 	KeySet * pluginConfig = elektraPluginGetConfig (handle);
-	masterKey = CRYPTO_PLUGIN_FUNCTION (getMasterPassword) (errorKey, pluginConfig);
+	ElektraCryptoKeyCache * cache = elektraPluginGetData (handle);
+	Key * masterKey = CRYPTO_PLUGIN_FUNCTION (keyCacheGetMasterPassword) (cache, errorKey, pluginConfig);
 	if (!masterKey)
 	{
-		goto error; // error has been set by getMasterPassword
+		return -1; // error has been set by getMasterPassword
 	}
 #endif
 
-#if defined(ELEKTRA_CRYPTO_API_GCRYPT) || defined(ELEKTRA_CRYPTO_API_OPENSSL)
+#ifdef CRYPTO_BACKEND_FUNCTION
 	elektraCryptoHandle * cryptoHandle = NULL;
+	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, pluginConfig);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, iterations);
 #endif
 
 	ksRewind (data);
@@ -320,68 +350,58 @@ static int elektraCryptoDecrypt (Plugin * handle ELEKTRA_UNUSED, KeySet * data,
 		if (!checkPayloadVersion (k, errorKey))
 		{
 			// error has been set by checkPayloadVersion()
-			goto error;
-		}
-
-#if defined(ELEKTRA_CRYPTO_API_GCRYPT)
-
-		if (elektraCryptoGcryHandleCreate (&cryptoHandle, pluginConfig, errorKey, masterKey, k, ELEKTRA_CRYPTO_DECRYPT) != 1)
-		{
-			goto error;
-		}
-
-		if (elektraCryptoGcryDecrypt (cryptoHandle, k, errorKey) != 1)
-		{
-			elektraCryptoGcryHandleDestroy (cryptoHandle);
-			goto error;
+			result = -1;
+			break;
 		}
 
-		elektraCryptoGcryHandleDestroy (cryptoHandle);
-		cryptoHandle = NULL;
-
-#elif defined(ELEKTRA_CRYPTO_API_OPENSSL)
+#ifdef CRYPTO_BACKEND_FUNCTION
 
-		if (elektraCryptoOpenSSLHandleCreate (&cryptoHandle, pluginConfig, errorKey, masterKey, k, ELEKTRA_CRYPTO_DECRYPT) != 1)
+		if (!cryptoHandle && CRYPTO_BACKEND_FUNCTION (HandleCreate) (&cryptoHandle, errorKey) != 1)
 		{
-			elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-			goto error;
+			result = -1;
+			break;
 		}
 
-		if (elektraCryptoOpenSSLDecrypt (cryptoHandle, k, errorKey) != 1)
+		kdb_octet_t * salt = NULL;
+		kdb_unsigned_long_t saltLen = 0;
+		if (CRYPTO_PLUGIN_FUNCTION (getSaltFromPayload) (errorKey, k, &salt, &saltLen) != 1 ||
+		    elektraCryptoSetKey (cache, cryptoHandle, errorKey, masterKey, salt, saltLen, iterations,
+					 ELEKTRA_CRYPTO_DECRYPT) != 1 ||
+		    CRYPTO_BACKEND_FUNCTION (Decrypt) (cryptoHandle, k, errorKey) != 1)
 		{
-			elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-			goto error;
+			result = -1;
+			break;
 		}
 
-		elektraCryptoOpenSSLHandleDestroy (cryptoHandle);
-		cryptoHandle = NULL;
-
 #elif defined(ELEKTRA_CRYPTO_API_BOTAN)
 
 		if (elektraCryptoBotanDecrypt (pluginConfig, k, errorKey, masterKey) != 1)
 		{
-			goto error; // failure, error has been set by elektraCryptoBotanDecrypt
+			result = -1; // failure, error has been set by elektraCryptoBotanDecrypt
+			break;
 		}
 
 #endif
 	}
-	elektraCryptoSafelyReleaseKey (masterKey);
-	return 1;
 
-error:
-	elektraCryptoSafelyReleaseKey (masterKey);
-	return -1;
+#ifdef CRYPTO_BACKEND_FUNCTION
+	CRYPTO_BACKEND_FUNCTION (HandleDestroy) (cryptoHandle);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+#endif
+	return result;
 }
 
 /**
  * @brief initialize the crypto provider for the first instance of the plugin.
  *
+ * Every instance gets its own cache for the master password and the derived keys.
+ *
  * @param handle holds the plugin handle
  * @param errorKey holds an error description in case of failure
  * @retval 1 on success
  * @retval -1 on failure. Check errorKey
  */
-int CRYPTO_PLUGIN_FUNCTION (open) (Plugin * handle ELEKTRA_UNUSED, Key * errorKey)
+int CRYPTO_PLUGIN_FUNCTION (open) (Plugin * handle, Key * errorKey)
 {
 	pthread_mutex_lock (&mutex_ref_cnt);
 	if (ref_cnt == 0)
@@ -394,12 +414,22 @@ int CRYPTO_PLUGIN_FUNCTION (open) (Plugin * handle ELEKTRA_UNUSED, Key * errorKe
 	}
 	ref_cnt++;
 	pthread_mutex_unlock (&mutex_ref_cnt);
+
+	ElektraCryptoKeyCache * cache = CRYPTO_PLUGIN_FUNCTION (keyCacheNew) ();
+	if (!cache)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
+		return -1;
+	}
+	elektraPluginSetData (handle, cache);
 	return 1;
 }
 
 /**
  * @brief finalizes the crypto provider for the last instance of the plugin.
  *
+ * The master password and the derived keys of the instance are overwritten with zeroes and released.
+ *
  * @param handle holds the plugin handle
  * @param errorKey holds an error description in case of failure. Not used at the moment.
  * @retval 1 on success
@@ -407,6 +437,9 @@ int CRYPTO_PLUGIN_FUNCTION (open) (Plugin * handle ELEKTRA_UNUSED, Key * errorKe
  */
 int CRYPTO_PLUGIN_FUNCTION (close) (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
 {
+	CRYPTO_PLUGIN_FUNCTION (keyCacheDel) (elektraPluginGetData (handle));
+	elektraPluginSetData (handle, NULL);
+
 	/* default behaviour: no teardown except the user/system requests it */
 	KeySet * pluginConfig = elektraPluginGetConfig (handle);
 	if (!pluginConfig)
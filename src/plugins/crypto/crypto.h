@@ -69,6 +69,9 @@ enum ElektraCryptoOperation {
 #define ELEKTRA_CRYPTO_DEFAULT_ITERATION_COUNT (15000)
 #define ELEKTRA_CRYPTO_DEFAULT_SALT_LEN (17)
 
+// length of the key material that is derived from the master password and a salt: an AES-256 key followed by the IV
+#define ELEKTRA_CRYPTO_KEY_MATERIAL_LEN (32 + 16)
+
 // plugin configuration parameters
 #define ELEKTRA_CRYPTO_PARAM_MASTER_PASSWORD_LEN "/crypto/masterpasswordlength"
 #define ELEKTRA_CRYPTO_PARAM_MASTER_PASSWORD "/crypto/masterpassword"
@@ -23,107 +23,15 @@
 
 #define KEY_BUFFER_SIZE (ELEKTRA_CRYPTO_GCRY_KEYSIZE + ELEKTRA_CRYPTO_GCRY_BLOCKSIZE)
 
+#if KEY_BUFFER_SIZE != ELEKTRA_CRYPTO_KEY_MATERIAL_LEN
+#error "the derived key material does not fit the key and IV of the cipher"
+#endif
+
 // initialize the gcrypt threading subsystem
 // NOTE: old versions of libgcrypt require the functions defined in this macro!
 GCRY_THREAD_OPTION_PTHREAD_IMPL;
 
 
-/**
- * @brief derive the cryptographic key and IV for a given (Elektra) Key k
- * @param config KeySet holding the plugin/backend configuration
- * @param errorKey holds an error description in case of failure
- * @param masterKey holds the decrypted master password from the plugin configuration
- * @param k the (Elektra)-Key to be encrypted
- * @param cKey (Elektra)-Key holding the cryptographic material
- * @param cIv (Elektra)-Key holding the initialization vector
- * @retval -1 on failure. errorKey holds the error description.
- * @retval 1 on success
- */
-static int getKeyIvForEncryption (KeySet * config, Key * errorKey, Key * masterKey, Key * k, Key * cKey, Key * cIv)
-{
-	gcry_error_t gcry_err;
-	kdb_octet_t salt[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN];
-	kdb_octet_t keyBuffer[KEY_BUFFER_SIZE];
-	char * saltHexString = NULL;
-
-	ELEKTRA_ASSERT (masterKey != NULL, "Parameter `masterKey` must not be NULL");
-
-	// generate the salt
-	gcry_create_nonce (salt, sizeof (salt));
-	const int encodingResult = CRYPTO_PLUGIN_FUNCTION (base64Encode) (errorKey, salt, sizeof (salt), &saltHexString);
-	if (encodingResult < 0)
-	{
-		// error in libinvoke - errorKey has been set by base64Encode
-		return -1;
-	}
-	if (!saltHexString)
-	{
-		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
-		return -1;
-	}
-	keySetMeta (k, ELEKTRA_CRYPTO_META_SALT, saltHexString);
-	elektraFree (saltHexString);
-
-	// read iteration count
-	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, config);
-
-	// generate/derive the cryptographic key and the IV
-	if ((gcry_err = gcry_kdf_derive (keyValue (masterKey), keyGetValueSize (masterKey), GCRY_KDF_PBKDF2, GCRY_MD_SHA512, salt,
-					 sizeof (salt), iterations, KEY_BUFFER_SIZE, keyBuffer)))
-	{
-		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
-				    "Failed to create a cryptographic key for encryption because: %s", gcry_strerror (gcry_err));
-		return -1;
-	}
-
-	keySetBinary (cKey, keyBuffer, ELEKTRA_CRYPTO_GCRY_KEYSIZE);
-	keySetBinary (cIv, keyBuffer + ELEKTRA_CRYPTO_GCRY_KEYSIZE, ELEKTRA_CRYPTO_GCRY_BLOCKSIZE);
-	return 1;
-}
-
-/**
- * @brief derive the cryptographic key and IV for a given (Elektra) Key k
- * @param config KeySet holding the plugin/backend configuration
- * @param errorKey holds an error description in case of failure
- * @param masterKey holds the decrypted master password from the plugin configuration
- * @param k the (Elektra)-Key to be encrypted
- * @param cKey (Elektra)-Key holding the cryptographic material
- * @param cIv (Elektra)-Key holding the initialization vector
- * @retval -1 on failure. errorKey holds the error description.
- * @retval 1 on success
- */
-static int getKeyIvForDecryption (KeySet * config, Key * errorKey, Key * masterKey, Key * k, Key * cKey, Key * cIv)
-{
-	gcry_error_t gcry_err;
-	kdb_octet_t keyBuffer[KEY_BUFFER_SIZE];
-	kdb_octet_t * saltBuffer = NULL;
-	kdb_unsigned_long_t saltBufferLen = 0;
-
-	ELEKTRA_ASSERT (masterKey != NULL, "Parameter `masterKey` must not be NULL");
-
-	// get the salt
-	if (CRYPTO_PLUGIN_FUNCTION (getSaltFromPayload) (errorKey, k, &saltBuffer, &saltBufferLen) != 1)
-	{
-		return -1; // error set by CRYPTO_PLUGIN_FUNCTION(getSaltFromPayload)()
-	}
-
-	// get the iteration count
-	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, config);
-
-	// derive the cryptographic key and the IV
-	if ((gcry_err = gcry_kdf_derive (keyValue (masterKey), keyGetValueSize (masterKey), GCRY_KDF_PBKDF2, GCRY_MD_SHA512, saltBuffer,
-					 saltBufferLen, iterations, KEY_BUFFER_SIZE, keyBuffer)))
-	{
-		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
-				    "Failed to restore the cryptographic key for decryption because: %s", gcry_strerror (gcry_err));
-		return -1;
-	}
-
-	keySetBinary (cKey, keyBuffer, ELEKTRA_CRYPTO_GCRY_KEYSIZE);
-	keySetBinary (cIv, keyBuffer + ELEKTRA_CRYPTO_GCRY_KEYSIZE, ELEKTRA_CRYPTO_GCRY_BLOCKSIZE);
-	return 1;
-}
-
 void elektraCryptoGcryHandleDestroy (elektraCryptoHandle * handle)
 {
 	if (handle != NULL)
@@ -157,90 +65,110 @@ int elektraCryptoGcryInit (Key * errorKey)
 	return 1;
 }
 
-int elektraCryptoGcryHandleCreate (elektraCryptoHandle ** handle, KeySet * config, Key * errorKey, Key * masterKey, Key * k,
-				   const enum ElektraCryptoOperation op)
+/**
+ * @brief generate a random salt for the encryption of a single Key.
+ * @param errorKey holds an error description in case of failure
+ * @param salt is filled with ELEKTRA_CRYPTO_DEFAULT_SALT_LEN bytes
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoGcryCreateSalt (Key * errorKey ELEKTRA_UNUSED, kdb_octet_t * salt)
+{
+	gcry_create_nonce (salt, ELEKTRA_CRYPTO_DEFAULT_SALT_LEN);
+	return 1;
+}
+
+/**
+ * @brief derive the cryptographic key and IV from the master password and a salt
+ * @param errorKey holds an error description in case of failure
+ * @param masterKey holds the decrypted master password from the plugin configuration
+ * @param salt the salt of the (Elektra) Key to be encrypted or decrypted
+ * @param saltLen the length of the salt
+ * @param iterations the iteration count of the key derivation function
+ * @param keyMaterial is filled with the cryptographic key followed by the IV (ELEKTRA_CRYPTO_KEY_MATERIAL_LEN bytes)
+ * @param op tells if the key material is used for encryption or decryption
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoGcryDeriveKey (Key * errorKey, Key * masterKey, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+				const kdb_unsigned_long_t iterations, kdb_octet_t * keyMaterial, const enum ElektraCryptoOperation op)
 {
 	gcry_error_t gcry_err;
-	unsigned char keyBuffer[64], ivBuffer[64];
-	size_t keyLength, ivLength;
 
-	(*handle) = NULL;
+	ELEKTRA_ASSERT (masterKey != NULL, "Parameter `masterKey` must not be NULL");
 
-	// retrieve/derive the cryptographic material
-	Key * key = keyNew (0);
-	Key * iv = keyNew (0);
-	switch (op)
+	if ((gcry_err = gcry_kdf_derive (keyValue (masterKey), keyGetValueSize (masterKey), GCRY_KDF_PBKDF2, GCRY_MD_SHA512, salt,
+					 saltLen, iterations, KEY_BUFFER_SIZE, keyMaterial)))
 	{
-	case ELEKTRA_CRYPTO_ENCRYPT:
-		if (getKeyIvForEncryption (config, errorKey, masterKey, k, key, iv) != 1)
+		if (op == ELEKTRA_CRYPTO_ENCRYPT)
 		{
-			keyDel (key);
-			keyDel (iv);
-			return -1;
+			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
+					    "Failed to create a cryptographic key for encryption because: %s", gcry_strerror (gcry_err));
 		}
-		break;
-
-	case ELEKTRA_CRYPTO_DECRYPT:
-		if (getKeyIvForDecryption (config, errorKey, masterKey, k, key, iv) != 1)
+		else
 		{
-			keyDel (key);
-			keyDel (iv);
-			return -1;
+			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
+					    "Failed to restore the cryptographic key for decryption because: %s", gcry_strerror (gcry_err));
 		}
-		break;
-
-	default: // not supported
-		keyDel (key);
-		keyDel (iv);
 		return -1;
 	}
+	return 1;
+}
 
-	keyLength = keyGetBinary (key, keyBuffer, sizeof (keyBuffer));
-	ivLength = keyGetBinary (iv, ivBuffer, sizeof (ivBuffer));
+/**
+ * @brief create a handle holding the cipher.
+ *
+ * The handle must be keyed with elektraCryptoGcrySetKey () before every encryption or decryption.
+ * This way one handle serves all Keys of a KeySet.
+ *
+ * @param handle is set to the allocated handle. Must be released with elektraCryptoGcryHandleDestroy ().
+ * @param errorKey holds an error description in case of failure
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoGcryHandleCreate (elektraCryptoHandle ** handle, Key * errorKey)
+{
+	gcry_error_t gcry_err;
 
-	// create the handle
 	(*handle) = elektraMalloc (sizeof (elektraCryptoHandle));
 	if (*handle == NULL)
 	{
-		memset (keyBuffer, 0, sizeof (keyBuffer));
-		memset (ivBuffer, 0, sizeof (ivBuffer));
-		keyDel (key);
-		keyDel (iv);
 		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
 		return -1;
 	}
 
 	if ((gcry_err = gcry_cipher_open (*handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CBC, 0)) != 0)
 	{
-		goto error;
+		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to create handle because: %s",
+				    gcry_strerror (gcry_err));
+		elektraFree (*handle);
+		(*handle) = NULL;
+		return -1;
 	}
+	return 1;
+}
 
-	if ((gcry_err = gcry_cipher_setkey (**handle, keyBuffer, keyLength)) != 0)
-	{
-		goto error;
-	}
+/**
+ * @brief set the cryptographic key and IV of the handle for the next encryption or decryption.
+ * @param handle created by elektraCryptoGcryHandleCreate ()
+ * @param errorKey holds an error description in case of failure
+ * @param keyMaterial holds the cryptographic key followed by the IV, as derived by elektraCryptoGcryDeriveKey ()
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoGcrySetKey (elektraCryptoHandle * handle, Key * errorKey, const kdb_octet_t * keyMaterial)
+{
+	gcry_error_t gcry_err;
 
-	if ((gcry_err = gcry_cipher_setiv (**handle, ivBuffer, ivLength)) != 0)
+	// setting the key resets the cipher, so it can be reused for every Key
+	if ((gcry_err = gcry_cipher_setkey (*handle, keyMaterial, ELEKTRA_CRYPTO_GCRY_KEYSIZE)) != 0 ||
+	    (gcry_err = gcry_cipher_setiv (*handle, keyMaterial + ELEKTRA_CRYPTO_GCRY_KEYSIZE, ELEKTRA_CRYPTO_GCRY_BLOCKSIZE)) != 0)
 	{
-		goto error;
+		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to set the key because: %s",
+				    gcry_strerror (gcry_err));
+		return -1;
 	}
-
-	memset (keyBuffer, 0, sizeof (keyBuffer));
-	memset (ivBuffer, 0, sizeof (ivBuffer));
-	keyDel (key);
-	keyDel (iv);
 	return 1;
-
-error:
-	memset (keyBuffer, 0, sizeof (keyBuffer));
-	memset (ivBuffer, 0, sizeof (ivBuffer));
-	ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to create handle because: %s", gcry_strerror (gcry_err));
-	gcry_cipher_close (**handle);
-	elektraFree (*handle);
-	(*handle) = NULL;
-	keyDel (key);
-	keyDel (iv);
-	return -1;
 }
 
 int elektraCryptoGcryEncrypt (elektraCryptoHandle * handle, Key * k, Key * errorKey)
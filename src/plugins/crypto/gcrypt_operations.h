@@ -18,8 +18,11 @@
 
 char * elektraCryptoGcryCreateRandomString (Key * errorKey, const kdb_unsigned_short_t length);
 int elektraCryptoGcryInit (Key * errorKey);
-int elektraCryptoGcryHandleCreate (elektraCryptoHandle ** handle, KeySet * config, Key * errorKey, Key * masterKey, Key * k,
-				   const enum ElektraCryptoOperation op);
+int elektraCryptoGcryCreateSalt (Key * errorKey, kdb_octet_t * salt);
+int elektraCryptoGcryDeriveKey (Key * errorKey, Key * masterKey, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+				const kdb_unsigned_long_t iterations, kdb_octet_t * keyMaterial, const enum ElektraCryptoOperation op);
+int elektraCryptoGcryHandleCreate (elektraCryptoHandle ** handle, Key * errorKey);
+int elektraCryptoGcrySetKey (elektraCryptoHandle * handle, Key * errorKey, const kdb_octet_t * keyMaterial);
 void elektraCryptoGcryHandleDestroy (elektraCryptoHandle * handle);
 int elektraCryptoGcryEncrypt (elektraCryptoHandle * handle, Key * k, Key * errorKey);
 int elektraCryptoGcryDecrypt (elektraCryptoHandle * handle, Key * k, Key * errorKey);
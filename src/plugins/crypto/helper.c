@@ -81,6 +81,34 @@ int CRYPTO_PLUGIN_FUNCTION (base64Decode) (Key * errorKey, const char * input, k
 	return result;
 }
 
+/**
+ * @brief store the salt Base64 encoded as metakey of the given (Elektra) Key.
+ * @param errorKey holds an error description in case of failure.
+ * @param k the Key that is going to be encrypted
+ * @param salt holds the salt
+ * @param saltLen the length of the salt
+ * @retval 1 on success
+ * @retval -1 on error. errorKey holds a description.
+ */
+int CRYPTO_PLUGIN_FUNCTION (setSaltAsMetakey) (Key * errorKey, Key * k, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen)
+{
+	char * saltHexString = NULL;
+	const int encodingResult = CRYPTO_PLUGIN_FUNCTION (base64Encode) (errorKey, salt, saltLen, &saltHexString);
+	if (encodingResult < 0)
+	{
+		// error in libinvoke - errorKey has been set by base64Encode
+		return -1;
+	}
+	if (!saltHexString)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
+		return -1;
+	}
+	keySetMeta (k, ELEKTRA_CRYPTO_META_SALT, saltHexString);
+	elektraFree (saltHexString);
+	return 1;
+}
+
 /**
  * @brief parse the hex-encoded salt from the metakey.
  * @param errorKey holds an error description in case of failure.
@@ -14,6 +14,7 @@
 #include <kdb.h>
 #include <kdbtypes.h>
 
+int CRYPTO_PLUGIN_FUNCTION (setSaltAsMetakey) (Key * errorKey, Key * k, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen);
 int CRYPTO_PLUGIN_FUNCTION (getSaltFromMetakey) (Key * errorKey, Key * k, kdb_octet_t ** salt, kdb_unsigned_long_t * saltLen);
 int CRYPTO_PLUGIN_FUNCTION (getSaltFromPayload) (Key * errorKey, Key * k, kdb_octet_t ** salt, kdb_unsigned_long_t * saltLen);
 Key * CRYPTO_PLUGIN_FUNCTION (getMasterPassword) (Key * errorKey, KeySet * config);
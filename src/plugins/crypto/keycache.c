@@ -0,0 +1,324 @@
+/**
+ * @file
+ *
+ * @brief cache for the master password and the cryptographic keys derived from it
+ *
+ * Decrypting the master password requires a call to gpg and every derived key costs a full run of PBKDF2.
+ * The cache keeps both for the lifetime of a plugin instance, so that they are computed only once.
+ * Derived keys are looked up by the salt they have been derived from.
+ *
+ * All secrets are held in locked memory, if the system allows it, and are overwritten with zeroes before they are released.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#include "keycache.h"
+#include "helper.h"
+
+#include <kdbhelper.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define KEY_CACHE_MIN_CAPACITY (64)
+
+typedef struct
+{
+	kdb_octet_t keyMaterial[ELEKTRA_CRYPTO_KEY_MATERIAL_LEN];
+	kdb_octet_t salt[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN];
+	kdb_octet_t saltLen; // 0 marks an empty slot
+	kdb_unsigned_long_t lastUsed;
+} CacheEntry;
+
+struct _ElektraCryptoKeyCache
+{
+	Key * masterPassword;		// the decrypted master password
+	Key * encryptedMasterPassword; // the configuration value the master password has been decrypted from
+
+	CacheEntry * entries; // hash table with linear probing, at most half full
+	size_t capacity;      // always a power of two
+	size_t size;
+
+	kdb_unsigned_long_t iterations; // iteration count the cached keys have been derived with
+	kdb_unsigned_long_t pass;	// number of the current encryption or decryption pass
+};
+
+/**
+ * @brief keep the given memory from being swapped out.
+ *
+ * This is a best effort. Without the required privileges or with a low RLIMIT_MEMLOCK the memory stays unlocked.
+ */
+static void lockMemory (void * memory, size_t size)
+{
+	if (memory && size > 0)
+	{
+		mlock (memory, size);
+	}
+}
+
+static void unlockMemory (void * memory, size_t size)
+{
+	if (memory && size > 0)
+	{
+		memset (memory, 0, size);
+		munlock (memory, size);
+	}
+}
+
+static void releaseMasterPassword (ElektraCryptoKeyCache * cache)
+{
+	if (cache->masterPassword)
+	{
+		unlockMemory ((void *) keyValue (cache->masterPassword), keyGetValueSize (cache->masterPassword));
+		keyDel (cache->masterPassword);
+		cache->masterPassword = NULL;
+	}
+	if (cache->encryptedMasterPassword)
+	{
+		keyDel (cache->encryptedMasterPassword);
+		cache->encryptedMasterPassword = NULL;
+	}
+}
+
+static void clearEntries (ElektraCryptoKeyCache * cache)
+{
+	if (cache->entries)
+	{
+		unlockMemory (cache->entries, cache->capacity * sizeof (CacheEntry));
+		elektraFree (cache->entries);
+	}
+	cache->entries = NULL;
+	cache->capacity = 0;
+	cache->size = 0;
+}
+
+static size_t hashSalt (const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen)
+{
+	// FNV-1a
+	kdb_unsigned_long_t hash = 2166136261u;
+	for (kdb_unsigned_long_t i = 0; i < saltLen; ++i)
+	{
+		hash ^= salt[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @returns the slot holding the given salt or the empty slot where it belongs
+ */
+static CacheEntry * findSlot (CacheEntry * entries, const size_t capacity, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen)
+{
+	size_t i = hashSalt (salt, saltLen) & (capacity - 1);
+	while (entries[i].saltLen != 0 && (entries[i].saltLen != saltLen || memcmp (entries[i].salt, salt, saltLen) != 0))
+	{
+		i = (i + 1) & (capacity - 1);
+	}
+	return &entries[i];
+}
+
+/**
+ * @brief move all entries used since pass minUsed into a new table with the given capacity.
+ * @retval 1 on success
+ * @retval -1 if the new table could not be allocated. The cache is unchanged in this case.
+ */
+static int rehash (ElektraCryptoKeyCache * cache, const size_t capacity, const kdb_unsigned_long_t minUsed)
+{
+	CacheEntry * entries = elektraCalloc (capacity * sizeof (CacheEntry));
+	if (!entries)
+	{
+		return -1;
+	}
+	lockMemory (entries, capacity * sizeof (CacheEntry));
+
+	size_t size = 0;
+	for (size_t i = 0; i < cache->capacity; ++i)
+	{
+		CacheEntry * entry = &cache->entries[i];
+		if (entry->saltLen != 0 && entry->lastUsed >= minUsed)
+		{
+			*findSlot (entries, capacity, entry->salt, entry->saltLen) = *entry;
+			++size;
+		}
+	}
+
+	clearEntries (cache);
+	cache->entries = entries;
+	cache->capacity = capacity;
+	cache->size = size;
+	return 1;
+}
+
+/**
+ * @brief create an empty cache for a plugin instance.
+ * @returns the new cache or NULL if the allocation failed. Must be freed with keyCacheDel ().
+ */
+ElektraCryptoKeyCache * CRYPTO_PLUGIN_FUNCTION (keyCacheNew) (void)
+{
+	return elektraCalloc (sizeof (ElektraCryptoKeyCache));
+}
+
+/**
+ * @brief overwrite all secrets held by the cache with zeroes and release the cache.
+ */
+void CRYPTO_PLUGIN_FUNCTION (keyCacheDel) (ElektraCryptoKeyCache * cache)
+{
+	if (cache)
+	{
+		releaseMasterPassword (cache);
+		clearEntries (cache);
+		elektraFree (cache);
+	}
+}
+
+/**
+ * @brief get the decrypted master password of the plugin configuration.
+ *
+ * The master password is decrypted on the first call only.
+ * It is decrypted again, if the encrypted master password in the configuration changed in the meantime.
+ *
+ * @param cache the cache of the plugin instance
+ * @param errorKey holds an error description in case of failure.
+ * @param config holds the plugin configuration.
+ * @returns the decrypted master password or NULL in case of error. The Key is owned by the cache.
+ */
+Key * CRYPTO_PLUGIN_FUNCTION (keyCacheGetMasterPassword) (ElektraCryptoKeyCache * cache, Key * errorKey, KeySet * config)
+{
+	Key * encrypted = ksLookupByName (config, ELEKTRA_CRYPTO_PARAM_MASTER_PASSWORD, 0);
+	if (cache->masterPassword && encrypted && keyGetValueSize (encrypted) == keyGetValueSize (cache->encryptedMasterPassword) &&
+	    memcmp (keyValue (encrypted), keyValue (cache->encryptedMasterPassword), keyGetValueSize (encrypted)) == 0)
+	{
+		return cache->masterPassword;
+	}
+
+	// the derived keys belong to the previous master password
+	releaseMasterPassword (cache);
+	clearEntries (cache);
+
+	Key * masterPassword = CRYPTO_PLUGIN_FUNCTION (getMasterPassword) (errorKey, config);
+	if (!masterPassword)
+	{
+		return NULL; // error set by CRYPTO_PLUGIN_FUNCTION(getMasterPassword)()
+	}
+	lockMemory ((void *) keyValue (masterPassword), keyGetValueSize (masterPassword));
+
+	cache->masterPassword = masterPassword;
+	cache->encryptedMasterPassword = keyDup (encrypted);
+	return masterPassword;
+}
+
+/**
+ * @brief start a new encryption or decryption pass over a KeySet.
+ * @param cache the cache of the plugin instance
+ * @param iterations the iteration count the keys of this pass are derived with
+ */
+void CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (ElektraCryptoKeyCache * cache, const kdb_unsigned_long_t iterations)
+{
+	if (cache->iterations != iterations)
+	{
+		clearEntries (cache);
+		cache->iterations = iterations;
+	}
+	cache->pass++;
+}
+
+/**
+ * @brief finish an encryption or decryption pass.
+ *
+ * Keys that were used neither in this nor in the previous pass are removed.
+ * This keeps the keys that are needed to read back what has just been written, while the cache does not grow with every kdbSet.
+ *
+ * @param cache the cache of the plugin instance
+ */
+void CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (ElektraCryptoKeyCache * cache)
+{
+	const kdb_unsigned_long_t minUsed = cache->pass - 1;
+	size_t remaining = 0;
+	for (size_t i = 0; i < cache->capacity; ++i)
+	{
+		if (cache->entries[i].saltLen != 0 && cache->entries[i].lastUsed >= minUsed)
+		{
+			++remaining;
+		}
+	}
+
+	if (remaining == cache->size)
+	{
+		return;
+	}
+	if (remaining == 0)
+	{
+		clearEntries (cache);
+		return;
+	}
+
+	size_t capacity = KEY_CACHE_MIN_CAPACITY;
+	while (capacity < 2 * remaining)
+	{
+		capacity *= 2;
+	}
+	rehash (cache, capacity, minUsed); // on failure the unused keys just stay a little longer
+}
+
+/**
+ * @brief look up the key material derived from the given salt.
+ * @param cache the cache of the plugin instance
+ * @param salt the salt of the Key to be encrypted or decrypted
+ * @param saltLen the length of the salt
+ * @returns the cryptographic key followed by the IV or NULL if the salt is unknown.
+ *          The pointer is valid until the next call to keyCacheInsert () or keyCacheEndPass ().
+ */
+const kdb_octet_t * CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (ElektraCryptoKeyCache * cache, const kdb_octet_t * salt,
+							     const kdb_unsigned_long_t saltLen)
+{
+	if (!cache->entries || saltLen > ELEKTRA_CRYPTO_DEFAULT_SALT_LEN)
+	{
+		return NULL;
+	}
+
+	CacheEntry * entry = findSlot (cache->entries, cache->capacity, salt, saltLen);
+	if (entry->saltLen == 0)
+	{
+		return NULL;
+	}
+	entry->lastUsed = cache->pass;
+	return entry->keyMaterial;
+}
+
+/**
+ * @brief remember the key material derived from the given salt.
+ *
+ * Salts longer than ELEKTRA_CRYPTO_DEFAULT_SALT_LEN are not cached.
+ *
+ * @param cache the cache of the plugin instance
+ * @param salt the salt the key material has been derived from
+ * @param saltLen the length of the salt
+ * @param keyMaterial the cryptographic key followed by the IV (ELEKTRA_CRYPTO_KEY_MATERIAL_LEN bytes)
+ */
+void CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (ElektraCryptoKeyCache * cache, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+					      const kdb_octet_t * keyMaterial)
+{
+	if (saltLen == 0 || saltLen > ELEKTRA_CRYPTO_DEFAULT_SALT_LEN)
+	{
+		return;
+	}
+
+	if (2 * (cache->size + 1) > cache->capacity)
+	{
+		const size_t capacity = cache->capacity ? 2 * cache->capacity : KEY_CACHE_MIN_CAPACITY;
+		if (rehash (cache, capacity, 0) != 1)
+		{
+			return; // the key is just derived again next time
+		}
+	}
+
+	CacheEntry * entry = findSlot (cache->entries, cache->capacity, salt, saltLen);
+	if (entry->saltLen == 0)
+	{
+		memcpy (entry->salt, salt, saltLen);
+		entry->saltLen = saltLen;
+		cache->size++;
+	}
+	memcpy (entry->keyMaterial, keyMaterial, ELEKTRA_CRYPTO_KEY_MATERIAL_LEN);
+	entry->lastUsed = cache->pass;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file
+ *
+ * @brief cache for the master password and the cryptographic keys derived from it
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#ifndef ELEKTRA_PLUGIN_CRYPTO_KEYCACHE_H
+#define ELEKTRA_PLUGIN_CRYPTO_KEYCACHE_H
+
+#include "crypto.h"
+#include <kdb.h>
+#include <kdbtypes.h>
+
+typedef struct _ElektraCryptoKeyCache ElektraCryptoKeyCache;
+
+ElektraCryptoKeyCache * CRYPTO_PLUGIN_FUNCTION (keyCacheNew) (void);
+void CRYPTO_PLUGIN_FUNCTION (keyCacheDel) (ElektraCryptoKeyCache * cache);
+
+Key * CRYPTO_PLUGIN_FUNCTION (keyCacheGetMasterPassword) (ElektraCryptoKeyCache * cache, Key * errorKey, KeySet * config);
+
+void CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (ElektraCryptoKeyCache * cache, const kdb_unsigned_long_t iterations);
+void CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (ElektraCryptoKeyCache * cache);
+const kdb_octet_t * CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (ElektraCryptoKeyCache * cache, const kdb_octet_t * salt,
+							     const kdb_unsigned_long_t saltLen);
+void CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (ElektraCryptoKeyCache * cache, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+					      const kdb_octet_t * keyMaterial);
+
+#endif
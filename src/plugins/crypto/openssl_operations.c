@@ -26,6 +26,10 @@
 
 #define KEY_BUFFER_SIZE (ELEKTRA_CRYPTO_SSL_KEYSIZE + ELEKTRA_CRYPTO_SSL_BLOCKSIZE)
 
+#if KEY_BUFFER_SIZE != ELEKTRA_CRYPTO_KEY_MATERIAL_LEN
+#error "the derived key material does not fit the key and IV of the cipher"
+#endif
+
 /*
  * Protects all calls to OpenSSL (libcrypto.so).
  *
@@ -33,26 +37,28 @@
  */
 static pthread_mutex_t mutex_ssl = PTHREAD_MUTEX_INITIALIZER;
 
+int elektraCryptoOpenSSLInit (Key * errorKey ELEKTRA_UNUSED)
+{
+	// initialize OpenSSL according to
+	// https://wiki.openssl.org/index.php/Library_Initialization
+	pthread_mutex_lock (&mutex_ssl);
+	OpenSSL_add_all_algorithms ();
+	ERR_load_crypto_strings ();
+	pthread_mutex_unlock (&mutex_ssl);
+	return 1;
+}
+
 /**
- * @brief derive the cryptographic key and IV for a given (Elektra) Key k
- * @param config KeySet holding the plugin/backend configuration
+ * @brief generate a random salt for the encryption of a single Key.
  * @param errorKey holds an error description in case of failure
- * @param masterKey holds the decrypted master password from the plugin configuration
- * @param k the (Elektra)-Key to be encrypted
- * @param cKey (Elektra)-Key holding the cryptographic material
- * @param cIv (Elektra)-Key holding the initialization vector
+ * @param salt is filled with ELEKTRA_CRYPTO_DEFAULT_SALT_LEN bytes
  * @retval -1 on failure. errorKey holds the error description.
  * @retval 1 on success
  */
-static int getKeyIvForEncryption (KeySet * config, Key * errorKey, Key * masterKey, Key * k, Key * cKey, Key * cIv)
+int elektraCryptoOpenSSLCreateSalt (Key * errorKey, kdb_octet_t * salt)
 {
-	kdb_octet_t salt[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN] = { 0 };
-	kdb_octet_t keyBuffer[KEY_BUFFER_SIZE] = { 0 };
-	char * saltHexString = NULL;
-
-	ELEKTRA_ASSERT (masterKey != NULL, "Parameter `masterKey` must not be NULL");
+	memset (salt, 0, ELEKTRA_CRYPTO_DEFAULT_SALT_LEN);
 
-	// generate the salt
 	pthread_mutex_lock (&mutex_ssl);
 	if (!RAND_bytes (salt, ELEKTRA_CRYPTO_DEFAULT_SALT_LEN - 1))
 	{
@@ -62,161 +68,66 @@ static int getKeyIvForEncryption (KeySet * config, Key * errorKey, Key * masterK
 		return -1;
 	}
 	pthread_mutex_unlock (&mutex_ssl);
-	const int encodingResult = CRYPTO_PLUGIN_FUNCTION (base64Encode) (errorKey, salt, sizeof (salt), &saltHexString);
-	if (encodingResult < 0)
-	{
-		// error in libinvoke - errorKey has been set by base64Encode
-		return -1;
-	}
-	if (!saltHexString)
-	{
-		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
-		return -1;
-	}
-	keySetMeta (k, ELEKTRA_CRYPTO_META_SALT, saltHexString);
-	elektraFree (saltHexString);
-
-	// read iteration count
-	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, config);
-
-	// generate/derive the cryptographic key and the IV
-	pthread_mutex_lock (&mutex_ssl);
-	if (!PKCS5_PBKDF2_HMAC_SHA1 (keyValue (masterKey), keyGetValueSize (masterKey), salt, sizeof (salt), iterations, KEY_BUFFER_SIZE,
-				     keyBuffer))
-	{
-		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
-				    "Failed to create a cryptographic key for encryption. Libcrypto returned error code: %lu",
-				    ERR_get_error ());
-		pthread_mutex_unlock (&mutex_ssl);
-		return -1;
-	}
-	pthread_mutex_unlock (&mutex_ssl);
-
-	keySetBinary (cKey, keyBuffer, ELEKTRA_CRYPTO_SSL_KEYSIZE);
-	keySetBinary (cIv, keyBuffer + ELEKTRA_CRYPTO_SSL_KEYSIZE, ELEKTRA_CRYPTO_SSL_BLOCKSIZE);
 	return 1;
 }
 
 /**
- * @brief derive the cryptographic key and IV for a given (Elektra) Key k
- * @param config KeySet holding the plugin/backend configuration
+ * @brief derive the cryptographic key and IV from the master password and a salt
  * @param errorKey holds an error description in case of failure
  * @param masterKey holds the decrypted master password from the plugin configuration
- * @param k the (Elektra)-Key to be encrypted
- * @param cKey (Elektra)-Key holding the cryptographic material
- * @param cIv (Elektra)-Key holding the initialization vector
+ * @param salt the salt of the (Elektra) Key to be encrypted or decrypted
+ * @param saltLen the length of the salt
+ * @param iterations the iteration count of the key derivation function
+ * @param keyMaterial is filled with the cryptographic key followed by the IV (ELEKTRA_CRYPTO_KEY_MATERIAL_LEN bytes)
+ * @param op tells if the key material is used for encryption or decryption
  * @retval -1 on failure. errorKey holds the error description.
  * @retval 1 on success
  */
-static int getKeyIvForDecryption (KeySet * config, Key * errorKey, Key * masterKey, Key * k, Key * cKey, Key * cIv)
+int elektraCryptoOpenSSLDeriveKey (Key * errorKey, Key * masterKey, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+				   const kdb_unsigned_long_t iterations, kdb_octet_t * keyMaterial, const enum ElektraCryptoOperation op)
 {
-	kdb_octet_t keyBuffer[KEY_BUFFER_SIZE];
-	kdb_octet_t * saltBuffer = NULL;
-	kdb_unsigned_long_t saltBufferLen = 0;
-
 	ELEKTRA_ASSERT (masterKey != NULL, "Parameter `masterKey` must not be NULL");
 
-	// get the salt
-	if (CRYPTO_PLUGIN_FUNCTION (getSaltFromPayload) (errorKey, k, &saltBuffer, &saltBufferLen) != 1)
-	{
-		return -1; // error set by CRYPTO_PLUGIN_FUNCTION(getSaltFromPayload)()
-	}
-
-	// get the iteration count
-	const kdb_unsigned_long_t iterations = CRYPTO_PLUGIN_FUNCTION (getIterationCount) (errorKey, config);
-
-	// derive the cryptographic key and the IV
 	pthread_mutex_lock (&mutex_ssl);
-	if (!PKCS5_PBKDF2_HMAC_SHA1 (keyValue (masterKey), keyGetValueSize (masterKey), saltBuffer, saltBufferLen, iterations,
-				     KEY_BUFFER_SIZE, keyBuffer))
+	if (!PKCS5_PBKDF2_HMAC_SHA1 (keyValue (masterKey), keyGetValueSize (masterKey), salt, saltLen, iterations, KEY_BUFFER_SIZE,
+				     keyMaterial))
 	{
-		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
-				    "Failed to restore the cryptographic key for decryption. Libcrypto returned the error code: %lu",
-				    ERR_get_error ());
+		if (op == ELEKTRA_CRYPTO_ENCRYPT)
+		{
+			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
+					    "Failed to create a cryptographic key for encryption. Libcrypto returned error code: %lu",
+					    ERR_get_error ());
+		}
+		else
+		{
+			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_INTERNAL_ERROR, errorKey,
+					    "Failed to restore the cryptographic key for decryption. "
+					    "Libcrypto returned the error code: %lu",
+					    ERR_get_error ());
+		}
 		pthread_mutex_unlock (&mutex_ssl);
 		return -1;
 	}
 	pthread_mutex_unlock (&mutex_ssl);
-
-	keySetBinary (cKey, keyBuffer, ELEKTRA_CRYPTO_SSL_KEYSIZE);
-	keySetBinary (cIv, keyBuffer + ELEKTRA_CRYPTO_SSL_KEYSIZE, ELEKTRA_CRYPTO_SSL_BLOCKSIZE);
-	return 1;
-}
-
-int elektraCryptoOpenSSLInit (Key * errorKey ELEKTRA_UNUSED)
-{
-	// initialize OpenSSL according to
-	// https://wiki.openssl.org/index.php/Library_Initialization
-	pthread_mutex_lock (&mutex_ssl);
-	OpenSSL_add_all_algorithms ();
-	ERR_load_crypto_strings ();
-	pthread_mutex_unlock (&mutex_ssl);
 	return 1;
 }
 
-int elektraCryptoOpenSSLHandleCreate (elektraCryptoHandle ** handle, KeySet * config, Key * errorKey, Key * masterKey, Key * k,
-				      const enum ElektraCryptoOperation op)
+/**
+ * @brief create a handle holding the cipher contexts.
+ *
+ * The handle must be keyed with elektraCryptoOpenSSLSetKey () before every encryption or decryption.
+ * This way one handle serves all Keys of a KeySet.
+ *
+ * @param handle is set to the allocated handle. Must be released with elektraCryptoOpenSSLHandleDestroy ().
+ * @param errorKey holds an error description in case of failure
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoOpenSSLHandleCreate (elektraCryptoHandle ** handle, Key * errorKey)
 {
-	unsigned char keyBuffer[64], ivBuffer[64];
-
-	*handle = NULL;
-
-	// retrieve/derive the cryptographic material
-	Key * key = keyNew (0);
-	Key * iv = keyNew (0);
-	switch (op)
-	{
-	case ELEKTRA_CRYPTO_ENCRYPT:
-		if (getKeyIvForEncryption (config, errorKey, masterKey, k, key, iv) != 1)
-		{
-			keyDel (key);
-			keyDel (iv);
-			return -1;
-		}
-		break;
-
-	case ELEKTRA_CRYPTO_DECRYPT:
-		if (getKeyIvForDecryption (config, errorKey, masterKey, k, key, iv) != 1)
-		{
-			keyDel (key);
-			keyDel (iv);
-			return -1;
-		}
-		break;
-
-	default: // not supported
-		keyDel (key);
-		keyDel (iv);
-		return -1;
-	}
-
-	if (keyGetValueSize (key) != ELEKTRA_CRYPTO_SSL_KEYSIZE)
-	{
-		keyDel (key);
-		keyDel (iv);
-		ELEKTRA_SET_ERROR (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to create handle! Invalid key length.");
-		return -1;
-	}
-
-	if (keyGetValueSize (iv) != ELEKTRA_CRYPTO_SSL_BLOCKSIZE)
-	{
-		keyDel (key);
-		keyDel (iv);
-		ELEKTRA_SET_ERROR (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to create handle! Invalid IV length.");
-		return -1;
-	}
-
-	keyGetBinary (key, keyBuffer, sizeof (keyBuffer));
-	keyGetBinary (iv, ivBuffer, sizeof (ivBuffer));
-
-	keyDel (key);
-	keyDel (iv);
-
 	*handle = elektraMalloc (sizeof (elektraCryptoHandle));
 	if (!(*handle))
 	{
-		memset (keyBuffer, 0, sizeof (keyBuffer));
-		memset (ivBuffer, 0, sizeof (ivBuffer));
 		ELEKTRA_SET_ERROR (87, errorKey, "Memory allocation failed");
 		return -1;
 	}
@@ -226,18 +137,44 @@ int elektraCryptoOpenSSLHandleCreate (elektraCryptoHandle ** handle, KeySet * co
 	(*handle)->encrypt = EVP_CIPHER_CTX_new ();
 	(*handle)->decrypt = EVP_CIPHER_CTX_new ();
 
-	EVP_EncryptInit ((*handle)->encrypt, EVP_aes_256_cbc (), keyBuffer, ivBuffer);
-	EVP_DecryptInit ((*handle)->decrypt, EVP_aes_256_cbc (), keyBuffer, ivBuffer);
-
-	memset (keyBuffer, 0, sizeof (keyBuffer));
-	memset (ivBuffer, 0, sizeof (ivBuffer));
+	EVP_EncryptInit_ex ((*handle)->encrypt, EVP_aes_256_cbc (), NULL, NULL, NULL);
+	EVP_DecryptInit_ex ((*handle)->decrypt, EVP_aes_256_cbc (), NULL, NULL, NULL);
 
 	if (ERR_peek_error ())
 	{
 		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to create handle! libcrypto error code was: %lu",
 				    ERR_get_error ());
-		elektraFree (*handle);
+		pthread_mutex_unlock (&mutex_ssl);
+		elektraCryptoOpenSSLHandleDestroy (*handle);
 		*handle = NULL;
+		return -1;
+	}
+	pthread_mutex_unlock (&mutex_ssl);
+	return 1;
+}
+
+/**
+ * @brief set the cryptographic key and IV of the handle for the next encryption or decryption.
+ * @param handle created by elektraCryptoOpenSSLHandleCreate ()
+ * @param errorKey holds an error description in case of failure
+ * @param keyMaterial holds the cryptographic key followed by the IV, as derived by elektraCryptoOpenSSLDeriveKey ()
+ * @retval -1 on failure. errorKey holds the error description.
+ * @retval 1 on success
+ */
+int elektraCryptoOpenSSLSetKey (elektraCryptoHandle * handle, Key * errorKey, const kdb_octet_t * keyMaterial)
+{
+	const kdb_octet_t * iv = keyMaterial + ELEKTRA_CRYPTO_SSL_KEYSIZE;
+
+	pthread_mutex_lock (&mutex_ssl);
+
+	// re-initializing the contexts resets them, so they can be reused for every Key
+	EVP_EncryptInit_ex (handle->encrypt, NULL, NULL, keyMaterial, iv);
+	EVP_DecryptInit_ex (handle->decrypt, NULL, NULL, keyMaterial, iv);
+
+	if (ERR_peek_error ())
+	{
+		ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CRYPTO_CONFIG_FAULT, errorKey, "Failed to set the key! libcrypto error code was: %lu",
+				    ERR_get_error ());
 		pthread_mutex_unlock (&mutex_ssl);
 		return -1;
 	}
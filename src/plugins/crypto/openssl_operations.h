@@ -18,8 +18,11 @@
 
 char * elektraCryptoOpenSSLCreateRandomString (Key * errorKey, const kdb_unsigned_short_t length);
 int elektraCryptoOpenSSLInit (Key * errorKey);
-int elektraCryptoOpenSSLHandleCreate (elektraCryptoHandle ** handle, KeySet * config, Key * errorKey, Key * masterKey, Key * k,
-				      const enum ElektraCryptoOperation op);
+int elektraCryptoOpenSSLCreateSalt (Key * errorKey, kdb_octet_t * salt);
+int elektraCryptoOpenSSLDeriveKey (Key * errorKey, Key * masterKey, const kdb_octet_t * salt, const kdb_unsigned_long_t saltLen,
+				   const kdb_unsigned_long_t iterations, kdb_octet_t * keyMaterial, const enum ElektraCryptoOperation op);
+int elektraCryptoOpenSSLHandleCreate (elektraCryptoHandle ** handle, Key * errorKey);
+int elektraCryptoOpenSSLSetKey (elektraCryptoHandle * handle, Key * errorKey, const kdb_octet_t * keyMaterial);
 void elektraCryptoOpenSSLHandleDestroy (elektraCryptoHandle * handle);
 int elektraCryptoOpenSSLEncrypt (elektraCryptoHandle * handle, Key * k, Key * errorKey);
 int elektraCryptoOpenSSLDecrypt (elektraCryptoHandle * handle, Key * k, Key * errorKey);
@@ -11,6 +11,7 @@
 #include "crypto.h"
 #include "gpg.h"
 #include "helper.h"
+#include "keycache.h"
 #include <kdb.h>
 #include <kdbinternal.h>
 #include <stdio.h>
@@ -27,12 +28,14 @@
 static KeySet * newPluginConfiguration (void);
 
 #define TEST_SUITE(PLUGIN_NAME)                                                                                                            \
+	test_key_cache ();                                                                                                                 \
 	if (gpg_available (newPluginConfiguration ()))                                                                                     \
 	{                                                                                                                                  \
 		test_gpg ();                                                                                                               \
 		test_init (PLUGIN_NAME);                                                                                                   \
 		test_incomplete_config (PLUGIN_NAME);                                                                                      \
 		test_crypto_operations (PLUGIN_NAME);                                                                                      \
+		test_crypto_operations_cached (PLUGIN_NAME);                                                                               \
 	}                                                                                                                                  \
 	else                                                                                                                               \
 	{                                                                                                                                  \
@@ -258,6 +261,161 @@ static void test_crypto_operations (const char * pluginName)
 	keyDel (parentKey);
 }
 
+static int runCheckconf (Plugin * plugin, Key * parentKey)
+{
+	union
+	{
+		checkConfPtr f;
+		void * v;
+	} conversation;
+
+	KeySet * contract = ksNew (0, KS_END);
+	Key * contractParent = keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME, KEY_END);
+	plugin->kdbGet (plugin, contract, contractParent);
+	Key * function = ksLookupByName (contract, "system/elektra/modules/" ELEKTRA_PLUGIN_NAME "/exports/checkconf", 0);
+	int result = -1;
+	if (function && keyGetBinary (function, &conversation.v, sizeof (conversation)) == sizeof (conversation) && conversation.f)
+	{
+		result = conversation.f (parentKey, elektraPluginGetConfig (plugin));
+	}
+	keyDel (contractParent);
+	ksDel (contract);
+	return result;
+}
+
+static void test_crypto_operations_cached (const char * pluginName)
+{
+	Plugin * plugin = NULL;
+	Key * parentKey = keyNew ("system", KEY_END);
+	KeySet * modules = ksNew (0, KS_END);
+	KeySet * config = newPluginConfiguration ();
+
+	setPluginShutdown (config);
+
+	elektraModulesInit (modules, 0);
+
+	plugin = elektraPluginOpen (pluginName, modules, config, 0);
+	if (plugin)
+	{
+		succeed_if (runCheckconf (plugin, parentKey) == 1, "checkconf call failed");
+
+		KeySet * data = newTestdataKeySet ();
+		KeySet * original = ksDeepDup (data);
+
+		// encrypting the same data twice must use fresh salts
+		succeed_if (plugin->kdbSet (plugin, data, parentKey) == 1, "kdb set failed");
+		KeySet * encrypted = ksDeepDup (data);
+		KeySet * again = ksDeepDup (original);
+		succeed_if (plugin->kdbSet (plugin, again, parentKey) == 1, "kdb set failed");
+		Key * k = ksLookupByName (encrypted, "user/crypto/test/mystring", 0);
+		Key * other = ksLookupByName (again, "user/crypto/test/mystring", 0);
+		succeed_if (k && other && (keyGetValueSize (k) != keyGetValueSize (other) ||
+					   memcmp (keyValue (k), keyValue (other), keyGetValueSize (k)) != 0),
+			    "the same value has been encrypted to the same cipher text twice");
+		ksDel (again);
+
+		// decrypt the same cipher text repeatedly, the later passes use the cached keys
+		succeed_if (plugin->kdbGet (plugin, data, parentKey) == 1, "kdb get failed");
+		compare_keyset (data, original);
+		ksDel (data);
+		data = ksDeepDup (encrypted);
+		succeed_if (plugin->kdbGet (plugin, data, parentKey) == 1, "repeated kdb get failed");
+		compare_keyset (data, original);
+		ksDel (data);
+
+		// a new master password must not reuse the keys derived from the old one
+		KeySet * pluginConfig = elektraPluginGetConfig (plugin);
+		keyDel (ksLookupByName (pluginConfig, "user/" ELEKTRA_CRYPTO_PARAM_MASTER_PASSWORD, KDB_O_POP));
+		succeed_if (runCheckconf (plugin, parentKey) == 1, "checkconf call failed");
+		data = ksDeepDup (encrypted);
+		Key * errorKey = keyNew ("system", KEY_END);
+		const int result = plugin->kdbGet (plugin, data, errorKey);
+		k = ksLookupByName (data, "user/crypto/test/mystring", 0);
+		succeed_if (result != 1 || !k || keyIsBinary (k) || strcmp (keyString (k), strVal) != 0,
+			    "decrypted with the keys of the old master password");
+		keyDel (errorKey);
+		ksDel (data);
+
+		ksDel (encrypted);
+		ksDel (original);
+		elektraPluginClose (plugin, 0);
+	}
+
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+	keyDel (parentKey);
+}
+
+static void test_key_cache (void)
+{
+	const kdb_octet_t saltA[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN] = { 1 };
+	const kdb_octet_t saltB[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN] = { 2 };
+	const kdb_octet_t saltLong[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN + 1] = { 3 };
+	kdb_octet_t material[ELEKTRA_CRYPTO_KEY_MATERIAL_LEN];
+	const kdb_octet_t * cached;
+
+	ElektraCryptoKeyCache * cache = CRYPTO_PLUGIN_FUNCTION (keyCacheNew) ();
+	succeed_if (cache, "failed to create the key cache");
+	if (!cache) return;
+
+	// pass 1: derive the key for salt A
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	succeed_if (!CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltA, sizeof (saltA)), "empty cache returned a key");
+	memset (material, 'A', sizeof (material));
+	CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (cache, saltA, sizeof (saltA), material);
+	memset (material, 'L', sizeof (material));
+	CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (cache, saltLong, sizeof (saltLong), material);
+	succeed_if (!CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltLong, sizeof (saltLong)), "long salt has been cached");
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+
+	// pass 2: salt A is still known, salt B is new
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	cached = CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltA, sizeof (saltA));
+	succeed_if (cached && cached[0] == 'A' && cached[ELEKTRA_CRYPTO_KEY_MATERIAL_LEN - 1] == 'A', "key of salt A is missing");
+	succeed_if (!CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltA, sizeof (saltA) - 1), "salt prefix returned a key");
+	memset (material, 'B', sizeof (material));
+	CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (cache, saltB, sizeof (saltB), material);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+
+	// pass 3 and 4: keys not used in the current or previous pass are dropped
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	cached = CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltB, sizeof (saltB));
+	succeed_if (cached && cached[0] == 'B', "key of salt B is missing");
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	succeed_if (!CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltA, sizeof (saltA)), "unused key has not been dropped");
+	succeed_if (CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltB, sizeof (saltB)), "recently used key dropped");
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+
+	// many keys in one pass
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 100);
+	kdb_octet_t salt[ELEKTRA_CRYPTO_DEFAULT_SALT_LEN] = { 0 };
+	for (int i = 0; i < 1000; ++i)
+	{
+		memcpy (salt, &i, sizeof (i));
+		memset (material, i % 256, sizeof (material));
+		CRYPTO_PLUGIN_FUNCTION (keyCacheInsert) (cache, salt, sizeof (salt), material);
+	}
+	int found = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		memcpy (salt, &i, sizeof (i));
+		cached = CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, salt, sizeof (salt));
+		if (cached && cached[0] == i % 256) ++found;
+	}
+	succeed_if (found == 1000, "keys got lost while the cache grew");
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+
+	// a different iteration count invalidates all keys
+	CRYPTO_PLUGIN_FUNCTION (keyCacheBeginPass) (cache, 200);
+	succeed_if (!CRYPTO_PLUGIN_FUNCTION (keyCacheLookup) (cache, saltB, sizeof (saltB)), "key of another iteration count returned");
+	CRYPTO_PLUGIN_FUNCTION (keyCacheEndPass) (cache);
+
+	CRYPTO_PLUGIN_FUNCTION (keyCacheDel) (cache);
+}
+
 static void test_gpg (void)
 {
 	// Plugin configuration
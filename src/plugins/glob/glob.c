@@ -24,7 +24,7 @@ struct GlobFlagMap
 
 struct GlobFlagMap flagMaps[] = { { "noescape", FNM_NOESCAPE }, { "pathname", FNM_PATHNAME }, { "period", FNM_PERIOD } };
 
-int elektraGlobMatch (Key * key, const Key * match, const char * globFlags)
+static int parseGlobFlags (const char * globFlags)
 {
 	char * tokenList = elektraStrDup (globFlags);
 	char delimiter[] = ",";
@@ -44,8 +44,12 @@ int elektraGlobMatch (Key * key, const Key * match, const char * globFlags)
 	}
 
 	free (tokenList);
+	return flags;
+}
 
-	if (!fnmatch (keyString (match), keyName (key), flags))
+int elektraGlobMatch (Key * key, const Key * match, const char * globFlags)
+{
+	if (!fnmatch (keyString (match), keyName (key), parseGlobFlags (globFlags)))
 	{
 		keyCopyAllMeta (key, match);
 		return 1;
@@ -59,6 +63,43 @@ enum GlobDirection {
 	SET,
 };
 
+// A glob key of the configuration with its flags already parsed
+typedef struct
+{
+	Key * match;	      // copy of the glob key, its metadata is copied to matching keys
+	char * pattern;       // the glob expression, with the parent prepended for cascading globs
+	size_t prefixSize;    // number of characters at the start of the pattern without special meaning
+	int literal;	      // the whole pattern is without special meaning
+	int flags;
+} GlobRule;
+
+// All rules whose literal prefix is a prefix of the prefix of this group
+typedef struct
+{
+	const char * prefix;
+	size_t prefixSize;
+	ssize_t parent; // the group with the longest prefix that is a proper prefix of this one
+	size_t * rules; // indices into GlobIndex.rules in the order of the configuration
+	size_t ruleSize;
+} GlobGroup;
+
+// The glob keys of one direction, grouped by the literal prefix of their patterns
+typedef struct
+{
+	GlobRule * rules;
+	size_t ruleSize;
+	int cascading; // some patterns depend on the name of the parent key
+	GlobGroup * groups; // sorted by prefix
+	size_t groupSize;
+	char * parentName; // the name the groups were built for, NULL if they need to be built
+} GlobIndex;
+
+typedef struct
+{
+	GlobIndex get;
+	GlobIndex set;
+} GlobData;
+
 static const char * getGlobFlags (KeySet * keys, Key * globKey)
 {
 	Key * flagKey = keyDup (globKey);
@@ -74,11 +115,9 @@ static const char * getGlobFlags (KeySet * keys, Key * globKey)
 	return 0;
 }
 
-static KeySet * getGlobKeys (Key * parentKey, KeySet * keys, enum GlobDirection direction)
+static void getGlobKeys (GlobIndex * index, KeySet * keys, enum GlobDirection direction)
 {
-	KeySet * glob = ksNew (0, KS_END);
 	Key * k = 0;
-	size_t parentsize = keyGetNameSize (parentKey);
 
 	Key * userGlobConfig = 0;
 	Key * systemGlobConfig = 0;
@@ -99,31 +138,28 @@ static KeySet * getGlobKeys (Key * parentKey, KeySet * keys, enum GlobDirection
 		break;
 	}
 
+	index->rules = elektraCalloc ((ksGetSize (keys) + 1) * sizeof (GlobRule));
+
+	ksRewind (keys);
 	while ((k = ksNext (keys)) != 0)
 	{
 		/* use only glob keys for the current direction */
 		if (keyIsDirectBelow (userGlobConfig, k) || keyIsDirectBelow (systemGlobConfig, k) ||
 		    keyIsDirectBelow (userDirGlobConfig, k) || keyIsDirectBelow (systemDirGlobConfig, k))
 		{
-			keySetMeta (k, "glob/flags", getGlobFlags (keys, k));
-
 			/* Look if we have a string */
-			size_t valsize = keyGetValueSize (k);
-			if (valsize < 2) continue;
+			if (keyGetValueSize (k) < 2) continue;
 
 			/* We now know we want that key.
 			 Dup it to not change the configuration. */
-			Key * ins = keyDup (k);
+			GlobRule * rule = &index->rules[index->ruleSize++];
+			rule->match = keyDup (k);
+			const char * flags = getGlobFlags (keys, k);
+			keySetMeta (rule->match, "glob/flags", flags);
+			/* if no flags were provided, default to FNM_PATHNAME behaviour */
+			rule->flags = flags ? parseGlobFlags (flags) : FNM_PATHNAME;
 			/* Now look if we want cascading for the key */
-			if (keyString (k)[0] == '/')
-			{
-				char * newstring = elektraMalloc (valsize + parentsize);
-				strcpy (newstring, keyName (parentKey));
-				strcat (newstring, keyString (k));
-				keySetString (ins, newstring);
-				elektraFree (newstring);
-			}
-			ksAppendKey (glob, ins);
+			if (keyString (k)[0] == '/') index->cascading = 1;
 		}
 	}
 
@@ -131,59 +167,215 @@ static KeySet * getGlobKeys (Key * parentKey, KeySet * keys, enum GlobDirection
 	keyDel (systemGlobConfig);
 	keyDel (userDirGlobConfig);
 	keyDel (systemDirGlobConfig);
+}
 
-	return glob;
+static size_t literalPrefixSize (const char * pattern, int flags)
+{
+	const char * special = (flags & FNM_NOESCAPE) ? "*?[" : "*?[\\";
+	return strcspn (pattern, special);
 }
 
-static void applyGlob (KeySet * returned, KeySet * glob)
+static int comparePrefix (const char * a, size_t aSize, const char * b, size_t bSize)
 {
-	Key * cur;
-	ksRewind (returned);
-	while ((cur = ksNext (returned)) != 0)
+	int cmp = memcmp (a, b, aSize < bSize ? aSize : bSize);
+	if (cmp != 0) return cmp;
+	return (aSize > bSize) - (aSize < bSize);
+}
+
+static int compareRules (const void * a, const void * b)
+{
+	const GlobRule * ruleA = *(const GlobRule * const *) a;
+	const GlobRule * ruleB = *(const GlobRule * const *) b;
+	int cmp = comparePrefix (ruleA->pattern, ruleA->prefixSize, ruleB->pattern, ruleB->prefixSize);
+	if (cmp != 0) return cmp;
+	// keep the order of the configuration within a group
+	return (ruleA > ruleB) - (ruleA < ruleB);
+}
+
+static void freeGroups (GlobIndex * index)
+{
+	for (size_t i = 0; i < index->groupSize; ++i)
+	{
+		elektraFree (index->groups[i].rules);
+	}
+	elektraFree (index->groups);
+	elektraFree (index->parentName);
+	index->groups = NULL;
+	index->groupSize = 0;
+	index->parentName = NULL;
+}
+
+/**
+ * @brief Expands cascading patterns and groups the rules by their literal prefixes
+ *
+ * The groups only need to be built again if the name of the parent key changes
+ * and there are cascading patterns.
+ */
+static void buildGroups (GlobIndex * index, Key * parentKey)
+{
+	const char * parentName = keyName (parentKey);
+	if (index->parentName && (!index->cascading || !strcmp (index->parentName, parentName))) return;
+	freeGroups (index);
+	index->parentName = elektraStrDup (parentName);
+
+	GlobRule ** sorted = elektraMalloc ((index->ruleSize + 1) * sizeof (GlobRule *));
+	for (size_t i = 0; i < index->ruleSize; ++i)
+	{
+		GlobRule * rule = &index->rules[i];
+		const char * value = keyString (rule->match);
+		elektraFree (rule->pattern);
+		rule->pattern = value[0] == '/' ? elektraFormat ("%s%s", parentName, value) : elektraStrDup (value);
+		rule->prefixSize = literalPrefixSize (rule->pattern, rule->flags);
+		rule->literal = rule->pattern[rule->prefixSize] == '\0';
+		sorted[i] = rule;
+	}
+	qsort (sorted, index->ruleSize, sizeof (GlobRule *), compareRules);
+
+	index->groups = elektraCalloc ((index->ruleSize + 1) * sizeof (GlobGroup));
+	// groups whose prefixes are prefixes of the current one, the last one is the longest
+	ssize_t * stack = elektraMalloc ((index->ruleSize + 1) * sizeof (ssize_t));
+	size_t stackSize = 0;
+	for (size_t i = 0; i < index->ruleSize;)
 	{
-		Key * match;
-		ksRewind (glob);
-		while ((match = ksNext (glob)) != 0)
+		GlobGroup * group = &index->groups[index->groupSize];
+		group->prefix = sorted[i]->pattern;
+		group->prefixSize = sorted[i]->prefixSize;
+
+		while (stackSize > 0)
 		{
-			const Key * flagKey = keyGetMeta (match, "glob/flags");
-			int matchApplied;
+			GlobGroup * top = &index->groups[stack[stackSize - 1]];
+			if (top->prefixSize < group->prefixSize && !memcmp (top->prefix, group->prefix, top->prefixSize)) break;
+			--stackSize;
+		}
+		group->parent = stackSize > 0 ? stack[stackSize - 1] : -1;
 
-			if (flagKey)
-			{
-				matchApplied = elektraGlobMatch (cur, match, keyString (flagKey));
-			}
+		size_t end = i;
+		while (end < index->ruleSize &&
+		       !comparePrefix (sorted[end]->pattern, sorted[end]->prefixSize, group->prefix, group->prefixSize))
+		{
+			++end;
+		}
+
+		// merge the rules of the parent group with the own ones, which are both in the order of the configuration
+		GlobGroup * parent = group->parent >= 0 ? &index->groups[group->parent] : NULL;
+		size_t parentSize = parent ? parent->ruleSize : 0;
+		group->rules = elektraMalloc ((parentSize + end - i) * sizeof (size_t));
+		size_t p = 0;
+		size_t own = i;
+		while (p < parentSize || own < end)
+		{
+			size_t ownRule = own < end ? (size_t) (sorted[own] - index->rules) : index->ruleSize;
+			if (p < parentSize && parent->rules[p] < ownRule)
+				group->rules[group->ruleSize++] = parent->rules[p++];
 			else
 			{
-				/* if no flags were provided, default to FNM_PATHNAME behaviour */
-				matchApplied = elektraGlobMatch (cur, match, "pathname");
+				group->rules[group->ruleSize++] = ownRule;
+				++own;
 			}
-
-			if (matchApplied) break;
 		}
+
+		stack[stackSize++] = index->groupSize++;
+		i = end;
+	}
+
+	elektraFree (stack);
+	elektraFree (sorted);
+}
+
+/**
+ * @return the first glob key in the configuration matching name, or NULL
+ */
+static GlobRule * findRule (GlobIndex * index, const char * name)
+{
+	size_t nameSize = strlen (name);
+
+	// find the group with the greatest prefix not greater than name
+	size_t low = 0;
+	size_t high = index->groupSize;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (comparePrefix (index->groups[mid].prefix, index->groups[mid].prefixSize, name, nameSize) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == 0) return NULL;
+
+	// every prefix of name in the groups is a prefix of the prefix found
+	ssize_t current = low - 1;
+	const GlobGroup * group = &index->groups[current];
+	size_t common = 0;
+	while (common < group->prefixSize && group->prefix[common] == name[common])
+		++common;
+	while (current >= 0 && index->groups[current].prefixSize > common)
+		current = index->groups[current].parent;
+	if (current < 0) return NULL;
+
+	group = &index->groups[current];
+	for (size_t i = 0; i < group->ruleSize; ++i)
+	{
+		GlobRule * rule = &index->rules[group->rules[i]];
+		if (rule->literal ? rule->prefixSize == nameSize : !fnmatch (rule->pattern, name, rule->flags)) return rule;
+	}
+	return NULL;
+}
+
+static void applyGlob (KeySet * returned, GlobIndex * index, Key * parentKey)
+{
+	if (index->ruleSize == 0) return;
+	buildGroups (index, parentKey);
+
+	Key * cur;
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != 0)
+	{
+		GlobRule * rule = findRule (index, keyName (cur));
+		if (rule) keyCopyAllMeta (cur, rule->match);
+	}
+}
+
+static void freeGlobIndex (GlobIndex * index)
+{
+	for (size_t i = 0; i < index->ruleSize; ++i)
+	{
+		keyDel (index->rules[i].match);
+		elektraFree (index->rules[i].pattern);
 	}
+	elektraFree (index->rules);
+	freeGroups (index);
 }
 
-int elektraGlobOpen (Plugin * handle ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+int elektraGlobOpen (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
 {
-	/* plugin initialization logic should be here */
-	/* TODO: name of parentKey is not set...*/
-	/* So rewriting cannot happen here (is in elektraGlobSet */
+	/* the name of the parent key is not known yet, so cascading
+	 * globs are expanded and grouped in the first get or set */
+	KeySet * config = elektraPluginGetConfig (handle);
+	GlobData * data = elektraCalloc (sizeof (GlobData));
+	getGlobKeys (&data->get, config, GET);
+	getGlobKeys (&data->set, config, SET);
+	elektraPluginSetData (handle, data);
 
 	return 1; /* success */
 }
 
-int elektraGlobClose (Plugin * handle ELEKTRA_UNUSED, Key * errorKey ELEKTRA_UNUSED)
+int elektraGlobClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
 {
 	/* free all plugin resources and shut it down */
 
-	KeySet * keys = elektraPluginGetData (handle);
-	ksDel (keys);
+	GlobData * data = elektraPluginGetData (handle);
+	if (data)
+	{
+		freeGlobIndex (&data->get);
+		freeGlobIndex (&data->set);
+		elektraFree (data);
+	}
 
 	return 1; /* success */
 }
 
 
-int elektraGlobGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey ELEKTRA_UNUSED)
+int elektraGlobGet (Plugin * handle, KeySet * returned, Key * parentKey)
 {
 	if (!strcmp (keyName (parentKey), "system/elektra/modules/glob"))
 	{
@@ -195,13 +387,8 @@ int elektraGlobGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 		return 1;
 	}
 
-	KeySet * keys = elektraPluginGetConfig (handle);
-	ksRewind (keys);
-
-	KeySet * glob = getGlobKeys (parentKey, keys, GET);
-	applyGlob (returned, glob);
-
-	ksDel (glob);
+	GlobData * data = elektraPluginGetData (handle);
+	applyGlob (returned, &data->get, parentKey);
 
 	return 1; /* success */
 }
@@ -209,13 +396,8 @@ int elektraGlobGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 
 int elektraGlobSet (Plugin * handle, KeySet * returned, Key * parentKey)
 {
-	KeySet * keys = elektraPluginGetConfig (handle);
-	ksRewind (keys);
-
-	KeySet * glob = getGlobKeys (parentKey, keys, SET);
-	applyGlob (returned, glob);
-
-	ksDel (glob);
+	GlobData * data = elektraPluginGetData (handle);
+	applyGlob (returned, &data->set, parentKey);
 
 	return 1; /* success */
 }
@@ -230,4 +412,3 @@ Plugin * ELEKTRA_PLUGIN_EXPORT (glob)
 		ELEKTRA_PLUGIN_SET,	&elektraGlobSet,
 		ELEKTRA_PLUGIN_END);
 }
-
@@ -290,6 +290,103 @@ void test_onlyFirstMatchIsApplied (void)
 	PLUGIN_CLOSE ();
 }
 
+void test_firstMatchAcrossPrefixes (void)
+{
+	Key * parentKey = keyNew ("user/tests/glob", KEY_END);
+	// clang-format off
+	KeySet * conf = ksNew (20,
+				keyNew ("user/glob/#1",
+						KEY_VALUE, "/*/subtest1",
+						KEY_META, "order", "1",
+						KEY_END),
+				keyNew ("user/glob/#2",
+						KEY_VALUE, "/test2/*",
+						KEY_META, "order", "2",
+						KEY_END),
+				keyNew ("user/glob/#3",
+						KEY_VALUE, "/test3",
+						KEY_META, "order", "3",
+						KEY_END),
+				keyNew ("user/glob/#4",
+						KEY_VALUE, "user/tests/glob/test\\1",
+						KEY_META, "order", "4",
+						KEY_END),
+				keyNew ("user/glob/#5",
+						KEY_VALUE, "/test*",
+						KEY_META, "order", "5",
+						KEY_END),
+				KS_END);
+	// clang-format on
+	PLUGIN_OPEN ("glob");
+
+	KeySet * ks = createKeys ();
+	ksAppendKey (ks, keyNew ("user/tests/glob/test2/subtest2", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/glob/test33", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/other", KEY_END));
+
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) >= 1, "call to kdbSet was not successful");
+	succeed_if (output_error (parentKey), "error in kdbSet");
+	succeed_if (output_warnings (parentKey), "warnings in kdbSet");
+
+	Key * key = ksLookupByName (ks, "user/tests/glob/test2/subtest1", 0);
+	exit_if_fail (key, "user/tests/glob/test2/subtest1 not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "order")), "1");
+
+	key = ksLookupByName (ks, "user/tests/glob/test2/subtest2", 0);
+	exit_if_fail (key, "user/tests/glob/test2/subtest2 not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "order")), "2");
+
+	key = ksLookupByName (ks, "user/tests/glob/test3", 0);
+	exit_if_fail (key, "user/tests/glob/test3 not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "order")), "3");
+
+	key = ksLookupByName (ks, "user/tests/glob/test1", 0);
+	exit_if_fail (key, "user/tests/glob/test1 not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "order")), "4");
+
+	key = ksLookupByName (ks, "user/tests/glob/test33", 0);
+	exit_if_fail (key, "user/tests/glob/test33 not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "order")), "5");
+
+	key = ksLookupByName (ks, "user/tests/other", 0);
+	exit_if_fail (key, "user/tests/other not found");
+	succeed_if (!keyGetMeta (key, "order"), "key without matching glob got metadata");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+void test_parentChanges (void)
+{
+	Key * parentKey = keyNew ("user/tests/glob", KEY_END);
+	// clang-format off
+	KeySet * conf = ksNew (20,
+				keyNew ("user/glob/#1",
+						KEY_VALUE, "/test1",
+						KEY_META, "testmetakey1", "testvalue1",
+						KEY_END),
+				KS_END);
+	// clang-format on
+	PLUGIN_OPEN ("glob");
+
+	KeySet * ks = createKeys ();
+	ksAppendKey (ks, keyNew ("system/tests/glob/test1", KEY_END));
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 1, "call to kdbGet was not successful");
+	succeed_if (keyGetMeta (ksLookupByName (ks, "user/tests/glob/test1", 0), "testmetakey1"), "testmetakey1 not found");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, "system/tests/glob/test1", 0), "testmetakey1"), "testmetakey1 copied to wrong key");
+
+	/* cascading globs have to be expanded with the new parent */
+	keySetName (parentKey, "system/tests/glob");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 1, "call to kdbGet was not successful");
+	succeed_if (keyGetMeta (ksLookupByName (ks, "system/tests/glob/test1", 0), "testmetakey1"), "testmetakey1 not found");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("GLOB      TESTS\n");
@@ -305,6 +402,8 @@ int main (int argc, char ** argv)
 	test_getDirectionMatch ();
 	test_namedMatchFlags ();
 	test_onlyFirstMatchIsApplied ();
+	test_firstMatchAcrossPrefixes ();
+	test_parentChanges ();
 
 	print_result ("testmod_glob");
 
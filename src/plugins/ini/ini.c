@@ -292,7 +292,7 @@ static int iniKeyToElektraArray (CallbackHandle * handle, Key * existingKey, Key
 static void insertKeyIntoKeySet (Key * parentKey, Key * key, KeySet * ks)
 {
 	cursor_t savedCursor = ksGetCursor (ks);
-	char * parent = findParent (parentKey, key, ksDup (ks));
+	char * parent = findParent (parentKey, key, ks);
 	keySetMeta (key, "internal/ini/parent", parent);
 	if (keyGetMeta (key, "internal/ini/section"))
 	{
@@ -631,9 +631,19 @@ static void outputDebug (KeySet * ks)
 }
 #endif
 
+/**
+ * @brief Searches the section a key belongs to.
+ *
+ * Walks up the hierarchy of searchkey until a section key within ks
+ * or parentKey is reached. ks is not copied for every key, only its
+ * cursor is restored, so finding the parents of all keys needs one
+ * lookup per level instead of a copy of the whole keyset.
+ *
+ * @return the name of the section (or of parentKey), free it with elektraFree()
+ */
 static char * findParent (Key * parentKey, Key * searchkey, KeySet * ks)
 {
-	ksRewind (ks);
+	cursor_t savedCursor = ksGetCursor (ks);
 	size_t offset = 0;
 	if (keyName (parentKey)[0] == '/' && keyName (searchkey)[0] != '/')
 	{
@@ -663,7 +673,7 @@ static char * findParent (Key * parentKey, Key * searchkey, KeySet * ks)
 	if (!lookedUp) lookedUp = parentKey;
 	char * parentName = elektraStrDup (keyName (lookedUp));
 	keyDel (key);
-	ksDel (ks);
+	ksSetCursor (ks, savedCursor);
 	return parentName;
 }
 static void setParents (KeySet * ks, Key * parentKey)
@@ -672,7 +682,7 @@ static void setParents (KeySet * ks, Key * parentKey)
 	ksRewind (ks);
 	while ((cur = ksNext (ks)) != NULL)
 	{
-		char * parentName = findParent (parentKey, cur, ksDup (ks));
+		char * parentName = findParent (parentKey, cur, ks);
 		if (parentName)
 		{
 			keySetMeta (cur, "internal/ini/parent", parentName);
@@ -1102,19 +1112,34 @@ void insertIntoKS (Key * parentKey, Key * cur, KeySet * newKS, IniPluginConfig *
 	keyDel (appendKey);
 }
 
+/**
+ * @brief A key together with its order metadata.
+ *
+ * Looking up metadata is expensive, so it is done once per key
+ * instead of for every comparison while sorting.
+ */
+typedef struct
+{
+	Key * key;
+	const Key * order;
+	const Key * number;
+} IniOrderEntry;
+
 static int iniCmpOrder (const void * a, const void * b)
 {
-	const Key * ka = (*(const Key **) a);
-	const Key * kb = (*(const Key **) b);
+	const IniOrderEntry * ea = a;
+	const IniOrderEntry * eb = b;
+	const Key * ka = ea->key;
+	const Key * kb = eb->key;
 
 	if (!ka && !kb) return 0;
 	if (ka && !kb) return 1;
 	if (!ka && kb) return -1;
 
-	const Key * kaom = keyGetMeta (ka, "internal/ini/order");
-	const Key * kbom = keyGetMeta (kb, "internal/ini/order");
-	const Key * kakm = keyGetMeta (ka, "internal/ini/key/number");
-	const Key * kbkm = keyGetMeta (kb, "internal/ini/key/number");
+	const Key * kaom = ea->order;
+	const Key * kbom = eb->order;
+	const Key * kakm = ea->number;
+	const Key * kbkm = eb->number;
 
 	int ret = keyGetNamespace (ka) - keyGetNamespace (kb);
 	if (!ret)
@@ -1195,8 +1220,27 @@ static int iniWriteKeySet (FILE * fh, Key * parentKey, KeySet * returned, IniPlu
 	ssize_t arraySize = ksGetSize (returned);
 	if (arraySize == 0) return 0;
 	keyArray = elektraCalloc (arraySize * sizeof (Key *));
+	IniOrderEntry * orderArray = elektraMalloc (arraySize * sizeof (IniOrderEntry));
+	if (!keyArray || !orderArray)
+	{
+		elektraFree (keyArray);
+		elektraFree (orderArray);
+		ELEKTRA_MALLOC_ERROR (parentKey, arraySize * (sizeof (Key *) + sizeof (IniOrderEntry)));
+		return -1;
+	}
 	elektraKsToMemArray (returned, keyArray);
-	qsort (keyArray, arraySize, sizeof (Key *), iniCmpOrder);
+	for (ssize_t i = 0; i < arraySize; ++i)
+	{
+		orderArray[i].key = keyArray[i];
+		orderArray[i].order = keyGetMeta (keyArray[i], "internal/ini/order");
+		orderArray[i].number = keyGetMeta (keyArray[i], "internal/ini/key/number");
+	}
+	qsort (orderArray, arraySize, sizeof (IniOrderEntry), iniCmpOrder);
+	for (ssize_t i = 0; i < arraySize; ++i)
+	{
+		keyArray[i] = orderArray[i].key;
+	}
+	elektraFree (orderArray);
 	Key * cur = NULL;
 	Key * sectionKey = parentKey;
 	int ret = 1;
@@ -1458,7 +1502,7 @@ static void stripInternalData (Key * parentKey ELEKTRA_UNUSED, KeySet * ks)
 			}
 			strcat (newName, "/");
 			keySetName (newKey, newName);
-			char * parent = findParent (parentKey, newKey, ksDup (newKS));
+			char * parent = findParent (parentKey, newKey, newKS);
 			keySetMeta (newKey, "internal/ini/parent", parent);
 			elektraFree (parent);
 			if (strcmp (keyName (parentKey), keyName (newKey))) ksAppendKey (newKS, keyDup (newKey));
@@ -1554,24 +1598,22 @@ int elektraIniSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	}
 	Key * cur;
 	KeySet * newKS = ksNew (0, KS_END);
+	KeySet * unordered = ksNew (0, KS_END);
+	// partition in one pass, popping every key would move and rescan the keyset
 	ksRewind (returned);
 	while ((cur = ksNext (returned)) != NULL)
 	{
-		if (keyGetMeta (cur, "internal/ini/order"))
-		{
-			ksAppendKey (newKS, cur);
-			keyDel (ksLookup (returned, cur, KDB_O_POP));
-		}
+		ksAppendKey (keyGetMeta (cur, "internal/ini/order") ? newKS : unordered, cur);
 	}
-	ksRewind (returned);
 
-	while ((cur = ksNext (returned)) != NULL)
+	ksRewind (unordered);
+	while ((cur = ksNext (unordered)) != NULL)
 	{
 		if (!strcmp (keyName (cur), keyName (parentKey))) continue;
 		if (!strcmp (keyBaseName (cur), INTERNAL_ROOT_SECTION)) continue;
 		insertIntoKS (parentKey, cur, newKS, pluginConfig);
-		keyDel (ksLookup (returned, cur, KDB_O_POP));
 	}
+	ksDel (unordered);
 	ksClear (returned);
 	ksAppend (returned, newKS);
 	ksDel (newKS);
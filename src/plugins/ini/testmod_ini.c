@@ -492,6 +492,91 @@ static void test_arrayInsert (char * source, char * compare)
 	ksDel (ks);
 	PLUGIN_CLOSE ();
 }
+static void test_nestedSectionRead (char * fileName)
+{
+	Key * parentKey = keyNew ("user/tests/ini-read", KEY_VALUE, srcdir_file (fileName), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	KeySet * ks = ksNew (30, KS_END);
+	PLUGIN_OPEN ("ini");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 1, "call to kdbGet was not successful");
+	succeed_if (output_error (parentKey), "error in kdbGet");
+
+	const char * sections[] = { "zeta", "zeta/inner", "alpha", "alpha/beta/gamma", "mid" };
+	char name[64];
+	const char * lastOrder = "";
+	for (size_t i = 0; i < sizeof (sections) / sizeof (sections[0]); ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/ini-read/%s", sections[i]);
+		Key * section = ksLookupByName (ks, name, KDB_O_NONE);
+		exit_if_fail (section, "section not found");
+		succeed_if (keyGetMeta (section, "internal/ini/section"), "section key is not a section key");
+
+		// the sections keep the order of the file, array numbers sort like strings
+		const Key * orderMeta = keyGetMeta (section, "internal/ini/order");
+		exit_if_fail (orderMeta, "section has no order");
+		succeed_if (strcmp (lastOrder, keyString (orderMeta)) < 0, "sections not ordered like the file");
+		lastOrder = keyString (orderMeta);
+	}
+
+	// keys belong to the nearest section, not to its parents
+	Key * key = ksLookupByName (ks, "user/tests/ini-read/alpha/beta/gamma/gkey", KDB_O_NONE);
+	exit_if_fail (key, "key of nested section not found");
+	succeed_if_same_string (keyString (key), "g");
+	succeed_if (ksLookupByName (ks, "user/tests/ini-read/alpha/beta", KDB_O_NONE) == 0, "intermediate section created");
+	key = ksLookupByName (ks, "user/tests/ini-read/zeta/inner/ikey", KDB_O_NONE);
+	exit_if_fail (key, "key of inner section not found");
+	succeed_if_same_string (keyString (key), "i");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_sectionOrderRoundtrip (char * fileName)
+{
+	Key * parentKey = keyNew ("user/tests/ini-write", KEY_VALUE, srcdir_file (fileName), KEY_END);
+	Key * writeParentKey = keyNew ("user/tests/ini-write", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	KeySet * ks = ksNew (30, KS_END);
+	PLUGIN_OPEN ("ini");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 1, "call to kdbGet was not successful");
+	keyDel (ksLookup (ks, parentKey, KDB_O_POP));
+	keyDel (parentKey);
+	succeed_if (plugin->kdbSet (plugin, ks, writeParentKey) >= 1, "call to kdbSet was not successful");
+	succeed_if (compare_line_files (srcdir_file (fileName), keyString (writeParentKey)), "section order changed on round trip");
+	keyDel (ksLookup (ks, writeParentKey, KDB_O_POP));
+	keyDel (writeParentKey);
+	ksDel (ks);
+	PLUGIN_CLOSE ();
+}
+
+static void test_outOfOrderInsert (char * source, char * compare)
+{
+	Key * parentKey = keyNew ("user/tests/ini-write", KEY_VALUE, srcdir_file (source), KEY_END);
+	Key * writeParentKey = keyNew ("user/tests/ini-write", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	KeySet * ks = ksNew (30, KS_END);
+	PLUGIN_OPEN ("ini");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 1, "call to kdbGet was not successful");
+	keyDel (ksLookup (ks, parentKey, KDB_O_POP));
+	keyDel (parentKey);
+
+	// keys are appended in reverse order of their sections in the file
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/mid/new", KEY_VALUE, "m2", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/alpha/beta/gamma/new", KEY_VALUE, "g2", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/alpha/beta/bkey", KEY_VALUE, "b", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/alpha/beta", KEY_META, "internal/ini/section", "", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/zeta/inner/new", KEY_VALUE, "i2", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/ini-write/new", KEY_VALUE, "top2", KEY_END));
+
+	succeed_if (plugin->kdbSet (plugin, ks, writeParentKey) >= 1, "call to kdbSet was not successful");
+	succeed_if (compare_line_files (srcdir_file (compare), keyString (writeParentKey)), "files do not match as expected");
+	keyDel (ksLookup (ks, writeParentKey, KDB_O_POP));
+	keyDel (writeParentKey);
+	ksDel (ks);
+	PLUGIN_CLOSE ();
+}
+
 static void test_readCommentMeta (char * fileName)
 {
 	Key * parentKey = keyNew ("user/tests/ini-read", KEY_VALUE, srcdir_file (fileName), KEY_END);
@@ -604,6 +689,9 @@ int main (int argc, char ** argv)
 	test_insertOrder ("ini/insertTest.input.ini", "ini/insertTest.output.ini");
 	test_complexInsert ("ini/complexIn.ini", "ini/complexOut.ini");
 	test_arrayInsert ("ini/arrayInsertIn.ini", "ini/arrayInsertOut.ini");
+	test_nestedSectionRead ("ini/sectionOrder.ini");
+	test_sectionOrderRoundtrip ("ini/sectionOrder.ini");
+	test_outOfOrderInsert ("ini/sectionOrder.ini", "ini/sectionOrderInsert.ini");
 	test_dontquotebracketvalues ("ini/bracketQuoteOut.ini");
 	test_commentDefaultChar ("ini/commentini");
 	test_readCommentMeta ("ini/testCommentMeta.ini");
@@ -15,6 +15,7 @@
 #include <kdbease.h>
 #include <kdberrors.h>
 #include <kdblogger.h>
+#include <kdbproposal.h>
 #include <kdbutility.h>
 #include <stdio.h>
 
@@ -101,28 +102,28 @@ static inline char * findUnescapedEquals (char * text)
 
 /**
  * @brief Parse a single line of a text in INI like format (`key = value`) and
- *        store the resulting key value pair in the given key set.
+ *        add the resulting key value pair to the given builder.
  *
  * The string stored in `line` can also be empty or contain comments denoted
  * by `;` or `#`. The function ignores empty lines. If a line contains non-commented
  * characters that do not follow the pattern `key = value`, then this function will
  * add a warning about this invalid key value pair to `parentKey`.
  *
- * @pre The parameters `line`, `keySet` and `parentKey` must not be `NULL`.
+ * @pre The parameters `line`, `builder` and `parentKey` must not be `NULL`.
  *
  * @param line A single line string that should be parsed by this function
  * @param lineNumber The lineNumber of the current line of text. This value will
  *                   be used by this function to generate warning messages about
  *                   invalid key value pairs.
- * @param keySet The keyset where the key value pair contained in `line` should
- *               be saved
+ * @param builder The builder where the key value pair contained in `line` should
+ *                be saved
  * @param parentKey This key is used by this function to store warnings about
  *                  invalid key value pairs
  */
-static inline void parseLine (char * line, size_t lineNumber, KeySet * keySet, Key * parentKey)
+static inline void parseLine (char * line, size_t lineNumber, ElektraKsBuilder * builder, Key * parentKey)
 {
 	ELEKTRA_NOT_NULL (line);
-	ELEKTRA_NOT_NULL (keySet);
+	ELEKTRA_NOT_NULL (builder);
 	ELEKTRA_NOT_NULL (parentKey);
 
 	char * pair = elektraStrip (stripComment (line));
@@ -152,7 +153,7 @@ static inline void parseLine (char * line, size_t lineNumber, KeySet * keySet, K
 	ELEKTRA_LOG_DEBUG ("Name:  “%s”", keyName (key));
 	ELEKTRA_LOG_DEBUG ("Value: “%s”", keyString (key));
 
-	ksAppendKey (keySet, key);
+	elektraKsBuilderAdd (builder, key);
 }
 
 /**
@@ -179,14 +180,29 @@ static int parseINI (FILE * file, KeySet * keySet, Key * parentKey)
 	size_t capacity = 0;
 	int errorNumber = errno;
 
+	// keys appear in file order, so they are sorted only once at the end
+	ElektraKsBuilder * builder = elektraKsBuilderNew (0);
+	if (!builder)
+	{
+		ELEKTRA_SET_ERROR (ELEKTRA_ERROR_MALLOC, parentKey, "Unable to allocate memory for collecting the keys");
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+
 	size_t lineNumber;
 	for (lineNumber = 1; getline (&line, &capacity, file) != -1; ++lineNumber)
 	{
 		ELEKTRA_LOG_DEBUG ("Read Line %zu: %s", lineNumber, line);
-		parseLine (line, lineNumber, keySet, parentKey);
+		parseLine (line, lineNumber, builder, parentKey);
 	}
 
 	elektraFree (line);
+	int built = elektraKsBuilderBuild (builder, keySet) >= 0;
+	elektraKsBuilderDel (builder);
+	if (!built)
+	{
+		ELEKTRA_SET_ERROR (ELEKTRA_ERROR_MALLOC, parentKey, "Unable to allocate memory for adding the keys");
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
 
 	if (!feof (file))
 	{
@@ -61,6 +61,7 @@ static char * keyNameToMatchingString (const Key * key)
 	for (char * ptr = name; *ptr != '\0'; ++ptr)
 		if (*ptr == '#') ++arrayCount;
 	char * pattern = elektraMalloc (elektraStrLen (name) + arrayCount);
+	if (!pattern) return NULL;
 	char * dst = pattern;
 	for (char * src = (name + 1); *src != '\0'; ++src)
 	{
@@ -95,6 +96,278 @@ static int matchPatternToKey (const char * pattern, const Key * key)
 		return FNM_NOMATCH;
 }
 
+// A node of the prefix tree of all spec patterns. Every edge is one part of a pattern between two slashes.
+typedef struct _SpecNode SpecNode;
+
+struct _SpecNode
+{
+	char * part;
+	int glob; // part contains `*` or `?` and has to be matched with fnmatch
+
+	SpecNode ** literals; // children without wildcards, sorted by part
+	size_t literalSize;
+	size_t literalAlloc;
+
+	SpecNode ** globs; // children with wildcards
+	size_t globSize;
+	size_t globAlloc;
+
+	size_t * specs; // indices of the spec keys whose pattern ends at this node
+	size_t specSize;
+	size_t specAlloc;
+};
+
+// All spec patterns of a single kdbGet or kdbSet compiled into one prefix tree
+typedef struct
+{
+	SpecNode * root;
+	char ** patterns;
+	size_t * complex; // patterns that can not be split at slashes, they are matched with fnmatch as a whole
+	size_t complexSize;
+	size_t size;
+	KeySet ** matches; // for every spec key the keys matching its pattern
+} SpecMatcher;
+
+// makes room for one more element, on failure array and alloc stay unchanged
+// @retval 0 on success
+// @retval -1 on memory errors
+static int arrayGrow (void ** array, size_t * alloc, size_t size, size_t elementSize)
+{
+	if (size < *alloc) return 0;
+	size_t newAlloc = *alloc ? *alloc * 2 : 4;
+	if (elektraRealloc (array, newAlloc * elementSize) == -1) return -1;
+	*alloc = newAlloc;
+	return 0;
+}
+
+// @return the new node or NULL on memory errors
+static SpecNode * specNodeNew (const char * part)
+{
+	SpecNode * node = elektraCalloc (sizeof (SpecNode));
+	if (!node) return NULL;
+	node->part = elektraStrDup (part);
+	if (!node->part)
+	{
+		elektraFree (node);
+		return NULL;
+	}
+	node->glob = strpbrk (part, "*?") != NULL;
+	return node;
+}
+
+static void specNodeDel (SpecNode * node)
+{
+	for (size_t i = 0; i < node->literalSize; ++i)
+		specNodeDel (node->literals[i]);
+	for (size_t i = 0; i < node->globSize; ++i)
+		specNodeDel (node->globs[i]);
+	elektraFree (node->literals);
+	elektraFree (node->globs);
+	elektraFree (node->specs);
+	elektraFree (node->part);
+	elektraFree (node);
+}
+
+// @return the position of the literal child for part, or the position where it has to be inserted
+static size_t specNodeFindLiteral (SpecNode * node, const char * part, int * found)
+{
+	size_t low = 0;
+	size_t high = node->literalSize;
+	*found = 0;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		int cmp = strcmp (node->literals[mid]->part, part);
+		if (cmp == 0)
+		{
+			*found = 1;
+			return mid;
+		}
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+// @return the child of node for part, which is created if needed, or NULL on memory errors
+static SpecNode * specNodeChild (SpecNode * node, const char * part)
+{
+	SpecNode * child;
+	if (strpbrk (part, "*?"))
+	{
+		for (size_t i = 0; i < node->globSize; ++i)
+			if (!strcmp (node->globs[i]->part, part)) return node->globs[i];
+		if (arrayGrow ((void **) &node->globs, &node->globAlloc, node->globSize, sizeof (SpecNode *)) == -1) return NULL;
+		if (!(child = specNodeNew (part))) return NULL;
+		return node->globs[node->globSize++] = child;
+	}
+
+	int found;
+	size_t pos = specNodeFindLiteral (node, part, &found);
+	if (found) return node->literals[pos];
+	if (arrayGrow ((void **) &node->literals, &node->literalAlloc, node->literalSize, sizeof (SpecNode *)) == -1) return NULL;
+	if (!(child = specNodeNew (part))) return NULL;
+	memmove (node->literals + pos + 1, node->literals + pos, (node->literalSize - pos) * sizeof (SpecNode *));
+	++node->literalSize;
+	return node->literals[pos] = child;
+}
+
+// Splits name at every slash in place
+// @return an array with the start of every part, which has to be freed, or NULL on memory errors
+static char ** splitName (char * name, size_t * size)
+{
+	*size = 1;
+	for (char * ptr = name; *ptr != '\0'; ++ptr)
+		if (*ptr == '/') ++*size;
+	char ** parts = elektraMalloc (*size * sizeof (char *));
+	if (!parts) return NULL;
+	size_t part = 0;
+	parts[part++] = name;
+	for (char * ptr = name; *ptr != '\0'; ++ptr)
+	{
+		if (*ptr != '/') continue;
+		*ptr = '\0';
+		parts[part++] = ptr + 1;
+	}
+	return parts;
+}
+
+// @retval 0 on success
+// @retval -1 on memory errors
+static int specMatcherAddPattern (SpecMatcher * matcher, size_t spec)
+{
+	// escapes and brackets might contain or escape slashes
+	if (strpbrk (matcher->patterns[spec], "\\["))
+	{
+		matcher->complex[matcher->complexSize++] = spec;
+		return 0;
+	}
+
+	char * pattern = elektraStrDup (matcher->patterns[spec]);
+	if (!pattern) return -1;
+	size_t size;
+	char ** parts = splitName (pattern, &size);
+	SpecNode * node = parts ? matcher->root : NULL;
+	for (size_t i = 0; node && i < size; ++i)
+		node = specNodeChild (node, parts[i]);
+	int ret = -1;
+	if (node && arrayGrow ((void **) &node->specs, &node->specAlloc, node->specSize, sizeof (size_t)) == 0)
+	{
+		node->specs[node->specSize++] = spec;
+		ret = 0;
+	}
+	elektraFree (parts);
+	elektraFree (pattern);
+	return ret;
+}
+
+static void specMatcherDel (SpecMatcher * matcher);
+
+// @return the matcher for the patterns of all keys of specKS or NULL on memory errors
+static SpecMatcher * specMatcherNew (KeySet * specKS)
+{
+	SpecMatcher * matcher = elektraCalloc (sizeof (SpecMatcher));
+	if (!matcher) return NULL;
+	matcher->size = ksGetSize (specKS);
+	matcher->root = specNodeNew ("");
+	matcher->patterns = elektraCalloc ((matcher->size + 1) * sizeof (char *));
+	matcher->complex = elektraCalloc ((matcher->size + 1) * sizeof (size_t));
+	matcher->matches = elektraCalloc ((matcher->size + 1) * sizeof (KeySet *));
+	if (!matcher->root || !matcher->patterns || !matcher->complex || !matcher->matches)
+	{
+		specMatcherDel (matcher);
+		return NULL;
+	}
+
+	Key * specKey;
+	size_t spec = 0;
+	ksRewind (specKS);
+	while ((specKey = ksNext (specKS)) != NULL)
+	{
+		if (keyGetMeta (specKey, "require"))
+		{
+			Key * matchKey = keyDup (specKey);
+			keySetBaseName (matchKey, 0);
+			matcher->patterns[spec] = keyNameToMatchingString (matchKey);
+			keyDel (matchKey);
+		}
+		else
+		{
+			matcher->patterns[spec] = keyNameToMatchingString (specKey);
+		}
+		matcher->matches[spec] = ksNew (0, KS_END);
+		if (!matcher->patterns[spec] || !matcher->matches[spec] || specMatcherAddPattern (matcher, spec) == -1)
+		{
+			specMatcherDel (matcher);
+			return NULL;
+		}
+		++spec;
+	}
+	return matcher;
+}
+
+static void specMatcherDel (SpecMatcher * matcher)
+{
+	for (size_t spec = 0; matcher->patterns && matcher->matches && spec < matcher->size; ++spec)
+	{
+		elektraFree (matcher->patterns[spec]);
+		ksDel (matcher->matches[spec]);
+	}
+	if (matcher->root) specNodeDel (matcher->root);
+	elektraFree (matcher->patterns);
+	elektraFree (matcher->complex);
+	elektraFree (matcher->matches);
+	elektraFree (matcher);
+}
+
+static void specNodeMatch (SpecMatcher * matcher, SpecNode * node, char ** parts, size_t size, Key * key)
+{
+	if (size == 0)
+	{
+		for (size_t i = 0; i < node->specSize; ++i)
+			ksAppendKey (matcher->matches[node->specs[i]], key);
+		return;
+	}
+
+	int found;
+	size_t pos = specNodeFindLiteral (node, parts[0], &found);
+	if (found) specNodeMatch (matcher, node->literals[pos], parts + 1, size - 1, key);
+	for (size_t i = 0; i < node->globSize; ++i)
+	{
+		if (!fnmatch (node->globs[i]->part, parts[0], FNM_PATHNAME))
+			specNodeMatch (matcher, node->globs[i], parts + 1, size - 1, key);
+	}
+}
+
+// adds key to the matches of every spec key whose pattern matches the name of key
+static void specMatcherMatch (SpecMatcher * matcher, Key * key)
+{
+	const char * name = strchr (keyName (key), '/');
+	char * copy = name && !strchr (name, '\\') ? elektraStrDup (name + 1) : NULL;
+	size_t size;
+	char ** parts = copy ? splitName (copy, &size) : NULL;
+	if (!parts)
+	{
+		// also used if there is no memory for splitting the name
+		for (size_t spec = 0; spec < matcher->size; ++spec)
+			if (matchPatternToKey (matcher->patterns[spec], key)) ksAppendKey (matcher->matches[spec], key);
+		elektraFree (copy);
+		return;
+	}
+
+	specNodeMatch (matcher, matcher->root, parts, size, key);
+	elektraFree (parts);
+	elektraFree (copy);
+
+	for (size_t i = 0; i < matcher->complexSize; ++i)
+	{
+		size_t spec = matcher->complex[i];
+		if (matchPatternToKey (matcher->patterns[spec], key)) ksAppendKey (matcher->matches[spec], key);
+	}
+}
+
 static int isValidArrayKey (Key * key)
 {
 	Key * copy = keyDup (key);
@@ -175,15 +448,54 @@ static void validateArrayRange (Key * parent, long validCount, Key * specKey)
 	}
 }
 
-static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey)
+// @return the keys of ks that are below or same as parent, which has to be part of ks
+static KeySet * cutBelow (KeySet * ks, Key * parent)
+{
+	if (keyGetNamespace (parent) == KEY_NS_CASCADING)
+	{
+		KeySet * ksCopy = ksDup (ks);
+		KeySet * below = ksCut (ksCopy, parent);
+		ksDel (ksCopy);
+		return below;
+	}
+
+	KeySet * below = ksNew (0, KS_END);
+	Key * cur;
+
+	// like ksCut, start at cascading keys below parent, which are sorted first
+	cursor_t it = 0;
+	while ((cur = ksAtCursor (ks, it)) != NULL && keyName (cur)[0] == '/' && keyIsBelowOrSame (parent, cur) != 1)
+	{
+		++it;
+	}
+	if (cur && keyName (cur)[0] == '/')
+	{
+		while ((cur = ksAtCursor (ks, it++)) != NULL && keyIsBelowOrSame (parent, cur) == 1)
+		{
+			ksAppendKey (below, cur);
+		}
+		ksRewind (below);
+		return below;
+	}
+
+	cur = ksLookup (ks, parent, KDB_O_NOCASCADING);
+	do
+	{
+		ksAppendKey (below, cur);
+	} while ((cur = ksNext (ks)) != NULL && keyIsBelow (parent, cur));
+	ksRewind (below);
+	return below;
+}
+
+static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey, KeySet * touched)
 {
 	Key * tmpArrayParent = keyDup (arrayKey);
 	keySetBaseName (tmpArrayParent, 0);
 	Key * arrayParent = ksLookup (ks, tmpArrayParent, KDB_O_NONE);
 	keyDel (tmpArrayParent);
 	if (arrayParent == NULL) return;
-	KeySet * ksCopy = ksDup (ks);
-	KeySet * subKeys = ksCut (ksCopy, arrayParent);
+	ksAppendKey (touched, arrayParent);
+	KeySet * subKeys = cutBelow (ks, arrayParent);
 	Key * cur;
 	long validCount = 0;
 	while ((cur = ksNext (subKeys)) != NULL)
@@ -204,16 +516,16 @@ static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey)
 				{
 					if (strcmp (keyName (cur), keyName (toMark))) keySetMeta (toMark, "conflict/invalid", "");
 					elektraMetaArrayAdd (arrayParent, "conflict/invalid/hasmember", keyName (toMark));
+					ksAppendKey (touched, toMark);
 				}
 				ksDel (invalidCutKS);
 			}
 		}
 	}
 	ksDel (subKeys);
-	ksDel (ksCopy);
 	validateArrayRange (arrayParent, validCount, specKey);
 }
-static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
+static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey, KeySet * touched)
 {
 	const Key * requiredMeta = keyGetMeta (specKey, "required");
 	if (!requiredMeta) return;
@@ -222,8 +534,8 @@ static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
 	Key * parent = ksLookup (ks, tmpParent, KDB_O_NONE);
 	keyDel (tmpParent);
 	if (parent == NULL) return;
-	KeySet * ksCopy = ksDup (ks);
-	KeySet * subKeys = ksCut (ksCopy, parent);
+	ksAppendKey (touched, parent);
+	KeySet * subKeys = cutBelow (ks, parent);
 	Key * cur;
 	long subCount = 0;
 	while ((cur = ksNext (subKeys)) != NULL)
@@ -239,7 +551,6 @@ static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
 	}
 
 	ksDel (subKeys);
-	ksDel (ksCopy);
 }
 
 
@@ -658,85 +969,184 @@ static int hasRequired (Key * key, Key * specKey, KeySet * ks)
 	return 1;
 }
 
-static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, ConflictHandling * ch, Direction dir, int clean)
+// @retval 1 if handleErrors would handle or remove metadata of key
+static int hasConflicts (Key * key)
 {
-	Key * specKey;
-	ksRewind (specKS);
-	int ret = 1;
-	while ((specKey = ksNext (specKS)) != NULL)
+	const Key * meta;
+	keyRewindMeta (key);
+	while ((meta = keyNextMeta (key)) != NULL)
 	{
-		int require = 0;
-		char * pattern;
-		if (keyGetMeta (specKey, "require"))
+		if (getConflict ((Key *) meta) != NAC || !strncmp (keyName (meta), "conflict/#", 10) ||
+		    !strncmp (keyName (meta), "conflict/invalid/hasmember/#", 28))
+			return 1;
+	}
+	return 0;
+}
+
+// Handles the conflicts of the keys of returned after inserted, or of all keys if inserted is NULL, like a walk over these keys would.
+// Only keys in touched can have conflicts, afterwards touched only contains keys whose conflicts are still unhandled.
+// All keys are walked over if returned contains spec keys, because lookups of cascading keys might add default keys.
+static int handleConflicts (Key * parentKey, KeySet * returned, KeySet * touched, Key * inserted, Key * specKey, ConflictHandling * ch,
+			    Direction dir, int ret, int hasSpecKeys)
+{
+	KeySet * conflicting = ksNew (0, KS_END);
+	int walkAll = hasSpecKeys;
+	Key * cur;
+	ksRewind (touched);
+	while ((cur = ksNext (touched)) != NULL)
+	{
+		if (ksLookup (returned, cur, KDB_O_NOCASCADING) != cur || !hasConflicts (cur)) continue;
+		ksAppendKey (conflicting, cur);
+		// conflicts of keys before inserted are handled when they are the parent of a later key
+		if (inserted && keyCmp (cur, inserted) <= 0) walkAll = 1;
+	}
+	ksClear (touched);
+	ksAppend (touched, conflicting);
+
+	if (inserted)
+		ksLookup (returned, inserted, KDB_O_NOCASCADING);
+	else
+		ksRewind (returned);
+
+	if (walkAll || ksGetSize (conflicting) > 0)
+	{
+		// cascading keys are sorted first and handle the conflicts of their parent, which is found by cascading lookup
+		while ((cur = ksNext (returned)) != NULL && (walkAll || keyName (cur)[0] == '/'))
 		{
-			require = 1;
-			Key * matchKey = keyDup (specKey);
-			keySetBaseName (matchKey, 0);
-			pattern = keyNameToMatchingString (matchKey);
-			keyDel (matchKey);
+			ret = handleErrors (parentKey, returned, cur, specKey, ch, dir);
+			keySetMeta (cur, "conflict/invalid", 0);
+		}
+	}
+	else
+	{
+		cur = ksNext (returned);
+	}
+
+	if (cur)
+	{
+		// the parent of other keys is sorted before them, so only keys with conflicts have to be handled
+		Key * last = ksTail (returned);
+		ret = 0;
+		ksRewind (conflicting);
+		while ((cur = ksNext (conflicting)) != NULL)
+		{
+			if (keyName (cur)[0] == '/') continue;
+			int result = handleErrors (parentKey, returned, cur, specKey, ch, dir);
+			keySetMeta (cur, "conflict/invalid", 0);
+			if (cur == last) ret = result;
+		}
+	}
+	ksDel (conflicting);
+	return ret;
+}
+
+// Checks cur against specKey and copies the metadata of specKey to it
+static void applySpec (Key * parentKey, KeySet * returned, KeySet * touched, Key * cur, Key * specKey, int clean)
+{
+	if (clean)
+	{
+		removeMeta (cur, specKey, parentKey);
+		return;
+	}
+	ksAppendKey (touched, cur);
+	if (keyGetMeta (specKey, "require"))
+	{
+		if (hasRequired (cur, specKey, returned)) copyMeta (cur, specKey, parentKey);
+	}
+	else if (keyGetMeta (cur, "conflict/invalid"))
+	{
+		copyMeta (cur, specKey, parentKey);
+	}
+	else if (keyGetMeta (cur, "spec/internal/valid"))
+	{
+		copyMeta (cur, specKey, parentKey);
+	}
+	else if (elektraArrayValidateName (cur) == 1)
+	{
+		validateArray (returned, cur, specKey, touched);
+		copyMeta (cur, specKey, parentKey);
+	}
+	else if (!(strcmp (keyBaseName (specKey), "_")))
+	{
+		validateWildcardSubs (returned, cur, specKey, touched);
+		copyMeta (cur, specKey, parentKey);
+	}
+	else
+	{
+		if (hasArray (cur))
+		{
+			if (isValidArrayKey (cur))
+			{
+				copyMeta (cur, specKey, parentKey);
+			}
 		}
 		else
 		{
-			pattern = keyNameToMatchingString (specKey);
+			copyMeta (cur, specKey, parentKey);
 		}
+	}
+}
+
+static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, ConflictHandling * ch, Direction dir, int clean)
+{
+	SpecMatcher * matcher = specMatcherNew (specKS);
+	if (!matcher)
+	{
+		ELEKTRA_MALLOC_ERROR (parentKey, sizeof (SpecMatcher));
+		return -1;
+	}
+	Key * cur;
+	int hasSpecKeys = 0;
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != NULL && !hasSpecKeys)
+	{
+		hasSpecKeys = keyGetNamespace (cur) == KEY_NS_SPEC;
+	}
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != NULL && !hasSpecKeys)
+	{
+		specMatcherMatch (matcher, cur);
+	}
+
+	// keys that might have conflicts, at first conflicts of all keys are handled
+	KeySet * touched = ksDup (returned);
+
+	Key * specKey;
+	size_t spec = 0;
+	ksRewind (specKS);
+	int ret = 1;
+	while ((specKey = ksNext (specKS)) != NULL)
+	{
 		int found = 0;
-		ksRewind (returned);
-		Key * cur;
-		while ((cur = ksNext (returned)) != NULL)
+		if (hasSpecKeys)
 		{
-			if (keyGetNamespace (cur) == KEY_NS_SPEC) continue;
-
-			cursor_t cursor = ksGetCursor (returned);
-			if (matchPatternToKey (pattern, cur))
+			// lookups might add default keys of spec keys, so the keys are matched again for every spec key
+			ksRewind (returned);
+			while ((cur = ksNext (returned)) != NULL)
 			{
-				if (!clean)
-				{
-					found = 1;
-					if (require)
-					{
-						if (hasRequired (cur, specKey, returned)) copyMeta (cur, specKey, parentKey);
-					}
-					else if (keyGetMeta (cur, "conflict/invalid"))
-					{
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (keyGetMeta (cur, "spec/internal/valid"))
-					{
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (elektraArrayValidateName (cur) == 1)
-					{
-						validateArray (returned, cur, specKey);
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (!(strcmp (keyBaseName (specKey), "_")))
-					{
-						validateWildcardSubs (returned, cur, specKey);
-						copyMeta (cur, specKey, parentKey);
-					}
-					else
-					{
-						if (hasArray (cur))
-						{
-							if (isValidArrayKey (cur))
-							{
-								copyMeta (cur, specKey, parentKey);
-							}
-						}
-						else
-						{
-							copyMeta (cur, specKey, parentKey);
-						}
-					}
-				}
-				else
+				if (keyGetNamespace (cur) == KEY_NS_SPEC) continue;
+
+				cursor_t cursor = ksGetCursor (returned);
+				if (matchPatternToKey (matcher->patterns[spec], cur))
 				{
-					removeMeta (cur, specKey, parentKey);
+					found |= !clean;
+					applySpec (parentKey, returned, touched, cur, specKey, clean);
 				}
+				ksSetCursor (returned, cursor);
 			}
-			ksSetCursor (returned, cursor);
 		}
-		ksRewind (returned);
+		else
+		{
+			KeySet * matches = matcher->matches[spec];
+			ksRewind (matches);
+			while ((cur = ksNext (matches)) != NULL)
+			{
+				found |= !clean;
+				applySpec (parentKey, returned, touched, cur, specKey, clean);
+			}
+		}
+		++spec;
+		Key * inserted = NULL;
 		if (!found && dir == GET)
 		{
 			if (keyGetMeta (specKey, "assign/condition")) // hardcoded for now because only "assign/condition" from "assign/*"
@@ -744,7 +1154,7 @@ static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, Conf
 			{
 				Key * newKey = keyNew (strchr (keyName (specKey), '/'), KEY_CASCADING_NAME, KEY_END);
 				keySetMeta (newKey, "assign/condition", keyString (keyGetMeta (specKey, "assign/condition")));
-				ksAppendKey (returned, keyDup (newKey));
+				inserted = keyDup (newKey);
 				keyDel (newKey);
 			}
 			else if (keyGetMeta (specKey,
@@ -753,18 +1163,20 @@ static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, Conf
 				Key * newKey = keyNew (strchr (keyName (specKey), '/'), KEY_CASCADING_NAME, KEY_VALUE,
 						       keyString (keyGetMeta (specKey, "default")), KEY_END);
 				copyMeta (newKey, specKey, parentKey);
-				ksAppendKey (returned, keyDup (newKey));
+				inserted = keyDup (newKey);
 				keyDel (newKey);
 			}
 		}
-		while ((cur = ksNext (returned)) != NULL)
+		if (inserted)
 		{
-			ret = handleErrors (parentKey, returned, cur, specKey, ch, dir);
-			keySetMeta (cur, "conflict/invalid", 0);
+			ksAppendKey (returned, inserted);
+			specMatcherMatch (matcher, inserted);
 		}
-
-		elektraFree (pattern);
+		ret = handleConflicts (parentKey, returned, touched, inserted, specKey, ch, dir, ret, hasSpecKeys);
 	}
+
+	ksDel (touched);
+	specMatcherDel (matcher);
 	return ret;
 }
 
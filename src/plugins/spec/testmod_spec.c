@@ -0,0 +1,209 @@
+/**
+ * @file
+ *
+ * @brief Tests for the spec plugin
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <tests_plugin.h>
+
+#define PARENT "user/tests/spec"
+
+// conflicts are reported in the error of parentKey, the return value only reflects the last key
+static int getWithConflict (KeySet * ks, const char * onConflict, Key * parentKey)
+{
+	KeySet * conf = ksNew (1, keyNew ("user/conflict/get", KEY_VALUE, onConflict, KEY_END), KS_END);
+	PLUGIN_OPEN ("spec");
+	int ret = plugin->kdbGet (plugin, ks, parentKey);
+	PLUGIN_CLOSE ();
+	return ret;
+}
+
+static void test_default (void)
+{
+	printf ("test default\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/missing", KEY_META, "default", "5", KEY_META, "type", "long", KEY_END),
+			     keyNew ("spec/tests/spec/present", KEY_META, "default", "7", KEY_END),
+			     keyNew (PARENT "/present", KEY_VALUE, "8", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "ERROR", parentKey) >= 0, "kdbGet failed");
+
+	Key * key = ksLookupByName (ks, "/tests/spec/missing", KDB_O_NOCASCADING);
+	exit_if_fail (key, "default key not inserted");
+	succeed_if_same_string (keyString (key), "5");
+	succeed_if (keyGetMeta (key, "type") && !strcmp (keyString (keyGetMeta (key, "type")), "long"), "metadata not copied to default key");
+
+	succeed_if (ksLookupByName (ks, "/tests/spec/present", KDB_O_NOCASCADING) == 0, "default key inserted for existing key");
+	key = ksLookupByName (ks, PARENT "/present", 0);
+	exit_if_fail (key, "existing key removed");
+	succeed_if_same_string (keyString (key), "8");
+	succeed_if (keyGetMeta (key, "default") && !strcmp (keyString (keyGetMeta (key, "default")), "7"), "metadata not copied");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_wildcard (void)
+{
+	printf ("test wildcard\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/_/value", KEY_META, "check/type", "long", KEY_END),
+			     keyNew (PARENT "/a/value", KEY_VALUE, "1", KEY_END), keyNew (PARENT "/b/value", KEY_VALUE, "2", KEY_END),
+			     keyNew (PARENT "/a/other", KEY_VALUE, "3", KEY_END), keyNew (PARENT "/a/b/value", KEY_VALUE, "4", KEY_END),
+			     KS_END);
+
+	succeed_if (getWithConflict (ks, "ERROR", parentKey) >= 0, "kdbGet failed");
+
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/a/value", 0), "check/type"), "metadata not copied to a/value");
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/b/value", 0), "check/type"), "metadata not copied to b/value");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, PARENT "/a/other", 0), "check/type"), "metadata copied to key not matching");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, PARENT "/a/b/value", 0), "check/type"), "_ matched more than one level");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_wildcardRequired (void)
+{
+	printf ("test wildcard with required subkeys\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/group/_", KEY_META, "required", "2", KEY_END), keyNew (PARENT "/group", KEY_END),
+			     keyNew (PARENT "/group/x", KEY_END), keyNew (PARENT "/group/y", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "ERROR", parentKey) >= 0, "kdbGet with right number of subkeys failed");
+	succeed_if (output_error (parentKey), "error for right number of subkeys");
+
+	ksAppendKey (ks, keyNew (PARENT "/group/z", KEY_END));
+	getWithConflict (ks, "ERROR", parentKey);
+	succeed_if (keyGetMeta (parentKey, "error"), "no error for wrong number of subkeys");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_array (void)
+{
+	printf ("test array\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/list/#", KEY_META, "check/type", "long", KEY_META, "array", "1-2", KEY_END),
+			     keyNew (PARENT "/list", KEY_END), keyNew (PARENT "/list/#0", KEY_VALUE, "0", KEY_END),
+			     keyNew (PARENT "/list/#1", KEY_VALUE, "1", KEY_END), keyNew (PARENT "/other/#0", KEY_VALUE, "0", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "ERROR", parentKey) >= 0, "kdbGet of valid array failed");
+	succeed_if (output_error (parentKey), "error for valid array");
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/list/#0", 0), "check/type"), "metadata not copied to #0");
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/list/#1", 0), "check/type"), "metadata not copied to #1");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, PARENT "/other/#0", 0), "check/type"), "metadata copied to other array");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, PARENT "/list", 0), "check/type"), "metadata copied to array parent");
+
+	ksAppendKey (ks, keyNew (PARENT "/list/#2", KEY_VALUE, "2", KEY_END));
+	getWithConflict (ks, "ERROR", parentKey);
+	succeed_if (keyGetMeta (parentKey, "error"), "no error for array out of range");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_arrayInvalidMember (void)
+{
+	printf ("test array with invalid member\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/list/#", KEY_META, "check/type", "long", KEY_END), keyNew (PARENT "/list", KEY_END),
+			     keyNew (PARENT "/list/#0", KEY_VALUE, "0", KEY_END), keyNew (PARENT "/list/#abc", KEY_VALUE, "1", KEY_END),
+			     keyNew (PARENT "/list/#abc/sub", KEY_VALUE, "2", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "IGNORE", parentKey) >= 0, "kdbGet failed although conflicts are ignored");
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/list/#0", 0), "check/type"), "metadata not copied to valid member");
+	succeed_if (!keyGetMeta (ksLookupByName (ks, PARENT "/list/#abc", 0), "check/type"), "metadata copied to invalid member");
+
+	getWithConflict (ks, "ERROR", parentKey);
+	succeed_if (keyGetMeta (parentKey, "error"), "no error for invalid array member");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_require (void)
+{
+	printf ("test require\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/section/needed", KEY_META, "require", "", KEY_META, "description", "needed", KEY_END),
+			     keyNew (PARENT "/section", KEY_END), keyNew (PARENT "/section/needed", KEY_VALUE, "1", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "ERROR", parentKey) >= 0, "kdbGet with required key failed");
+	succeed_if (output_error (parentKey), "error although required key exists");
+	succeed_if (keyGetMeta (ksLookupByName (ks, PARENT "/section", 0), "description"), "metadata not copied to parent of required key");
+
+	keyDel (ksLookupByName (ks, PARENT "/section/needed", KDB_O_POP));
+	getWithConflict (ks, "ERROR", parentKey);
+	succeed_if (keyGetMeta (parentKey, "error"), "no error for missing required key");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+static void test_collision (void)
+{
+	printf ("test conflicting metadata\n");
+
+	Key * parentKey = keyNew (PARENT, KEY_END);
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/key", KEY_META, "check/type", "long", KEY_END),
+			     keyNew (PARENT "/key", KEY_VALUE, "1", KEY_META, "check/type", "string", KEY_END), KS_END);
+
+	succeed_if (getWithConflict (ks, "INFO", parentKey) >= 0, "kdbGet failed for conflicts as info");
+	Key * key = ksLookupByName (ks, PARENT "/key", 0);
+	exit_if_fail (key, "key not found");
+	succeed_if_same_string (keyString (keyGetMeta (key, "check/type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (key, "conflict/check/type")), "string");
+	succeed_if (keyGetMeta (key, "logs/spec/info/#0"), "conflict not logged");
+	succeed_if (!keyGetMeta (key, "conflict/collision"), "handled conflict not removed");
+
+	keySetMeta (key, "check/type", "string");
+	getWithConflict (ks, "ERROR", parentKey);
+	succeed_if (keyGetMeta (parentKey, "error"), "no error for conflicting metadata");
+
+	ksDel (ks);
+	keyDel (parentKey);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("SPEC        TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_default ();
+	test_wildcard ();
+	test_wildcardRequired ();
+	test_array ();
+	test_arrayInvalidMember ();
+	test_require ();
+	test_collision ();
+
+	print_result ("testmod_spec");
+
+	return nbError;
+}
@@ -537,3 +537,142 @@ TEST (type, octet)
 		EXPECT_TRUE (tc.check (k)) << x << " should check successfully as octet";
 	}
 }
+
+TEST (type, floatRange)
+{
+	KeySet config;
+	TypeChecker tc (config);
+
+	Key k ("user/anything", KEY_VALUE, "3.4e38", KEY_META, "check/type", "float", KEY_END);
+	EXPECT_TRUE (tc.check (k)) << "3.4e38 should fit into float";
+	k.setString ("3.5e38");
+	EXPECT_FALSE (tc.check (k)) << "3.5e38 should overflow float";
+	k.setString ("-0.00035e42");
+	EXPECT_FALSE (tc.check (k)) << "-0.00035e42 should overflow float";
+	k.setString ("1e-300");
+	EXPECT_TRUE (tc.check (k)) << "underflow should check successfully";
+
+	k.setMeta<string> ("check/type", "double");
+	k.setString ("3.5e38");
+	EXPECT_TRUE (tc.check (k)) << "3.5e38 should fit into double";
+	k.setString ("1797693134862315.7e293");
+	EXPECT_TRUE (tc.check (k)) << "maximum of double should check successfully";
+	k.setString ("1797693134862315.9e293");
+	EXPECT_FALSE (tc.check (k)) << "1797693134862315.9e293 should overflow double";
+	k.setString ("1e99999999999999999999");
+	EXPECT_FALSE (tc.check (k)) << "huge exponent should overflow double";
+	k.setString ("1e-99999999999999999999");
+	EXPECT_TRUE (tc.check (k)) << "tiny exponent should check successfully";
+	k.setString ("0e99999999999999999999");
+	EXPECT_TRUE (tc.check (k)) << "zero should check successfully";
+}
+
+TEST (type, streamSyntax)
+{
+	KeySet config;
+	TypeChecker tc (config);
+
+	// values are accepted exactly like `istream >> value` does in the "C" locale
+	Key k ("user/anything", KEY_VALUE, " \t+0001.5E+1", KEY_META, "check/type", "double", KEY_END);
+	EXPECT_TRUE (tc.check (k)) << "leading whitespace, sign and zeros should check successfully";
+	k.setString ("1.5 ");
+	EXPECT_FALSE (tc.check (k)) << "trailing whitespace should fail";
+	k.setString ("1.5e");
+	EXPECT_FALSE (tc.check (k)) << "missing exponent should fail";
+	k.setString (".e5");
+	EXPECT_FALSE (tc.check (k)) << "missing mantissa should fail";
+	k.setString ("1.5.5");
+	EXPECT_FALSE (tc.check (k)) << "second decimal point should fail";
+	k.setString ("0x10");
+	EXPECT_FALSE (tc.check (k)) << "hexadecimal should fail";
+	k.setString ("inf");
+	EXPECT_FALSE (tc.check (k)) << "inf should fail";
+	k.setString ("nan");
+	EXPECT_FALSE (tc.check (k)) << "nan should fail";
+
+	k.setMeta<string> ("check/type", "boolean");
+	k.setString (" +01");
+	EXPECT_TRUE (tc.check (k)) << "+01 should check successfully as boolean";
+	k.setString ("-0");
+	EXPECT_TRUE (tc.check (k)) << "-0 should check successfully as boolean";
+	k.setString ("-1");
+	EXPECT_FALSE (tc.check (k)) << "-1 should fail as boolean";
+	k.setString ("2");
+	EXPECT_FALSE (tc.check (k)) << "2 should fail as boolean";
+
+	// integers must be reversible to the same string
+	k.setMeta<string> ("check/type", "long");
+	k.setString ("-2147483648");
+	EXPECT_TRUE (tc.check (k)) << "minimum of long should check successfully";
+	k.setString ("-2147483649");
+	EXPECT_FALSE (tc.check (k)) << "below minimum of long should fail";
+	k.setString ("+1");
+	EXPECT_FALSE (tc.check (k)) << "plus sign should fail";
+	k.setString ("01");
+	EXPECT_FALSE (tc.check (k)) << "leading zero should fail";
+	k.setString ("-0");
+	EXPECT_FALSE (tc.check (k)) << "negative zero should fail";
+	k.setString (" 1");
+	EXPECT_FALSE (tc.check (k)) << "leading whitespace should fail";
+
+	// but min and max are read like streams do
+	k.setMeta<string> ("check/type", "unsigned_long_long");
+	k.setMeta<string> ("check/type/min", " +010");
+	k.setMeta<string> ("check/type/max", "-1");
+	k.setString ("18446744073709551615");
+	EXPECT_TRUE (tc.check (k)) << "maximum of unsigned_long_long should check successfully";
+	k.setString ("9");
+	EXPECT_FALSE (tc.check (k)) << "should fail because below min";
+	k.setMeta<string> ("check/type/max", "18446744073709551616");
+	k.setString ("10");
+	EXPECT_FALSE (tc.check (k)) << "should fail because max is out of range";
+}
+
+TEST (type, FSType)
+{
+	KeySet config;
+	TypeChecker tc (config);
+
+	Key k ("user/anything", KEY_VALUE, "ext4", KEY_META, "check/type", "FSType", KEY_END);
+	EXPECT_TRUE (tc.check (k)) << "ext4 should check successfully";
+	k.setString ("auto,swap,xiafs,adfs");
+	EXPECT_TRUE (tc.check (k)) << "list of filesystems should check successfully";
+	k.setString ("ext4,");
+	EXPECT_FALSE (tc.check (k)) << "empty filesystem should fail";
+	k.setString ("ext");
+	EXPECT_TRUE (tc.check (k)) << "ext should check successfully";
+	k.setString ("ext5");
+	EXPECT_FALSE (tc.check (k)) << "ext5 should fail";
+	k.setString ("nfs,ex");
+	EXPECT_FALSE (tc.check (k)) << "prefix of a filesystem should fail";
+	k.setString ("");
+	EXPECT_FALSE (tc.check (k)) << "empty string should fail";
+}
+
+TEST (type, keySet)
+{
+	KeySet config;
+	TypeChecker tc (config);
+
+	// clang-format off
+	KeySet ks (5,
+		*Key ("user/a", KEY_VALUE, "1", KEY_META, "check/type", "short", KEY_END),
+		*Key ("user/b", KEY_VALUE, "", KEY_META, "check/type", "empty short", KEY_END),
+		*Key ("user/c", KEY_VALUE, "1.5", KEY_META, "type", "float", KEY_END),
+		*Key ("user/d", KEY_VALUE, "2", KEY_META, "check/type", "short", KEY_END),
+		*Key ("user/e", KEY_VALUE, "x", KEY_META, "check/type", "unknown short", KEY_END),
+		KS_END);
+	// clang-format on
+
+	ks.rewind ();
+	EXPECT_FALSE (tc.check (ks)) << "user/e should fail";
+	EXPECT_EQ (ks.current ().getName (), "user/e") << "cursor should be at the failing key";
+
+	ks.lookup ("user/e").setString ("3");
+	ks.rewind ();
+	EXPECT_TRUE (tc.check (ks)) << "all keys should check successfully";
+
+	ks.lookup ("user/b").setMeta<string> ("check/type", "short");
+	ks.rewind ();
+	EXPECT_FALSE (tc.check (ks)) << "changed type of user/b should be used";
+}
@@ -10,11 +10,11 @@
 #ifndef ELEKTRA_TYPE_CHECKER_HPP
 #define ELEKTRA_TYPE_CHECKER_HPP
 
-#include <locale>
 #include <map>
-#include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "kdbtypes.h"
 #include "types.hpp"
@@ -29,9 +29,38 @@ using namespace std;
 
 class TypeChecker
 {
+	typedef std::vector<Type *> Checkers;
+
 	std::map<string, Type *> types;
 	bool enforce;
 
+	// type labels already split into their checkers
+	std::unordered_map<string, Checkers> resolved;
+	string lastLabel;
+	Checkers const * lastCheckers = nullptr;
+
+	Checkers const & resolve (const char * label)
+	{
+		if (lastCheckers && lastLabel == label) return *lastCheckers;
+
+		auto it = resolved.find (label);
+		if (it == resolved.end ())
+		{
+			it = resolved.insert (make_pair (string (label), Checkers ())).first;
+			istringstream istr (label);
+			string type;
+			while (istr >> type)
+			{
+				auto t = types.find (type);
+				if (t != types.end ()) it->second.push_back (t->second);
+			}
+		}
+
+		lastLabel = label;
+		lastCheckers = &it->second;
+		return it->second;
+	}
+
 public:
 	explicit TypeChecker (KeySet config)
 	{
@@ -65,15 +94,13 @@ public:
 
 	bool check (Key & k)
 	{
-		Key m = k.getMeta<const Key> ("check/type");
-		if (!m) m = k.getMeta<const Key> ("type");
+		const ckdb::Key * m = ckdb::keyGetMeta (*k, "check/type");
+		if (!m) m = ckdb::keyGetMeta (*k, "type");
 		if (!m) return !enforce;
 
-		istringstream istr (m.getString ());
-		string type;
-		while (istr >> type)
+		for (Type * type : resolve (ckdb::keyString (m)))
 		{
-			if (types[type] && types[type]->check (k)) return true;
+			if (type->check (k)) return true;
 		}
 
 		/* Type could not be checked successfully */
@@ -82,6 +109,10 @@ public:
 
 	bool check (KeySet & ks)
 	{
+		// resolve the type labels once per KeySet
+		resolved.clear ();
+		lastCheckers = nullptr;
+
 		Key k;
 		while ((k = ks.next ()))
 		{
@@ -10,17 +10,18 @@
 #ifndef ELEKTRA_TYPES_HPP
 #define ELEKTRA_TYPES_HPP
 
-#include <locale>
-#include <map>
-#include <set>
-#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include <key.hpp>
 #include <keyset.hpp>
 
-#include <iostream>
-
 
 namespace elektra
 {
@@ -28,17 +29,219 @@ namespace elektra
 using namespace kdb;
 using namespace std;
 
+/**
+ * @brief Character classification as done by the "C" locale
+ *
+ * The parsers below must not depend on the global locale, so they
+ * do not use isspace and isdigit.
+ */
+inline bool isSpace (char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+inline bool isDigit (char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/**
+ * @brief Parse an integer exactly like `istream >> n` in the "C" locale
+ *
+ * Leading whitespace, a sign and leading zeros are accepted. As with
+ * iostreams, a negative value for an unsigned type wraps around.
+ *
+ * @param str the string to parse, it must be consumed completely
+ * @param n the parsed value, only written on success
+ *
+ * @retval true if the string is a number that fits into T
+ * @retval false otherwise
+ */
+template <typename T>
+bool parseInteger (char const * str, T & n)
+{
+	typedef typename make_unsigned<T>::type U;
+
+	while (isSpace (*str))
+		++str;
+	bool const negative = *str == '-';
+	if (negative || *str == '+') ++str;
+	if (!isDigit (*str)) return false;
+
+	// the magnitude of the minimum of a signed type is one larger than its maximum
+	U const limit = static_cast<U> (numeric_limits<T>::max ()) + (negative && is_signed<T>::value ? 1 : 0);
+	U value = 0;
+	do
+	{
+		U const digit = *str - '0';
+		if (value > (limit - digit) / 10) return false;
+		value = value * 10 + digit;
+	} while (isDigit (*++str));
+	if (*str) return false;
+
+	n = static_cast<T> (negative ? static_cast<U> (0 - value) : value);
+	return true;
+}
+
+/**
+ * @brief Parse an integer and check that `ostream << n` yields the same string
+ *
+ * Only the canonical representation is accepted: no whitespace, no plus
+ * sign, no leading zeros, no negative zero and no negative values for
+ * unsigned types.
+ */
+template <typename T>
+bool parseCanonical (char const * str, T & n)
+{
+	char const * digits = is_signed<T>::value && *str == '-' ? str + 1 : str;
+	if (!isDigit (*digits)) return false;
+	if (*digits == '0' && (digits != str || digits[1])) return false;
+	return parseInteger (str, n);
+}
+
+/**
+ * @brief Parse a value like `istream >> n` in the "C" locale
+ */
+template <typename T>
+bool parseNumber (char const * str, T & n)
+{
+	return parseInteger (str, n);
+}
+
+template <>
+inline bool parseNumber (char const * str, bool & n)
+{
+	// iostreams read booleans as long and only accept 0 and 1
+	long l;
+	if (!parseInteger (str, l) || (l != 0 && l != 1)) return false;
+	n = l == 1;
+	return true;
+}
+
+inline float toFloatingPoint (char const * str, float)
+{
+	return strtof (str, nullptr);
+}
+
+inline double toFloatingPoint (char const * str, double)
+{
+	return strtod (str, nullptr);
+}
+
+inline long double toFloatingPoint (char const * str, long double)
+{
+	return strtold (str, nullptr);
+}
+
+/**
+ * @brief Check if `istream >> n` would read a floating point number in the "C" locale
+ *
+ * Like iostreams, values that overflow are rejected, values that underflow
+ * are not. So only the syntax needs to be checked here, as long as the
+ * magnitude of the number is clearly within the range of T. Only numbers
+ * close to or beyond the range are converted with strtod. As strtod depends
+ * on the decimal point of the global locale, they are passed without
+ * decimal point and with an adjusted exponent.
+ */
+template <typename T>
+bool checkFloatingPoint (char const * str)
+{
+	while (isSpace (*str))
+		++str;
+	bool const negative = *str == '-';
+	if (negative || *str == '+') ++str;
+
+	char const * point = nullptr;
+	char const * first = nullptr; // first significant digit
+	bool mantissa = false;
+	for (;; ++str)
+	{
+		if (isDigit (*str))
+		{
+			mantissa = true;
+			if (!first && *str != '0') first = str;
+		}
+		else if (*str == '.' && !point)
+			point = str;
+		else
+			break;
+	}
+	if (!mantissa) return false;
+
+	char const * const exponent = str;
+	long e = 0;
+	if (*str == 'e' || *str == 'E')
+	{
+		++str;
+		bool const negativeExponent = *str == '-';
+		if (negativeExponent || *str == '+') ++str;
+		if (!isDigit (*str)) return false;
+		do
+		{
+			// saturate, such exponents are far beyond the range of any T
+			if (e < 100000000L) e = e * 10 + (*str - '0');
+		} while (isDigit (*++str));
+		if (negativeExponent) e = -e;
+	}
+	if (*str) return false;
+
+	if (!first) return true; // zero
+
+	// the number is below 10^magnitude
+	char const * const integerEnd = point ? point : exponent;
+	long const magnitude = (integerEnd - first) + (first < integerEnd ? 0 : 1) + e;
+	if (magnitude <= numeric_limits<T>::max_exponent10) return true;
+
+	string normalized (negative ? "-" : "");
+	for (char const * digit = first; digit != exponent; ++digit)
+	{
+		if (*digit != '.') normalized += *digit;
+	}
+	normalized += 'e';
+	normalized += to_string (magnitude - static_cast<long> (normalized.size () - (negative ? 2 : 1)));
+
+	return !isinf (toFloatingPoint (normalized.c_str (), T ()));
+}
+
+/**
+ * @brief Check if `istream >> n` would read a value of type T, specialized per type
+ */
+template <typename T>
+bool checkNumber (char const * str)
+{
+	T n;
+	return parseNumber (str, n);
+}
+
+template <>
+inline bool checkNumber<float> (char const * str)
+{
+	return checkFloatingPoint<float> (str);
+}
+
+template <>
+inline bool checkNumber<double> (char const * str)
+{
+	return checkFloatingPoint<double> (str);
+}
+
+template <>
+inline bool checkNumber<long double> (char const * str)
+{
+	return checkFloatingPoint<long double> (str);
+}
+
 class Type
 {
 public:
-	virtual bool check (Key k) = 0;
+	virtual bool check (Key const & k) = 0;
 	virtual ~Type ();
 };
 
 class AnyType : public Type
 {
 public:
-	bool check (Key) override
+	bool check (Key const &) override
 	{
 		return true;
 	}
@@ -47,7 +250,7 @@ public:
 class EmptyType : public Type
 {
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
 		return k.getString ().empty ();
 	}
@@ -56,7 +259,7 @@ public:
 class CharType : public Type
 {
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
 		return k.getString ().length () == 1;
 	}
@@ -65,7 +268,7 @@ public:
 class StringType : public Type
 {
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
 		return !k.getString ().empty ();
 	}
@@ -75,16 +278,9 @@ template <typename T>
 class TType : public Type
 {
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
-		istringstream i (k.getString ());
-		i.imbue (locale ("C"));
-		T n;
-		i >> n;
-		if (i.bad ()) return false;
-		if (i.fail ()) return false;
-		if (!i.eof ()) return false;
-		return true;
+		return checkNumber<T> (ckdb::keyString (*k));
 	}
 };
 
@@ -97,22 +293,13 @@ public:
 template <typename T>
 class RType : public Type
 {
+	static_assert (is_integral<T>::value, "only integers have a canonical representation");
+
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
-		istringstream i (k.getString ());
-		i.imbue (locale ("C"));
 		T n;
-		i >> n;
-		if (i.bad ()) return false;
-		if (i.fail ()) return false;
-		if (!i.eof ()) return false;
-
-		ostringstream o;
-		o << n;
-		if (o.str () != k.getString ()) return false;
-
-		return true;
+		return parseCanonical (ckdb::keyString (*k), n);
 	}
 };
 
@@ -125,46 +312,27 @@ public:
 template <typename T>
 class MType : public Type
 {
+	static_assert (is_integral<T>::value, "only integers have a canonical representation");
+
 public:
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
-		istringstream i (k.getString ());
-		i.imbue (locale ("C"));
 		T n;
-		i >> n;
-		if (i.bad ()) return false;
-		if (i.fail ()) return false;
-		if (!i.eof ()) return false;
-
-		ostringstream o;
-		o.imbue (locale ("C"));
-		o << n;
-		if (o.fail ()) return false;
-		if (o.str () != k.getString ()) return false;
-
-		Key const min = k.getMeta<const Key> ("check/type/min");
+		if (!parseCanonical (ckdb::keyString (*k), n)) return false;
+
+		const ckdb::Key * min = ckdb::keyGetMeta (*k, "check/type/min");
 		if (min)
 		{
-			istringstream i_min (min.getString ());
-			i_min.imbue (locale ("C"));
 			T n_min;
-			i_min >> n_min;
-			if (i_min.bad ()) return false;
-			if (i_min.fail ()) return false;
-			if (!i_min.eof ()) return false;
+			if (!parseNumber (ckdb::keyString (min), n_min)) return false;
 			if (n < n_min) return false;
 		}
 
-		Key const max = k.getMeta<const Key> ("check/type/max");
+		const ckdb::Key * max = ckdb::keyGetMeta (*k, "check/type/max");
 		if (max)
 		{
-			istringstream i_max (max.getString ());
-			i_max.imbue (locale ("C"));
 			T n_max;
-			i_max >> n_max;
-			if (i_max.bad ()) return false;
-			if (i_max.fail ()) return false;
-			if (!i_max.eof ()) return false;
+			if (!parseNumber (ckdb::keyString (max), n_max)) return false;
 			if (n > n_max) return false;
 		}
 
@@ -174,75 +342,73 @@ public:
 
 class FSType : public Type
 {
-	std::set<std::string> choices;
+	// sorted, so that the labels can be searched without copying them
+	std::vector<std::string> choices;
 
 public:
 	FSType ()
 	{
-		choices.insert ("auto");
-		choices.insert ("swap");
-		choices.insert ("adfs");
-		choices.insert ("affs");
-		choices.insert ("autofs");
-		choices.insert ("cifs");
-		choices.insert ("coda");
-		choices.insert ("coherent");
-		choices.insert ("cramfs");
-		choices.insert ("debugfs");
-		choices.insert ("devpts");
-		choices.insert ("efs");
-		choices.insert ("ext");
-		choices.insert ("ext2");
-		choices.insert ("ext3");
-		choices.insert ("ext4");
-		choices.insert ("hfs");
-		choices.insert ("hfsplus");
-		choices.insert ("hpfs");
-		choices.insert ("iso9660");
-		choices.insert ("jfs");
-		choices.insert ("minix");
-		choices.insert ("msdos");
-		choices.insert ("ncpfs");
-		choices.insert ("nfs");
-		choices.insert ("nfs4");
-		choices.insert ("ntfs");
-		choices.insert ("proc");
-		choices.insert ("qnx4");
-		choices.insert ("ramfs");
-		choices.insert ("reiserfs");
-		choices.insert ("romfs");
-		choices.insert ("smbfs");
-		choices.insert ("sysv");
-		choices.insert ("tmpfs");
-		choices.insert ("udf");
-		choices.insert ("ufs");
-		choices.insert ("umsdos");
-		choices.insert ("usbfs");
-		choices.insert ("vfat");
-		choices.insert ("xenix");
-		choices.insert ("xfs");
-		choices.insert ("xiafs");
+		choices.push_back ("auto");
+		choices.push_back ("swap");
+		choices.push_back ("adfs");
+		choices.push_back ("affs");
+		choices.push_back ("autofs");
+		choices.push_back ("cifs");
+		choices.push_back ("coda");
+		choices.push_back ("coherent");
+		choices.push_back ("cramfs");
+		choices.push_back ("debugfs");
+		choices.push_back ("devpts");
+		choices.push_back ("efs");
+		choices.push_back ("ext");
+		choices.push_back ("ext2");
+		choices.push_back ("ext3");
+		choices.push_back ("ext4");
+		choices.push_back ("hfs");
+		choices.push_back ("hfsplus");
+		choices.push_back ("hpfs");
+		choices.push_back ("iso9660");
+		choices.push_back ("jfs");
+		choices.push_back ("minix");
+		choices.push_back ("msdos");
+		choices.push_back ("ncpfs");
+		choices.push_back ("nfs");
+		choices.push_back ("nfs4");
+		choices.push_back ("ntfs");
+		choices.push_back ("proc");
+		choices.push_back ("qnx4");
+		choices.push_back ("ramfs");
+		choices.push_back ("reiserfs");
+		choices.push_back ("romfs");
+		choices.push_back ("smbfs");
+		choices.push_back ("sysv");
+		choices.push_back ("tmpfs");
+		choices.push_back ("udf");
+		choices.push_back ("ufs");
+		choices.push_back ("umsdos");
+		choices.push_back ("usbfs");
+		choices.push_back ("vfat");
+		choices.push_back ("xenix");
+		choices.push_back ("xfs");
+		choices.push_back ("xiafs");
+		sort (choices.begin (), choices.end ());
 	}
 
-	bool check (Key k) override
+	bool check (Key const & k) override
 	{
-		std::string label = k.getString ();
-		size_t oldpos = 0;
-		size_t pos = label.find (',');
-		;
-		while (pos != string::npos)
+		char const * label = ckdb::keyString (*k);
+		for (;;)
 		{
-			std::string type = label.substr (oldpos, pos - oldpos);
-			if (choices.find (type) == choices.end ()) return false;
+			char const * end = strchr (label, ',');
+			size_t const length = end ? static_cast<size_t> (end - label) : strlen (label);
+			auto choice = lower_bound (choices.begin (), choices.end (), label, [length](string const & c, char const * l) {
+				return c.compare (0, string::npos, l, length) < 0;
+			});
+			if (choice == choices.end () || choice->compare (0, string::npos, label, length) != 0) return false;
 
-			oldpos = pos + 1;
-			pos = label.find (',', oldpos);
+			if (!end) return true;
+			label = end + 1;
 		}
-
-		std::string lastType = label.substr (oldpos, string::npos);
-		if (choices.find (lastType) == choices.end ()) return false;
-
-		return true;
 	}
 };
 
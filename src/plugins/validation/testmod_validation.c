@@ -246,6 +246,120 @@ void icase_test (void)
 	PLUGIN_CLOSE ();
 }
 
+static void test_cache (void)
+{
+	Key * parentKey = keyNew ("user/tests/validation", KEY_VALUE, "", KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("validation");
+
+	KeySet * ks = ksNew (0, KS_END);
+	for (int i = 0; i < 100; ++i)
+	{
+		char name[64];
+		snprintf (name, sizeof (name), "user/tests/validation/key%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, i % 2 ? "word" : "1234", KEY_META, "check/validation", i % 2 ? "^[a-z]+$" : "^[0-9]+$",
+					 KEY_END));
+	}
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+
+	ValidationStatistics statistics;
+	elektraValidationStatistics (plugin, &statistics);
+	succeed_if (statistics.misses == 2, "every pattern should be compiled once");
+	succeed_if (statistics.hits == 198, "other validations should use the cache");
+	succeed_if (statistics.evictions == 0, "cache should not evict");
+	succeed_if (statistics.size == 2, "cache should contain both patterns");
+
+	keySetString (ksLookupByName (ks, "user/tests/validation/key2", 0), "no number");
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == -1, "cached pattern should reject invalid value");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_cacheSize (void)
+{
+	Key * parentKey = keyNew ("user/tests/validation", KEY_VALUE, "", KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("user/cache/size", KEY_VALUE, "2", KEY_END), KS_END);
+	PLUGIN_OPEN ("validation");
+
+	const char * patterns[] = { "^a$", "^b$", "^c$", "^a$" };
+	const char * values[] = { "a", "b", "c", "a" };
+	for (int i = 0; i < 4; ++i)
+	{
+		KeySet * ks = ksNew (1, keyNew ("user/tests/validation/key", KEY_VALUE, values[i], KEY_META, "check/validation", patterns[i], KEY_END),
+				     KS_END);
+		ksRewind (ks);
+		succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+		ksDel (ks);
+	}
+
+	ValidationStatistics statistics;
+	elektraValidationStatistics (plugin, &statistics);
+	succeed_if (statistics.misses == 4, "evicted pattern should be compiled again");
+	succeed_if (statistics.evictions == 2, "cache should evict least recently used patterns");
+	succeed_if (statistics.size == 2, "cache should not grow beyond its size");
+
+	KeySet * ks = ksNew (1, keyNew ("user/tests/validation/key", KEY_VALUE, "a", KEY_META, "check/validation", "(", KEY_END), KS_END);
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == -1, "invalid pattern should be rejected");
+	elektraValidationStatistics (plugin, &statistics);
+	succeed_if (statistics.size == 2, "invalid pattern should not be cached");
+	ksDel (ks);
+
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_cacheDisabled (void)
+{
+	Key * parentKey = keyNew ("user/tests/validation", KEY_VALUE, "", KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("user/cache/size", KEY_VALUE, "0", KEY_END), KS_END);
+	PLUGIN_OPEN ("validation");
+
+	KeySet * ks = ksNew (2, keyNew ("user/tests/validation/a", KEY_VALUE, "a", KEY_META, "check/validation", "^a$", KEY_END),
+			     keyNew ("user/tests/validation/b", KEY_VALUE, "a", KEY_META, "check/validation", "^a$", KEY_END), KS_END);
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+
+	ValidationStatistics statistics;
+	elektraValidationStatistics (plugin, &statistics);
+	succeed_if (statistics.hits == 0 && statistics.misses == 0 && statistics.size == 0, "disabled cache should not be used");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_cacheInvalidSize (void)
+{
+	const char * sizes[] = { "-1", "abc", "", "2x", " 2", "99999999999999999999999", "100000000" };
+	for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+	{
+		Key * parentKey = keyNew ("user/tests/validation", KEY_VALUE, "", KEY_END);
+		KeySet * conf = ksNew (1, keyNew ("user/cache/size", KEY_VALUE, sizes[i], KEY_END), KS_END);
+		PLUGIN_OPEN ("validation");
+
+		KeySet * ks =
+			ksNew (2, keyNew ("user/tests/validation/a", KEY_VALUE, "a", KEY_META, "check/validation", "^a$", KEY_END),
+			       keyNew ("user/tests/validation/b", KEY_VALUE, "a", KEY_META, "check/validation", "^a$", KEY_END), KS_END);
+		ksRewind (ks);
+		succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+
+		ValidationStatistics statistics;
+		elektraValidationStatistics (plugin, &statistics);
+		succeed_if (statistics.hits == 1 && statistics.misses == 1 && statistics.size == 1, "invalid cache size should not disable cache");
+
+		ksDel (ks);
+		keyDel (parentKey);
+		PLUGIN_CLOSE ();
+	}
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -261,6 +375,12 @@ int main (int argc, char ** argv)
 	line_test ();
 	icase_test ();
 	invert_test ();
+
+	test_cache ();
+	test_cacheSize ();
+	test_cacheDisabled ();
+	test_cacheInvalidSize ();
+
 	print_result ("testmod_validation");
 
 	return nbError;
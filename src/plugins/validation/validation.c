@@ -10,15 +10,212 @@
 #include "kdbconfig.h"
 #endif
 
-#include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "validation.h"
 
+#include <kdblogger.h>
+
+#define DEFAULT_CACHE_SIZE 64
+#define MAX_CACHE_SIZE 4096
+
+typedef struct
+{
+	char * pattern;
+	int cflags;
+	regex_t * regex; // allocated, regex_t might not be relocatable
+	size_t lastUse;
+} CacheEntry;
+
+/**
+ * Compiled regular expressions of a plugin instance, so that patterns
+ * used by many keys are only compiled once.
+ */
+typedef struct
+{
+	CacheEntry * entries;
+	size_t size;
+	size_t capacity;
+	size_t last; // the entry returned last, consecutive keys often use the same pattern
+	size_t clock;
+	ValidationStatistics statistics;
+} RegexCache;
+
 static int validateKey (Key *, Key *);
 
+/**
+ * @return the configured cache size, invalid sizes give the default and too large sizes the maximum
+ */
+static size_t getCacheSize (KeySet * config)
+{
+	Key * sizeKey = ksLookupByName (config, "/cache/size", 0);
+	if (!sizeKey) return DEFAULT_CACHE_SIZE;
+
+	const char * size = keyString (sizeKey);
+	char * end;
+	errno = 0;
+	unsigned long long capacity = strtoull (size, &end, 10);
+	if (*size < '0' || *size > '9' || *end != '\0')
+	{
+		ELEKTRA_LOG_WARNING ("invalid cache/size %s, using %d", size, DEFAULT_CACHE_SIZE);
+		return DEFAULT_CACHE_SIZE;
+	}
+	if (errno == ERANGE || capacity > MAX_CACHE_SIZE)
+	{
+		ELEKTRA_LOG_WARNING ("cache/size %s too large, using %d", size, MAX_CACHE_SIZE);
+		return MAX_CACHE_SIZE;
+	}
+	return capacity;
+}
+
+int elektraValidationOpen (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	RegexCache * cache = elektraCalloc (sizeof (RegexCache));
+	if (!cache) return 1; // patterns are compiled for every key then
+
+	cache->capacity = getCacheSize (elektraPluginGetConfig (handle));
+	if (cache->capacity > 0) cache->entries = elektraCalloc (cache->capacity * sizeof (CacheEntry));
+	if (!cache->entries) cache->capacity = 0;
+	elektraPluginSetData (handle, cache);
+	return 1;
+}
+
+int elektraValidationClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	RegexCache * cache = elektraPluginGetData (handle);
+	if (!cache) return 1;
+	ELEKTRA_LOG_DEBUG ("regex cache: %zu hits, %zu misses, %zu evictions", cache->statistics.hits, cache->statistics.misses,
+			   cache->statistics.evictions);
+	for (size_t i = 0; i < cache->size; ++i)
+	{
+		regfree (cache->entries[i].regex);
+		elektraFree (cache->entries[i].regex);
+		elektraFree (cache->entries[i].pattern);
+	}
+	elektraFree (cache->entries);
+	elektraFree (cache);
+	elektraPluginSetData (handle, NULL);
+	return 1;
+}
+
+/**
+ * @brief Get the statistics of the regex cache of a plugin instance
+ *
+ * @param handle the validation plugin
+ * @param statistics is filled with the number of cache hits, misses, evictions and compiled patterns
+ */
+void elektraValidationStatistics (Plugin * handle, ValidationStatistics * statistics)
+{
+	RegexCache * cache = elektraPluginGetData (handle);
+	memset (statistics, 0, sizeof (ValidationStatistics));
+	if (!cache) return;
+	*statistics = cache->statistics;
+	statistics->size = cache->size;
+}
+
+static CacheEntry * cacheLookup (RegexCache * cache, const char * pattern, int cflags)
+{
+	if (cache->size > 0)
+	{
+		CacheEntry * entry = &cache->entries[cache->last];
+		if (entry->cflags == cflags && !strcmp (entry->pattern, pattern)) return entry;
+	}
+	for (size_t i = 0; i < cache->size; ++i)
+	{
+		CacheEntry * entry = &cache->entries[i];
+		if (entry->cflags == cflags && !strcmp (entry->pattern, pattern))
+		{
+			cache->last = i;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @param regex an allocated compiled pattern
+ *
+ * @return the new entry owning regex, or NULL if the pattern could not be copied (regex stays with the caller then)
+ */
+static CacheEntry * cacheInsert (RegexCache * cache, const char * pattern, int cflags, regex_t * regex)
+{
+	char * copy = elektraStrDup (pattern);
+	if (!copy) return NULL;
+
+	size_t pos = cache->size;
+	if (cache->size == cache->capacity)
+	{
+		// evict the least recently used pattern
+		pos = 0;
+		for (size_t i = 1; i < cache->size; ++i)
+		{
+			if (cache->entries[i].lastUse < cache->entries[pos].lastUse) pos = i;
+		}
+		regfree (cache->entries[pos].regex);
+		elektraFree (cache->entries[pos].regex);
+		elektraFree (cache->entries[pos].pattern);
+		++cache->statistics.evictions;
+	}
+	else
+	{
+		++cache->size;
+	}
+
+	CacheEntry * entry = &cache->entries[pos];
+	entry->pattern = copy;
+	entry->cflags = cflags;
+	entry->regex = regex;
+	cache->last = pos;
+	return entry;
+}
+
+/**
+ * @brief Compile pattern or get it from the cache
+ *
+ * @param cache the cache to use, or NULL to always compile
+ * @param buffer used for patterns that are not cached
+ * @param ret is set to the result of regcomp
+ *
+ * @return the compiled pattern, which has to be freed with regfree if it is buffer
+ */
+static regex_t * compileRegex (RegexCache * cache, const char * pattern, int cflags, regex_t * buffer, int * ret)
+{
+	*ret = 0;
+	if (!cache || cache->capacity == 0)
+	{
+		*ret = regcomp (buffer, pattern, cflags);
+		return buffer;
+	}
+
+	CacheEntry * entry = cacheLookup (cache, pattern, cflags);
+	if (entry)
+	{
+		++cache->statistics.hits;
+	}
+	else
+	{
+		++cache->statistics.misses;
+		regex_t * compiled = elektraMalloc (sizeof (regex_t));
+		if (compiled && regcomp (compiled, pattern, cflags) == 0)
+		{
+			entry = cacheInsert (cache, pattern, cflags, compiled);
+			if (!entry) regfree (compiled);
+		}
+		if (!entry)
+		{
+			// invalid patterns and memory errors: compile again into buffer, which the caller frees
+			elektraFree (compiled);
+			*ret = regcomp (buffer, pattern, cflags);
+			return buffer;
+		}
+	}
+	entry->lastUse = ++cache->clock;
+	return entry->regex;
+}
+
 int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey ELEKTRA_UNUSED)
 {
 	KeySet * n;
@@ -26,6 +223,8 @@ int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 		  n = ksNew (30,
 			     keyNew ("system/elektra/modules/validation", KEY_VALUE, "validation plugin waits for your orders", KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports", KEY_END),
+			     keyNew ("system/elektra/modules/validation/exports/open", KEY_FUNC, elektraValidationOpen, KEY_END),
+			     keyNew ("system/elektra/modules/validation/exports/close", KEY_FUNC, elektraValidationClose, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/get", KEY_FUNC, elektraValidationGet, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/set", KEY_FUNC, elektraValidationSet, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/ksLookupRE", KEY_FUNC, ksLookupRE, KEY_END),
@@ -36,7 +235,7 @@ int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 	return 1;
 }
 
-static int validateKey (Key * key, Key * parentKey)
+static int validateKeyCached (RegexCache * cache, Key * key, Key * parentKey)
 {
 	const Key * regexMeta = keyGetMeta (key, "check/validation");
 
@@ -54,21 +253,14 @@ static int validateKey (Key * key, Key * parentKey)
 	if (invertMeta) invertValidation = 1;
 	if (matchMeta)
 	{
-		char * matchCopy = elektraStrDup (keyString (matchMeta));
-		char * ptr = matchCopy;
-		while (*ptr)
-		{
-			*ptr = toupper (*ptr);
-			++ptr;
-		}
-		if (!strcmp (matchCopy, "LINE")) lineValidation = 1;
-		if (!strcmp (matchCopy, "WORD")) wordValidation = 1;
-		if (!strcmp (matchCopy, "ANY"))
+		const char * matchString = keyString (matchMeta);
+		if (!elektraStrCaseCmp (matchString, "LINE")) lineValidation = 1;
+		if (!elektraStrCaseCmp (matchString, "WORD")) wordValidation = 1;
+		if (!elektraStrCaseCmp (matchString, "ANY"))
 		{
 			lineValidation = 0;
 			wordValidation = 0;
 		}
-		elektraFree (matchCopy);
 	}
 
 	int cflags = REG_NOSUB | REG_EXTENDED;
@@ -76,18 +268,11 @@ static int validateKey (Key * key, Key * parentKey)
 	if (lineValidation) cflags |= REG_NEWLINE;
 	if (typeMeta)
 	{
-		char * typeCopy = elektraStrDup (keyString (typeMeta));
-		char * ptr = typeCopy;
-		while (*ptr)
-		{
-			*ptr = toupper (*ptr);
-			++ptr;
-		}
-		if (!strcmp (typeCopy, "ERE"))
+		const char * typeString = keyString (typeMeta);
+		if (!elektraStrCaseCmp (typeString, "ERE"))
 			cflags |= REG_EXTENDED;
-		else if (!strcmp (typeCopy, "BRE"))
+		else if (!elektraStrCaseCmp (typeString, "BRE"))
 			cflags &= REG_EXTENDED;
-		elektraFree (typeCopy);
 	}
 
 	char * regexString = NULL;
@@ -103,23 +288,24 @@ static int validateKey (Key * key, Key * parentKey)
 		regexString = (char *) keyString (regexMeta);
 	}
 
-	regex_t regex;
+	regex_t buffer;
 	regmatch_t offsets;
-	int ret = regcomp (&regex, regexString, cflags);
+	int ret;
+	regex_t * regex = compileRegex (cache, regexString, cflags, &buffer, &ret);
+	if (freeString) elektraFree (regexString);
 
 	if (ret != 0)
 	{
-		char buffer[1000];
-		regerror (ret, &regex, buffer, 999);
-		ELEKTRA_SET_ERROR (41, parentKey, buffer);
-		regfree (&regex);
-		if (freeString) elektraFree (regexString);
+		char message[1000];
+		regerror (ret, regex, message, 999);
+		ELEKTRA_SET_ERROR (41, parentKey, message);
+		regfree (regex);
 		return 0;
 	}
 	int match = 0;
 	if (!wordValidation)
 	{
-		ret = regexec (&regex, keyString (key), 1, &offsets, 0);
+		ret = regexec (regex, keyString (key), 1, &offsets, 0);
 		if (ret == 0) match = 1;
 	}
 	else
@@ -129,7 +315,7 @@ static int validateKey (Key * key, Key * parentKey)
 		char * string = (char *) keyString (key);
 		while ((token = strtok_r (string, " \t\n", &savePtr)) != NULL)
 		{
-			ret = regexec (&regex, token, 1, &offsets, 0);
+			ret = regexec (regex, token, 1, &offsets, 0);
 			if (ret == 0)
 			{
 				match = 1;
@@ -146,28 +332,27 @@ static int validateKey (Key * key, Key * parentKey)
 		if (msg)
 		{
 			ELEKTRA_SET_ERROR (42, parentKey, keyString (msg));
-			regfree (&regex);
-			if (freeString) elektraFree (regexString);
-			return 0;
 		}
 		else
 		{
-			char buffer[1000];
-			regerror (ret, &regex, buffer, 999);
-			ELEKTRA_SET_ERROR (42, parentKey, buffer);
-			regfree (&regex);
-			if (freeString) elektraFree (regexString);
-			return 0;
+			char message[1000];
+			regerror (ret, regex, message, 999);
+			ELEKTRA_SET_ERROR (42, parentKey, message);
 		}
 	}
 
-	regfree (&regex);
-	if (freeString) elektraFree (regexString);
-	return 1;
+	if (regex == &buffer) regfree (regex);
+	return match;
+}
+
+static int validateKey (Key * key, Key * parentKey)
+{
+	return validateKeyCached (NULL, key, parentKey);
 }
 
-int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+int elektraValidationSet (Plugin * handle, KeySet * returned, Key * parentKey)
 {
+	RegexCache * cache = elektraPluginGetData (handle);
 	Key * cur = 0;
 
 	while ((cur = ksNext (returned)) != 0)
@@ -175,7 +360,7 @@ int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 		const Key * regexMeta = keyGetMeta (cur, "check/validation");
 
 		if (!regexMeta) continue;
-		int rc = validateKey (cur, parentKey);
+		int rc = validateKeyCached (cache, cur, parentKey);
 		if (!rc) return -1;
 	}
 
@@ -186,6 +371,8 @@ Plugin * ELEKTRA_PLUGIN_EXPORT (validation)
 {
 	// clang-format off
 	return elektraPluginExport("validation",
+			ELEKTRA_PLUGIN_OPEN,	&elektraValidationOpen,
+			ELEKTRA_PLUGIN_CLOSE,	&elektraValidationClose,
 			ELEKTRA_PLUGIN_GET,	&elektraValidationGet,
 			ELEKTRA_PLUGIN_SET,	&elektraValidationSet,
 			ELEKTRA_PLUGIN_END);
@@ -15,12 +15,26 @@
 #include <kdberrors.h>
 #include <kdbplugin.h>
 
+typedef struct
+{
+	// validations that used an already compiled pattern
+	size_t hits;
+	// validations that had to compile their pattern
+	size_t misses;
+	// compiled patterns freed to stay within the cache size
+	size_t evictions;
+	// compiled patterns currently in the cache
+	size_t size;
+} ValidationStatistics;
+
 int elektraValidationOpen (Plugin * handle, Key * errorKey);
 int elektraValidationClose (Plugin * handle, Key * errorKey);
 int elektraValidationGet (Plugin * handle, KeySet * ks, Key * parentKey);
 int elektraValidationSet (Plugin * handle, KeySet * ks, Key * parentKey);
 int elektraValidationError (Plugin * handle, KeySet * ks, Key * parentKey);
 
+void elektraValidationStatistics (Plugin * handle, ValidationStatistics * statistics);
+
 Key * ksLookupRE (KeySet * ks, const regex_t * regexp);
 
 Plugin * ELEKTRA_PLUGIN_EXPORT (validation);
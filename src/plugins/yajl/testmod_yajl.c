@@ -539,6 +539,51 @@ void test_readWrite (const char * fileName, KeySet * conf)
 	elektraPluginClose (plugin, 0);
 }
 
+void test_largeArray (void)
+{
+	printf ("Test large array\n");
+
+	Plugin * plugin = elektraPluginOpen ("yajl", modules, ksNew (0, KS_END), 0);
+	exit_if_fail (plugin != 0, "could not open plugin");
+
+	KeySet * keys = ksNew (0, KS_END);
+	ksAppendKey (keys, keyNew ("user/tests/yajl", KEY_END));
+	ksAppendKey (keys, keyNew ("user/tests/yajl/array", KEY_END));
+	char name[64];
+	char value[32];
+	for (int i = 0; i < 20000; ++i)
+	{
+		strcpy (name, "user/tests/yajl/array/");
+		elektraWriteArrayNumber (name + strlen (name), i);
+		snprintf (value, sizeof (value), "%d", i);
+		if (i % 100 == 0)
+		{
+			ksAppendKey (keys, keyNew (name, KEY_END));
+			strcat (name, "/map");
+		}
+		ksAppendKey (keys, keyNew (name, KEY_VALUE, value, KEY_META, "type", "double", KEY_END));
+	}
+	ksAppendKey (keys, keyNew ("user/tests/yajl/last", KEY_VALUE, "true", KEY_META, "type", "boolean", KEY_END));
+
+	Key * parentKey = keyNew ("user/tests/yajl", KEY_VALUE, elektraFilename (), KEY_END);
+	succeed_if (plugin->kdbSet (plugin, keys, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (output_error (parentKey), "error in kdbSet");
+	succeed_if (output_warnings (parentKey), "warnings in kdbSet");
+
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 1, "kdbGet was not successful");
+	succeed_if (output_error (parentKey), "error in kdbGet");
+	succeed_if (output_warnings (parentKey), "warnings in kdbGet");
+	compare_keyset (read, keys);
+
+	elektraUnlink (keyString (parentKey));
+	keyDel (parentKey);
+	ksDel (read);
+	ksDel (keys);
+
+	elektraPluginClose (plugin, 0);
+}
+
 // TODO: make nicer and put to test framework
 #define succeed_if_equal(x, y) succeed_if (!strcmp (x, y), x)
 
@@ -748,6 +793,7 @@ int main (int argc, char ** argv)
 	test_json ("yajl/testdata_array.json", getArrayKeys (), ksNew (0, KS_END));
 	test_json ("yajl/testdata_below.json", getBelowKeys (), ksNew (0, KS_END));
 	test_json ("yajl/OpenICC_device_config_DB.json", getOpenICCKeys (), ksNew (0, KS_END));
+	test_largeArray ();
 
 	// TODO currently do not have a KeySet, wait for C-plugin to make
 	// it easy to generate it..
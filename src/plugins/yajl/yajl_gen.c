@@ -11,112 +11,135 @@
 #include <errno.h>
 
 
+/** Number of levels the buffers of a generator can hold initially */
+#define ELEKTRA_GEN_MIN_LEVELS 16
+
 /**
- * @brief Return the first character of next name level
- *
- * @pre it must be safe to look at pnext+size
- * @pre string must be null terminated
+ * @brief One level of an escaped key name.
+ */
+typedef struct
+{
+	const char * name;
+	size_t size;
+} ElektraGenLevel;
+
+/**
+ * @brief State of the generation of a KeySet.
  *
- * @param pnext pointer to current level
- * @param size size of name in that level
+ * The levels of the previous key are kept, so that the maps and
+ * arrays to close and open only need a comparison with the levels
+ * of the next key.
+ */
+typedef struct
+{
+	yajl_gen g;
+	Key * parentKey;
+	ElektraGenLevel * levels;	/*!< levels of the current key */
+	ElektraGenLevel * previous;	/*!< levels of the previous key */
+	size_t size;			/*!< number of levels of the current key */
+	size_t previousSize;		/*!< number of levels of the previous key */
+	size_t alloc;			/*!< levels both buffers can hold */
+	int * arrays;			/*!< per level: 1 if an array is open, 0 if a map is open */
+	size_t open;			/*!< number of the open maps and arrays */
+	size_t skip;			/*!< levels of the name of the parentKey */
+} ElektraGenContext;
+
+/**
+ * @brief Splits the name of a key into its levels.
  *
- * @return #lookahead
+ * @retval 0 on success
+ * @retval -1 on memory errors
  */
-lookahead_t elektraLookahead (const char * pnext, size_t size)
+static int elektraGenSplit (ElektraGenContext * context, const Key * key)
 {
-	lookahead_t lookahead = LOOKAHEAD_END; // found end
-	if (*(pnext + size) == '/')
+	const char * name = keyName (key);
+	size_t size = 0;
+
+	context->size = 0;
+	while (*(name = keyNameGetOneLevel (name + size, &size)))
 	{
-		// we are not at end, so we can look one further
-		if (*(pnext + size + 1) == '#')
+		if (context->size == context->alloc)
 		{
-			if (!strcmp (pnext + size + 1, "###empty_array"))
-			{
-				lookahead = LOOKAHEAD_EMPTY_ARRAY;
-			}
-			else
+			size_t alloc = context->alloc ? context->alloc * 2 : ELEKTRA_GEN_MIN_LEVELS;
+			if (elektraRealloc ((void **) &context->levels, alloc * sizeof (ElektraGenLevel)) == -1 ||
+			    elektraRealloc ((void **) &context->previous, alloc * sizeof (ElektraGenLevel)) == -1 ||
+			    elektraRealloc ((void **) &context->arrays, alloc * sizeof (int)) == -1)
 			{
-				lookahead = LOOKAHEAD_ARRAY;
-			}
-		}
-		else
-		{
-			if (!strcmp (pnext + size + 1, "___empty_map"))
-			{
-				lookahead = LOOKAHEAD_EMPTY_MAP;
-			}
-			else
-			{
-				lookahead = LOOKAHEAD_MAP;
+				return -1;
 			}
+			context->alloc = alloc;
 		}
+		context->levels[context->size].name = name;
+		context->levels[context->size].size = size;
+		++context->size;
 	}
+	return 0;
+}
 
-	// / and not NULL for nice printing
-	return lookahead; // found End
+/**
+ * @retval 1 if the level is the marker of an empty map or array
+ * @retval 0 otherwise
+ */
+static int elektraGenIsMarker (const ElektraGenLevel * level)
+{
+	return (level->size == sizeof ("###empty_array") - 1 && !strncmp (level->name, "###empty_array", level->size)) ||
+	       (level->size == sizeof ("___empty_map") - 1 && !strncmp (level->name, "___empty_map", level->size));
 }
 
 /**
- * @brief Implements special handling for last element of key name
- *
- * @pre g is in a map or array
- *
- * @post g need value as next step
- *
- * (L1)
- * #/_
- * If # is in the same counter stage, we just have to yield the name
- *
- * If # is in a new counter stage elektraGenOpenFirst already has
- * yield the map, so we also just have to yield the name
- *
- * (L2)
- * /#
- * does nothing (even for #/# the array was already done because of
- * lookahead)
- *
- * (L3)
- * /_
- * yields the name for the value
- *
- * @param g the generator
- * @param next the key
- * @retval 0 no value needed afterwards
- * @retval 1 value is needed
+ * @brief Yields the name of the entry at @p level if it is within a map.
  */
-static int elektraGenOpenValue (yajl_gen g, const Key * next)
+static void elektraGenName (ElektraGenContext * context, size_t level)
 {
-	keyNameReverseIterator last = elektraKeyNameGetReverseIterator (next);
-	elektraKeyNameReverseNext (&last);
+	if (context->arrays[level]) return;
 
-	int valueNeeded = 1;
+	ELEKTRA_LOG_DEBUG ("GEN string %.*s", (int) context->levels[level].size, context->levels[level].name);
+	yajl_gen_string (context->g, (const unsigned char *) context->levels[level].name, context->levels[level].size);
+}
 
-	ELEKTRA_LOG_DEBUG ("next: \"%.*s\"", (int) last.size, last.current);
+/**
+ * @brief Opens the map or array holding the entries at @p level.
+ *
+ * Array entries start with `#`, so does the marker of empty arrays.
+ */
+static void elektraGenOpen (ElektraGenContext * context, size_t level)
+{
+	context->arrays[level] = context->levels[level].name[0] == '#';
+	context->open = level - context->skip + 1;
 
-	if (!strcmp (last.current, "###empty_array"))
+	if (context->arrays[level])
 	{
-		ELEKTRA_LOG_DEBUG ("GEN empty array in value");
-		yajl_gen_array_open (g);
-		yajl_gen_array_close (g);
-		valueNeeded = 0;
+		ELEKTRA_LOG_DEBUG ("GEN array open");
+		yajl_gen_array_open (context->g);
 	}
-	else if (!strcmp (last.current, "___empty_map"))
+	else
 	{
-		ELEKTRA_LOG_DEBUG ("GEN empty map in value");
-		yajl_gen_map_open (g);
-		yajl_gen_map_close (g);
-		valueNeeded = 0;
+		ELEKTRA_LOG_DEBUG ("GEN map open");
+		yajl_gen_map_open (context->g);
 	}
-	else if (last.current[0] != '#')
+}
+
+/**
+ * @brief Closes maps and arrays until only @p open of them are left.
+ */
+static void elektraGenClose (ElektraGenContext * context, size_t open)
+{
+	while (context->open > open)
 	{
-		ELEKTRA_LOG_DEBUG ("GEN string (L1,3)");
-		yajl_gen_string (g, (const unsigned char *) last.current, last.size - 1);
+		--context->open;
+		if (context->arrays[context->skip + context->open])
+		{
+			ELEKTRA_LOG_DEBUG ("GEN array close");
+			yajl_gen_array_close (context->g);
+		}
+		else
+		{
+			ELEKTRA_LOG_DEBUG ("GEN map close");
+			yajl_gen_map_close (context->g);
+		}
 	}
-
-	return valueNeeded;
 }
 
-
 /**
  * @brief Generate the value for the current key
  *
@@ -133,12 +156,6 @@ static int elektraGenOpenValue (yajl_gen g, const Key * next)
  */
 static void elektraGenValue (yajl_gen g, Key * parentKey, const Key * cur)
 {
-	if (!elektraGenOpenValue (g, cur))
-	{
-		ELEKTRA_LOG_DEBUG ("Do not yield value");
-		return;
-	}
-
 	ELEKTRA_LOG_DEBUG ("GEN value %s for %s", keyString (cur), keyName (cur));
 
 	const Key * type = keyGetMeta (cur, "type");
@@ -225,80 +242,137 @@ int elektraGenEmpty (yajl_gen g, KeySet * returned, Key * parentKey)
 	return did_something;
 }
 
-int elektraGenWriteFile (yajl_gen g, Key * parentKey)
+/**
+ * @brief Generates a leaf of the KeySet.
+ *
+ * Closes the maps and arrays the previous key was in but this key is
+ * not, opens the new ones and yields the value.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors
+ */
+static int elektraGenKey (ElektraGenContext * context, const Key * cur)
 {
-	int errnosave = errno;
-	FILE * fp = fopen (keyString (parentKey), "w");
+	if (elektraGenSplit (context, cur) == -1) return -1;
+	if (context->size <= context->skip) return 0; // not below parentKey
 
-	if (!fp)
+	size_t common = context->skip;
+	if (context->open)
 	{
-		ELEKTRA_SET_ERROR_SET (parentKey);
-		errno = errnosave;
-		return -1;
+		size_t equal = 0;
+		while (equal + 1 < context->size && equal + 1 < context->previousSize &&
+		       context->levels[equal].size == context->previous[equal].size &&
+		       !strncmp (context->levels[equal].name, context->previous[equal].name, context->levels[equal].size))
+		{
+			++equal;
+		}
+		if (equal > common) common = equal;
+		elektraGenClose (context, common - context->skip + 1);
+	}
+	else
+	{
+		elektraGenOpen (context, common);
 	}
 
-	const unsigned char * buf;
-	yajl_size_type len;
-	yajl_gen_get_buf (g, &buf, &len);
-	fwrite (buf, 1, len, fp);
-	yajl_gen_clear (g);
+	for (size_t level = common + 1; level < context->size; ++level)
+	{
+		elektraGenName (context, level - 1);
+		elektraGenOpen (context, level);
+	}
 
-	fclose (fp);
+	const size_t last = context->size - 1;
+	if (!elektraGenIsMarker (&context->levels[last]))
+	{
+		elektraGenName (context, last);
+		elektraGenValue (context->g, context->parentKey, cur);
+	}
 
-	errno = errnosave;
-	return 1; /* success */
+	ElektraGenLevel * swap = context->previous;
+	context->previous = context->levels;
+	context->levels = swap;
+	context->previousSize = context->size;
+	return 0;
 }
 
-int elektraYajlSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+/**
+ * @brief Generates all leaves of the KeySet in a single pass.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors
+ */
+static int elektraGenKeySet (yajl_gen g, KeySet * returned, Key * parentKey)
 {
-#if YAJL_MAJOR == 1
-	yajl_gen_config conf = { 1, "    " };
-	yajl_gen g = yajl_gen_alloc (&conf, NULL);
-#else
-	yajl_gen g = yajl_gen_alloc (NULL);
-	yajl_gen_config (g, yajl_gen_beautify, 1);
-#endif
-
-	if (elektraGenEmpty (g, returned, parentKey))
-	{
-		int ret = elektraGenWriteFile (g, parentKey);
-		yajl_gen_free (g);
-		return ret;
-	}
+	ElektraGenContext context = { .g = g, .parentKey = parentKey };
+	int ret = 0;
 
 	ksRewind (returned);
 	Key * cur = elektraNextNotBelow (returned);
-	if (!cur)
+	if (cur) context.skip = elektraKeyCountEqualLevel (parentKey, cur);
+
+	for (; cur && ret == 0; cur = elektraNextNotBelow (returned))
 	{
-		// empty config should be handled by resolver
-		// (e.g. remove file)
-		yajl_gen_free (g);
-		return 0;
+		ELEKTRA_LOG_DEBUG ("ITERATE: %s", keyName (cur));
+		ret = elektraGenKey (&context, cur);
 	}
 
-	ELEKTRA_LOG_DEBUG ("parentKey: %s, cur: %s", keyName (parentKey), keyName (cur));
-	elektraGenOpenInitial (g, parentKey, cur);
-
-	Key * next = 0;
-	while ((next = elektraNextNotBelow (returned)) != 0)
+	if (!context.open)
 	{
-		elektraGenValue (g, parentKey, cur);
-		elektraGenClose (g, cur, next);
+		// no key below the parentKey
+		yajl_gen_map_open (g);
+		yajl_gen_map_close (g);
+	}
+	elektraGenClose (&context, 0);
 
-		ELEKTRA_LOG_DEBUG ("ITERATE: %s next: %s", keyName (cur), keyName (next));
-		elektraGenOpen (g, cur, next);
+	elektraFree (context.levels);
+	elektraFree (context.previous);
+	elektraFree (context.arrays);
+	return ret;
+}
 
-		cur = next;
-	}
+/**
+ * @brief Writes the output of the generator directly to the file.
+ */
+static void elektraGenPrint (void * ctx, const char * str, yajl_size_type len)
+{
+	fwrite (str, 1, len, (FILE *) ctx);
+}
 
-	ELEKTRA_LOG_DEBUG ("leaving loop: %s", keyName (cur));
+int elektraYajlSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	int errnosave = errno;
+	FILE * fp = fopen (keyString (parentKey), "w");
 
-	elektraGenValue (g, parentKey, cur);
+	if (!fp)
+	{
+		ELEKTRA_SET_ERROR_SET (parentKey);
+		errno = errnosave;
+		return -1;
+	}
 
-	elektraGenCloseFinally (g, cur, parentKey);
+#if YAJL_MAJOR == 1
+	yajl_gen_config conf = { 1, "    " };
+	yajl_gen g = yajl_gen_alloc2 (elektraGenPrint, &conf, NULL, fp);
+#else
+	yajl_gen g = yajl_gen_alloc (NULL);
+	yajl_gen_config (g, yajl_gen_beautify, 1);
+	yajl_gen_config (g, yajl_gen_print_callback, elektraGenPrint, fp);
+#endif
 
-	int ret = elektraGenWriteFile (g, parentKey);
+	int ret = 1; /* success */
+	if (!elektraGenEmpty (g, returned, parentKey) && elektraGenKeySet (g, returned, parentKey) == -1)
+	{
+		ELEKTRA_SET_ERROR (ELEKTRA_ERROR_MALLOC, parentKey, "could not allocate memory to generate JSON");
+		ret = -1;
+	}
 	yajl_gen_free (g);
 
+	const int writeError = ferror (fp);
+	if (fclose (fp) != 0 || writeError)
+	{
+		ELEKTRA_SET_ERROR_SET (parentKey);
+		ret = -1;
+	}
+
+	errno = errnosave;
 	return ret;
 }
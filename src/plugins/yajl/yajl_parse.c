@@ -18,51 +18,128 @@
 #include <yajl/yajl_parse.h>
 
 
+/** Bytes read from the file at once */
+#define ELEKTRA_YAJL_CHUNK_SIZE 65536
+
+/** Number of containers the stack of a parse context can hold initially */
+#define ELEKTRA_YAJL_MIN_DEPTH 16
+
 /**
- @retval 0 if ksCurrent does not hold an array entry
- @retval 1 if the array entry will be used because its the first
- @retval 2 if a new array entry was created
- @retval -1 error in snprintf
+ * @brief A map or array currently parsed.
  */
-static int elektraYajlIncrementArrayEntry (KeySet * ks)
+typedef struct
 {
-	Key * current = ksCurrent (ks);
-	const char * baseName = keyBaseName (current);
+	int array;		 /*!< 1 for arrays, 0 for maps */
+	kdb_long_long_t entries; /*!< number of values found so far */
+} ElektraYajlLevel;
 
-	if (baseName && *baseName == '#')
+/**
+ * @brief State shared by the parser callbacks.
+ *
+ * The name of the current value is kept in a single key, which is
+ * extended when a map or array starts and shortened when it ends.
+ * So keys are only appended to the KeySet, never looked up.
+ */
+typedef struct
+{
+	KeySet * ks;
+	Key * current; /*!< key receiving the next value */
+	Key * name;    /*!< name of the current value or the marker of an empty container */
+	ElektraYajlLevel * levels;
+	size_t depth;
+	size_t alloc;
+	char * buffer; /*!< the strings of yajl are not null-terminated */
+	size_t bufferSize;
+	Key * boolean; /*!< holds the metadata shared by all booleans */
+	Key * number;  /*!< holds the metadata shared by all numbers */
+} ElektraYajlContext;
+
+/**
+ * @brief Copies a string of yajl to the buffer of the context.
+ *
+ * @return the null-terminated copy or 0 on memory errors
+ */
+static const char * elektraYajlTerminate (ElektraYajlContext * context, const unsigned char * stringVal, yajl_size_type stringLen)
+{
+	if (stringLen + 1 > context->bufferSize)
 	{
-		current = keyNew (keyName (current), KEY_END);
-		if (!strcmp (baseName, "###empty_array"))
+		size_t size = context->bufferSize ? context->bufferSize : 64;
+		while (size < stringLen + 1)
 		{
-			// get rid of previous key
-			keyDel (ksLookup (ks, current, KDB_O_POP));
-			// we have a new array entry
-			keySetBaseName (current, 0);
-			keyAddName (current, "#0");
-			ksAppendKey (ks, current);
-			return 1;
-		}
-		else
-		{
-			// we are in an array
-			elektraArrayIncName (current);
-			ksAppendKey (ks, current);
-			return 2;
+			size *= 2;
 		}
+		if (elektraRealloc ((void **) &context->buffer, size) == -1) return 0;
+		context->bufferSize = size;
+	}
+	memcpy (context->buffer, stringVal, stringLen);
+	context->buffer[stringLen] = '\0';
+	return context->buffer;
+}
+
+/**
+ * @brief Yields the key for the value which starts now.
+ *
+ * Within arrays a key for the next array entry is created. Within
+ * maps the key was already created by elektraYajlParseMapKey() and
+ * outside of containers the value belongs to the parent key.
+ *
+ * @return the key receiving the value or 0 on memory errors
+ */
+static Key * elektraYajlParseValue (ElektraYajlContext * context)
+{
+	if (context->depth == 0 || !context->levels[context->depth - 1].array) return context->current;
+
+	ElektraYajlLevel * level = &context->levels[context->depth - 1];
+	char index[ELEKTRA_MAX_ARRAY_SIZE];
+	elektraWriteArrayNumber (index, level->entries++);
+	keySetBaseName (context->name, index);
+
+	context->current = keyDup (context->name);
+	if (!context->current || ksAppendKey (context->ks, context->current) == -1) return 0;
+	return context->current;
+}
+
+/**
+ * @brief Enters a map or array.
+ *
+ * The name is extended by the marker of an empty container, which
+ * is replaced by the first entry.
+ *
+ * @retval 1 on success
+ * @retval 0 on memory errors
+ */
+static int elektraYajlParseStart (ElektraYajlContext * context, int array)
+{
+	if (!elektraYajlParseValue (context)) return 0;
+
+	if (context->depth == context->alloc)
+	{
+		size_t alloc = context->alloc ? context->alloc * 2 : ELEKTRA_YAJL_MIN_DEPTH;
+		if (elektraRealloc ((void **) &context->levels, alloc * sizeof (ElektraYajlLevel)) == -1) return 0;
+		context->alloc = alloc;
+	}
+	context->levels[context->depth].array = array;
+	context->levels[context->depth].entries = 0;
+	++context->depth;
+
+	if (array)
+	{
+		keyAddName (context->name, "###empty_array");
 	}
 	else
 	{
-		// previous entry indicates this is not an array
-		return 0;
+		keyAddBaseName (context->name, "___empty_map");
 	}
+
+	ELEKTRA_LOG_DEBUG ("with new key %s", keyName (context->name));
+
+	return 1;
 }
 
 static int elektraYajlParseNull (void * ctx)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
+	Key * current = elektraYajlParseValue ((ElektraYajlContext *) ctx);
+	if (!current) return 0;
 
 	keySetBinary (current, NULL, 0);
 
@@ -73,10 +150,9 @@ static int elektraYajlParseNull (void * ctx)
 
 static int elektraYajlParseBoolean (void * ctx, int boolean)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
+	ElektraYajlContext * context = (ElektraYajlContext *) ctx;
+	Key * current = elektraYajlParseValue (context);
+	if (!current) return 0;
 
 	if (boolean == 1)
 	{
@@ -86,7 +162,7 @@ static int elektraYajlParseBoolean (void * ctx, int boolean)
 	{
 		keySetString (current, "false");
 	}
-	keySetMeta (current, "type", "boolean");
+	keyCopyAllMeta (current, context->boolean);
 
 	ELEKTRA_LOG_DEBUG ("%d", boolean);
 
@@ -95,138 +171,75 @@ static int elektraYajlParseBoolean (void * ctx, int boolean)
 
 static int elektraYajlParseNumber (void * ctx, const char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
+	ElektraYajlContext * context = (ElektraYajlContext *) ctx;
+	Key * current = elektraYajlParseValue (context);
+	const char * stringValue = elektraYajlTerminate (context, (const unsigned char *) stringVal, stringLen);
+	if (!current || !stringValue) return 0;
 
-	Key * current = ksCurrent (ks);
+	ELEKTRA_LOG_DEBUG ("%s %zu", stringValue, (size_t) stringLen);
 
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *) stringVal;
-	stringValue[stringLen] = '\0';
-
-	ELEKTRA_LOG_DEBUG ("%s %zu", stringVal, stringLen);
-
-	keySetString (current, stringVal);
-	keySetMeta (current, "type", "double");
-
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
+	keySetString (current, stringValue);
+	keyCopyAllMeta (current, context->number);
 
 	return 1;
 }
 
 static int elektraYajlParseString (void * ctx, const unsigned char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
+	ElektraYajlContext * context = (ElektraYajlContext *) ctx;
+	Key * current = elektraYajlParseValue (context);
+	const char * stringValue = elektraYajlTerminate (context, stringVal, stringLen);
+	if (!current || !stringValue) return 0;
 
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *) stringVal;
-	stringValue[stringLen] = '\0';
-
-	ELEKTRA_LOG_DEBUG ("%s %zu", stringVal, stringLen);
+	ELEKTRA_LOG_DEBUG ("%s %zu", stringValue, (size_t) stringLen);
 
 	keySetString (current, stringValue);
 
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
 	return 1;
 }
 
 static int elektraYajlParseMapKey (void * ctx, const unsigned char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * currentKey = keyNew (keyName (ksCurrent (ks)), KEY_END);
-	keySetString (currentKey, 0);
+	ElektraYajlContext * context = (ElektraYajlContext *) ctx;
+	const char * stringValue = elektraYajlTerminate (context, stringVal, stringLen);
+	if (!stringValue) return 0;
 
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *) stringVal;
-	stringValue[stringLen] = '\0';
+	// replaces the marker of the empty map or the previous pair
+	keySetBaseName (context->name, stringValue);
+	++context->levels[context->depth - 1].entries;
 
-	ELEKTRA_LOG_DEBUG ("stringValue: %s currentKey: %s", stringValue, keyName (currentKey));
-	if (currentKey && !strcmp (keyBaseName (currentKey), "___empty_map"))
-	{
-		// remove old key
-		keyDel (ksLookup (ks, currentKey, KDB_O_POP));
-		// now we know the name of the object
-		keySetBaseName (currentKey, stringValue);
-	}
-	else
-	{
-		// we entered a new pair (inside the previous object)
-		keySetBaseName (currentKey, stringValue);
-	}
-	ksAppendKey (ks, currentKey);
+	context->current = keyDup (context->name);
+	if (!context->current || ksAppendKey (context->ks, context->current) == -1) return 0;
 
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
+	ELEKTRA_LOG_DEBUG ("stringValue: %s currentKey: %s", stringValue, keyName (context->current));
 
 	return 1;
 }
 
 static int elektraYajlParseStartMap (void * ctx)
 {
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * currentKey = ksCurrent (ks);
-
-	Key * newKey = keyNew (keyName (currentKey), KEY_END);
-	// add a pseudo element for empty map
-	keyAddBaseName (newKey, "___empty_map");
-	ksAppendKey (ks, newKey);
-
-	ELEKTRA_LOG_DEBUG ("with new key %s", keyName (newKey));
+	return elektraYajlParseStart ((ElektraYajlContext *) ctx, 0);
+}
 
-	return 1;
+static int elektraYajlParseStartArray (void * ctx)
+{
+	return elektraYajlParseStart ((ElektraYajlContext *) ctx, 1);
 }
 
 static int elektraYajlParseEnd (void * ctx)
 {
-	KeySet * ks = (KeySet *) ctx;
-	Key * currentKey = ksCurrent (ks);
-
-	Key * lookupKey = keyNew (keyName (currentKey), KEY_END);
-	keySetBaseName (lookupKey, 0); // remove current baseName
+	ElektraYajlContext * context = (ElektraYajlContext *) ctx;
 
-	// lets point current to the correct place
-	Key * foundKey = ksLookup (ks, lookupKey, 0);
-
-#ifdef HAVE_LOGGER
-	if (foundKey)
-	{
-		ELEKTRA_LOG_DEBUG ("%s", keyName (foundKey));
-	}
-	else
+	if (context->levels[--context->depth].entries == 0)
 	{
-		ELEKTRA_LOG_DEBUG ("did not find key!");
+		// keep the marker of the empty map or array
+		Key * marker = keyDup (context->name);
+		if (!marker || ksAppendKey (context->ks, marker) == -1) return 0;
 	}
-#else
-	(void) foundKey; // foundKey is not used, but lookup is needed
-#endif
-
-	keyDel (lookupKey);
-
-	return 1;
-}
-
-static int elektraYajlParseStartArray (void * ctx)
-{
-	KeySet * ks = (KeySet *) ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * currentKey = ksCurrent (ks);
 
-	Key * newKey = keyNew (keyName (currentKey), KEY_END);
-	// add a pseudo element for empty array
-	keyAddName (newKey, "###empty_array");
-	ksAppendKey (ks, newKey);
+	keySetBaseName (context->name, 0);
 
-	ELEKTRA_LOG_DEBUG ("with new key %s", keyName (newKey));
+	ELEKTRA_LOG_DEBUG ("%s", keyName (context->name));
 
 	return 1;
 }
@@ -306,43 +319,56 @@ int elektraYajlGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 				     elektraYajlParseStartArray,
 				     elektraYajlParseEnd };
 
-	ksAppendKey (returned, keyNew (keyName ((parentKey)), KEY_END));
+	Key * root = keyNew (keyName (parentKey), KEY_END);
+	ksAppendKey (returned, root);
+
+	ElektraYajlContext context = { .ks = returned,
+				       .current = root,
+				       .name = keyDup (root),
+				       .boolean = keyNew ("/", KEY_META, "type", "boolean", KEY_END),
+				       .number = keyNew ("/", KEY_META, "type", "double", KEY_END) };
 
 #if YAJL_MAJOR == 1
 	yajl_parser_config cfg = { 1, 1 };
-	yajl_handle hand = yajl_alloc (&callbacks, &cfg, NULL, returned);
+	yajl_handle hand = yajl_alloc (&callbacks, &cfg, NULL, &context);
 #else
-	yajl_handle hand = yajl_alloc (&callbacks, NULL, returned);
+	yajl_handle hand = yajl_alloc (&callbacks, NULL, &context);
 	yajl_config (hand, yajl_allow_comments, 1);
 #endif
 
 	int errnosave = errno;
-	unsigned char fileData[65536];
+	// parsers might run in parallel threads, so do not use their stack
+	unsigned char * fileData = elektraMalloc (ELEKTRA_YAJL_CHUNK_SIZE);
 	int done = 0;
+	int ret = 1;
 	FILE * fileHandle = fopen (keyString (parentKey), "r");
 	if (!fileHandle)
 	{
-		yajl_free (hand);
 		ELEKTRA_SET_ERROR_GET (parentKey);
 		errno = errnosave;
-		return -1;
+		done = 1;
+		ret = -1;
+	}
+	else if (!fileData || !context.name || !context.boolean || !context.number)
+	{
+		ELEKTRA_MALLOC_ERROR (parentKey, (size_t) ELEKTRA_YAJL_CHUNK_SIZE);
+		done = 1;
+		ret = -1;
 	}
 
 	while (!done)
 	{
-		yajl_size_type rd = fread ((void *) fileData, 1, sizeof (fileData) - 1, fileHandle);
+		yajl_size_type rd = fread ((void *) fileData, 1, ELEKTRA_YAJL_CHUNK_SIZE, fileHandle);
 		if (rd == 0)
 		{
 			if (!feof (fileHandle))
 			{
 				ELEKTRA_SET_ERROR (76, parentKey, keyString (parentKey));
-				fclose (fileHandle);
-				yajl_free (hand);
-				return -1;
+				ret = -1;
+				break;
 			}
 			done = 1;
 		}
-		fileData[rd] = 0;
 
 		yajl_status stat;
 		if (done)
@@ -366,16 +392,20 @@ int elektraYajlGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 			unsigned char * str = yajl_get_error (hand, 1, fileData, rd);
 			ELEKTRA_SET_ERROR (77, parentKey, (char *) str);
 			yajl_free_error (hand, str);
-			yajl_free (hand);
-			fclose (fileHandle);
-
-			return -1;
+			ret = -1;
+			break;
 		}
 	}
 
 	yajl_free (hand);
-	fclose (fileHandle);
-	elektraYajlParseSuppressEmpty (returned, parentKey);
-
-	return 1; /* success */
+	if (fileHandle) fclose (fileHandle);
+	elektraFree (fileData);
+	elektraFree (context.levels);
+	elektraFree (context.buffer);
+	keyDel (context.name);
+	keyDel (context.boolean);
+	keyDel (context.number);
+	if (ret == 1) elektraYajlParseSuppressEmpty (returned, parentKey);
+
+	return ret;
 }
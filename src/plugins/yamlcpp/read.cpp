@@ -7,159 +7,476 @@
  */
 
 #include "read.hpp"
+#include "yaml-cpp/eventhandler.h"
 #include "yaml-cpp/yaml.h"
 
 #include <kdb.hpp>
-#include <kdbease.h>
+#include <kdbhelper.h>
 #include <kdblogger.h>
 #include <kdbplugin.h>
 
-#include <sstream>
+#include <fstream>
+#include <map>
+#include <vector>
 
 using namespace std;
 using namespace kdb;
 
 namespace
 {
+
 /**
- * @brief This function creates a new key from the given parameters.
+ * @brief This function stores a (possibly null) value in a key.
  *
- * @param name This string specifies the postfix of the name of the key produced by this function.
- * @param parent This key specifies the prefix of the name of the key produced by this function.
+ * @param key This parameter specifies the key that stores `value` afterwards.
+ * @param value This parameter stores the value, or `nullptr` if the value is null.
+ */
+void setValue (Key & key, string const * value)
+{
+	if (value)
+	{
+		key.setString (*value);
+	}
+	else
+	{
+		key.setBinary (nullptr, 0);
+	}
+}
+
+/**
+ * @brief This class converts the events of the YAML parser directly into keys.
  *
- * @returns The function returns a new key that combines the name of the parent key and `name`.
+ * In contrast to `YAML::LoadFile` the builder does not store the YAML document as tree of nodes. It only keeps track of the collections
+ * that contain the current node. The only events the builder stores are the ones of anchored nodes, which it replays for every alias.
  */
-Key newKey (string const & name, Key const & parent)
+class KeySetBuilder : public YAML::EventHandler
 {
-	ELEKTRA_LOG_DEBUG ("Add new key with base name “%s”", name.c_str ());
+public:
+	KeySetBuilder (KeySet & mappings, Key & parent);
 
-	Key key{ parent.getFullName (), KEY_BINARY, KEY_END };
-	key.addBaseName (name);
+	void OnDocumentStart (YAML::Mark const & mark) override;
+	void OnDocumentEnd () override;
 
-	return key;
-}
+	void OnNull (YAML::Mark const & mark, YAML::anchor_t anchor) override;
+	void OnAlias (YAML::Mark const & mark, YAML::anchor_t anchor) override;
+	void OnScalar (YAML::Mark const & mark, string const & tag, YAML::anchor_t anchor, string const & value) override;
+
+	void OnSequenceStart (YAML::Mark const & mark, string const & tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override;
+	void OnSequenceEnd () override;
+
+	void OnMapStart (YAML::Mark const & mark, string const & tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override;
+	void OnMapEnd () override;
+
+	void addEmptyDocument ();
+
+private:
+	/** This enumeration specifies the collections the builder distinguishes. */
+	enum class Collection
+	{
+		MAP,	  ///< A mapping, its scalars are alternately names and values of keys
+		SEQUENCE, ///< A sequence, its elements are stored as Elektra array
+		META,	  ///< A sequence tagged with `!elektra/meta`, it contains a value and a mapping storing metadata
+		METADATA, ///< The mapping of a meta sequence, its scalars are alternately names and values of metakeys
+		IGNORED	  ///< A collection whose content does not end up in the key set
+	};
+
+	/** This structure stores the state of a collection that contains the current node. */
+	struct Level
+	{
+		Collection type;
+		Key name;		 ///< A key without metadata and value that stores the name of the collection
+		Key key;		 ///< The array parent of a sequence, the key storing the value of a meta sequence
+		unsigned long long size; ///< The number of elements the builder read
+		bool hasName;		 ///< Specifies if the builder read the name of the next value of a mapping
+		string childName;	 ///< The name of the next value of a mapping
+	};
+
+	/** This structure stores an event of the parser, so that the builder can replay it for an alias. */
+	struct Event
+	{
+		enum
+		{
+			NULL_VALUE,
+			SCALAR,
+			SEQUENCE_START,
+			SEQUENCE_END,
+			MAP_START,
+			MAP_END
+		} type;
+		YAML::Mark mark;
+		string tag;
+		string value;
+	};
+
+	/** This structure stores the progress of an anchored node the builder currently records. */
+	struct Recording
+	{
+		YAML::anchor_t anchor;
+		size_t begin; ///< The position of the first event of the node
+		size_t depth; ///< The number of collections of the node the parser did not close yet
+	};
+
+	KeySet & mappings;
+	Key & parent;
+	Key root;
+	vector<Level> levels;
+	YAML::Mark mark;
+
+	vector<Event> events;
+	vector<Recording> recordings;
+	map<YAML::anchor_t, vector<Event>> anchors;
+
+	void record (Event const & event, YAML::anchor_t anchor);
+	void replay (Event const & event);
+
+	bool addName (string const & name);
+	Key nextName ();
+	Level & push (Collection type, Key const & name, Key const & key = Key ());
+
+	void addValue (string const & tag, string const * value);
+	void startSequence (string const & tag);
+	void endSequence ();
+	void startMap ();
+	void endMap ();
+};
 
 /**
- * @brief This function creates a new array key from the given parameters.
+ * @brief This constructor creates a builder that adds the keys of a YAML document to a key set.
  *
- * @param mappings This argument specifies the key set of the new key this function creates.
- * @param arrayKey This argument specifies the key that represents the root of the array.
+ * @param keys This key set stores the keys the builder creates.
+ * @param parentKey This key specifies the prefix of the names of the created keys.
+ */
+KeySetBuilder::KeySetBuilder (KeySet & keys, Key & parentKey)
+: mappings (keys), parent (parentKey), root (parentKey.getFullName (), KEY_END), mark (YAML::Mark::null_mark ())
+{
+}
+
+void KeySetBuilder::OnDocumentStart (YAML::Mark const & documentMark)
+{
+	mark = documentMark;
+}
+
+void KeySetBuilder::OnDocumentEnd ()
+{
+}
+
+void KeySetBuilder::OnNull (YAML::Mark const & nodeMark, YAML::anchor_t anchor)
+{
+	mark = nodeMark;
+	if (anchor != YAML::NullAnchor || !recordings.empty ()) record (Event{ Event::NULL_VALUE, nodeMark, "", "" }, anchor);
+	addValue ("", nullptr);
+}
+
+void KeySetBuilder::OnAlias (YAML::Mark const & nodeMark, YAML::anchor_t anchor)
+{
+	mark = nodeMark;
+	ELEKTRA_LOG_DEBUG ("Replay events of anchor %zu", anchor);
+	// Replaying might record new anchors, which invalidates references into `anchors`
+	auto const replayed = anchors[anchor];
+	for (auto const & event : replayed)
+	{
+		replay (event);
+	}
+}
+
+void KeySetBuilder::OnScalar (YAML::Mark const & nodeMark, string const & tag, YAML::anchor_t anchor, string const & value)
+{
+	mark = nodeMark;
+	if (anchor != YAML::NullAnchor || !recordings.empty ()) record (Event{ Event::SCALAR, nodeMark, tag, value }, anchor);
+	addValue (tag, &value);
+}
+
+void KeySetBuilder::OnSequenceStart (YAML::Mark const & nodeMark, string const & tag, YAML::anchor_t anchor,
+				     YAML::EmitterStyle::value style ELEKTRA_UNUSED)
+{
+	mark = nodeMark;
+	if (anchor != YAML::NullAnchor || !recordings.empty ()) record (Event{ Event::SEQUENCE_START, nodeMark, tag, "" }, anchor);
+	startSequence (tag);
+}
+
+void KeySetBuilder::OnSequenceEnd ()
+{
+	if (!recordings.empty ()) record (Event{ Event::SEQUENCE_END, mark, "", "" }, YAML::NullAnchor);
+	endSequence ();
+}
+
+void KeySetBuilder::OnMapStart (YAML::Mark const & nodeMark, string const & tag, YAML::anchor_t anchor,
+				YAML::EmitterStyle::value style ELEKTRA_UNUSED)
+{
+	mark = nodeMark;
+	if (anchor != YAML::NullAnchor || !recordings.empty ()) record (Event{ Event::MAP_START, nodeMark, tag, "" }, anchor);
+	startMap ();
+}
+
+void KeySetBuilder::OnMapEnd ()
+{
+	if (!recordings.empty ()) record (Event{ Event::MAP_END, mark, "", "" }, YAML::NullAnchor);
+	endMap ();
+}
+
+/**
+ * @brief This function stores an event of an anchored node.
  *
- * @returns The function returns a new key that is part of the array represented by `arrayKey`.
+ * @param event This parameter specifies the event the builder received.
+ * @param anchor This parameter specifies the anchor of the node starting with `event`, or `YAML::NullAnchor`.
  */
-Key newArrayKey (KeySet const & mappings, Key & arrayKey)
+void KeySetBuilder::record (Event const & event, YAML::anchor_t anchor)
 {
-	ELEKTRA_LOG_DEBUG ("Add new array element to array parent “%s”", arrayKey.getName ().c_str ());
+	if (anchor != YAML::NullAnchor) recordings.push_back (Recording{ anchor, events.size (), 0 });
+
+	events.push_back (event);
+	for (auto & recording : recordings)
+	{
+		if (event.type == Event::SEQUENCE_START || event.type == Event::MAP_START) recording.depth++;
+		if (event.type == Event::SEQUENCE_END || event.type == Event::MAP_END) recording.depth--;
+	}
 
-	KeySet arrayEntries{ elektraArrayGet (*arrayKey, mappings.getKeySet ()) };
+	while (!recordings.empty () && recordings.back ().depth == 0)
+	{
+		ELEKTRA_LOG_DEBUG ("Store %zu events for anchor %zu", events.size () - recordings.back ().begin, recordings.back ().anchor);
+		anchors[recordings.back ().anchor].assign (events.begin () + recordings.back ().begin, events.end ());
+		recordings.pop_back ();
+	}
+	if (recordings.empty ()) events.clear ();
+}
 
-	if (arrayEntries.size () <= 0)
+/**
+ * @brief This function handles a stored event as if the parser emitted it at the position of an alias.
+ *
+ * @param event This parameter specifies the event the builder should handle again.
+ */
+void KeySetBuilder::replay (Event const & event)
+{
+	switch (event.type)
 	{
-		Key first = arrayKey.dup ();
-		first.addBaseName ("#");
-		arrayEntries.append (first);
+	case Event::NULL_VALUE:
+		OnNull (event.mark, YAML::NullAnchor);
+		break;
+	case Event::SCALAR:
+		OnScalar (event.mark, event.tag, YAML::NullAnchor, event.value);
+		break;
+	case Event::SEQUENCE_START:
+		OnSequenceStart (event.mark, event.tag, YAML::NullAnchor, YAML::EmitterStyle::Default);
+		break;
+	case Event::SEQUENCE_END:
+		OnSequenceEnd ();
+		break;
+	case Event::MAP_START:
+		OnMapStart (event.mark, event.tag, YAML::NullAnchor, YAML::EmitterStyle::Default);
+		break;
+	case Event::MAP_END:
+		OnMapEnd ();
+		break;
 	}
+}
 
-	Key newKey{ elektraArrayGetNextKey (arrayEntries.getKeySet ()) };
-	arrayKey.setMeta ("array", newKey.getBaseName ());
+/**
+ * @brief This function stores the name of the next value, if the current collection expects a name.
+ *
+ * @param name This parameter stores the name the parser read.
+ *
+ * @retval true if the current collection used `name` as name of its next value
+ * @retval false if the current collection expects a value
+ */
+bool KeySetBuilder::addName (string const & name)
+{
+	if (levels.empty ()) return false;
 
-	return newKey;
+	Level & level = levels.back ();
+	if ((level.type != Collection::MAP && level.type != Collection::METADATA) || level.hasName) return false;
+
+	level.childName = name;
+	level.hasName = true;
+	return true;
 }
 
 /**
- * @brief Add metadata saved in a YAML map to the specified key
+ * @brief This function determines the name of the next value of the current collection.
+ *
+ * @pre The current collection is either a mapping that read the name of the next value, or a sequence.
  *
- * @param key This parameter saves the key to which this function should add the metadata stored in `node`.
- * @param node This YAML node stores a map containing metadata.
+ * @returns A new key without metadata and value that stores the name of the next value
  */
-void addMetadata (Key & key, YAML::Node const & node)
+Key KeySetBuilder::nextName ()
 {
-	for (auto & element : node)
+	if (levels.empty ()) return root.dup ();
+
+	Level & level = levels.back ();
+	Key name = level.name.dup ();
+	if (level.type == Collection::MAP)
 	{
-		auto metakey = element.first.as<string> ();
-		auto metavalue = element.second.IsNull () ? "" : element.second.as<string> ();
-		ELEKTRA_LOG_DEBUG ("Add metakey “%s: %s”", metakey.c_str (), metavalue.c_str ());
-		key.setMeta (metakey, metavalue);
+		name.addBaseName (level.childName);
+		level.hasName = false;
+		return name;
 	}
+
+	char index[ELEKTRA_MAX_ARRAY_SIZE];
+	ckdb::elektraWriteArrayNumber (index, level.size++);
+	name.addBaseName (index);
+	return name;
 }
 
 /**
- * @brief Create a key containing a (possibly empty) value.
+ * @brief This function adds a collection to the list of collections containing the current node.
  *
- * @param node This YAML node stores the data that should be converted to a new `Key`.
- * @param name This text specifies the name of the key this function creates.
+ * @returns The new innermost collection
+ */
+KeySetBuilder::Level & KeySetBuilder::push (Collection type, Key const & name, Key const & key)
+{
+	levels.push_back (Level{ type, name, key, 0, false, "" });
+	return levels.back ();
+}
+
+/**
+ * @brief This function handles a scalar or null value.
  *
- * @return A new key containing the data specified in `node`
+ * @param tag This parameter specifies the tag of the value.
+ * @param value This parameter stores the value, or `nullptr` if the value is null.
  */
-Key createLeafKey (YAML::Node const & node, string const & name)
+void KeySetBuilder::addValue (string const & tag, string const * value)
 {
-	Key key{ name, KEY_BINARY, KEY_END };
-	if (!node.IsNull ())
+	if (addName (value ? *value : "null")) return;
+
+	Collection const type = levels.empty () ? Collection::MAP : levels.back ().type;
+	if (type == Collection::IGNORED) return;
+	if (type == Collection::METADATA)
+	{
+		Level & level = levels.back ();
+		level.hasName = false;
+		ELEKTRA_LOG_DEBUG ("Add metakey “%s: %s”", level.childName.c_str (), value ? value->c_str () : "");
+		levels[levels.size () - 2].key.setMeta (level.childName, value ? *value : "");
+		return;
+	}
+	if (type == Collection::META)
 	{
-		key.setString (node.as<string> ());
+		Level & level = levels.back ();
+		if (level.size++ > 0) return;
+		level.key = level.name.dup ();
+		setValue (level.key, value);
+		return;
 	}
-	if (node.Tag () == "tag:yaml.org,2002:binary")
+
+	Key key = nextName ();
+	setValue (key, value);
+	if (tag == "tag:yaml.org,2002:binary")
 	{
 		ELEKTRA_LOG_DEBUG ("Set metadata type of key to binary");
 		key.setMeta ("type", "binary");
 	}
 	ELEKTRA_LOG_DEBUG ("Add key “%s: %s”", key.getName ().c_str (),
 			   key.getBinarySize () == 0 ? "NULL" : key.isBinary () ? "binary value!" : key.get<string> ().c_str ());
-	return key;
+	mappings.append (key);
 }
 
 /**
- * @brief Convert the key value of a YAML meta node to a key
- *
- * @param node This YAML meta node stores the data this function stores in the returned key
- * @param parent This key stores the prefix for the key name
+ * @brief This function handles the start of a sequence.
  *
- * @return A key representing the key value stored in `node`
+ * @param tag This parameter specifies the tag of the sequence.
  */
-Key convertMetaNodeToKey (YAML::Node const & node, Key & parent)
+void KeySetBuilder::startSequence (string const & tag)
 {
-	auto key = node[0].IsNull () ? Key{ parent.getFullName (), KEY_BINARY, KEY_END } :
-				       Key{ parent.getFullName (), KEY_VALUE, node[0].as<string> ().c_str (), KEY_END };
-	ELEKTRA_LOG_DEBUG ("Add key “%s”: “%s”", key.getName ().c_str (),
-			   key.getBinarySize () == 0 ? "NULL" : key.isString () ? key.getString ().c_str () : "binary value!");
-	return key;
+	if (!levels.empty () && levels.back ().type == Collection::IGNORED)
+	{
+		push (Collection::IGNORED, Key ());
+		return;
+	}
+	if (!levels.empty () && levels.back ().type == Collection::META)
+	{
+		if (levels.back ().size++ == 0) throw YAML::RepresentationException (mark, "the value of a meta node must be a scalar");
+		push (Collection::IGNORED, Key ());
+		return;
+	}
+	if (addName ("") || (!levels.empty () && levels.back ().type == Collection::METADATA))
+	{
+		throw YAML::RepresentationException (mark, "a sequence can not be used as key or metadata");
+	}
+
+	Key name = nextName ();
+	if (tag == "!elektra/meta")
+	{
+		push (Collection::META, name);
+		return;
+	}
+
+	if (levels.empty ())
+	{
+		// The parent only becomes an array parent if the sequence contains elements
+		push (Collection::SEQUENCE, name, parent);
+		return;
+	}
+
+	Key key = name.dup ();
+	key.setBinary (nullptr, 0);
+	key.setMeta ("array", "");
+	ELEKTRA_LOG_DEBUG ("Add array parent “%s”", key.getName ().c_str ());
+	mappings.append (key);
+	push (Collection::SEQUENCE, name, key);
 }
 
 /**
- * @brief Convert a YAML node to a key set
- *
- * @param node This YAML node stores the data that should be added to the keyset `mappings`
- * @param mappings The key set where the YAML data will be stored
- * @param parent This key stores the prefix for the key name
+ * @brief This function handles the end of a sequence.
  */
-void convertNodeToKeySet (YAML::Node const & node, KeySet & mappings, Key & parent)
+void KeySetBuilder::endSequence ()
 {
-	if (node.Tag () == "!elektra/meta")
+	Level level = levels.back ();
+	levels.pop_back ();
+
+	if (level.type == Collection::SEQUENCE && level.size > 0)
 	{
-		auto key = convertMetaNodeToKey (node, parent);
-		mappings.append (key);
-		addMetadata (key, node[1]);
+		char index[ELEKTRA_MAX_ARRAY_SIZE];
+		ckdb::elektraWriteArrayNumber (index, level.size - 1);
+		level.key.setMeta ("array", index);
 	}
-	else if (node.IsScalar () || node.IsNull ())
+	if (level.type == Collection::META)
 	{
-		auto key = createLeafKey (node, parent.getFullName ());
-		mappings.append (key);
+		if (level.size == 0) throw YAML::RepresentationException (mark, "a meta node must contain a value");
+		ELEKTRA_LOG_DEBUG ("Add key “%s”: “%s”", level.key.getName ().c_str (),
+				   level.key.getBinarySize () == 0 ? "NULL" :
+								     level.key.isString () ? level.key.getString ().c_str () : "binary value!");
+		mappings.append (level.key);
 	}
-	else if (node.IsMap () || node.IsSequence ())
+}
+
+/**
+ * @brief This function handles the start of a mapping.
+ */
+void KeySetBuilder::startMap ()
+{
+	if (!levels.empty () && levels.back ().type == Collection::IGNORED)
 	{
-		for (auto element : node)
-		{
-			Key key = node.IsMap () ? newKey (element.first.as<string> (), parent) : newArrayKey (mappings, parent);
-			// Add intermediate key for array parent
-			if ((node.IsMap () ? element.second : element).IsSequence ())
-			{
-				key.setMeta ("array", "");
-				mappings.append (key);
-			}
-			convertNodeToKeySet (node.IsMap () ? element.second : element, mappings, key);
-		}
+		push (Collection::IGNORED, Key ());
+		return;
 	}
+	if (!levels.empty () && levels.back ().type == Collection::META)
+	{
+		if (levels.back ().size++ == 0) throw YAML::RepresentationException (mark, "the value of a meta node must be a scalar");
+		push (levels.back ().size == 2 ? Collection::METADATA : Collection::IGNORED, Key ());
+		return;
+	}
+	if (addName ("") || (!levels.empty () && levels.back ().type == Collection::METADATA))
+	{
+		throw YAML::RepresentationException (mark, "a mapping can not be used as key or metadata");
+	}
+
+	push (Collection::MAP, nextName ());
+}
+
+/**
+ * @brief This function handles the end of a mapping.
+ */
+void KeySetBuilder::endMap ()
+{
+	levels.pop_back ();
+}
+
+/**
+ * @brief This function handles a file that does not contain a YAML document.
+ */
+void KeySetBuilder::addEmptyDocument ()
+{
+	addValue ("", nullptr);
 }
+
 } // end namespace
 
 /**
@@ -170,14 +487,12 @@ void convertNodeToKeySet (YAML::Node const & node, KeySet & mappings, Key & pare
  */
 void yamlcpp::yamlRead (KeySet & mappings, Key & parent)
 {
-	YAML::Node config = YAML::LoadFile (parent.getString ());
+	ifstream input (parent.getString ());
+	if (!input) throw YAML::ParserException (YAML::Mark::null_mark (), YAML::ErrorMsg::BAD_FILE);
 
-#ifdef HAVE_LOGGER
-	ostringstream data;
-	data << config;
-	ELEKTRA_LOG_DEBUG ("Read data “%s”", data.str ().c_str ());
-#endif
+	YAML::Parser parser (input);
+	KeySetBuilder builder (mappings, parent);
+	if (!parser.HandleNextDocument (builder)) builder.addEmptyDocument ();
 
-	convertNodeToKeySet (config, mappings, parent);
 	ELEKTRA_LOG_DEBUG ("Added %zd key%s", mappings.size (), mappings.size () == 1 ? "" : "s");
 }
@@ -133,6 +133,13 @@ static void test_array (void)
 	test_write_read (
 #include "yamlcpp/nested_sequences.h"
 	);
+
+	test_read ("yamlcpp/mapping_sequence.yaml",
+#include "yamlcpp/mapping_sequence.h"
+	);
+	test_write_read (
+#include "yamlcpp/mapping_sequence.h"
+	);
 }
 
 // -- Main ---------------------------------------------------------------------------------------------------------------------------------
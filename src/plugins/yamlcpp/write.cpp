@@ -9,11 +9,12 @@
 #include "write.hpp"
 #include "yaml-cpp/yaml.h"
 
-#include <kdbease.h>
 #include <kdblogger.h>
 #include <kdbplugin.h>
 
+#include <cstring>
 #include <fstream>
+#include <vector>
 
 using namespace std;
 using namespace kdb;
@@ -75,39 +76,28 @@ std::pair<bool, unsigned long long> isArrayIndex (NameIterator const & nameItera
 	}
 }
 
-/**
- * @brief This function creates a YAML node representing a key value.
- *
- * @param key This key specifies the data that should be saved in the YAML node returned by this function.
- *
- * @note Since YAML does not support non-empty binary data directly this function replaces data stored in binary keys with the string
- *       `Unsupported binary value!`. If you need support for binary data, please load the Base64 before you use YAML CPP.
- *
- * @returns A new YAML node containing the data specified in `key`
- */
-YAML::Node createMetaDataNode (Key const & key)
+/** This structure stores a key together with the part of its name the writer did not emit yet. */
+struct Entry
 {
-	return key.hasMeta ("array") ?
-		       YAML::Node (YAML::NodeType::Sequence) :
-		       key.getBinarySize () == 0 ? YAML::Node (YAML::NodeType::Null) :
-						   YAML::Node (key.isBinary () ? "Unsupported binary value!" : key.getString ());
-}
+	Key key;
+	NameIterator name;
+};
+
+using Entries = vector<Entry>;
 
 /**
- * @brief This function creates a YAML Node containing a key value and optionally metadata.
+ * @brief This function emits the value and metadata of a key.
  *
- * @param key This key specifies the data that should be saved in the YAML node returned by this function.
+ * @param emitter This parameter specifies the emitter that writes the YAML data.
+ * @param key This key specifies the data that this function emits.
  *
  * @note Since YAML does not support non-empty binary data directly this function replaces data stored in binary keys with the string
  *       `Unsupported binary value!`. If you need support for binary data, please load the Base64 before you use YAML CPP.
- *
- * @returns A new YAML node containing the data and metadata specified in `key`
  */
-YAML::Node createLeafNode (Key & key)
+void emitLeaf (YAML::Emitter & emitter, Key & key)
 {
-
-	YAML::Node metaNode{ YAML::Node (YAML::NodeType::Map) };
-	YAML::Node dataNode = createMetaDataNode (key);
+	bool isBinary = false;
+	bool hasMetadata = false;
 
 	key.rewindMeta ();
 	while (Key meta = key.nextMeta ())
@@ -115,128 +105,106 @@ YAML::Node createLeafNode (Key & key)
 		if (meta.getName () == "array" || meta.getName () == "binary") continue;
 		if (meta.getName () == "type" && meta.getString () == "binary")
 		{
-			dataNode.SetTag ("tag:yaml.org,2002:binary");
+			isBinary = true;
 			continue;
 		}
-		metaNode[meta.getName ()] = meta.getString ();
-		ELEKTRA_LOG_DEBUG ("Add metakey “%s: %s”", meta.getName ().c_str (), meta.getString ().c_str ());
+		hasMetadata = true;
 	}
 
-	if (metaNode.size () <= 0)
+	if (hasMetadata) emitter << YAML::VerbatimTag ("!elektra/meta") << YAML::BeginSeq;
+
+	if (key.hasMeta ("array"))
 	{
-		ELEKTRA_LOG_DEBUG ("Return leaf node with value “%s”",
-				   dataNode.IsNull () ? "~" : dataNode.IsSequence () ? "[]" : dataNode.as<string> ().c_str ());
-		return dataNode;
+		if (isBinary) emitter << YAML::VerbatimTag ("tag:yaml.org,2002:binary");
+		emitter << YAML::BeginSeq << YAML::EndSeq;
+	}
+	else if (key.getBinarySize () == 0)
+	{
+		emitter << YAML::Null;
+	}
+	else
+	{
+		if (isBinary) emitter << YAML::VerbatimTag ("tag:yaml.org,2002:binary");
+		emitter << (key.isBinary () ? "Unsupported binary value!" : key.getString ());
 	}
 
-	YAML::Node node{ YAML::Node (YAML::NodeType::Sequence) };
-	node.SetTag ("!elektra/meta");
-	node.push_back (dataNode);
-	node.push_back (metaNode);
-
-#ifdef HAVE_LOGGER
-	ostringstream data;
-	data << node;
-	ELEKTRA_LOG_DEBUG ("Return meta leaf node with value “%s”", data.str ().c_str ());
-#endif
-
-	return node;
-}
+	if (!hasMetadata) return;
 
-/**
- * @brief This function adds `null` elements to the given YAML collection.
- *
- * @param sequence This node stores the collection to which this function adds `numberOfElements` empty elements.
- * @param numberOfElements This parameter specifies the number of empty element this function adds to `sequence`.
- */
-void addEmptyArrayElements (YAML::Node & sequence, unsigned long long const numberOfElements)
-{
-	ELEKTRA_LOG_DEBUG ("Add %lld empty array elements", numberOfElements);
-	for (auto missingFields = numberOfElements; missingFields > 0; missingFields--)
+	emitter << YAML::BeginMap;
+	key.rewindMeta ();
+	while (Key meta = key.nextMeta ())
 	{
-		sequence.push_back (YAML::Node ());
+		if (meta.getName () == "array" || meta.getName () == "binary") continue;
+		if (meta.getName () == "type" && meta.getString () == "binary") continue;
+		ELEKTRA_LOG_DEBUG ("Emit metakey “%s: %s”", meta.getName ().c_str (), meta.getString ().c_str ());
+		emitter << meta.getName () << meta.getString ();
 	}
+	emitter << YAML::EndMap << YAML::EndSeq;
 }
 
 /**
- * @brief This function adds a key to a YAML node.
+ * @brief This function emits the keys of a part of the written key set as one YAML node.
  *
- * @param data This node stores the data specified via `keyIterator`.
- * @param keyIterator This iterator specifies the current part of the key name this function adds to `data`.
- * @param key This parameter specifies the key that should be added to `data`.
+ * All keys in the range `[begin, end)` share the part of their name the writer already emitted. The first part of the remaining name
+ * decides below which element of the current collection the writer emits a key. If every element is an array index, the function emits a
+ * sequence, which contains `null` for missing elements. Otherwise it emits a mapping, using the name parts as keys.
+ *
+ * @pre The range `[begin, end)` is not empty and sorted.
+ *
+ * @param emitter This parameter specifies the emitter that writes the YAML data.
+ * @param begin This iterator specifies the first key of the node.
+ * @param end This iterator specifies the end of the keys of the node.
  */
-void addKey (YAML::Node & data, NameIterator & keyIterator, Key & key)
+void emitNode (YAML::Emitter & emitter, Entries::iterator begin, Entries::iterator const end)
 {
-	auto const isArrayAndIndex = isArrayIndex (keyIterator);
-	auto const isArray = isArrayAndIndex.first;
-	auto const arrayIndex = isArrayAndIndex.second;
-
-	if (data.IsScalar ()) data = YAML::Node (YAML::NodeType::Undefined);
-
-#ifdef HAVE_LOGGER
-	ostringstream output;
-	output << data;
-	ELEKTRA_LOG_DEBUG ("Add key part “%s” to node “%s”", (*keyIterator).c_str (), output.str ().c_str ());
-#endif
-
-	if (keyIterator == key.end ())
-	{
-		ELEKTRA_LOG_DEBUG ("Create leaf node for key “%s”", key.getName ().c_str ());
-		data = createLeafNode (key);
-		return;
-	}
-	if (keyIterator == --key.end ())
+	if (begin->name == begin->key.end ())
 	{
-		if (isArray)
+		if (begin + 1 == end)
 		{
-			addEmptyArrayElements (data, arrayIndex - data.size ());
-			data.push_back (createLeafNode (key));
+			ELEKTRA_LOG_DEBUG ("Emit leaf node for key “%s”", begin->key.getName ().c_str ());
+			emitLeaf (emitter, begin->key);
+			return;
 		}
-		else
-		{
-			data[*keyIterator] = createLeafNode (key);
-		}
-
-		return;
+		// The value of a key with children can not be represented
+		++begin;
 	}
 
-	YAML::Node node;
-
-	if (isArray)
-	{
-		node = (data[arrayIndex] && !data[arrayIndex].IsScalar ()) ? data[arrayIndex] : YAML::Node ();
-		data[arrayIndex] = node;
-	}
-	else
+	vector<Entries::iterator> groups;
+	bool isSequence = true;
+	for (auto entry = begin; entry != end; ++entry)
 	{
-		node = (data[*keyIterator] && !data[*keyIterator].IsScalar ()) ? data[*keyIterator] : YAML::Node ();
-		data[*keyIterator] = node;
+		if (!groups.empty () && strcmp (groups.back ()->name.pos (), entry->name.pos ()) == 0) continue;
+		groups.push_back (entry);
+		isSequence = isSequence && isArrayIndex (entry->name).first;
 	}
-	addKey (node, ++keyIterator, key);
-}
+	groups.push_back (end);
 
-/**
- * @brief This function adds a key set to a YAML node.
- *
- * @param data This node stores the data specified via `mappings`.
- * @param mappings This keyset specifies all keys and values this function adds to `data`.
- * @param parent This key is the root of all keys stored in `mappings`.
- */
-void addKeys (YAML::Node & data, KeySet const & mappings, Key const & parent)
-{
-	for (auto key : mappings)
+	emitter << (isSequence ? YAML::BeginSeq : YAML::BeginMap);
+	unsigned long long nextIndex = 0;
+	for (size_t group = 0; group + 1 < groups.size (); group++)
 	{
-		ELEKTRA_LOG_DEBUG ("Convert key “%s”: “%s”", key.getName ().c_str (),
-				   key.getBinarySize () == 0 ? "NULL" : key.isString () ? key.getString ().c_str () : "binary value!");
-		NameIterator keyIterator = relativeKeyIterator (key, parent);
-		addKey (data, keyIterator, key);
+		if (isSequence)
+		{
+			auto const arrayIndex = isArrayIndex (groups[group]->name).second;
+			ELEKTRA_LOG_DEBUG ("Emit %lld empty array elements", arrayIndex > nextIndex ? arrayIndex - nextIndex : 0);
+			for (; nextIndex < arrayIndex; nextIndex++)
+			{
+				emitter << YAML::Null;
+			}
+			nextIndex = arrayIndex + 1;
+		}
+		else
+		{
+			emitter << *groups[group]->name;
+		}
 
-#ifdef HAVE_LOGGER
-		ostringstream output;
-		output << data;
-		ELEKTRA_LOG_DEBUG ("Converted key data “%s”", output.str ().c_str ());
-#endif
+		for (auto entry = groups[group]; entry != groups[group + 1]; ++entry)
+		{
+			++entry->name;
+		}
+		emitNode (emitter, groups[group], groups[group + 1]);
 	}
+	emitter << (isSequence ? YAML::EndSeq : YAML::EndMap);
 }
 
 } // end namespace
@@ -244,21 +212,26 @@ void addKeys (YAML::Node & data, KeySet const & mappings, Key const & parent)
 /**
  * @brief This function saves the key-value pairs stored in `mappings` as YAML data in the location specified via `parent`.
  *
+ * The function does not build a YAML document in memory. Since the keys of `mappings` are sorted, the keys of every YAML node form a
+ * contiguous range, which the function passes directly to the emitter.
+ *
  * @param mappings This key set stores the mappings that should be saved as YAML data.
  * @param parent This key specifies the path to the YAML data file that should be written.
  */
 void yamlcpp::yamlWrite (KeySet const & mappings, Key const & parent)
 {
 	ofstream output (parent.getString ());
-	auto data = YAML::Node ();
-	addKeys (data, mappings, parent);
+	YAML::Emitter emitter (output);
 
-#ifdef HAVE_LOGGER
-	ostringstream outputString;
-	outputString << data;
+	Entries entries;
+	entries.reserve (mappings.size ());
+	for (auto key : mappings)
+	{
+		entries.push_back (Entry{ key, relativeKeyIterator (key, parent) });
+	}
 
-	ELEKTRA_LOG_DEBUG ("Write data “%s”", outputString.str ().c_str ());
-#endif
+	if (!entries.empty ()) emitNode (emitter, entries.begin (), entries.end ());
+	if (!emitter.good ()) throw YAML::EmitterException (emitter.GetLastError ());
 
-	output << data;
+	ELEKTRA_LOG_DEBUG ("Wrote %zd key%s", mappings.size (), mappings.size () == 1 ? "" : "s");
 }
@@ -0,0 +1,13 @@
+// clang-format off
+
+#define PREFIX "user/examples/yamlcpp/"
+
+ksNew (10,
+       keyNew (PREFIX "#0/band", KEY_VALUE, "Bloc Party", KEY_END),
+       keyNew (PREFIX "#0/album", KEY_VALUE, "Silent Alarm", KEY_END),
+       keyNew (PREFIX "#1/band", KEY_VALUE, "Kings of Leon", KEY_END),
+       keyNew (PREFIX "#2/band", KEY_VALUE, "My Bloody Valentine", KEY_END),
+       keyNew (PREFIX "#2/album", KEY_VALUE, "Loveless", KEY_END),
+       keyNew (PREFIX "#3/band", KEY_VALUE, "My Bloody Valentine", KEY_END),
+       keyNew (PREFIX "#3/album", KEY_VALUE, "Loveless", KEY_END),
+       KS_END)
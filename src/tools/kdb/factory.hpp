@@ -39,6 +39,7 @@
 #include <list.hpp>
 #include <listcommands.hpp>
 #include <ls.hpp>
+#include <memory.hpp>
 #include <merge.hpp>
 #include <metaget.hpp>
 #include <metals.hpp>
@@ -53,6 +54,7 @@
 #include <shell.hpp>
 #include <specmount.hpp>
 #include <test.hpp>
+#include <trace.hpp>
 #include <umount.hpp>
 #include <validation.hpp>
 
@@ -118,6 +120,8 @@ public:
 		m_factory.insert (std::make_pair ("gmount", new Cnstancer<GlobalMountCommand> ()));
 		m_factory.insert (std::make_pair ("gumount", new Cnstancer<GlobalUmountCommand> ()));
 		m_factory.insert (std::make_pair ("list-commands", new Cnstancer<ListCommandsCommand> ()));
+		m_factory.insert (std::make_pair ("memory", new Cnstancer<MemoryCommand> ()));
+		m_factory.insert (std::make_pair ("trace", new Cnstancer<TraceCommand> ()));
 	}
 
 	~Factory ()
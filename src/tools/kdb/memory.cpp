@@ -0,0 +1,64 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <memory.hpp>
+
+#include <iomanip>
+#include <iostream>
+
+#include <cmdline.hpp>
+#include <kdb.hpp>
+#include <kdbproposal.h>
+
+using namespace kdb;
+using namespace std;
+
+MemoryCommand::MemoryCommand ()
+{
+}
+
+static void printUsage (const ckdb::ElektraMemoryUsage & usage)
+{
+	cout << left << setw (8) << "keys:" << usage.keys << endl;
+	cout << left << setw (8) << "names:" << usage.names << endl;
+	cout << left << setw (8) << "values:" << usage.values << endl;
+	cout << left << setw (8) << "meta:" << usage.meta << endl;
+	cout << left << setw (8) << "index:" << usage.index << endl;
+	cout << left << setw (8) << "slack:" << usage.slack << endl;
+	cout << left << setw (8) << "total:" << usage.total << endl;
+}
+
+int MemoryCommand::execute (Cmdline const & cl)
+{
+	if (cl.arguments.size () != 1)
+	{
+		throw invalid_argument ("1 argument required");
+	}
+
+	Key root = cl.createKey (0);
+
+	kdb.get (ks, root);
+
+	if (cl.verbose) cout << "size of all keys in mountpoint: " << ks.size () << endl;
+
+	KeySet part (ks.cut (root));
+
+	if (cl.verbose) cout << "size of requested keys: " << part.size () << endl;
+
+	ckdb::ElektraMemoryUsage usage;
+	ckdb::ksMemoryUsage (part.getKeySet (), &usage);
+	printUsage (usage);
+
+	printWarnings (cerr, root);
+
+	return 0;
+}
+
+MemoryCommand::~MemoryCommand ()
+{
+}
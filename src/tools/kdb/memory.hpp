@@ -0,0 +1,48 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <command.hpp>
+#include <kdb.hpp>
+
+class MemoryCommand : public Command
+{
+	kdb::KDB kdb;
+	kdb::KeySet ks;
+
+public:
+	MemoryCommand ();
+	~MemoryCommand ();
+
+	virtual std::string getShortOptions () override
+	{
+		return "v";
+	}
+
+	virtual std::string getSynopsis () override
+	{
+		return "<name>";
+	}
+
+	virtual std::string getShortHelpText () override
+	{
+		return "Print the memory used by the keys below a given name.";
+	}
+
+	virtual std::string getLongHelpText () override
+	{
+		return "Retrieves the keys below the given name and prints\n"
+		       "how many bytes they use, split up into categories.";
+	}
+
+	virtual int execute (Cmdline const & cmdline) override;
+};
+
+#endif
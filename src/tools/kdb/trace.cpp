@@ -0,0 +1,158 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <trace.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <cmdline.hpp>
+#include <kdb.hpp>
+
+using namespace kdb;
+using namespace std;
+
+TraceCommand::TraceCommand ()
+{
+}
+
+namespace
+{
+
+struct Event
+{
+	string phase;
+	string plugin;
+	string mountpoint;
+	unsigned long long start;
+	unsigned long long duration;
+	string keys;
+};
+
+/**
+ * @brief Reads the events kdbGet() wrote to the metadata `trace/#<n>` of the parent key.
+ */
+vector<Event> readEvents (Key const & root)
+{
+	vector<Event> events;
+	for (size_t i = 0;; ++i)
+	{
+		ostringstream name;
+		name << "trace/#";
+		for (size_t digits = to_string (i).size (); digits > 1; --digits)
+		{
+			name << '_';
+		}
+		name << i << '/';
+		const string prefix = name.str ();
+		if (!root.hasMeta (prefix + "phase")) break;
+
+		Event event;
+		event.phase = root.getMeta<string> (prefix + "phase");
+		event.plugin = root.hasMeta (prefix + "plugin") ? root.getMeta<string> (prefix + "plugin") : "";
+		event.mountpoint = root.hasMeta (prefix + "mountpoint") ? root.getMeta<string> (prefix + "mountpoint") : "";
+		event.start = stoull (root.getMeta<string> (prefix + "start"));
+		event.duration = stoull (root.getMeta<string> (prefix + "duration"));
+		event.keys = root.hasMeta (prefix + "keys") ? root.getMeta<string> (prefix + "keys") : "";
+		events.push_back (event);
+	}
+	return events;
+}
+
+void printTable (vector<Event> const & events)
+{
+	cout << right << setw (12) << "start/us" << setw (12) << "duration/us" << setw (8) << "keys"
+	     << "  " << left << setw (16) << "phase" << setw (16) << "plugin"
+	     << "mountpoint" << endl;
+	for (auto const & event : events)
+	{
+		cout << right << setw (12) << event.start / 1000 << setw (12) << event.duration / 1000 << setw (8) << event.keys << "  "
+		     << left << setw (16) << event.phase << setw (16) << event.plugin << event.mountpoint << endl;
+	}
+}
+
+string jsonString (string const & str)
+{
+	ostringstream os;
+	os << '"';
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (static_cast<unsigned char> (c) < 0x20)
+			os << "\\u" << hex << setw (4) << setfill ('0') << static_cast<int> (c) << dec << setfill (' ');
+		else
+			os << c;
+	}
+	os << '"';
+	return os.str ();
+}
+
+/**
+ * @brief Prints the events in the Trace Event Format of chrome://tracing.
+ */
+void printChrome (vector<Event> const & events)
+{
+	cout << "{\"traceEvents\":[" << endl;
+	for (size_t i = 0; i < events.size (); ++i)
+	{
+		Event const & event = events[i];
+		cout << "{\"name\":" << jsonString (event.plugin.empty () ? event.phase : event.plugin)
+		     << ",\"cat\":" << jsonString (event.phase) << ",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+		     << ",\"ts\":" << event.start / 1000 << '.' << setw (3) << setfill ('0') << event.start % 1000
+		     << ",\"dur\":" << event.duration / 1000 << '.' << setw (3) << event.duration % 1000 << setfill (' ')
+		     << ",\"args\":{";
+		if (!event.mountpoint.empty ()) cout << "\"mountpoint\":" << jsonString (event.mountpoint);
+		if (!event.mountpoint.empty () && !event.keys.empty ()) cout << ',';
+		if (!event.keys.empty ()) cout << "\"keys\":" << event.keys;
+		cout << "}}" << (i + 1 < events.size () ? "," : "") << endl;
+	}
+	cout << "]}" << endl;
+}
+} // namespace
+
+int TraceCommand::execute (Cmdline const & cl)
+{
+	if (cl.arguments.size () < 1 || cl.arguments.size () > 2)
+	{
+		throw invalid_argument ("1 or 2 arguments required");
+	}
+
+	const string format = cl.arguments.size () == 2 ? cl.arguments[1] : "table";
+	if (format != "table" && format != "chrome")
+	{
+		throw invalid_argument ("unknown format " + format + ", use table or chrome");
+	}
+
+	Key root = cl.createKey (0);
+	root.setMeta<string> ("trace", "");
+
+	kdb.get (ks, root);
+
+	if (cl.verbose) cout << "size of all keys in mountpoint: " << ks.size () << endl;
+
+	vector<Event> events = readEvents (root);
+	if (format == "chrome")
+	{
+		printChrome (events);
+	}
+	else
+	{
+		printTable (events);
+	}
+
+	printWarnings (cerr, root);
+
+	return 0;
+}
+
+TraceCommand::~TraceCommand ()
+{
+}
@@ -0,0 +1,51 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <command.hpp>
+#include <kdb.hpp>
+
+class TraceCommand : public Command
+{
+	kdb::KDB kdb;
+	kdb::KeySet ks;
+
+public:
+	TraceCommand ();
+	~TraceCommand ();
+
+	virtual std::string getShortOptions () override
+	{
+		return "v";
+	}
+
+	virtual std::string getSynopsis () override
+	{
+		return "<name> [<format>]";
+	}
+
+	virtual std::string getShortHelpText () override
+	{
+		return "Print where retrieving the keys below a given name spends its time.";
+	}
+
+	virtual std::string getLongHelpText () override
+	{
+		return "Retrieves the keys below the given name and prints\n"
+		       "how long every phase and every plugin took.\n"
+		       "\n"
+		       "The format is either \"table\" (default) or \"chrome\",\n"
+		       "which prints JSON for chrome://tracing.";
+	}
+
+	virtual int execute (Cmdline const & cmdline) override;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file
+ *
+ * @brief Tests for keys allocated within the arena of a KeySet.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static void test_arenaNames (void)
+{
+	printf ("Test arena key names\n");
+
+	const char * names[] = { "user/tests/arena",
+				 "system/tests/arena/#0",
+				 "/tests/arena/cascading",
+				 "spec/tests/arena",
+				 "dir/tests/arena/%",
+				 "user/tests/arena/../arena/dotdot",
+				 "user//tests///arena/./dot/",
+				 "user/tests/arena/esc\\/aped",
+				 "user:owner/tests/arena",
+				 "user",
+				 "/",
+				 0 };
+
+	for (const char ** name = names; *name; ++name)
+	{
+		KeySet * ks = ksNew (0, KS_END);
+		Key * expected = keyNew (*name, KEY_END);
+		Key * key = elektraKsArenaKeyNew (ks, *name, 0, 0);
+		exit_if_fail (key, "could not create arena key");
+
+		succeed_if_same_string (keyName (key), keyName (expected));
+		succeed_if (keyGetNameSize (key) == keyGetNameSize (expected), "name size differs");
+		succeed_if (key->keyUSize == expected->keyUSize, "unescaped name size differs");
+		succeed_if (!memcmp (keyUnescapedName (key), keyUnescapedName (expected), key->keyUSize), "unescaped name differs");
+		succeed_if (key->data.v == 0, "value should be null");
+		succeed_if (ksLookup (ks, expected, 0) == key, "lookup did not find arena key");
+
+		keyDel (expected);
+		ksDel (ks);
+	}
+
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (elektraKsArenaKeyNew (ks, "invalid", 0, 0) == 0, "invalid name accepted");
+	succeed_if (elektraKsArenaKeyNew (ks, "", 0, 0) == 0, "empty name accepted");
+	succeed_if (elektraKsArenaKeyNew (ks, 0, 0, 0) == 0, "null name accepted");
+	succeed_if (elektraKsArenaKeyNew (0, "user/tests", 0, 0) == 0, "null keyset accepted");
+	succeed_if (ksGetSize (ks) == 0, "invalid keys appended");
+	ksDel (ks);
+}
+
+static void test_arenaMany (void)
+{
+	printf ("Test many arena keys\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	char name[64];
+	char value[64];
+
+	// enough keys for several blocks
+	const int count = 5000;
+	for (int i = 0; i < count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/arena/key%d", i);
+		snprintf (value, sizeof (value), "value%d", i);
+		succeed_if (elektraKsArenaKeyNew (ks, name, value, strlen (value) + 1) != 0, "could not create arena key");
+	}
+	succeed_if (ksGetSize (ks) == count, "wrong size");
+
+	// a value larger than a block
+	char * large = elektraCalloc (ELEKTRA_ARENA_BLOCK_SIZE * 2);
+	memset (large, 'x', ELEKTRA_ARENA_BLOCK_SIZE * 2 - 1);
+	Key * largeKey = elektraKsArenaKeyNew (ks, "user/tests/arena/large", large, ELEKTRA_ARENA_BLOCK_SIZE * 2);
+	exit_if_fail (largeKey, "could not create large key");
+	succeed_if_same_string (keyString (largeKey), large);
+	elektraFree (large);
+
+	for (int i = 0; i < count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/arena/key%d", i);
+		snprintf (value, sizeof (value), "value%d", i);
+		Key * found = ksLookupByName (ks, name, 0);
+		exit_if_fail (found, "arena key not found");
+		succeed_if_same_string (keyString (found), value);
+	}
+
+	KeySet * dup = ksDeepDup (ks);
+	compare_keyset (dup, ks);
+	ksDel (dup);
+
+	ksDel (ks);
+}
+
+static void test_arenaEscape (void)
+{
+	printf ("Test arena keys outliving their keyset\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	KeySet * other = ksNew (0, KS_END);
+
+	Key * appended = elektraKsArenaKeyNew (ks, "user/tests/arena/appended", "appended", sizeof ("appended"));
+	Key * popped = elektraKsArenaKeyNew (ks, "user/tests/arena/popped", "popped", sizeof ("popped"));
+	Key * dup = keyDup (appended);
+	ksAppendKey (other, appended);
+	keyIncRef (popped);
+	succeed_if (ksLookup (ks, popped, KDB_O_POP) == popped, "could not pop key");
+	keyDecRef (popped);
+
+	ksDel (ks);
+
+	succeed_if_same_string (keyName (appended), "user/tests/arena/appended");
+	succeed_if_same_string (keyString (appended), "appended");
+	succeed_if_same_string (keyName (dup), "user/tests/arena/appended");
+	succeed_if_same_string (keyString (dup), "appended");
+	succeed_if (dup->arena == 0, "duplicate should not be within the arena");
+	keyDel (dup);
+
+	// modifications copy name and value out of the arena,
+	// the name of keys which were in a keyset is locked
+	clear_bit (popped->flags, KEY_FLAG_RO_NAME);
+	succeed_if (keySetString (popped, keyString (popped)) > 0, "could not set value to own value");
+	succeed_if_same_string (keyString (popped), "popped");
+	succeed_if (keyAddBaseName (popped, "base") > 0, "could not add base name");
+	succeed_if_same_string (keyName (popped), "user/tests/arena/popped/base");
+	succeed_if (keyAddName (popped, "../added") > 0, "could not add name");
+	succeed_if_same_string (keyName (popped), "user/tests/arena/popped/added");
+	succeed_if (keySetBaseName (popped, "set") > 0, "could not set base name");
+	succeed_if_same_string (keyName (popped), "user/tests/arena/popped/set");
+	succeed_if_same_string (keyBaseName (popped), "set");
+	succeed_if (keySetBinary (popped, "bin", 3) == 3, "could not set binary");
+	succeed_if (keyGetValueSize (popped) == 3, "wrong value size");
+
+	Key * copied = elektraKsArenaKeyNew (other, "user/tests/arena/copied", "copied", sizeof ("copied"));
+	keyIncRef (copied);
+	succeed_if (ksLookup (other, copied, KDB_O_POP) == copied, "could not pop key");
+	keyDecRef (copied);
+	clear_bit (copied->flags, KEY_FLAG_RO_NAME);
+	succeed_if (keyCopy (copied, popped) == 1, "could not copy into arena key");
+	succeed_if_same_string (keyName (copied), "user/tests/arena/popped/set");
+	succeed_if (keyCopy (copied, 0) == 0, "could not clear arena key");
+	succeed_if (keySetName (copied, "user/tests/arena/renamed") > 0, "could not rename cleared arena key");
+	succeed_if_same_string (keyName (copied), "user/tests/arena/renamed");
+
+	keyDel (copied);
+	keyDel (popped);
+	ksDel (other);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("ARENA      TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_arenaNames ();
+	test_arenaMany ();
+	test_arenaEscape ();
+
+	printf ("\ntest_arena RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
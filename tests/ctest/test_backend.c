@@ -244,6 +244,91 @@ static void test_backref (void)
 	ksDel (modules);
 }
 
+static void test_lazy (void)
+{
+	printf ("Test lazy opening of backend\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Backend * backend = backendOpenLazy (set_simple (), 0);
+	exit_if_fail (backend != 0, "there should be a backend");
+	succeed_if (backend->pluginConfig != 0, "configuration of plugins should be kept");
+	for (int i = 0; i < NR_OF_PLUGINS; ++i)
+	{
+		succeed_if (backend->getplugins[i] == 0, "there should be no plugin");
+		succeed_if (backend->setplugins[i] == 0, "there should be no plugin");
+		succeed_if (backend->errorplugins[i] == 0, "there should be no plugin");
+	}
+
+	Key * mp;
+	succeed_if ((mp = backend->mountpoint) != 0, "no mountpoint found");
+	succeed_if_same_string (keyName (mp), "user/tests/backend/simple");
+	succeed_if_same_string (keyString (mp), "simple");
+
+	succeed_if (backendOpenPlugins (backend, modules, 0) == 0, "could not open plugins");
+	succeed_if (backend->pluginConfig == 0, "configuration of plugins should be consumed");
+	exit_if_fail (backend->getplugins[1] != 0, "there should be a plugin");
+	exit_if_fail (backend->setplugins[1] != 0, "there should be a plugin");
+	Plugin * plugin = backend->getplugins[1];
+
+	KeySet * test_config = set_pluginconf ();
+	KeySet * config = elektraPluginGetConfig (plugin);
+	succeed_if (config != 0, "there should be a config");
+	compare_keyset (config, test_config);
+	ksDel (test_config);
+
+	succeed_if (backendOpenPlugins (backend, modules, 0) == 0, "opening plugins again should do nothing");
+	succeed_if (backend->getplugins[1] == plugin, "plugins should not be opened again");
+	backendClose (backend, 0);
+
+	// backends closed before their plugins were opened
+	backend = backendOpenLazy (set_simple (), 0);
+	exit_if_fail (backend != 0, "there should be a backend");
+	backendClose (backend, 0);
+
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void test_lazyMissing (void)
+{
+	printf ("Test lazy opening of backend with missing plugin\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	KeySet * conf = ksNew (5, keyNew ("system/elektra/mountpoints/lazymissing", KEY_END),
+			       keyNew ("system/elektra/mountpoints/lazymissing/getplugins", KEY_END),
+		      keyNew ("system/elektra/mountpoints/lazymissing/getplugins/#1does_not_exist", KEY_END),
+			       keyNew ("system/elektra/mountpoints/lazymissing/mountpoint", KEY_VALUE, "user/tests/backend/lazymissing", KEY_END),
+			       KS_END);
+	Key * errorKey = keyNew ("", KEY_END);
+	Backend * backend = backendOpenLazy (conf, errorKey);
+	exit_if_fail (backend != 0, "there should be a backend");
+	succeed_if_same_string (keyString (backend->mountpoint), "lazymissing");
+	succeed_if (keyGetMeta (errorKey, "warnings") == 0, "plugins should not be opened yet");
+
+	succeed_if (backendOpenPlugins (backend, modules, errorKey) == -1, "plugin should be missing");
+	succeed_if (keyGetMeta (errorKey, "warnings") != 0, "no warning for missing plugin");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+	succeed_if_same_string (keyName (backend->mountpoint), "user/tests/backend/lazymissing");
+	exit_if_fail (backend->getplugins[0] != 0, "there should be the missing plugin");
+	succeed_if (backend->getplugins[0] == backend->setplugins[0], "missing plugin should be used for get and set");
+	succeed_if (backend->getplugins[1] == 0, "there should be no plugin");
+
+	Key * parentKey = keyNew ("user/tests/backend/lazymissing", KEY_END);
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (backend->getplugins[0]->kdbGet (backend->getplugins[0], ks, parentKey) == -1, "missing backend should fail");
+	ksDel (ks);
+	keyDel (parentKey);
+
+	backendClose (backend, errorKey);
+	keyDel (errorKey);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("  BACKEND   TESTS\n");
@@ -254,6 +339,8 @@ int main (int argc, char ** argv)
 	test_simple ();
 	test_default ();
 	test_backref ();
+	test_lazy ();
+	test_lazyMissing ();
 
 	printf ("\ntest_backend RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
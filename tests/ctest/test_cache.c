@@ -0,0 +1,458 @@
+/**
+ * @file
+ *
+ * @brief Tests for the persistent cache of backend KeySets.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <tests_internal.h>
+
+static char cacheDirectory[1024];
+static char configFile[1024];
+
+static KeySet * createConfig (const char * enabled)
+{
+	return ksNew (10, keyNew (KDB_CACHE_CONFIG "/enabled", KEY_VALUE, enabled, KEY_END),
+		      keyNew (KDB_CACHE_CONFIG "/directory", KEY_VALUE, cacheDirectory, KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/cache", KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/cache/mountpoint", KEY_VALUE, "user/tests/cache", KEY_END), KS_END);
+}
+
+static KDB * createHandle (const char * enabled)
+{
+	KDB * handle = elektraCalloc (sizeof (struct _KDB));
+	KeySet * config = createConfig (enabled);
+	elektraCacheInit (handle, config);
+	ksDel (config);
+	return handle;
+}
+
+static void deleteHandle (KDB * handle)
+{
+	elektraCacheClose (handle);
+	elektraFree (handle);
+}
+
+static void writeConfigFile (const char * content)
+{
+	FILE * f = fopen (configFile, "w");
+	exit_if_fail (f, "could not open config file");
+	fputs (content, f);
+	fclose (f);
+}
+
+static int loadCache (KDB * handle, const Key * parent, KeySet * loaded)
+{
+	ElektraCacheStamp stamp;
+	return elektraCacheLoad (handle, parent, loaded, &stamp);
+}
+
+// stores the keys as if they were just read from the configuration file
+static int storeCache (KDB * handle, const Key * parent, KeySet * ks)
+{
+	ElektraCacheStamp stamp;
+	elektraCacheGetStamp (parent, &stamp);
+	return elektraCacheStore (handle, parent, ks, &stamp);
+}
+
+static void removeCacheDirectory (void)
+{
+	DIR * dir = opendir (cacheDirectory);
+	if (!dir) return;
+	struct dirent * entry;
+	char path[2048];
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, "..")) continue;
+		snprintf (path, sizeof (path), "%s/%s", cacheDirectory, entry->d_name);
+		unlink (path);
+	}
+	closedir (dir);
+	rmdir (cacheDirectory);
+}
+
+static KeySet * createKeys (void)
+{
+	Key * shared = keyNew ("user/tests/cache/shared", KEY_VALUE, "shared", KEY_META, "type", "string", KEY_META, "comment",
+			       "#0 shared", KEY_END);
+	Key * other = keyNew ("user/tests/cache/other", KEY_END);
+	keySetBinary (other, 0, 0);
+	keyCopyAllMeta (other, shared);
+
+	return ksNew (10, keyNew ("user/tests/cache", KEY_VALUE, "root", KEY_END), shared, other,
+		      keyNew ("user/tests/cache/empty", KEY_VALUE, "", KEY_END),
+		      keyNew ("user/tests/cache/binary", KEY_BINARY, KEY_SIZE, 4, KEY_VALUE, "a\0b", KEY_END),
+		      keyNew ("user/tests/cache/escaped\\/name/#0", KEY_VALUE, "array", KEY_META, "order", "4", KEY_END), KS_END);
+}
+
+static void test_cacheRoundtrip (void)
+{
+	printf ("Test cache roundtrip\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	succeed_if (handle->cacheDirectory != 0, "cache should be enabled");
+
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = createKeys ();
+	KeySet * loaded = ksNew (0, KS_END);
+
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache should be empty");
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	succeed_if (loadCache (handle, parent, loaded) == 1, "could not load cache");
+
+	compare_keyset (loaded, ks);
+	succeed_if (ksGetSize (loaded) == ksGetSize (ks), "size differs");
+
+	Key * binary = ksLookupByName (loaded, "user/tests/cache/binary", 0);
+	exit_if_fail (binary, "binary key missing");
+	succeed_if (keyIsBinary (binary), "key should be binary");
+	succeed_if (keyGetValueSize (binary) == 4, "wrong binary size");
+	succeed_if (!memcmp (keyValue (binary), "a\0b", 4), "wrong binary value");
+
+	Key * empty = ksLookupByName (loaded, "user/tests/cache/empty", 0);
+	exit_if_fail (empty, "empty key missing");
+	succeed_if_same_string (keyString (empty), "");
+
+	Key * null = ksLookupByName (loaded, "user/tests/cache/other", 0);
+	exit_if_fail (null, "null key missing");
+	succeed_if (keyValue (null) == 0, "null value not restored");
+
+	Key * shared = ksLookupByName (loaded, "user/tests/cache/shared", 0);
+	exit_if_fail (shared, "shared key missing");
+	succeed_if (keyGetMeta (shared, "type") == keyGetMeta (null, "type"), "metakeys should be shared again");
+	succeed_if_same_string (keyString (keyGetMeta (shared, "comment")), "#0 shared");
+	succeed_if (keySetMeta (shared, "type", "long") > 0, "could not change metadata");
+	succeed_if_same_string (keyString (keyGetMeta (null, "type")), "string");
+
+	Key * array = ksLookupByName (loaded, "user/tests/cache/escaped\\/name/#0", 0);
+	exit_if_fail (array, "escaped key missing");
+	succeed_if_same_string (keyBaseName (array), "#0");
+	succeed_if_same_string (keyString (keyGetMeta (array, "order")), "4");
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+static void test_cacheInvalidation (void)
+{
+	printf ("Test cache invalidation\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = createKeys ();
+	KeySet * loaded = ksNew (0, KS_END);
+
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+
+	ksAppendKey (loaded, keyNew ("user/tests/cache/appointed", KEY_END));
+	succeed_if (loadCache (handle, parent, loaded) == 0, "must not merge cache with appointed keys");
+	ksClear (loaded);
+
+	Key * otherParent = keyNew ("system/tests/cache", KEY_VALUE, configFile, KEY_END);
+	succeed_if (loadCache (handle, otherParent, loaded) == 0, "cache of other mountpoint used");
+	keyDel (otherParent);
+
+	KDB * otherHandle = createHandle ("1");
+	otherHandle->cacheConfigHash++;
+	succeed_if (loadCache (otherHandle, parent, loaded) == 0, "cache of other mount configuration used");
+	deleteHandle (otherHandle);
+
+	KDB * disabledHandle = createHandle ("0");
+	succeed_if (disabledHandle->cacheDirectory == 0, "cache should be disabled");
+	succeed_if (loadCache (disabledHandle, parent, loaded) == 0, "disabled cache used");
+	succeed_if (storeCache (disabledHandle, parent, ks) == 0, "disabled cache stored");
+	deleteHandle (disabledHandle);
+
+	struct timespec times[2] = { { 1000, 0 }, { 1000, 0 } };
+	succeed_if (utimensat (AT_FDCWD, configFile, times, 0) == 0, "could not change mtime");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "outdated cache used");
+	succeed_if (ksGetSize (loaded) == 0, "keys appended for outdated cache");
+
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	writeConfigFile ("changed configuration\n");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache of changed file used");
+
+	keySetString (parent, "/does/not/exist");
+	succeed_if (storeCache (handle, parent, ks) == 0, "missing file cached");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "missing file loaded");
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+static void test_cacheReplacedWhileReading (void)
+{
+	printf ("Test cache of file replaced while reading\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = createKeys ();
+	KeySet * loaded = ksNew (0, KS_END);
+
+	ElektraCacheStamp stamp;
+	succeed_if (elektraCacheLoad (handle, parent, loaded, &stamp) == 0, "cache should be empty");
+
+	// another process replaces the file while the plugins parse the old one
+	char tmpFile[1100];
+	snprintf (tmpFile, sizeof (tmpFile), "%s.tmp", configFile);
+	FILE * f = fopen (tmpFile, "w");
+	exit_if_fail (f, "could not open temporary file");
+	fputs ("some configuration\n", f);
+	fclose (f);
+	succeed_if (rename (tmpFile, configFile) == 0, "could not replace config file");
+
+	succeed_if (elektraCacheStore (handle, parent, ks, &stamp) == 0, "keys of replaced file stored");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "keys of replaced file loaded");
+
+	succeed_if (elektraCacheLoad (handle, parent, loaded, &stamp) == 0, "cache should be empty");
+	succeed_if (elektraCacheStore (handle, parent, ks, &stamp) == 1, "could not store cache");
+	succeed_if (loadCache (handle, parent, loaded) == 1, "could not load cache");
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+static void test_cacheCorrupt (void)
+{
+	printf ("Test corrupt cache\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = createKeys ();
+	KeySet * loaded = ksNew (0, KS_END);
+
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+
+	DIR * dir = opendir (cacheDirectory);
+	exit_if_fail (dir, "cache directory not created");
+	struct dirent * entry;
+	char path[2048];
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, "..")) continue;
+		snprintf (path, sizeof (path), "%s/%s", cacheDirectory, entry->d_name);
+		struct stat buf;
+		succeed_if (stat (path, &buf) == 0, "could not stat cache file");
+		succeed_if (truncate (path, buf.st_size / 2) == 0, "could not truncate cache file");
+	}
+	closedir (dir);
+
+	succeed_if (loadCache (handle, parent, loaded) == 0, "truncated cache used");
+	succeed_if (ksGetSize (loaded) == 0, "keys appended for truncated cache");
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+/**
+ * Replaces the first occurrence of find in all cache files, which keeps the file size.
+ */
+static void patchCacheFiles (const char * find, size_t findSize, const char * replace)
+{
+	DIR * dir = opendir (cacheDirectory);
+	exit_if_fail (dir, "cache directory not created");
+	struct dirent * entry;
+	char path[2048];
+	int patched = 0;
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, "..")) continue;
+		snprintf (path, sizeof (path), "%s/%s", cacheDirectory, entry->d_name);
+		FILE * f = fopen (path, "r+b");
+		exit_if_fail (f, "could not open cache file");
+		char content[4096];
+		size_t size = fread (content, 1, sizeof (content), f);
+		for (size_t i = 0; i + findSize <= size; ++i)
+		{
+			if (memcmp (content + i, find, findSize)) continue;
+			fseek (f, i, SEEK_SET);
+			fwrite (replace, 1, findSize, f);
+			patched = 1;
+			break;
+		}
+		fclose (f);
+	}
+	closedir (dir);
+	succeed_if (patched, "nothing patched in cache files");
+}
+
+static void test_cacheUnterminated (void)
+{
+	printf ("Test cache with unterminated strings\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = ksNew (1, keyNew ("user/tests/cache/unterminated", KEY_VALUE, "value", KEY_META, "meta", "metavalue", KEY_END),
+			     KS_END);
+	KeySet * loaded = ksNew (0, KS_END);
+
+	// the value of a string key
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	patchCacheFiles ("value\0", sizeof ("value"), "valuex");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "unterminated value used");
+	succeed_if (ksGetSize (loaded) == 0, "keys appended for unterminated value");
+	ksClear (loaded);
+
+	// the value of a metakey
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	patchCacheFiles ("metavalue\0", sizeof ("metavalue"), "metavaluex");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "unterminated metavalue used");
+	ksClear (loaded);
+
+	// the unescaped name, the only name preceded by a null byte
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	patchCacheFiles ("\0unterminated\0", sizeof ("\0unterminated"), "\0unterminatedx");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "unterminated unescaped name used");
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+static void chmodCacheFiles (mode_t mode)
+{
+	DIR * dir = opendir (cacheDirectory);
+	exit_if_fail (dir, "cache directory not created");
+	struct dirent * entry;
+	char path[2048];
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, "..")) continue;
+		snprintf (path, sizeof (path), "%s/%s", cacheDirectory, entry->d_name);
+		succeed_if (chmod (path, mode) == 0, "could not change mode of cache file");
+	}
+	closedir (dir);
+}
+
+static void test_cachePermissions (void)
+{
+	printf ("Test cache writable by others\n");
+
+	writeConfigFile ("some configuration\n");
+	KDB * handle = createHandle ("1");
+	Key * parent = keyNew ("user/tests/cache", KEY_VALUE, configFile, KEY_END);
+	KeySet * ks = createKeys ();
+	KeySet * loaded = ksNew (0, KS_END);
+
+	succeed_if (storeCache (handle, parent, ks) == 1, "could not store cache");
+	succeed_if (loadCache (handle, parent, loaded) == 1, "could not load private cache");
+	ksClear (loaded);
+
+	chmodCacheFiles (0620);
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache file writable by group used");
+	chmodCacheFiles (0602);
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache file writable by others used");
+	chmodCacheFiles (0600);
+
+	succeed_if (chmod (cacheDirectory, 0777) == 0, "could not change mode of cache directory");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache directory writable by others used");
+	succeed_if (chmod (cacheDirectory, 0700) == 0, "could not change mode of cache directory");
+
+	succeed_if (loadCache (handle, parent, loaded) == 1, "could not load private cache again");
+	compare_keyset (loaded, ks);
+
+	ksDel (loaded);
+	ksDel (ks);
+	keyDel (parent);
+	deleteHandle (handle);
+}
+
+static void test_cacheBootstrap (void)
+{
+	printf ("Test cache of bootstrap configuration\n");
+
+	writeConfigFile ("bootstrap configuration\n");
+	KDB * handle = elektraCalloc (sizeof (struct _KDB));
+
+	// the cache files cannot enable the bootstrap cache themselves
+	unsetenv ("ELEKTRA_BOOTSTRAP_CACHE");
+	elektraCacheInitBootstrap (handle);
+	succeed_if (handle->cacheDirectory == 0, "bootstrap cache used without being enabled");
+	elektraCacheClose (handle);
+
+	setenv ("ELEKTRA_BOOTSTRAP_CACHE", "1", 1);
+	elektraCacheInitBootstrap (handle);
+	exit_if_fail (handle->cacheDirectory, "bootstrap cache should use the default directory");
+	succeed_if_same_string (handle->cacheDirectory, cacheDirectory);
+
+	Key * parent = keyNew ("system/elektra", KEY_VALUE, configFile, KEY_END);
+	KeySet * disabled = createConfig ("0");
+	KeySet * enabled = createConfig ("1");
+	KeySet * loaded = ksNew (0, KS_END);
+
+	succeed_if (storeCache (handle, parent, enabled) == 0, "bootstrap cache must be read-only");
+	succeed_if (elektraCacheStoreBootstrap (handle, parent, disabled) == 0, "configuration disabling the cache stored");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "cache should be empty");
+
+	succeed_if (elektraCacheStoreBootstrap (handle, parent, enabled) == 1, "could not store bootstrap cache");
+	succeed_if (elektraCacheStoreBootstrap (handle, parent, enabled) == 0, "valid bootstrap cache stored again");
+	succeed_if (storeCache (handle, parent, enabled) == 0, "bootstrap cache must stay read-only");
+	succeed_if (loadCache (handle, parent, loaded) == 1, "could not load bootstrap cache");
+	compare_keyset (loaded, enabled);
+	ksClear (loaded);
+
+	KDB * otherHandle = createHandle ("1");
+	succeed_if (loadCache (otherHandle, parent, loaded) == 0, "bootstrap cache used after bootstrapping");
+	deleteHandle (otherHandle);
+
+	writeConfigFile ("changed bootstrap configuration\n");
+	succeed_if (loadCache (handle, parent, loaded) == 0, "outdated bootstrap cache used");
+
+	elektraCacheClose (handle);
+	unsetenv ("ELEKTRA_BOOTSTRAP_CACHE");
+	succeed_if (handle->cacheReadOnly == 0, "cache still read-only after closing");
+	elektraFree (handle);
+
+	ksDel (loaded);
+	ksDel (enabled);
+	ksDel (disabled);
+	keyDel (parent);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("CACHE      TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	// the default directory is used for bootstrapping
+	setenv ("XDG_CACHE_HOME", getenv ("HOME"), 1);
+	snprintf (cacheDirectory, sizeof (cacheDirectory), "%s/elektra", getenv ("HOME"));
+	snprintf (configFile, sizeof (configFile), "%s", elektraFilename ());
+
+	test_cacheRoundtrip ();
+	test_cacheInvalidation ();
+	test_cacheReplacedWhileReading ();
+	test_cacheCorrupt ();
+	test_cacheUnterminated ();
+	test_cachePermissions ();
+	test_cacheBootstrap ();
+
+	removeCacheDirectory ();
+
+	printf ("\ntest_cache RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file
+ *
+ * @brief Tests for the interning of metadata.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static KeySet * createSpec (size_t size)
+{
+	KeySet * ks = ksNew (size, KS_END);
+	char name[64];
+	for (size_t i = 0; i < size; ++i)
+	{
+		snprintf (name, sizeof (name), "spec/tests/intern/key%zu", i);
+		ksAppendKey (ks, keyNew (name, KEY_META, "type", "long", KEY_META, "check/range", "0-100", KEY_META, "default",
+					 i % 2 ? "1" : "2", KEY_END));
+	}
+	return ks;
+}
+
+static void test_intern (void)
+{
+	printf ("Test interning metadata\n");
+
+	KeySet * ks = createSpec (10);
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	exit_if_fail (pool, "could not create pool");
+
+	succeed_if (elektraInternPoolAdd (pool, ks) == 10, "wrong number of keys processed");
+
+	Key * k0 = ksAtCursor (ks, 0);
+	Key * k1 = ksAtCursor (ks, 1);
+	Key * k2 = ksAtCursor (ks, 2);
+	succeed_if (keyGetMeta (k0, "type") == keyGetMeta (k1, "type"), "metakeys not interned");
+	succeed_if (keyGetMeta (k0, "check/range") == keyGetMeta (k1, "check/range"), "metakeys not interned");
+	succeed_if (keyGetMeta (k0, "default") != keyGetMeta (k1, "default"), "different metakeys interned");
+	succeed_if (k0->meta != k1->meta, "different metadata shared");
+	succeed_if (k0->meta == k2->meta, "equal metadata not shared");
+	succeed_if_same_string (keyString (keyGetMeta (k1, "default")), "1");
+	succeed_if_same_string (keyString (keyGetMeta (k2, "default")), "2");
+
+	ElektraInternStats stats;
+	succeed_if (elektraInternPoolGetStats (pool, &stats) == 0, "could not get stats");
+	succeed_if (stats.keys == 4, "wrong number of metakeys");
+	succeed_if (stats.sets == 2, "wrong number of metadata sets");
+	succeed_if (stats.internedKeys == 8 * 3 + 2, "wrong number of interned metakeys");
+	succeed_if (stats.sharedSets == 8, "wrong number of shared metadata sets");
+	succeed_if (stats.savedBytes > 0, "no memory saved");
+
+	// adding the keys again changes nothing
+	succeed_if (elektraInternPoolAdd (pool, ks) == 10, "wrong number of keys processed");
+	ElektraInternStats again;
+	elektraInternPoolGetStats (pool, &again);
+	succeed_if (again.internedKeys == stats.internedKeys && again.sharedSets == stats.sharedSets, "keys interned again");
+
+	elektraInternPoolDel (pool);
+
+	// the keys still have their metadata
+	succeed_if_same_string (keyString (keyGetMeta (k2, "type")), "long");
+	ksDel (ks);
+}
+
+static void test_modify (void)
+{
+	printf ("Test modifying interned metadata\n");
+
+	KeySet * ks = createSpec (4);
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	elektraInternPoolAdd (pool, ks);
+
+	Key * k0 = ksAtCursor (ks, 0);
+	Key * k2 = ksAtCursor (ks, 2);
+	succeed_if (k0->meta == k2->meta, "equal metadata not shared");
+
+	keySetMeta (k0, "type", "string");
+	succeed_if (k0->meta != k2->meta, "modified metadata still shared");
+	succeed_if_same_string (keyString (keyGetMeta (k0, "type")), "string");
+	succeed_if_same_string (keyString (keyGetMeta (k2, "type")), "long");
+	succeed_if (keyGetMeta (k0, "check/range") == keyGetMeta (k2, "check/range"), "metakeys not kept");
+
+	// copies share the pooled metadata until they modify it
+	Key * k3 = ksAtCursor (ks, 3);
+	Key * copy = keyDup (k3);
+	const Key * type = keyGetMeta (copy, "type");
+	succeed_if (type == keyGetMeta (k3, "type"), "metadata of copy not shared");
+	keySetMeta (copy, "description", "copy");
+	KeySet * other = ksNew (1, copy, KS_END);
+	elektraInternPoolAdd (pool, other);
+	succeed_if (keyGetMeta (copy, "type") == keyGetMeta (k3, "type"), "metakey of copy not interned");
+	succeed_if_same_string (keyString (keyGetMeta (copy, "description")), "copy");
+
+	// keys still using the metadata keep it alive after the pool is deleted
+	elektraInternPoolDel (pool);
+	ksDel (other);
+	succeed_if_same_string (keyString (keyGetMeta (k2, "check/range")), "0-100");
+	ksDel (ks);
+}
+
+static void test_sharedUninterned (void)
+{
+	printf ("Test interning metadata shared with other keys\n");
+
+	KeySet * ks = createSpec (1);
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	elektraInternPoolAdd (pool, ks);
+	const Key * pooled = keyGetMeta (ksAtCursor (ks, 0), "type");
+
+	// the duplicate shares metadata which is not interned yet
+	Key * key = keyNew ("user/tests/intern/shared", KEY_META, "type", "long", KEY_META, "description", "shared", KEY_END);
+	Key * dup = keyDup (key);
+	const Key * original = keyGetMeta (dup, "type");
+	succeed_if (original != pooled, "metakey interned too early");
+
+	KeySet * other = ksNew (1, key, KS_END);
+	succeed_if (elektraInternPoolAdd (pool, other) == 1, "wrong number of keys processed");
+	succeed_if (keyGetMeta (key, "type") == pooled, "metakey not interned");
+	succeed_if (keyGetMeta (dup, "type") == original, "metadata of other key modified");
+	succeed_if (key->meta != dup->meta, "metadata still shared after interning");
+	succeed_if_same_string (keyString (keyGetMeta (dup, "type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (dup, "description")), "shared");
+
+	// interned metadata is shared without copying
+	Key * copy = keyDup (key);
+	KeySet * copies = ksNew (1, copy, KS_END);
+	elektraInternPoolAdd (pool, copies);
+	succeed_if (copy->meta == key->meta, "interned metadata copied");
+
+	elektraInternPoolDel (pool);
+	ksDel (copies);
+	ksDel (other);
+	keyDel (dup);
+	ksDel (ks);
+}
+
+static void test_purge (void)
+{
+	printf ("Test releasing unused metadata\n");
+
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	ElektraInternStats stats;
+	char value[64];
+	for (size_t round = 0; round < 100; ++round)
+	{
+		KeySet * ks = ksNew (0, KS_END);
+		for (size_t i = 0; i < 10; ++i)
+		{
+			snprintf (value, sizeof (value), "%zu", round * 10 + i);
+			Key * key = keyNew ("user/tests/intern", KEY_META, "default", value, KEY_END);
+			keyAddBaseName (key, value);
+			ksAppendKey (ks, key);
+		}
+		elektraInternPoolAdd (pool, ks);
+		ksDel (ks);
+	}
+
+	// metadata of deleted keys is released when the pool needs room
+	elektraInternPoolGetStats (pool, &stats);
+	succeed_if (stats.keys < 200, "unused metakeys not released");
+	succeed_if (stats.sets < 200, "unused metadata not released");
+	elektraInternPoolDel (pool);
+}
+
+static void test_null (void)
+{
+	printf ("Test interning with NULL pointers\n");
+
+	ElektraInternPool * pool = elektraInternPoolNew ();
+	KeySet * ks = ksNew (1, keyNew ("user/tests/intern", KEY_END), KS_END);
+	ElektraInternStats stats;
+
+	succeed_if (elektraInternPoolAdd (0, ks) == -1, "no error on NULL pool");
+	succeed_if (elektraInternPoolAdd (pool, 0) == -1, "no error on NULL keyset");
+	succeed_if (elektraInternPoolAdd (pool, ks) == 1, "key without metadata not processed");
+	succeed_if (elektraInternPoolGetStats (0, &stats) == -1, "no error on NULL pool");
+	succeed_if (elektraInternPoolGetStats (pool, 0) == -1, "no error on NULL stats");
+	elektraInternPoolDel (0);
+
+	ksDel (ks);
+	elektraInternPoolDel (pool);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("INTERN TESTS\n");
+	printf ("============\n\n");
+
+	init (argc, argv);
+
+	test_intern ();
+	test_modify ();
+	test_sharedUninterned ();
+	test_purge ();
+	test_null ();
+
+	printf ("\ntest_intern RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -1644,6 +1644,62 @@ static void test_keyFlags (void)
 	keyDel (key2);
 }
 
+static void test_keySetNameBuffer (void)
+{
+	printf ("Test elektraKeySetNameBuffer\n");
+
+	const char * names[] = { "",
+				 "/",
+				 "///",
+				 "/a//b/../c/./d",
+				 "user",
+				 "user/",
+				 "user//hello/.././world\\/x",
+				 "system/a/%/b/\\%",
+				 "spec/a/#0/b",
+				 "proc/x",
+				 "dir/x/..",
+				 "order",
+				 "check/type",
+				 "user/a/../../..",
+				 "user/hello/world",
+				 "/a/b",
+				 "/a/./b",
+				 "system/a.b/.c/%x/x%/...",
+				 "spec/a/#0/%",
+				 "dir/a/",
+				 "users/a" };
+
+	for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+	{
+		Key * expected = keyNew ("", KEY_END);
+		const ssize_t expectedSize = elektraKeySetName (expected, names[i], KEY_META_NAME | KEY_CASCADING_NAME);
+
+		struct _Key key;
+		keyInit (&key);
+		const size_t bufferSize = elektraKeyNameBufferSize (names[i]);
+		char * buffer = elektraMalloc (bufferSize);
+		succeed_if (elektraKeySetNameBuffer (&key, names[i], buffer) == expectedSize, "wrong size returned");
+		succeed_if (key.key == buffer, "name not in buffer");
+		succeed_if_same_string (keyName (&key), keyName (expected));
+		succeed_if (keyGetUnescapedNameSize (&key) == keyGetUnescapedNameSize (expected), "wrong unescaped size");
+		succeed_if (key.keySize + key.keyUSize <= bufferSize, "buffer too small");
+		succeed_if (!memcmp (keyUnescapedName (&key), keyUnescapedName (expected), keyGetUnescapedNameSize (expected)),
+			    "wrong unescaped name");
+		succeed_if (!keyCmp (&key, expected), "keys not equal");
+
+		elektraFree (buffer);
+		keyDel (expected);
+	}
+
+	struct _Key key;
+	keyInit (&key);
+	char buffer[64];
+	succeed_if (elektraKeySetNameBuffer (&key, "user:owner/a", buffer) == -1, "owner in name should not be supported");
+	succeed_if (elektraKeySetNameBuffer (&key, "invalid", 0) == -1, "NULL buffer should not be accepted");
+	succeed_if (elektraKeySetNameBuffer (&key, "user/invalid\\", buffer) == -1, "invalid name should not be set");
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KEY      TESTS\n");
@@ -1672,6 +1728,7 @@ int main (int argc, char ** argv)
 	test_keyCopy ();
 	test_keyFixedNew ();
 	test_keyFlags ();
+	test_keySetNameBuffer ();
 
 	printf ("\ntest_key RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -80,6 +80,71 @@ static void test_cascadingLookup (void)
 	ksDel (ks);
 }
 
+static void test_cascadingLookupNamespaces (void)
+{
+	printf ("test cascading lookup in all namespaces\n");
+
+	Key * proc;
+	Key * dir;
+	Key * user;
+	Key * system;
+	Key * root;
+	KeySet * ks = ksNew (10, proc = keyNew ("proc/tests/a\\/b/%", KEY_END), dir = keyNew ("dir/tests/a\\/b/\\%", KEY_END),
+			     user = keyNew ("user/tests/a\\/b/\\.", KEY_END), system = keyNew ("system/tests/a\\/b", KEY_END),
+			     root = keyNew ("/tests/x", KEY_CASCADING_NAME, KEY_END), KS_END);
+
+	succeed_if (ksLookupByName (ks, "/tests/a\\/b/%", 0) == proc, "proc key not found");
+	succeed_if (ksLookupByName (ks, "/tests/a\\/b/\\%", 0) == dir, "dir key not found");
+	succeed_if (ksLookupByName (ks, "/tests//a\\/b/./\\.", 0) == user, "user key not found");
+	succeed_if (ksLookupByName (ks, "/tests/a\\/b", 0) == system, "system key not found");
+	succeed_if (ksLookupByName (ks, "/tests/x", 0) == root, "cascading key not found");
+	succeed_if (ksLookupByName (ks, "/tests/a/b", 0) == 0, "key with unescaped slash found");
+
+	// the name of the search key is unchanged after the lookup
+	Key * search = keyNew ("/tests/a\\/b", KEY_CASCADING_NAME, KEY_END);
+	Key * expected = keyDup (search);
+	for (int i = 0; i < 3; ++i)
+	{
+		succeed_if (ksLookup (ks, search, 0) == system, "system key not found");
+		succeed_if_same_string (keyName (search), keyName (expected));
+		succeed_if (keyGetUnescapedNameSize (search) == keyGetUnescapedNameSize (expected), "unescaped name changed");
+		succeed_if (!memcmp (keyUnescapedName (search), keyUnescapedName (expected), keyGetUnescapedNameSize (expected)),
+			    "unescaped name changed");
+	}
+	keyDel (expected);
+	keyDel (search);
+
+	ksDel (ks);
+}
+
+static void test_longNameLookup (void)
+{
+	printf ("test lookup of names longer than the stack\n");
+
+	const size_t length = 16 * 1024 * 1024;
+	char * name = elektraMalloc (length + 1);
+	exit_if_fail (name, "could not allocate name");
+	memset (name, 'a', length);
+	memcpy (name, "user/", sizeof ("user/") - 1);
+	name[length] = '\0';
+
+	// user/aaa..., the cascading name /aaa... and the meta name aaa...
+	const char * cascading = name + sizeof ("user") - 1;
+	const char * metaName = cascading + 1;
+
+	Key * found = keyNew ("user/tests/long", KEY_END);
+	KeySet * ks = ksNew (10, found, KS_END);
+	succeed_if (ksLookupByName (ks, name, 0) == 0, "long name found");
+	succeed_if (ksLookupByName (ks, cascading, 0) == 0, "long cascading name found");
+	succeed_if (keyGetMeta (found, metaName) == 0, "long meta name found");
+	succeed_if (keySetMeta (found, metaName, "value") > 0, "could not set long meta name");
+	succeed_if_same_string (keyString (keyGetMeta (found, metaName)), "value");
+	succeed_if (ksLookupByName (ks, "/tests/long", 0) == found, "key not found");
+
+	ksDel (ks);
+	elektraFree (name);
+}
+
 static void test_creatingLookup (void)
 {
 	printf ("Test creating lookup\n");
@@ -156,6 +221,108 @@ static void test_creatingLookup (void)
 	ksDel (ks);
 }
 
+static void test_duplication (void)
+{
+	printf ("Test flat and deep duplication\n");
+
+	Key * a = keyNew ("user/tests/dup/a", KEY_VALUE, "a", KEY_META, "type", "string", KEY_END);
+	Key * b = keyNew ("user/tests/dup/b", KEY_BINARY, KEY_SIZE, 2, KEY_VALUE, "b", KEY_END);
+	Key * c = keyNew ("user/tests/dup/c", KEY_END);
+	KeySet * ks = ksNew (3, c, b, a, KS_END);
+	keyClearSync (b);
+
+	KeySet * flat = ksDup (ks);
+	succeed_if (ksCurrent (flat) == c, "cursor should be at the last key");
+	compare_keyset (flat, ks);
+	succeed_if (ksGetSize (flat) == 3, "wrong size of flat copy");
+	succeed_if (keyGetRef (a) == 2, "flat copy should reference keys");
+	succeed_if (ksLookupByName (flat, "user/tests/dup/b", 0) == b, "flat copy should contain the same keys");
+
+	KeySet * copied = ksNew (1, keyNew ("user/tests/dup/other", KEY_END), KS_END);
+	succeed_if (ksCopy (copied, ks) == 1, "could not copy keyset");
+	compare_keyset (copied, ks);
+	succeed_if (keyGetRef (a) == 3, "copy should reference keys");
+
+	KeySet * deep = ksDeepDup (ks);
+	compare_keyset (deep, ks);
+	Key * deepA = ksLookupByName (deep, "user/tests/dup/a", 0);
+	Key * deepB = ksLookupByName (deep, "user/tests/dup/b", 0);
+	exit_if_fail (deepA && deepB, "keys missing in deep copy");
+	succeed_if (deepA != a, "deep copy should duplicate keys");
+	succeed_if (keyGetRef (a) == 3, "deep copy should not reference keys");
+	succeed_if (keyGetMeta (deepA, "type") == keyGetMeta (a, "type"), "metakeys should be shared");
+	succeed_if (keyNeedSync (deepA), "sync flag not duplicated");
+	succeed_if (!keyNeedSync (deepB), "sync flag not duplicated");
+	succeed_if (keyIsBinary (deepB), "binary not duplicated");
+	succeed_if (keyGetValueSize (deepB) == 2, "binary value not duplicated");
+
+	succeed_if (keySetString (deepA, "changed") > 0, "could not change deep copy");
+	succeed_if (keySetMeta (deepA, "type", "long") > 0, "could not change metadata of deep copy");
+	succeed_if_same_string (keyString (a), "a");
+	succeed_if_same_string (keyString (keyGetMeta (a, "type")), "string");
+
+	ksDel (ks);
+	ksDel (flat);
+	ksDel (copied);
+	succeed_if_same_string (keyString (deepA), "changed");
+	succeed_if_same_string (keyName (deepB), "user/tests/dup/b");
+	ksDel (deep);
+}
+
+static void test_appendMerge (void)
+{
+	printf ("Test appending keysets by merging\n");
+
+	Key * b = keyNew ("user/tests/merge/b", KEY_VALUE, "old b", KEY_END);
+	Key * d = keyNew ("user/tests/merge/d", KEY_END);
+	KeySet * ks = ksNew (5, keyNew ("user/tests/merge/a", KEY_END), b, d, keyNew ("user/tests/merge/f", KEY_END), KS_END);
+	keyIncRef (b);
+
+	Key * newB = keyNew ("user/tests/merge/b", KEY_VALUE, "new b", KEY_END);
+	Key * e = keyNew ("user/tests/merge/e", KEY_END);
+	KeySet * toAppend = ksNew (5, keyNew ("system/tests/merge/a", KEY_END), newB, d, e, keyNew ("user/tests/merge/z", KEY_END), KS_END);
+
+	succeed_if (ksAppend (ks, toAppend) == 7, "wrong size after merge");
+	succeed_if (ksCurrent (ks) == ksLookupByName (ks, "user/tests/merge/z", 0), "cursor not at last appended key");
+	succeed_if (ksLookupByName (ks, "user/tests/merge/b", 0) == newB, "key not replaced");
+	succeed_if (keyGetRef (b) == 1, "replaced key still referenced");
+	succeed_if (keyGetRef (d) == 2, "same key referenced twice");
+	succeed_if (keyGetRef (e) == 2, "merged key not referenced");
+	succeed_if (keySetName (e, "user/tests/merge/renamed") == -1, "name of merged key not locked");
+
+	Key * cur;
+	Key * prev = 0;
+	ksRewind (ks);
+	while ((cur = ksNext (ks)) != 0)
+	{
+		succeed_if (!prev || keyCmp (prev, cur) < 0, "keyset not sorted after merge");
+		prev = cur;
+	}
+
+	// the last key merged replaces a key in the middle
+	Key * newF = keyNew ("user/tests/merge/f", KEY_VALUE, "new f", KEY_END);
+	KeySet * replacing = ksNew (2, keyNew ("user/tests/merge/c", KEY_END), newF, KS_END);
+	succeed_if (ksAppend (ks, replacing) == 8, "wrong size after merge");
+	succeed_if (ksCurrent (ks) == newF, "cursor not at last appended key");
+	succeed_if (ksAtCursor (ks, 2) == ksLookupByName (ks, "user/tests/merge/b", 0), "keys before merged keys moved");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 7)), "user/tests/merge/z");
+	ksDel (replacing);
+
+	// appending after the last key and to itself
+	KeySet * after = ksNew (2, keyNew ("user/tests/merge/zz", KEY_END), keyNew ("user/tests/merge/zzz", KEY_END), KS_END);
+	succeed_if (ksAppend (ks, after) == 10, "wrong size after appending");
+	succeed_if_same_string (keyName (ksCurrent (ks)), "user/tests/merge/zzz");
+	succeed_if (ksAppend (ks, ks) == 10, "wrong size after appending to itself");
+	succeed_if (ksAppend (after, ks) == 10, "wrong size after appending to smaller keyset");
+	compare_keyset (after, ks);
+
+	keyDecRef (b);
+	keyDel (b);
+	ksDel (after);
+	ksDel (toAppend);
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KS         TESTS\n");
@@ -166,7 +333,11 @@ int main (int argc, char ** argv)
 	test_elektraRenameKeys ();
 	test_elektraEmptyKeys ();
 	test_cascadingLookup ();
+	test_cascadingLookupNamespaces ();
+	test_longNameLookup ();
 	test_creatingLookup ();
+	test_duplication ();
+	test_appendMerge ();
 
 	printf ("\ntest_ks RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -0,0 +1,161 @@
+/**
+ * @file
+ *
+ * @brief Tests for the hash index of KeySets.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static KeySet * createKeySet (void)
+{
+	return ksNew (10, keyNew ("user/tests/hashindex/a", KEY_END), keyNew ("user/tests/hashindex/b", KEY_END),
+		      keyNew ("user/tests/hashindex/c", KEY_END), keyNew ("user/tests/hashindex/c/d", KEY_END),
+		      keyNew ("user/tests/hashindex/e", KEY_END), keyNew ("/tests/hashindex/a", KEY_END),
+		      keyNew ("system/tests/hashindex/a", KEY_END), KS_END);
+}
+
+/**
+ * Every key of ks must be found at its position,
+ * all other names must not be found.
+ */
+static void checkIndex (KeySet * ks)
+{
+	exit_if_fail (ks->hashIndex, "no hash index");
+
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		Key * key = keyDup (ks->array[i]);
+		succeed_if (ksLookup (ks, key, KDB_O_NOCASCADING) == ks->array[i], "key not found");
+		succeed_if (ksGetCursor (ks) == (cursor_t) i, "cursor not set to found key");
+		keyAddBaseName (key, "notthere");
+		succeed_if (ksLookup (ks, key, KDB_O_NOCASCADING) == 0, "key found which is not there");
+		keyDel (key);
+	}
+
+	succeed_if (elektraHashIndexIsBuild (ks->hashIndex), "hash index not build");
+}
+
+static void test_build (void)
+{
+	printf ("Test hash index build\n");
+
+	KeySet * ks = createKeySet ();
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/b", 0) != 0, "key not found");
+	succeed_if (ks->hashIndex == 0, "hash index without option");
+
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/nothere", KDB_O_HASHINDEX) == 0, "key found which is not there");
+	checkIndex (ks);
+
+	// names are compared unescaped
+	Key * found = ksLookupByName (ks, "user/tests//hashindex/./c/d/", 0);
+	exit_if_fail (found, "not canonical name not found");
+	succeed_if_same_string (keyName (found), "user/tests/hashindex/c/d");
+
+	// nocase lookups use the binary search
+	succeed_if (ksLookupByName (ks, "user/tests/HASHINDEX/a", KDB_O_NOCASE) != 0, "nocase lookup failed");
+
+	ksDel (ks);
+}
+
+static void test_insertRemove (void)
+{
+	printf ("Test hash index insertion and removal\n");
+
+	KeySet * ks = createKeySet ();
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/a", KDB_O_HASHINDEX) != 0, "key not found");
+
+	char name[64];
+	for (int i = 0; i < 200; ++i)
+	{
+		// insert at the beginning, in the middle and at the end
+		snprintf (name, sizeof (name), "user/tests/hashindex/%c/%d", "aez"[i % 3], i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+	succeed_if (ksGetSize (ks) == 207, "wrong size");
+	checkIndex (ks);
+
+	// replacing a key keeps its position
+	Key * replaced = keyNew ("user/tests/hashindex/c", KEY_VALUE, "replaced", KEY_END);
+	ksAppendKey (ks, replaced);
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/c", 0) == replaced, "replaced key not found");
+
+	// merging keys which only replace keys keeps the index
+	Key * mergedA = keyNew ("user/tests/hashindex/a", KEY_VALUE, "merged", KEY_END);
+	Key * mergedE = keyNew ("user/tests/hashindex/e", KEY_VALUE, "merged", KEY_END);
+	KeySet * merged = ksNew (2, mergedA, mergedE, KS_END);
+	ksAppend (ks, merged);
+	ksDel (merged);
+	succeed_if (elektraHashIndexIsBuild (ks->hashIndex), "hash index discarded by replacing keys");
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/a", 0) == mergedA, "merged key not found");
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/e", 0) == mergedE, "merged key not found");
+
+	for (int i = 0; i < 200; i += 2)
+	{
+		snprintf (name, sizeof (name), "user/tests/hashindex/%c/%d", "aez"[i % 3], i);
+		Key * popped = ksLookupByName (ks, name, KDB_O_POP);
+		succeed_if (popped != 0, "could not pop key");
+		succeed_if_same_string (keyName (popped), name);
+		keyDel (popped);
+		succeed_if (ksLookupByName (ks, name, 0) == 0, "popped key found");
+	}
+	keyDel (ksPop (ks));
+	keyDel (elektraKsPopAtCursor (ks, 3));
+	succeed_if (ksGetSize (ks) == 105, "wrong size");
+	checkIndex (ks);
+
+	ksDel (ks);
+}
+
+static void test_bulk (void)
+{
+	printf ("Test hash index with bulk operations\n");
+
+	KeySet * ks = createKeySet ();
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/a", KDB_O_HASHINDEX) != 0, "key not found");
+
+	KeySet * copy = ksDup (ks);
+	checkIndex (copy);
+	ksDel (copy);
+
+	copy = ksDeepDup (ks);
+	checkIndex (copy);
+	ksDel (copy);
+
+	Key * cutpoint = keyNew ("user/tests/hashindex/c", KEY_END);
+	KeySet * cut = ksCut (ks, cutpoint);
+	succeed_if (ksGetSize (cut) == 2, "wrong size of cut keyset");
+	succeed_if (ksLookup (ks, cutpoint, 0) == 0, "cut key found");
+	// the index is rebuild with the next lookup
+	checkIndex (ks);
+	keyDel (cutpoint);
+
+	ksAppend (ks, cut);
+	checkIndex (ks);
+	ksDel (cut);
+
+	ksClear (ks);
+	succeed_if (ksLookupByName (ks, "user/tests/hashindex/a", 0) == 0, "key found in empty keyset");
+	ksAppendKey (ks, keyNew ("user/tests/hashindex/a", KEY_END));
+	checkIndex (ks);
+
+	ksDel (ks);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("KS HASHINDEX TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_build ();
+	test_insertRemove ();
+	test_bulk ();
+
+	printf ("\ntest_ks_hashindex RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
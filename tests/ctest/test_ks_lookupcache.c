@@ -0,0 +1,192 @@
+/**
+ * @file
+ *
+ * @brief Tests for the cache of cascading and specification lookups.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static KeySet * createKeySet (void)
+{
+	return ksNew (10, keyNew ("user/tests/lookupcache/a", KEY_VALUE, "user a", KEY_END),
+		      keyNew ("system/tests/lookupcache/a", KEY_VALUE, "system a", KEY_END),
+		      keyNew ("system/tests/lookupcache/b", KEY_VALUE, "system b", KEY_END),
+		      keyNew ("user/tests/lookupcache/c", KEY_VALUE, "user c", KEY_END), KS_END);
+}
+
+static void test_hit (void)
+{
+	printf ("Test lookup cache hits\n");
+
+	KeySet * ks = createKeySet ();
+	Key * a = ksLookupByName (ks, "user/tests/lookupcache/a", 0);
+	Key * b = ksLookupByName (ks, "system/tests/lookupcache/b", 0);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		ksRewind (ks);
+		succeed_if (ksLookupByName (ks, "/tests/lookupcache/a", 0) == a, "wrong key found");
+		succeed_if (ksCurrent (ks) == a, "cursor not set to found key");
+		succeed_if (ksLookupByName (ks, "/tests/lookupcache/b", 0) == b, "wrong key found");
+		succeed_if (ksCurrent (ks) == b, "cursor not set to found key");
+		succeed_if (ksLookupByName (ks, "/tests/lookupcache/notthere", 0) == 0, "key found which is not there");
+	}
+	succeed_if (ks->lookupCache != 0, "no lookup cache");
+
+	// other options are different lookups
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/a", KDB_O_NOCASCADING) == 0, "cascading key found");
+
+	// the lookup key is copied
+	Key * key = keyNew ("/tests/lookupcache/a", KEY_END);
+	succeed_if (ksLookup (ks, key, 0) == a, "wrong key found");
+	keySetName (key, "/tests/lookupcache/b");
+	succeed_if (ksLookup (ks, key, 0) == b, "wrong key found after renaming lookup key");
+	keyDel (key);
+
+	ksDel (ks);
+}
+
+static void test_invalidate (void)
+{
+	printf ("Test lookup cache invalidation\n");
+
+	KeySet * ks = createKeySet ();
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/b", 0) == ksLookupByName (ks, "system/tests/lookupcache/b", 0),
+		    "wrong key found");
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/d", 0) == 0, "key found which is not there");
+
+	// append
+	Key * b = keyNew ("user/tests/lookupcache/b", KEY_END);
+	ksAppendKey (ks, b);
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/b", 0) == b, "appended key not found");
+	Key * d = keyNew ("system/tests/lookupcache/d", KEY_END);
+	ksAppendKey (ks, d);
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/d", 0) == d, "appended key not found");
+
+	// replace
+	Key * replaced = keyNew ("user/tests/lookupcache/b", KEY_END);
+	ksAppendKey (ks, replaced);
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/b", 0) == replaced, "replaced key not found");
+
+	// pop
+	keyDel (ksLookupByName (ks, "user/tests/lookupcache/b", KDB_O_POP));
+	succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/b", 0)), "system/tests/lookupcache/b");
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/d", 0) == d, "wrong key found");
+	keyDel (ksLookupByName (ks, "system/tests/lookupcache/d", KDB_O_POP));
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/d", 0) == 0, "popped key found");
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/c", 0) != 0, "key not found");
+	keyDel (ksPop (ks));
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/c", 0) == 0, "popped key found");
+	ksAppendKey (ks, keyNew ("user/tests/lookupcache/c", KEY_END));
+
+	// cut
+	Key * cutpoint = keyNew ("user/tests/lookupcache", KEY_END);
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/c", 0) != 0, "key not found");
+	ksDel (ksCut (ks, cutpoint));
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/c", 0) == 0, "cut key found");
+	succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/a", 0)), "system/tests/lookupcache/a");
+	keyDel (cutpoint);
+
+	// clear
+	ksClear (ks);
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/a", 0) == 0, "key found in empty keyset");
+
+	ksDel (ks);
+}
+
+static void test_spec (void)
+{
+	printf ("Test lookup cache with specifications\n");
+
+	Key * specKey = keyNew ("/tests/lookupcache/a", KEY_META, "override/#0", "/tests/lookupcache/c", KEY_END);
+	KeySet * ks = createKeySet ();
+
+	for (int i = 0; i < 2; ++i)
+	{
+		succeed_if_same_string (keyName (ksLookup (ks, specKey, KDB_O_SPEC)), "user/tests/lookupcache/c");
+	}
+
+	// the metadata of the lookup key changed
+	keySetMeta (specKey, "override/#0", "/tests/lookupcache/b");
+	succeed_if_same_string (keyName (ksLookup (ks, specKey, KDB_O_SPEC)), "system/tests/lookupcache/b");
+	keySetMeta (specKey, "override/#0", 0);
+	succeed_if_same_string (keyName (ksLookup (ks, specKey, KDB_O_SPEC)), "user/tests/lookupcache/a");
+
+	// defaults are added once
+	keySetMeta (specKey, "default", "default d");
+	keySetName (specKey, "/tests/lookupcache/d");
+	Key * found = ksLookup (ks, specKey, KDB_O_SPEC);
+	exit_if_fail (found, "default key not created");
+	succeed_if_same_string (keyString (found), "default d");
+	succeed_if (ksLookup (ks, specKey, KDB_O_SPEC) == found, "default key not found again");
+	succeed_if (ksGetSize (ks) == 5, "wrong size");
+
+	keyDel (specKey);
+	ksDel (ks);
+}
+
+static void test_specKey (void)
+{
+	printf ("Test lookup cache with specification keys\n");
+
+	KeySet * ks = createKeySet ();
+	Key * specKey = keyNew ("spec/tests/lookupcache/a", KEY_META, "override/#0", "/tests/lookupcache/c", KEY_END);
+	ksAppendKey (ks, specKey);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/a", 0)), "user/tests/lookupcache/c");
+	}
+
+	// the metadata of the specification key within the keyset changed
+	keySetMeta (specKey, "override/#0", "/tests/lookupcache/b");
+	succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/a", 0)), "system/tests/lookupcache/b");
+	keySetMeta (specKey, "override/#0", 0);
+	succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/a", 0)), "user/tests/lookupcache/a");
+	keySetMeta (specKey, "namespace/#0", "system");
+	succeed_if_same_string (keyName (ksLookupByName (ks, "/tests/lookupcache/a", 0)), "system/tests/lookupcache/a");
+
+	ksDel (ks);
+}
+
+static void test_dup (void)
+{
+	printf ("Test lookup cache of copied keysets\n");
+
+	KeySet * ks = createKeySet ();
+	succeed_if (ksLookupByName (ks, "/tests/lookupcache/a", 0) != 0, "key not found");
+
+	KeySet * copy = ksDeepDup (ks);
+	Key * found = ksLookupByName (copy, "/tests/lookupcache/a", 0);
+	succeed_if (found == ksLookupByName (copy, "user/tests/lookupcache/a", 0), "key of other keyset found");
+
+	ksCopy (copy, 0);
+	succeed_if (ksLookupByName (copy, "/tests/lookupcache/a", 0) == 0, "key found in empty keyset");
+	ksCopy (copy, ks);
+	succeed_if (ksLookupByName (copy, "/tests/lookupcache/a", 0) == ksLookupByName (ks, "user/tests/lookupcache/a", 0),
+		    "wrong key found in copy");
+
+	ksDel (copy);
+	ksDel (ks);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("KS LOOKUPCACHE TESTS\n");
+	printf ("====================\n\n");
+
+	init (argc, argv);
+
+	test_hit ();
+	test_invalidate ();
+	test_spec ();
+	test_specKey ();
+	test_dup ();
+
+	printf ("\ntest_ks_lookupcache RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file
+ *
+ * @brief Tests for the memory usage of keys and KeySets.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static int isSum (const ElektraMemoryUsage * usage)
+{
+	return usage->total == usage->keys + usage->names + usage->values + usage->meta + usage->index + usage->slack;
+}
+
+static void test_key (void)
+{
+	printf ("Test memory usage of keys\n");
+
+	ElektraMemoryUsage usage;
+	Key * key = keyNew ("user/tests/memoryusage", KEY_VALUE, "value", KEY_END);
+	succeed_if (keyMemoryUsage (key, &usage) == (ssize_t) usage.total, "wrong total returned");
+	succeed_if (isSum (&usage), "total is not the sum of the categories");
+	succeed_if (usage.keys == sizeof (Key), "wrong size of key struct");
+	succeed_if (usage.names == (size_t) keyGetNameSize (key) + keyGetUnescapedNameSize (key), "wrong size of names");
+	succeed_if (usage.values == sizeof ("value"), "wrong size of value");
+	succeed_if (usage.meta == 0, "metadata counted for key without metadata");
+
+	keySetMeta (key, "description", "a key");
+	size_t withoutMeta = usage.total;
+	keyMemoryUsage (key, &usage);
+	succeed_if (usage.meta >= sizeof (KeySet) + sizeof (Key) + sizeof ("a key"), "metadata not counted");
+	succeed_if (usage.total == withoutMeta + usage.meta, "metadata changed other categories");
+
+	succeed_if (keyMemoryUsage (0, &usage) == -1, "no error on NULL key");
+	succeed_if (keyMemoryUsage (key, 0) == -1, "no error on NULL usage");
+	keyDel (key);
+}
+
+static void test_keySet (void)
+{
+	printf ("Test memory usage of keysets\n");
+
+	ElektraMemoryUsage usage;
+	KeySet * ks = ksNew (0, KS_END);
+	ksMemoryUsage (ks, &usage);
+	succeed_if (isSum (&usage), "total is not the sum of the categories");
+	succeed_if (usage.keys == sizeof (KeySet), "wrong size of empty keyset");
+	succeed_if (usage.names == 0 && usage.values == 0 && usage.meta == 0, "empty keyset has keys");
+
+	ksAppendKey (ks, keyNew ("user/tests/memoryusage/a", KEY_VALUE, "1", KEY_END));
+	ksAppendKey (ks, keyNew ("user/tests/memoryusage/b", KEY_VALUE, "2", KEY_END));
+	ksMemoryUsage (ks, &usage);
+	succeed_if (isSum (&usage), "total is not the sum of the categories");
+	succeed_if (usage.keys == sizeof (KeySet) + 2 * (sizeof (Key) + sizeof (Key *)), "wrong size of keys");
+	succeed_if (usage.values == 2 * sizeof ("1"), "wrong size of values");
+	succeed_if (usage.slack == (ks->alloc - 2) * sizeof (Key *), "wrong slack");
+
+	succeed_if (ksMemoryUsage (0, &usage) == -1, "no error on NULL keyset");
+	succeed_if (ksMemoryUsage (ks, 0) == -1, "no error on NULL usage");
+	ksDel (ks);
+}
+
+static void test_sharedMeta (void)
+{
+	printf ("Test memory usage of shared metadata\n");
+
+	ElektraMemoryUsage single;
+	ElektraMemoryUsage shared;
+	ElektraMemoryUsage copied;
+
+	Key * key = keyNew ("user/tests/memoryusage/a", KEY_META, "type", "long", KEY_META, "default", "5", KEY_END);
+	KeySet * ks = ksNew (1, key, KS_END);
+	ksMemoryUsage (ks, &single);
+
+	// duplicated keys share their metadata, so it is counted once
+	Key * dup = keyDup (key);
+	keySetName (dup, "user/tests/memoryusage/b");
+	ksAppendKey (ks, dup);
+	ksMemoryUsage (ks, &shared);
+	succeed_if (shared.meta == single.meta, "shared metadata counted twice");
+
+	// modified metadata is not shared anymore
+	keySetMeta (dup, "default", "6");
+	ksMemoryUsage (ks, &copied);
+	succeed_if (copied.meta > shared.meta, "copied metadata not counted");
+
+	ksDel (ks);
+}
+
+static void test_index (void)
+{
+	printf ("Test memory usage of lookup tables\n");
+
+	ElektraMemoryUsage before;
+	ElektraMemoryUsage after;
+	KeySet * ks = ksNew (0, KS_END);
+	char name[64];
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/memoryusage/key%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+	ksMemoryUsage (ks, &before);
+
+	// cascading lookups fill the lookup cache
+	succeed_if (ksLookupByName (ks, "/tests/memoryusage/key42", 0) != 0, "key not found");
+	ksMemoryUsage (ks, &after);
+	succeed_if (after.index > before.index, "lookup tables not counted");
+	succeed_if (after.keys == before.keys && after.names == before.names, "lookup changed other categories");
+
+	ksDel (ks);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("MEMORY USAGE TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_key ();
+	test_keySet ();
+	test_sharedMeta ();
+	test_index ();
+
+	printf ("\ntest_memoryusage RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -508,6 +508,144 @@ static void test_top (void)
 	ksDel (testCycleOrder3);
 	elektraFree (array);
 }
+
+static void test_shared (void)
+{
+	printf ("Test sharing of metadata\n");
+
+	Key * key = keyNew ("user/shared", KEY_META, "type", "string", KEY_META, "order", "1", KEY_END);
+	Key * dup = keyDup (key);
+	succeed_if (dup->meta == key->meta, "metadata of duplicate should be shared");
+	succeed_if (keyGetMeta (dup, "type") == keyGetMeta (key, "type"), "metakeys should be the same");
+
+	// modifications only change the modified key
+	succeed_if (keySetMeta (dup, "type", "long") == sizeof ("long"), "could not set metadata");
+	succeed_if (dup->meta != key->meta, "metadata should not be shared after modification");
+	succeed_if_same_string (keyString (keyGetMeta (key, "type")), "string");
+	succeed_if_same_string (keyString (keyGetMeta (dup, "type")), "long");
+	succeed_if (keyGetMeta (dup, "order") == keyGetMeta (key, "order"), "unmodified metakeys should still be the same");
+
+	Key * copy = keyNew (0);
+	succeed_if (keyCopy (copy, key) == 1, "could not copy key");
+	succeed_if (copy->meta == key->meta, "metadata of copy should be shared");
+	succeed_if (keySetMeta (key, "order", 0) == 0, "could not remove metadata");
+	succeed_if (keyGetMeta (key, "order") == 0, "metadata not removed");
+	succeed_if_same_string (keyString (keyGetMeta (copy, "order")), "1");
+
+	// removing metadata which is not there does not copy
+	Key * other = keyDup (copy);
+	succeed_if (keySetMeta (other, "notthere", 0) == 0, "could not remove missing metadata");
+	succeed_if (other->meta == copy->meta, "metadata should still be shared");
+	keyDel (other);
+
+	Key * all = keyNew ("user/all", KEY_END);
+	succeed_if (keyCopyAllMeta (all, copy) == 1, "could not copy metadata");
+	succeed_if (all->meta == copy->meta, "metadata should be shared");
+	succeed_if (keyCopyMeta (all, dup, "type") == 1, "could not copy metakey");
+	succeed_if (all->meta != copy->meta, "metadata should not be shared after modification");
+	succeed_if_same_string (keyString (keyGetMeta (all, "type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (copy, "type")), "string");
+
+	// iterating over keys sharing metadata at the same time
+	Key * iter = keyDup (copy);
+	int count = 0;
+	keyRewindMeta (copy);
+	while (keyNextMeta (copy))
+	{
+		keyRewindMeta (iter);
+		while (keyNextMeta (iter))
+		{
+			++count;
+		}
+	}
+	succeed_if (count == 4, "nested iteration over shared metadata failed");
+	keyDel (iter);
+
+	// sharing the metadata while iterating over it keeps the position
+	Key * three = keyNew ("user/three", KEY_META, "a", "1", KEY_META, "b", "2", KEY_META, "c", "3", KEY_END);
+	Key * dups[4] = { 0 };
+	count = 0;
+	keyRewindMeta (three);
+	while (keyNextMeta (three) && count < 4)
+	{
+		dups[count++] = keyDup (three);
+	}
+	succeed_if (count == 3, "iteration restarted after the metadata was shared");
+	for (int i = 0; i < count; ++i)
+	{
+		keyDel (dups[i]);
+	}
+	Key * held = keyDup (three);
+	succeed_if (keyNextMeta (three) == 0, "iteration at the end restarted after the metadata was shared");
+	keyDel (held);
+
+	// looking up metadata does not touch the cursor of shared metadata
+	keyRewindMeta (three);
+	keyNextMeta (three);
+	held = keyDup (three);
+	succeed_if (keyGetMeta (held, "c") != 0, "metadata not found");
+	succeed_if_same_string (keyName (keyCurrentMeta (held)), "a");
+	succeed_if_same_string (keyName (keyNextMeta (three)), "b");
+	keyDel (held);
+
+	// modifying a duplicate does not touch the cursor of the shared metadata
+	keyRewindMeta (three);
+	keyNextMeta (three);
+	held = keyDup (three);
+	succeed_if (keySetMeta (held, "c", "4") > 0, "could not set metadata");
+	succeed_if_same_string (keyName (keyNextMeta (three)), "b");
+	succeed_if_same_string (keyString (keyGetMeta (three, "c")), "3");
+	keyDel (held);
+	keyDel (three);
+
+	// deleting keys in any order
+	keyDel (key);
+	succeed_if_same_string (keyString (keyGetMeta (copy, "order")), "1");
+	keyDel (copy);
+	keyDel (all);
+	succeed_if_same_string (keyString (keyGetMeta (dup, "type")), "long");
+	keyDel (dup);
+}
+
+static void test_interned (void)
+{
+	printf ("Test names of metadata\n");
+
+	const char * names[] = { "type",       "check/type",  "check/validation/message", "comment/#0", "comment/#0/start",
+				 "order",      "opt/long",    "internal/ini/order",	"override/#0", "meta",
+				 "check/typo", "comment/#00", "a/b/c",			   "comment/#1" };
+
+	Key * key = keyNew ("user/interned", KEY_END);
+	for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+	{
+		succeed_if (keySetMeta (key, names[i], names[i]) > 0, "could not set metadata");
+		const Key * meta = keyGetMeta (key, names[i]);
+		exit_if_fail (meta, "metadata not found");
+
+		Key * expected = keyNew (0);
+		elektraKeySetName (expected, names[i], KEY_META_NAME | KEY_EMPTY_NAME);
+		succeed_if_same_string (keyName (meta), keyName (expected));
+		succeed_if (keyGetUnescapedNameSize (meta) == keyGetUnescapedNameSize (expected), "wrong size of unescaped name");
+		succeed_if (!memcmp (keyUnescapedName (meta), keyUnescapedName (expected), keyGetUnescapedNameSize (expected)),
+			    "wrong unescaped name");
+		succeed_if_same_string (keyString (meta), names[i]);
+		keyDel (expected);
+
+		succeed_if (keySetName ((Key *) meta, "user/renamed") == -1, "name of metakey must be read-only");
+		succeed_if (keySetString ((Key *) meta, "changed") == -1, "value of metakey must be read-only");
+	}
+
+	// metakeys stay valid in other keys
+	Key * other = keyNew ("user/other", KEY_END);
+	keyCopyMeta (other, key, "check/type");
+	keyDel (key);
+	succeed_if_same_string (keyString (keyGetMeta (other, "check/type")), "check/type");
+	Key * dup = keyDup (keyGetMeta (other, "check/type"));
+	succeed_if_same_string (keyName (dup), "check/type");
+	keyDel (dup);
+	keyDel (other);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KEY META     TESTS\n");
@@ -524,6 +662,8 @@ int main (int argc, char ** argv)
 
 	test_metaArrayToKS ();
 	test_top ();
+	test_shared ();
+	test_interned ();
 	printf ("\ntest_meta RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
 	return nbError;
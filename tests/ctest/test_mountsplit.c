@@ -666,6 +666,68 @@ static void test_defaultonly (void)
 	ksDel (modules);
 }
 
+KeySet * lazy_config (void)
+{
+	return ksNew (10, keyNew ("system/elektra/mountpoints", KEY_END), keyNew ("system/elektra/mountpoints/lazy", KEY_END),
+		      keyNew ("system/elektra/mountpoints/lazy/getplugins", KEY_END),
+		      keyNew ("system/elektra/mountpoints/lazy/getplugins/#1does_not_exist", KEY_END),
+		      keyNew ("system/elektra/mountpoints/lazy/mountpoint", KEY_VALUE, "user/tests/lazy", KEY_END),
+		      keyNew ("system/elektra/mountpoints/other", KEY_END),
+		      keyNew ("system/elektra/mountpoints/other/getplugins", KEY_END),
+		      keyNew ("system/elektra/mountpoints/other/getplugins/#1does_not_exist", KEY_END),
+		      keyNew ("system/elektra/mountpoints/other/mountpoint", KEY_VALUE, "user/tests/other", KEY_END), KS_END);
+}
+
+static void test_lazy (void)
+{
+	printf ("Test lazy opening of plugins\n");
+
+	KDB * kdb = kdb_new ();
+	kdb->lazyBackends = 1;
+	kdb->modules = modules_config ();
+	Key * errorKey = keyNew (0);
+
+	succeed_if (mountOpen (kdb, lazy_config (), kdb->modules, errorKey) == 0, "could not open mount");
+	succeed_if (output_warnings (errorKey), "warnings found, plugins should not be opened");
+	succeed_if (kdb->split->size == 2, "size of split not correct");
+
+	Key * searchKey = keyNew ("user/tests/lazy", KEY_END);
+	Backend * lazy = trieLookup (kdb->trie, searchKey);
+	exit_if_fail (lazy, "there should be a backend");
+	succeed_if (lazy->pluginConfig != 0, "plugins should not be opened");
+	succeed_if_same_string (keyString (lazy->mountpoint), "lazy");
+	keySetName (searchKey, "user/tests/other");
+	Backend * other = trieLookup (kdb->trie, searchKey);
+	exit_if_fail (other, "there should be a backend");
+	succeed_if (other->pluginConfig != 0, "plugins should not be opened");
+
+	Key * parentKey = keyNew ("user/tests/lazy/below", KEY_END);
+	Split * split = splitNew ();
+	succeed_if (splitBuildup (split, kdb, parentKey) == 1, "could not build up split");
+	succeed_if (split->size == 1, "there should be one backend");
+	succeed_if (split->handles[0] == lazy, "wrong backend");
+	succeed_if (lazy->pluginConfig == 0, "plugins should be opened");
+	succeed_if_same_string (keyString (lazy->mountpoint), "missing");
+	succeed_if (keyGetMeta (parentKey, "warnings") != 0, "no warning about missing plugin");
+	succeed_if (other->pluginConfig != 0, "plugins of other backend should not be opened");
+	splitDel (split);
+
+	// the second buildup does not open the plugins again
+	keyDel (parentKey);
+	parentKey = keyNew ("user/tests/lazy", KEY_END);
+	split = splitNew ();
+	succeed_if (splitBuildup (split, kdb, parentKey) == 1, "could not build up split");
+	succeed_if (split->size == 1 && split->handles[0] == lazy, "wrong backend");
+	succeed_if (output_warnings (parentKey), "warnings found, plugins should be opened only once");
+	splitDel (split);
+
+	keyDel (parentKey);
+	keyDel (searchKey);
+	keyDel (errorKey);
+	ksDel (kdb->modules);
+	kdb_del (kdb);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("MOUNTSPLIT    TESTS\n");
@@ -682,6 +744,7 @@ int main (int argc, char ** argv)
 	test_default ();
 	test_modules ();
 	test_defaultonly ();
+	test_lazy ();
 
 	printf ("\ntest_mountsplit RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
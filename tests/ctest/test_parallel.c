@@ -0,0 +1,371 @@
+/**
+ * @file
+ *
+ * @brief Tests for the parallel execution of get-chains.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <../../src/libs/elektra/backend.c>
+#include <../../src/libs/elektra/mount.c>
+#include <../../src/libs/elektra/split.c>
+#include <../../src/libs/elektra/trie.c>
+#include <kdberrors.h>
+#include <tests_internal.h>
+
+static Split * currentSplit;
+static int unsafeSawAllSafe;
+static size_t resolved;
+static size_t expectedResolved;
+static int storageBeforeResolver;
+
+static int contractGet (Plugin * handle, KeySet * returned, Key * parentKey, const char * status)
+{
+	if (strncmp (keyName (parentKey), "system/elektra/modules/", sizeof ("system/elektra/modules/") - 1)) return 0;
+
+	Key * key = keyDup (parentKey);
+	keyAddName (key, "infos/status");
+	keySetString (key, status);
+	ksAppendKey (returned, key);
+	succeed_if_same_string (keyBaseName (parentKey), handle->name);
+	return 1;
+}
+
+static int safeGet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	if (contractGet (handle, returned, parentKey, "unittest threadsafe libc")) return 1;
+
+	Key * key = keyNew (keyName (parentKey), KEY_VALUE, keyString (parentKey), KEY_END);
+	keyAddBaseName (key, "key");
+	ksAppendKey (returned, key);
+
+	if (strstr (keyName (parentKey), "warn"))
+	{
+		ELEKTRA_ADD_WARNING (13, parentKey, "first warning");
+		ELEKTRA_ADD_WARNING (13, parentKey, "second warning");
+	}
+	if (strstr (keyName (parentKey), "fail"))
+	{
+		ELEKTRA_SET_ERROR (10, parentKey, "failing backend");
+		return -1;
+	}
+	return 1;
+}
+
+static int unsafeGet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	if (contractGet (handle, returned, parentKey, "unittest threadsafeness")) return 1;
+
+	// thread-safe backends are finished before the others start
+	unsafeSawAllSafe = 1;
+	for (size_t i = 0; i < currentSplit->size - 1; ++i)
+	{
+		if (!test_bit (currentSplit->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+		if (currentSplit->handles[i]->getplugins[STORAGE_PLUGIN]->kdbGet != safeGet) continue;
+		if (ksGetSize (currentSplit->keysets[i]) == 0) unsafeSawAllSafe = 0;
+	}
+
+	Key * key = keyNew (keyName (parentKey), KEY_END);
+	keyAddBaseName (key, "unsafe");
+	ksAppendKey (returned, key);
+	return 1;
+}
+
+static int safeSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	// all resolvers ran before
+	if (resolved != expectedResolved) storageBeforeResolver = 1;
+	ksNext (returned);
+
+	if (strstr (keyName (parentKey), "fail"))
+	{
+		ELEKTRA_SET_ERROR (10, parentKey, "failing backend");
+		return -1;
+	}
+	return 1;
+}
+
+static int getBackend (KDB * handle ELEKTRA_UNUSED, Split * split, size_t i, Key * parentKey)
+{
+	Plugin * plugin = split->handles[i]->getplugins[STORAGE_PLUGIN];
+	return plugin->kdbGet (plugin, split->keysets[i], parentKey) == -1 ? -1 : 0;
+}
+
+static int setResolver (KDB * handle ELEKTRA_UNUSED, Split * split, size_t i, Key * parentKey ELEKTRA_UNUSED,
+			Key ** errorKey ELEKTRA_UNUSED)
+{
+	if (strstr (keyName (split->parents[i]), "skip")) return 0;
+	++resolved;
+	return 1;
+}
+
+static int setBackend (KDB * handle ELEKTRA_UNUSED, Split * split, size_t i, Key * parentKey, Key ** errorKey)
+{
+	Plugin * plugin = split->handles[i]->setplugins[STORAGE_PLUGIN];
+	ksRewind (split->keysets[i]);
+	keySetName (parentKey, keyName (split->parents[i]));
+	if (plugin->kdbSet (plugin, split->keysets[i], parentKey) == -1)
+	{
+		*errorKey = ksCurrent (split->keysets[i]);
+		return -1;
+	}
+	return 1;
+}
+
+static Backend * createBackend (const char * name, kdbGetPtr get)
+{
+	Backend * backend = elektraCalloc (sizeof (struct _Backend));
+	Plugin * plugin = elektraCalloc (sizeof (struct _Plugin));
+	plugin->name = name;
+	plugin->kdbGet = get;
+	plugin->kdbSet = safeSet;
+	backend->getplugins[STORAGE_PLUGIN] = plugin;
+	backend->setplugins[STORAGE_PLUGIN] = plugin;
+	backend->mountpoint = keyNew ("user/tests/parallel", KEY_END);
+	return backend;
+}
+
+static void deleteBackend (Backend * backend)
+{
+	elektraFree (backend->getplugins[STORAGE_PLUGIN]);
+	keyDel (backend->mountpoint);
+	elektraFree (backend);
+}
+
+static void appendBackend (Split * split, Backend * backend, const char * name)
+{
+	Key * parent = keyNew (name, KEY_VALUE, "/path/to/file", KEY_END);
+	keyIncRef (parent);
+	splitAppend (split, backend, parent, SPLIT_FLAG_SYNC);
+}
+
+static Split * createSplit (Backend ** backends, size_t count, const char * prefix)
+{
+	char name[64];
+	Split * split = splitNew ();
+	for (size_t i = 0; i < count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/parallel/%s%zu", prefix, i);
+		appendBackend (split, backends[i], name);
+	}
+	// the bypass is never updated
+	appendBackend (split, 0, "user/tests/parallel/bypass");
+	return split;
+}
+
+static void test_parallelInit (void)
+{
+	printf ("Test parallel init\n");
+
+	KDB handle;
+	KeySet * config = ksNew (10, KS_END);
+	elektraParallelInit (&handle, config);
+	succeed_if (handle.parallelThreads == 0, "parallel update should be disabled by default");
+
+	ksAppendKey (config, keyNew (KDB_PARALLEL_CONFIG "/enabled", KEY_VALUE, "1", KEY_END));
+	ksAppendKey (config, keyNew (KDB_PARALLEL_CONFIG "/threads", KEY_VALUE, "3", KEY_END));
+	elektraParallelInit (&handle, config);
+	succeed_if (handle.parallelThreads == 3, "wrong number of threads");
+
+	ksAppendKey (config, keyNew (KDB_PARALLEL_CONFIG "/threads", KEY_VALUE, "1", KEY_END));
+	elektraParallelInit (&handle, config);
+	succeed_if (handle.parallelThreads == 0, "a single thread should disable the parallel update");
+
+	ksAppendKey (config, keyNew (KDB_PARALLEL_CONFIG "/enabled", KEY_VALUE, "0", KEY_END));
+	ksAppendKey (config, keyNew (KDB_PARALLEL_CONFIG "/threads", KEY_VALUE, "4", KEY_END));
+	elektraParallelInit (&handle, config);
+	succeed_if (handle.parallelThreads == 0, "parallel update should be disabled");
+
+	ksDel (config);
+}
+
+static void test_parallelGet (void)
+{
+	printf ("Test parallel get\n");
+
+	const size_t count = 20;
+	Backend * backends[20];
+	for (size_t i = 0; i < count; ++i)
+	{
+		backends[i] = i % 5 == 4 ? createBackend ("unsafe", unsafeGet) : createBackend ("safe", safeGet);
+	}
+
+	KDB handle;
+	handle.parallelThreads = 4;
+	Split * split = createSplit (backends, count, "warn");
+	currentSplit = split;
+	unsafeSawAllSafe = 0;
+	split->syncbits[1] = 0;
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	ELEKTRA_ADD_WARNING (13, parentKey, "existing warning");
+	succeed_if (elektraParallelGet (&handle, split, parentKey, getBackend) == 0, "parallel get failed");
+	succeed_if (unsafeSawAllSafe, "backend which is not thread-safe ran in parallel");
+	succeed_if (keyGetMeta (parentKey, "error") == 0, "error set");
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i == 1)
+		{
+			succeed_if (ksGetSize (split->keysets[i]) == 0, "backend without sync flag updated");
+			continue;
+		}
+		succeed_if (ksGetSize (split->keysets[i]) == 1, "backend not updated");
+		succeed_if (backends[i]->threadSafe == (i % 5 == 4 ? -1 : 1), "thread-safety not remembered");
+	}
+	succeed_if (ksGetSize (split->keysets[count]) == 0, "bypass updated");
+
+	// 1 existing and 2 warnings of every thread-safe backend (but index 1)
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings")), "30");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "existing warning");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/reason")), "first warning");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/mountpoint")), "user/tests/parallel/warn0");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#02/reason")), "second warning");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#03/mountpoint")), "user/tests/parallel/warn2");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#30/configfile")), "/path/to/file");
+
+	keyDel (parentKey);
+	splitDel (split);
+	for (size_t i = 0; i < count; ++i)
+	{
+		deleteBackend (backends[i]);
+	}
+}
+
+static void test_parallelGetShared (void)
+{
+	printf ("Test parallel get with shared backends and appointed keys\n");
+
+	Backend * shared = createBackend ("safe", safeGet);
+	Backend * backends[] = { shared, createBackend ("safe", safeGet), shared, createBackend ("safe", safeGet) };
+
+	KDB handle;
+	handle.parallelThreads = 8;
+	Split * split = createSplit (backends, 4, "key");
+	currentSplit = split;
+	ksAppendKey (split->keysets[3], keyNew ("user/tests/parallel/key3/appointed", KEY_END));
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	succeed_if (elektraParallelGet (&handle, split, parentKey, getBackend) == 0, "parallel get failed");
+	for (size_t i = 0; i < 3; ++i)
+	{
+		succeed_if (ksGetSize (split->keysets[i]) == 1, "backend not updated");
+	}
+	succeed_if (ksGetSize (split->keysets[3]) == 2, "backend with appointed keys not updated");
+	succeed_if (keyGetMeta (parentKey, "warnings") == 0, "warnings added");
+
+	keyDel (parentKey);
+	splitDel (split);
+	deleteBackend (backends[0]);
+	deleteBackend (backends[1]);
+	deleteBackend (backends[3]);
+}
+
+static void test_parallelGetError (void)
+{
+	printf ("Test parallel get with errors\n");
+
+	Backend * backends[6];
+	for (size_t i = 0; i < 6; ++i)
+	{
+		backends[i] = createBackend ("safe", safeGet);
+	}
+
+	KDB handle;
+	handle.parallelThreads = 2;
+	Split * split = createSplit (backends, 6, "key");
+	currentSplit = split;
+	keySetName (split->parents[2], "user/tests/parallel/fail2");
+	keySetName (split->parents[4], "user/tests/parallel/fail4");
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	succeed_if (elektraParallelGet (&handle, split, parentKey, getBackend) == -1, "error not reported");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/reason")), "failing backend");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/mountpoint")), "user/tests/parallel/fail2");
+	succeed_if_same_string (keyName (parentKey), "user/tests/parallel/fail2");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "failing backend");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/mountpoint")), "user/tests/parallel/fail4");
+
+	keyDel (parentKey);
+	splitDel (split);
+	for (size_t i = 0; i < 6; ++i)
+	{
+		deleteBackend (backends[i]);
+	}
+}
+
+static void test_parallelSet (void)
+{
+	printf ("Test parallel set\n");
+
+	const size_t count = 10;
+	Backend * backends[10];
+	for (size_t i = 0; i < count; ++i)
+	{
+		backends[i] = i % 3 == 2 ? createBackend ("unsafe", unsafeGet) : createBackend ("safe", safeGet);
+	}
+
+	KDB handle;
+	handle.parallelThreads = 3;
+	Split * split = createSplit (backends, count, "key");
+	currentSplit = split;
+	// kdbSet() has no bypass
+	splitRemove (split, count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ksAppendKey (split->keysets[i], keyNew ("user/tests/parallel/key", KEY_END));
+		ksAppendKey (split->keysets[i], keyNew ("user/tests/parallel/key/sub", KEY_END));
+		ksRewind (split->keysets[i]);
+	}
+	keySetName (split->parents[1], "user/tests/parallel/skip1");
+	keySetName (split->parents[3], "user/tests/parallel/fail3");
+	keySetName (split->parents[5], "user/tests/parallel/fail5");
+	keySetName (split->parents[8], "user/tests/parallel/fail8");
+	resolved = 0;
+	expectedResolved = count - 1;
+	storageBeforeResolver = 0;
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	Key * errorKey = 0;
+	succeed_if (elektraParallelSet (&handle, split, parentKey, &errorKey, setResolver, setBackend) == -1, "error not reported");
+	succeed_if (resolved == expectedResolved, "not all resolvers ran");
+	succeed_if (!storageBeforeResolver, "storage ran before all resolvers");
+	succeed_if (errorKey == ksHead (split->keysets[8]), "wrong error key");
+
+	// 3 is thread-safe and merged before 5 and 8 fail in this thread
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/mountpoint")), "user/tests/parallel/fail3");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/mountpoint")), "user/tests/parallel/fail5");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/mountpoint")), "user/tests/parallel/fail8");
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		// the set plugin moves the cursor to the first key
+		succeed_if ((ksCurrent (split->keysets[i]) != 0) == (i != 1), "set plugin did not run (or ran when skipped)");
+	}
+
+	keyDel (parentKey);
+	splitDel (split);
+	for (size_t i = 0; i < count; ++i)
+	{
+		deleteBackend (backends[i]);
+	}
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("PARALLEL   TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_parallelInit ();
+	test_parallelGet ();
+	test_parallelGetShared ();
+	test_parallelGetError ();
+	test_parallelSet ();
+
+	printf ("\ntest_parallel RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
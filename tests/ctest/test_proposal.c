@@ -54,6 +54,95 @@ static void test_ksToArray (void)
 	ksDel (ks);
 }
 
+static void test_ksLookupMany (void)
+{
+	printf ("test ksLookupMany\n");
+
+	KeySet * ks = ksNew (10, keyNew ("user/many/a", KEY_END), keyNew ("user/many/b", KEY_END), keyNew ("user/many/b/c", KEY_END),
+			     keyNew ("user/many/z", KEY_END), keyNew ("system/many/a", KEY_END), keyNew ("system/many/d", KEY_END),
+			     keyNew ("/many/e", KEY_END), KS_END);
+	const char * names[] = { "user/many/z", "user/many/notthere", "system/many/a", "user/many/b/c", "user//many/./a",
+				 "user/many/b/c", "/many/d",	"/many/e",		"user/MANY/a",   "",
+				 "invalid",     "system/many/a/..", "user:owner/many/b", "zzz/last" };
+	const size_t count = sizeof (names) / sizeof (names[0]);
+	Key * found[sizeof (names) / sizeof (names[0])];
+
+	ksRewind (ks);
+	ksNext (ks);
+	cursor_t cursor = ksGetCursor (ks);
+	succeed_if (ksLookupMany (ks, names, count, found, 0) == 8, "wrong number of keys found");
+	succeed_if (ksGetCursor (ks) == cursor, "cursor was changed");
+	for (size_t i = 0; i < count; ++i)
+	{
+		succeed_if (found[i] == ksLookupByName (ks, names[i], 0), "ksLookupMany differs from ksLookupByName");
+	}
+	succeed_if (found[3] == found[5], "same names found different keys");
+	succeed_if_same_string (keyName (found[6]), "system/many/d");
+
+	succeed_if (ksLookupMany (ks, names, count, found, KDB_O_NOCASCADING) == 7, "wrong number of keys found without cascading");
+	succeed_if (found[6] == 0, "cascading lookup done with KDB_O_NOCASCADING");
+	succeed_if (found[7] != 0, "cascading key not found with KDB_O_NOCASCADING");
+
+	succeed_if (ksLookupMany (ks, names, count, found, KDB_O_NOCASE) == 9, "wrong number of keys found without case");
+	succeed_if (found[8] == ksLookupByName (ks, "user/many/a", 0), "nocase key not found");
+
+	succeed_if (ksLookupMany (ks, names, 0, found, 0) == 0, "keys found without names");
+	succeed_if (ksLookupMany (0, names, count, found, 0) == -1, "no error on NULL keyset");
+	succeed_if (ksLookupMany (ks, 0, count, found, 0) == -1, "no error on NULL names");
+	succeed_if (ksLookupMany (ks, names, count, 0, 0) == -1, "no error on NULL result");
+	succeed_if (ksLookupMany (ks, names, count, found, KDB_O_POP) == -1, "no error on unsupported option");
+
+	KeySet * empty = ksNew (0, KS_END);
+	succeed_if (ksLookupMany (empty, names, count, found, 0) == 0, "keys found in empty keyset");
+	succeed_if (found[0] == 0, "result not cleared");
+	ksDel (empty);
+
+	ksDel (ks);
+}
+
+static void test_ksBuilder (void)
+{
+	printf ("test ksBuilder\n");
+
+	ElektraKsBuilder * builder = elektraKsBuilderNew (2);
+	exit_if_fail (builder, "could not create builder");
+
+	Key * first = keyNew ("user/builder/b", KEY_VALUE, "first", KEY_END);
+	keyIncRef (first);
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("user/builder/c", KEY_END)) == 1, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, first) == 2, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("system/builder/a", KEY_END)) == 3, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("user/builder/b", KEY_VALUE, "last", KEY_END)) == 4, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("user/builder/a", KEY_END)) == 5, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew (0)) == -1, "key without name added");
+	succeed_if (keySetName (first, "user/builder/renamed") == -1, "name of added key not locked");
+
+	KeySet * ks = ksNew (5, keyNew ("user/builder/a", KEY_VALUE, "replaced", KEY_END), keyNew ("user/builder/d", KEY_END), KS_END);
+	succeed_if (elektraKsBuilderBuild (builder, ks) == 5, "wrong size after build");
+	succeed_if (keyGetRef (first) == 1, "overwritten key still referenced");
+	succeed_if_same_string (keyString (ksLookupByName (ks, "user/builder/b", 0)), "last");
+	succeed_if_same_string (keyString (ksLookupByName (ks, "user/builder/a", 0)), "");
+	succeed_if (ksLookupByName (ks, "system/builder/a", 0) != 0, "key not built");
+	succeed_if (keyGetRef (ksLookupByName (ks, "user/builder/c", 0)) == 1, "builder still references key");
+
+	// the builder can be reused
+	succeed_if (elektraKsBuilderBuild (builder, ks) == 5, "empty builder changed keyset");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("user/builder/e", KEY_END)) == 1, "wrong number of keys");
+	succeed_if (elektraKsBuilderAdd (builder, keyNew ("user/builder/f", KEY_END)) == 2, "wrong number of keys");
+	succeed_if (elektraKsBuilderBuild (builder, ks) == 7, "wrong size after second build");
+
+	// keys not built are deleted with the builder
+	succeed_if (elektraKsBuilderAdd (builder, first) == 1, "wrong number of keys");
+	succeed_if (elektraKsBuilderBuild (0, ks) == -1, "no error on NULL builder");
+	succeed_if (elektraKsBuilderBuild (builder, 0) == -1, "no error on NULL keyset");
+	elektraKsBuilderDel (builder);
+	succeed_if (keyGetRef (first) == 1, "deleted builder still references key");
+
+	keyDecRef (first);
+	keyDel (first);
+	ksDel (ks);
+}
+
 static void test_keyAsCascading (void)
 {
 	printf ("test keyAsCascading\n");
@@ -232,6 +321,8 @@ int main (int argc, char ** argv)
 
 	test_ksPopAtCursor ();
 	test_ksToArray ();
+	test_ksLookupMany ();
+	test_ksBuilder ();
 
 	test_keyAsCascading ();
 	test_keyGetLevelsBelow ();
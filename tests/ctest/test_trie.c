@@ -786,6 +786,107 @@ static void test_emptyvalues (void)
 }
 
 
+static void check_router (Trie * trie, KeySet * ks)
+{
+	TrieRouter * router = trieRouterNew (trie);
+	exit_if_fail (router, "could not create router");
+	succeed_if (trieRouterGetTrie (router) == trie, "wrong trie");
+
+	// in order
+	Key * cur;
+	ksRewind (ks);
+	while ((cur = ksNext (ks)) != 0)
+	{
+		succeed_if (trieRouterLookup (router, cur) == trieLookup (trie, cur), "routed to wrong backend");
+	}
+
+	// reverse order
+	for (cursor_t i = ksGetSize (ks); i > 0; --i)
+	{
+		cur = ksAtCursor (ks, i - 1);
+		succeed_if (trieRouterLookup (router, cur) == trieLookup (trie, cur), "routed to wrong backend in reverse order");
+	}
+
+	// jumping around
+	for (cursor_t i = 0; i < ksGetSize (ks); ++i)
+	{
+		cur = ksAtCursor (ks, (i * 7) % ksGetSize (ks));
+		succeed_if (trieRouterLookup (router, cur) == trieLookup (trie, cur), "routed to wrong backend in random order");
+	}
+
+	trieRouterDel (router);
+}
+
+static void test_router (void)
+{
+	printf ("Test router\n");
+
+	Trie * trie = 0;
+	trie = test_insert (trie, "user/tests/router/a/", "a");
+	trie = test_insert (trie, "", "root");
+	trie = test_insert (trie, "system/elektra/", "default");
+	trie = test_insert (trie, "spec/", "spec");
+	trie = test_insert (trie, "user/", "user");
+	trie = test_insert (trie, "user/tests/router/a/b/c/", "c");
+	trie = test_insert (trie, "user/tests/router/ab/", "ab");
+	trie = test_insert (trie, "user/tests/router/a/b/", "b");
+	trie = test_insert (trie, "user/tests/router/z/", "z");
+	trie = test_insert (trie, "user/tests/router/\\/", "backslash");
+	trie = test_insert (trie, "user/tests/router/\\/x\\/y/", "escaped");
+	trie = test_insert (trie, "user/tests/router/\303\244/", "umlaut");
+	trie = test_insert (trie, "system/tests/router/a/", "system a");
+	// the backend inserted last wins
+	trie = test_insert (trie, "user/tests/router/z/", "z2");
+
+	KeySet * ks = ksNew (50, keyNew ("/tests/router/a", KEY_END), keyNew ("spec", KEY_END), keyNew ("spec/tests/router/a", KEY_END),
+			     keyNew ("dir/tests/router/a", KEY_END), keyNew ("user", KEY_END), keyNew ("user/tests", KEY_END),
+			     keyNew ("user/tests/router", KEY_END), keyNew ("user/tests/router/a", KEY_END),
+			     keyNew ("user/tests/router/a/a", KEY_END), keyNew ("user/tests/router/a/b", KEY_END),
+			     keyNew ("user/tests/router/a/b/b", KEY_END), keyNew ("user/tests/router/a/b/c", KEY_END),
+			     keyNew ("user/tests/router/a/b/c/d/e", KEY_END), keyNew ("user/tests/router/a/b/d", KEY_END),
+			     keyNew ("user/tests/router/a/ba", KEY_END), keyNew ("user/tests/router/a/c", KEY_END),
+			     keyNew ("user/tests/router/a\\/b", KEY_END), keyNew ("user/tests/router/a#", KEY_END),
+			     keyNew ("user/tests/router/aa", KEY_END), keyNew ("user/tests/router/ab", KEY_END),
+			     keyNew ("user/tests/router/ab/c", KEY_END), keyNew ("user/tests/router/b", KEY_END),
+			     keyNew ("user/tests/router/z", KEY_END), keyNew ("user/tests/router/z/z", KEY_END),
+			     keyNew ("user/tests/router/\\", KEY_END), keyNew ("user/tests/router/\\/x", KEY_END),
+			     keyNew ("user/tests/router/\\/x\\/y", KEY_END), keyNew ("user/tests/router/\\/x\\/y/z", KEY_END),
+			     keyNew ("user/tests/router/\\/x/y", KEY_END), keyNew ("user/tests/router/\\\\", KEY_END),
+			     keyNew ("user/tests/router/\303\244", KEY_END), keyNew ("user/tests/router/\303\244/x", KEY_END),
+			     keyNew ("user/tests/router/\303\245", KEY_END), keyNew ("user:owner/tests/router/a/b", KEY_END),
+			     keyNew ("system", KEY_END), keyNew ("system/elektra", KEY_END), keyNew ("system/elektra/modules", KEY_END),
+			     keyNew ("system/elektraa", KEY_END), keyNew ("system/tests/router/a", KEY_END),
+			     keyNew ("system/tests/router/a/b/c", KEY_END), keyNew ("system/tests/router/b", KEY_END), KS_END);
+
+	Key * key = keyNew ("user/tests/router/z/z", KEY_END);
+	TrieRouter * router = trieRouterNew (trie);
+	succeed_if_same_string (keyString (trieRouterLookup (router, key)->mountpoint), "z2");
+	keySetName (key, "user/tests/router/a/b/c/d/e");
+	succeed_if_same_string (keyString (trieRouterLookup (router, key)->mountpoint), "c");
+	keySetName (key, "user/tests/router/a/b/d");
+	succeed_if_same_string (keyString (trieRouterLookup (router, key)->mountpoint), "b");
+	keySetName (key, "user/tests/router/aa");
+	succeed_if_same_string (keyString (trieRouterLookup (router, key)->mountpoint), "user");
+	keySetName (key, "dir/tests/router/a");
+	succeed_if_same_string (keyString (trieRouterLookup (router, key)->mountpoint), "root");
+	trieRouterDel (router);
+	keyDel (key);
+
+	check_router (trie, ks);
+	trieClose (trie, 0);
+
+	// names not ending with a slash are routed by the trie
+	trie = test_insert (0, "user/tests/router/a", "a");
+	trie = test_insert (trie, "user/tests/router/b/", "b");
+	check_router (trie, ks);
+	trieClose (trie, 0);
+
+	// an empty trie
+	check_router (0, ks);
+
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("TRIE       TESTS\n");
@@ -804,6 +905,7 @@ int main (int argc, char ** argv)
 	test_root ();
 	test_double ();
 	test_emptyvalues ();
+	test_router ();
 
 	printf ("\ntest_trie RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
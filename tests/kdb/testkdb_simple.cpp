@@ -9,6 +9,11 @@
 
 #include <keysetio.hpp>
 
+#include <algorithm>
+#include <vector>
+
+#include <kdbproposal.h>
+
 #include <gtest/gtest-elektra.h>
 
 
@@ -504,3 +509,114 @@ TEST_F (Simple, TriggerError)
 	EXPECT_EQ (ks.current ().getName (), "system" + testRoot + "k") << "ks should point to error key";
 	ASSERT_EQ (stat (mp->systemConfigFile.c_str (), &buf), -1) << "created file even though error triggered";
 }
+
+TEST_F (Simple, GetDelta)
+{
+	using namespace ckdb;
+	Key * parentKey = keyNew (("system" + testRoot).c_str (), KEY_END);
+	KDB * handle = kdbOpen (parentKey);
+	KeySet * ks = ksNew (0, KS_END);
+	KeySet * added = ksNew (0, KS_END);
+	KeySet * removed = ksNew (0, KS_END);
+	KeySet * modified = ksNew (0, KS_END);
+	EXPECT_EQ (kdbGetDelta (handle, ks, parentKey, added, removed, modified), 0) << "nothing to do in get";
+
+	{
+		kdb::KDB kdb;
+		kdb::KeySet write;
+		kdb.get (write, testRoot);
+		write.append (kdb::Key ("system" + testRoot + "changed", KEY_VALUE, "old", KEY_END));
+		write.append (kdb::Key ("system" + testRoot + "removed", KEY_END));
+		write.append (kdb::Key ("system" + testRoot + "unchanged", KEY_VALUE, "same", KEY_META, "meta", "same", KEY_END));
+		kdb.set (write, testRoot);
+	}
+
+	EXPECT_EQ (kdbGetDelta (handle, ks, parentKey, added, removed, modified), 1) << "could not get changes";
+	EXPECT_EQ (ksGetSize (ks), 3) << "wrong size";
+	EXPECT_EQ (ksGetSize (added), 3) << "all keys should be added";
+	EXPECT_EQ (ksGetSize (removed), 0) << "keys removed";
+	EXPECT_EQ (ksGetSize (modified), 0) << "keys modified";
+	Key * unchanged = ksLookupByName (ks, ("system" + testRoot + "unchanged").c_str (), 0);
+	ASSERT_TRUE (unchanged);
+	ksClear (added);
+
+	{
+		kdb::KDB kdb;
+		kdb::KeySet write;
+		kdb.get (write, testRoot);
+		write.lookup ("system" + testRoot + "changed").setString ("new");
+		write.lookup ("system" + testRoot + "removed", KDB_O_POP);
+		write.append (kdb::Key ("system" + testRoot + "added", KEY_END));
+		kdb.set (write, testRoot);
+	}
+
+	EXPECT_EQ (kdbGetDelta (handle, ks, parentKey, added, removed, modified), 1) << "could not get changes";
+	EXPECT_EQ (ksGetSize (ks), 3) << "wrong size";
+	ASSERT_EQ (ksGetSize (added), 1) << "wrong number of added keys";
+	EXPECT_STREQ (keyName (ksHead (added)), ("system" + testRoot + "added").c_str ());
+	ASSERT_EQ (ksGetSize (removed), 1) << "wrong number of removed keys";
+	EXPECT_STREQ (keyName (ksHead (removed)), ("system" + testRoot + "removed").c_str ());
+	ASSERT_EQ (ksGetSize (modified), 1) << "wrong number of modified keys";
+	EXPECT_STREQ (keyString (ksHead (modified)), "new");
+	EXPECT_EQ (ksLookup (ks, ksHead (modified), 0), ksHead (modified)) << "modified key not in keyset";
+	EXPECT_EQ (ksLookupByName (ks, ("system" + testRoot + "unchanged").c_str (), 0), unchanged) << "unchanged key was replaced";
+
+	ksDel (modified);
+	ksDel (removed);
+	ksDel (added);
+	ksDel (ks);
+	kdbClose (handle, parentKey);
+	keyDel (parentKey);
+}
+
+static void countTraceEvents (const ckdb::ElektraTraceEvent * event, void * data)
+{
+	std::vector<std::string> * phases = static_cast<std::vector<std::string> *> (data);
+	phases->push_back (event->phase);
+}
+
+TEST_F (Simple, Trace)
+{
+	using namespace ckdb;
+	Key * parentKey = keyNew (("system" + testRoot).c_str (), KEY_META, "trace", "", KEY_END);
+	KDB * handle = kdbOpen (parentKey);
+	KeySet * ks = ksNew (1, keyNew (("system" + testRoot + "key").c_str (), KEY_VALUE, "value", KEY_END), KS_END);
+
+	EXPECT_EQ (kdbGet (handle, ks, parentKey), 0) << "nothing to do in get";
+	ASSERT_TRUE (keyGetMeta (parentKey, "trace/#0/phase")) << "no trace written";
+	EXPECT_EQ (kdbSet (handle, ks, parentKey), 1) << "could not set keys";
+
+	// the last event is the whole call
+	std::string last;
+	for (int i = 0; keyGetMeta (parentKey, ("trace/#" + std::to_string (i) + "/phase").c_str ()); ++i)
+	{
+		last = "trace/#" + std::to_string (i);
+		ASSERT_TRUE (keyGetMeta (parentKey, (last + "/duration").c_str ())) << "event without duration";
+	}
+	EXPECT_STREQ (keyString (keyGetMeta (parentKey, (last + "/phase").c_str ())), "set");
+	EXPECT_STREQ (keyString (keyGetMeta (parentKey, (last + "/keys").c_str ())), "1");
+	EXPECT_STREQ (keyString (keyGetMeta (parentKey, (last + "/start").c_str ())), "0");
+
+	// a fresh handle needs to read the file written above
+	kdbClose (handle, parentKey);
+	keyDel (parentKey);
+	parentKey = keyNew (("system" + testRoot).c_str (), KEY_END);
+	handle = kdbOpen (parentKey);
+	std::vector<std::string> phases;
+	EXPECT_EQ (elektraTraceSetCallback (handle, countTraceEvents, &phases), 0);
+	EXPECT_EQ (kdbGet (handle, ks, parentKey), 1) << "could not get keys";
+	EXPECT_FALSE (keyGetMeta (parentKey, "trace/#0/phase")) << "trace written without metakey trace";
+	ASSERT_FALSE (phases.empty ()) << "callback not called";
+	EXPECT_NE (std::find (phases.begin (), phases.end (), "resolver"), phases.end ()) << "resolver not traced";
+	EXPECT_NE (std::find (phases.begin (), phases.end (), "getstorage"), phases.end ()) << "storage not traced";
+	EXPECT_EQ (phases.back (), "get");
+
+	EXPECT_EQ (elektraTraceSetCallback (handle, 0, 0), 0);
+	phases.clear ();
+	kdbGet (handle, ks, parentKey);
+	EXPECT_TRUE (phases.empty ()) << "callback called after removing it";
+
+	ksDel (ks);
+	kdbClose (handle, parentKey);
+	keyDel (parentKey);
+}